@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-packet client lookup cost against the number of clients
+ *
+ * Builds the client tables of af_client.c on the host and times random
+ * lookups of existing clients:
+ * - by IPv4 address, walking every bucket as find_af_client_by_ip() did
+ *   before the address index, and through af_client_ip_table now;
+ * - by MAC, hashed by mac[5] as before and by jhash of the full address.
+ *
+ * The old lookups ran under af_client_lock, the new ones under RCU, so
+ * the lock cost comes on top of the walk for the old numbers.
+ *
+ * Usage: client-lookup-bench [lookups]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_AF_CLIENT_HASH_SIZE 256
+#define ETH_ALEN 6
+
+typedef uint32_t u32;
+
+/* jhash() and jhash_1word() from include/linux/jhash.h */
+#define JHASH_INITVAL 0xdeadbeef
+
+static inline u32 rol32(u32 word, unsigned int shift)
+{
+	return (word << shift) | (word >> ((-shift) & 31));
+}
+
+#define __jhash_mix(a, b, c)			\
+{						\
+	a -= c;  a ^= rol32(c, 4);  c += b;	\
+	b -= a;  b ^= rol32(a, 6);  a += c;	\
+	c -= b;  c ^= rol32(b, 8);  b += a;	\
+	a -= c;  a ^= rol32(c, 16); c += b;	\
+	b -= a;  b ^= rol32(a, 19); a += c;	\
+	c -= b;  c ^= rol32(b, 4);  b += a;	\
+}
+
+#define __jhash_final(a, b, c)			\
+{						\
+	c ^= b; c -= rol32(b, 14);		\
+	a ^= c; a -= rol32(c, 11);		\
+	b ^= a; b -= rol32(a, 25);		\
+	c ^= b; c -= rol32(b, 16);		\
+	a ^= c; a -= rol32(c, 4);		\
+	b ^= a; b -= rol32(a, 14);		\
+	c ^= b; c -= rol32(b, 24);		\
+}
+
+static u32 jhash(const void *key, u32 length, u32 initval)
+{
+	const unsigned char *k = key;
+	u32 a, b, c;
+
+	a = b = c = JHASH_INITVAL + length + initval;
+
+	while (length > 12) {
+		a += k[0] + ((u32)k[1] << 8) + ((u32)k[2] << 16) + ((u32)k[3] << 24);
+		b += k[4] + ((u32)k[5] << 8) + ((u32)k[6] << 16) + ((u32)k[7] << 24);
+		c += k[8] + ((u32)k[9] << 8) + ((u32)k[10] << 16) + ((u32)k[11] << 24);
+		__jhash_mix(a, b, c);
+		length -= 12;
+		k += 12;
+	}
+	switch (length) {
+	case 12: c += (u32)k[11] << 24; /* fall through */
+	case 11: c += (u32)k[10] << 16; /* fall through */
+	case 10: c += (u32)k[9] << 8;   /* fall through */
+	case 9:  c += k[8];             /* fall through */
+	case 8:  b += (u32)k[7] << 24;  /* fall through */
+	case 7:  b += (u32)k[6] << 16;  /* fall through */
+	case 6:  b += (u32)k[5] << 8;   /* fall through */
+	case 5:  b += k[4];             /* fall through */
+	case 4:  a += (u32)k[3] << 24;  /* fall through */
+	case 3:  a += (u32)k[2] << 16;  /* fall through */
+	case 2:  a += (u32)k[1] << 8;   /* fall through */
+	case 1:  a += k[0];
+		 __jhash_final(a, b, c);
+		 break;
+	case 0:
+		break;
+	}
+
+	return c;
+}
+
+static u32 jhash_1word(u32 a, u32 initval)
+{
+	u32 b, c;
+
+	a += JHASH_INITVAL + (1 << 2) + initval;
+	b = c = JHASH_INITVAL + (1 << 2) + initval;
+	c += initval;
+	__jhash_final(a, b, c);
+
+	return c;
+}
+
+/* the fields of af_client_info the lookups touch, in list order */
+struct client {
+	struct client *mac_next;	/* full MAC hash bucket */
+	struct client *old_next;	/* mac[5] hash bucket */
+	struct client *ip_next;		/* af_client_ip_table bucket */
+	unsigned char mac[ETH_ALEN];
+	unsigned int ip;
+	char pad[200];			/* app_table and counters */
+};
+
+static struct client *mac_table[MAX_AF_CLIENT_HASH_SIZE];
+static struct client *old_table[MAX_AF_CLIENT_HASH_SIZE];
+static struct client *ip_table[MAX_AF_CLIENT_HASH_SIZE];
+
+static int mac_hash(const unsigned char *mac)
+{
+	return jhash(mac, ETH_ALEN, 0) & (MAX_AF_CLIENT_HASH_SIZE - 1);
+}
+
+static int old_mac_hash(const unsigned char *mac)
+{
+	return mac[5] & (MAX_AF_CLIENT_HASH_SIZE - 1);
+}
+
+static int ip_hash(unsigned int ip)
+{
+	return jhash_1word(ip, 0) & (MAX_AF_CLIENT_HASH_SIZE - 1);
+}
+
+static struct client *old_find_by_ip(unsigned int ip)
+{
+	struct client *node;
+	int i;
+
+	for (i = 0; i < MAX_AF_CLIENT_HASH_SIZE; i++)
+		for (node = old_table[i]; node; node = node->old_next)
+			if (node->ip == ip)
+				return node;
+	return NULL;
+}
+
+static struct client *find_by_ip(unsigned int ip)
+{
+	struct client *node;
+
+	for (node = ip_table[ip_hash(ip)]; node; node = node->ip_next)
+		if (node->ip == ip)
+			return node;
+	return NULL;
+}
+
+static struct client *old_find(const unsigned char *mac)
+{
+	struct client *node;
+
+	for (node = old_table[old_mac_hash(mac)]; node; node = node->old_next)
+		if (!memcmp(node->mac, mac, ETH_ALEN))
+			return node;
+	return NULL;
+}
+
+static struct client *find(const unsigned char *mac)
+{
+	struct client *node;
+
+	for (node = mac_table[mac_hash(mac)]; node; node = node->mac_next)
+		if (!memcmp(node->mac, mac, ETH_ALEN))
+			return node;
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ns per lookup of keys[i % count], checking every result */
+#define TIME_LOOKUPS(expr)						\
+({									\
+	double start = now();						\
+	long i;								\
+	for (i = 0; i < lookups; i++) {					\
+		struct client *c = clients[order[i % count]];		\
+		if ((expr) != c) {					\
+			fprintf(stderr, "lookup %ld missed\n", i);	\
+			exit(1);					\
+		}							\
+	}								\
+	(now() - start) * 1e9 / lookups;				\
+})
+
+int main(int argc, char **argv)
+{
+	static const int counts[] = { 16, 64, 256, 512, 1024, 4096 };
+	long lookups = argc > 1 ? atol(argv[1]) : 2000000;
+	unsigned int k;
+
+	srand(1);
+	printf("%7s %14s %14s %14s %14s\n", "clients", "ip walk ns",
+	       "ip index ns", "mac[5] ns", "mac jhash ns");
+
+	for (k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+		int count = counts[k], i, b;
+		struct client **clients = calloc(count, sizeof(*clients));
+		int *order = calloc(count, sizeof(*order));
+		double t_walk, t_ip, t_old, t_mac;
+
+		if (!clients || !order)
+			return 1;
+		memset(mac_table, 0, sizeof(mac_table));
+		memset(old_table, 0, sizeof(old_table));
+		memset(ip_table, 0, sizeof(ip_table));
+
+		for (i = 0; i < count; i++) {
+			struct client *c = calloc(1, sizeof(*c));
+
+			if (!c)
+				return 1;
+			/* one vendor OUI, sequential LAN addresses */
+			c->mac[0] = 0x00;
+			c->mac[1] = 0x11;
+			c->mac[2] = 0x32;
+			c->mac[3] = rand();
+			c->mac[4] = rand();
+			c->mac[5] = rand();
+			c->ip = 0xc0a80000 + 2 + i;
+
+			b = mac_hash(c->mac);
+			c->mac_next = mac_table[b];
+			mac_table[b] = c;
+			b = old_mac_hash(c->mac);
+			c->old_next = old_table[b];
+			old_table[b] = c;
+			b = ip_hash(c->ip);
+			c->ip_next = ip_table[b];
+			ip_table[b] = c;
+
+			clients[i] = c;
+			order[i] = i;
+		}
+		for (i = count - 1; i > 0; i--) {
+			int j = rand() % (i + 1), t = order[i];
+
+			order[i] = order[j];
+			order[j] = t;
+		}
+
+		t_walk = TIME_LOOKUPS(old_find_by_ip(c->ip));
+		t_ip = TIME_LOOKUPS(find_by_ip(c->ip));
+		t_old = TIME_LOOKUPS(old_find(c->mac));
+		t_mac = TIME_LOOKUPS(find(c->mac));
+		printf("%7d %14.1f %14.1f %14.1f %14.1f\n",
+		       count, t_walk, t_ip, t_old, t_mac);
+
+		for (i = 0; i < count; i++)
+			free(clients[i]);
+		free(clients);
+		free(order);
+	}
+
+	return 0;
+}
@@ -17,6 +17,8 @@
 #include <linux/cdev.h>
 #include <linux/device.h>
 #include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/jhash.h>
 
 #include "af_client.h"
 #include "af_client_fs.h"
@@ -29,9 +31,53 @@ DEFINE_RWLOCK(af_client_lock);
 
 u32 total_client = 0;
 struct list_head af_client_list_table[MAX_AF_CLIENT_HASH_SIZE];
+static struct hlist_head af_client_ip_table[MAX_AF_CLIENT_HASH_SIZE];
+
+/* classified conntracks whose traffic is credited to a client app */
+typedef struct af_acct_flow
+{
+	struct list_head list;
+	struct nf_conn *ct;
+	unsigned char mac[MAC_ADDR_LEN];
+	unsigned int app_id;
+	u64 bytes[IP_CT_DIR_MAX];
+	u64 pkts[IP_CT_DIR_MAX];
+} af_acct_flow_t;
+
+/* seconds af_client_acct_update() takes to visit every flow */
+#define AF_ACCT_PERIOD 60
+
+static LIST_HEAD(af_acct_flow_list);
+static DEFINE_SPINLOCK(af_acct_lock);
+static int af_acct_flow_num = 0;
 
 int af_send_msg_to_user(char *pbuf, uint16_t len);
 
+static void af_client_free_apps(af_client_info_t *node)
+{
+	app_visit_info_t *app;
+	struct hlist_node *n;
+	int i;
+
+	for (i = 0; i < AF_APP_HASH_SIZE; i++)
+	{
+		hlist_for_each_entry_safe(app, n, &node->app_table[i], hlist)
+		{
+			hlist_del(&app->hlist);
+			kfree(app);
+		}
+	}
+	node->visit_app_num = 0;
+}
+
+static void af_client_free_rcu(struct rcu_head *head)
+{
+	af_client_info_t *node = container_of(head, af_client_info_t, rcu);
+
+	af_client_free_apps(node);
+	kfree(node);
+}
+
 static void
 nf_client_list_init(void)
 {
@@ -40,6 +86,7 @@ nf_client_list_init(void)
 	for (i = 0; i < MAX_AF_CLIENT_HASH_SIZE; i++)
 	{
 		INIT_LIST_HEAD(&af_client_list_table[i]);
+		INIT_HLIST_HEAD(&af_client_ip_table[i]);
 	}
 	AF_CLIENT_UNLOCK_W();
 	AF_INFO("client list init......ok\n");
@@ -63,8 +110,10 @@ nf_client_list_clear(void)
 			sprintf(mac_str, MAC_FMT, MAC_ARRAY(p->mac));
 			AF_DEBUG("clean mac:%s\n", mac_str);
 			list_del(&(p->hlist));
+			af_client_free_apps(p);
 			kfree(p);
 		}
+		INIT_HLIST_HEAD(&af_client_ip_table[i]);
 	}
 	AF_CLIENT_UNLOCK_W();
 }
@@ -89,18 +138,24 @@ int get_mac_hash_code(unsigned char *mac)
 	if (!mac)
 		return 0;
 	else
-		return mac[5] & (MAX_AF_CLIENT_HASH_SIZE - 1);
+		return jhash(mac, ETH_ALEN, 0) & (MAX_AF_CLIENT_HASH_SIZE - 1);
 }
 
+static inline int get_ip_hash_code(unsigned int ip)
+{
+	return jhash_1word(ip, 0) & (MAX_AF_CLIENT_HASH_SIZE - 1);
+}
+
+/* caller holds af_client_lock or rcu_read_lock() */
 af_client_info_t *find_af_client(unsigned char *mac)
 {
 	af_client_info_t *node;
 	unsigned int index;
 
 	index = get_mac_hash_code(mac);
-	list_for_each_entry(node, &af_client_list_table[index], hlist)
+	list_for_each_entry_rcu(node, &af_client_list_table[index], hlist)
 	{
-		if (0 == memcmp(node->mac, mac, 6))
+		if (ether_addr_equal(node->mac, mac))
 		{
 			return node;
 		}
@@ -119,25 +174,38 @@ af_client_info_t *find_and_add_af_client(unsigned char *mac)
 }	
 
 
+/* caller holds af_client_lock or rcu_read_lock() */
 af_client_info_t *find_af_client_by_ip(unsigned int ip)
 {
 	af_client_info_t *node;
-	int i;
+	unsigned int index;
 
-	for (i = 0; i < MAX_AF_CLIENT_HASH_SIZE; i++)
+	index = get_ip_hash_code(ip);
+	hlist_for_each_entry_rcu(node, &af_client_ip_table[index], ip_hlist)
 	{
-		list_for_each_entry(node, &af_client_list_table[i], hlist)
+		if (node->ip == ip)
 		{
-			if (node->ip == ip)
-			{
-				AF_LMT_DEBUG("match node->ip=%pI4, ip=%pI4\n", &node->ip, &ip);
-				return node;
-			}
+			AF_LMT_DEBUG("match node->ip=%pI4, ip=%pI4\n", &node->ip, &ip);
+			return node;
 		}
 	}
 	return NULL;
 }
 
+/*
+ * Move a client to the bucket of its new address, called with af_client_lock
+ * held for writing. A reader walking the old bucket may follow the node into
+ * the new one, hlist is NULL terminated so it only misses that one lookup.
+ */
+static void nf_client_set_ip(af_client_info_t *node, unsigned int ip)
+{
+	if (node->ip)
+		hlist_del_init_rcu(&node->ip_hlist);
+	node->ip = ip;
+	if (ip)
+		hlist_add_head_rcu(&node->ip_hlist, &af_client_ip_table[get_ip_hash_code(ip)]);
+}
+
 af_client_info_t *
 nf_client_add(unsigned char *mac)
 {
@@ -160,10 +228,40 @@ nf_client_add(unsigned char *mac)
 
 	AF_LMT_INFO("new client mac=" MAC_FMT "\n", MAC_ARRAY(node->mac));
 	total_client++;
-	list_add(&(node->hlist), &af_client_list_table[index]);
+	list_add_rcu(&(node->hlist), &af_client_list_table[index]);
 	return node;
 }
 
+/*
+ * Look up the client sending from mac/ip and refresh it. The common case of
+ * a known client with an unchanged address is lock free and only writes
+ * update_jiffies once per tick, af_client_lock is taken for new clients and
+ * address changes. Must be called under rcu_read_lock(), as netfilter hooks
+ * are.
+ */
+af_client_info_t *find_and_update_af_client(unsigned char *mac, unsigned int ip)
+{
+	af_client_info_t *nfc;
+
+	nfc = find_af_client(mac);
+	if (!nfc || (ip && nfc->ip != ip))
+	{
+		AF_CLIENT_LOCK_W();
+		nfc = find_and_add_af_client(mac);
+		if (nfc && ip && nfc->ip != ip)
+		{
+			AF_DEBUG("update node " MAC_FMT " ip %pI4--->%pI4\n", MAC_ARRAY(nfc->mac), &nfc->ip, &ip);
+			nf_client_set_ip(nfc, ip);
+		}
+		AF_CLIENT_UNLOCK_W();
+		if (!nfc)
+			return NULL;
+	}
+	if (READ_ONCE(nfc->update_jiffies) != jiffies)
+		WRITE_ONCE(nfc->update_jiffies, jiffies);
+	return nfc;
+}
+
 
 
 
@@ -181,8 +279,11 @@ void check_client_expire(void)
 			if (jiffies > (node->update_jiffies + MAX_CLIENT_ACTIVE_TIME * HZ))
 			{
 				AF_INFO("del client:" MAC_FMT "\n", MAC_ARRAY(node->mac));
-				list_del(&(node->hlist));
-				kfree(node);
+				list_del_rcu(&(node->hlist));
+				if (node->ip)
+					hlist_del_rcu(&node->ip_hlist);
+				/* lookups done before the unlink may still update the apps */
+				call_rcu(&node->rcu, af_client_free_rcu);
 				AF_CLIENT_UNLOCK_W();
 				return;
 			}
@@ -191,94 +292,315 @@ void check_client_expire(void)
 	AF_CLIENT_UNLOCK_W();
 }
 
-#define MAX_EXPIRED_VISIT_INFO_COUNT 10
-void flush_expired_visit_info(af_client_info_t *node)
+static inline int get_app_hash_code(unsigned int app_id)
 {
+	return app_id % AF_APP_HASH_SIZE;
+}
+
+/*
+ * Find the record of app_id, optionally creating it. When the client already
+ * has MAX_RECORD_APP_NUM apps the least recently seen one is recycled.
+ * Called with af_client_lock held for writing.
+ */
+app_visit_info_t *af_client_find_app(af_client_info_t *node, unsigned int app_id, int add)
+{
+	app_visit_info_t *app, *oldest = NULL;
 	int i;
-	int count = 0;
-	u_int32_t cur_timep = 0;
-	int timeout = 0;
-	cur_timep = af_get_timestamp_sec();
-	for (i = 0; i < MAX_RECORD_APP_NUM; i++)
+
+	hlist_for_each_entry(app, &node->app_table[get_app_hash_code(app_id)], hlist)
 	{
-		if (node->visit_info[i].app_id == 0)
+		if (app->app_id == app_id)
+			return app;
+	}
+	if (!add)
+		return NULL;
+
+	if (node->visit_app_num >= MAX_RECORD_APP_NUM)
+	{
+		for (i = 0; i < AF_APP_HASH_SIZE; i++)
 		{
-			return;
+			hlist_for_each_entry(app, &node->app_table[i], hlist)
+			{
+				if (!oldest || time_before(app->latest_time, oldest->latest_time))
+					oldest = app;
+			}
 		}
+		if (!oldest)
+			return NULL;
+		hlist_del(&oldest->hlist);
+		memset(oldest, 0x0, sizeof(app_visit_info_t));
+		app = oldest;
 	}
-	for (i = 0; i < MAX_RECORD_APP_NUM; i++)
+	else
 	{
-		if (count >= MAX_EXPIRED_VISIT_INFO_COUNT)
-			break;
+		app = kzalloc(sizeof(app_visit_info_t), GFP_ATOMIC);
+		if (!app)
+			return NULL;
+		node->visit_app_num++;
+	}
+	app->app_id = app_id;
+	app->latest_time = af_get_timestamp_sec();
+	hlist_add_head(&app->hlist, &node->app_table[get_app_hash_code(app_id)]);
+	return app;
+}
 
-		if (node->visit_info[i].total_num > 3)
-		{
-			timeout = 180;
-		}
-		else
+static void af_app_add_traffic(app_visit_info_t *app, u64 up_bytes, u64 down_bytes,
+							   u64 up_pkts, u64 down_pkts)
+{
+	u32 minute = af_get_timestamp_sec() / 60;
+	app_stat_bucket_t *bucket = &app->bucket[minute % AF_APP_STAT_MINUTES];
+
+	if (bucket->minute != minute)
+	{
+		bucket->minute = minute;
+		bucket->up_bytes = 0;
+		bucket->down_bytes = 0;
+	}
+	bucket->up_bytes += up_bytes;
+	bucket->down_bytes += down_bytes;
+	app->up_bytes += up_bytes;
+	app->down_bytes += down_bytes;
+	app->up_pkts += up_pkts;
+	app->down_pkts += down_pkts;
+	/* flows classified long ago still keep the app from expiring */
+	if (up_pkts || down_pkts)
+		app->latest_time = af_get_timestamp_sec();
+}
+
+/* drop app records whose whole time series has aged out */
+void flush_expired_visit_info(af_client_info_t *node)
+{
+	app_visit_info_t *app;
+	struct hlist_node *n;
+	u_int32_t cur_timep = af_get_timestamp_sec();
+	int i;
+
+	for (i = 0; i < AF_APP_HASH_SIZE; i++)
+	{
+		hlist_for_each_entry_safe(app, n, &node->app_table[i], hlist)
 		{
-			timeout = 60;
+			if (cur_timep - app->latest_time <= AF_APP_STAT_MINUTES * 60)
+				continue;
+			hlist_del(&app->hlist);
+			kfree(app);
+			node->visit_app_num--;
 		}
+	}
+}
 
-		if (cur_timep - node->visit_info[i].latest_time > timeout)
+/*
+ * Start crediting the traffic of a freshly classified conntrack to the app of
+ * the client with the given mac. A reference to the conntrack is kept until
+ * it dies, af_client_acct_update() then collects the final counters.
+ */
+int af_client_acct_flow(struct nf_conn *ct, unsigned char *mac, unsigned int app_id)
+{
+	af_acct_flow_t *flow;
+
+	if (!nf_conn_acct_find(ct))
+		return -1;
+
+	flow = kzalloc(sizeof(af_acct_flow_t), GFP_ATOMIC);
+	if (!flow)
+		return -1;
+
+	spin_lock(&af_acct_lock);
+	if (af_acct_flow_num >= MAX_AF_ACCT_FLOWS)
+	{
+		spin_unlock(&af_acct_lock);
+		kfree(flow);
+		return -1;
+	}
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+	flow->app_id = app_id;
+	memcpy(flow->mac, mac, MAC_ADDR_LEN);
+	list_add_tail(&flow->list, &af_acct_flow_list);
+	af_acct_flow_num++;
+	spin_unlock(&af_acct_lock);
+	return 0;
+}
+
+static void af_acct_flow_collect(af_acct_flow_t *flow)
+{
+	struct nf_conn_acct *acct = nf_conn_acct_find(flow->ct);
+	af_client_info_t *node;
+	app_visit_info_t *app;
+	u64 bytes[IP_CT_DIR_MAX], pkts[IP_CT_DIR_MAX];
+	int dir;
+
+	if (!acct)
+		return;
+	for (dir = 0; dir < IP_CT_DIR_MAX; dir++)
+	{
+		bytes[dir] = atomic64_read(&acct->counter[dir].bytes);
+		pkts[dir] = atomic64_read(&acct->counter[dir].packets);
+	}
+
+	AF_CLIENT_LOCK_W();
+	node = find_af_client(flow->mac);
+	app = node ? af_client_find_app(node, flow->app_id, 1) : NULL;
+	if (app)
+		af_app_add_traffic(app,
+						   bytes[IP_CT_DIR_ORIGINAL] - flow->bytes[IP_CT_DIR_ORIGINAL],
+						   bytes[IP_CT_DIR_REPLY] - flow->bytes[IP_CT_DIR_REPLY],
+						   pkts[IP_CT_DIR_ORIGINAL] - flow->pkts[IP_CT_DIR_ORIGINAL],
+						   pkts[IP_CT_DIR_REPLY] - flow->pkts[IP_CT_DIR_REPLY]);
+	AF_CLIENT_UNLOCK_W();
+
+	memcpy(flow->bytes, bytes, sizeof(bytes));
+	memcpy(flow->pkts, pkts, sizeof(pkts));
+}
+
+/*
+ * Called every second from the oaf timer. Each call visits the next slice of
+ * the flows, sized so the whole list is covered once per AF_ACCT_PERIOD
+ * seconds: running conntracks are accounted and moved to the tail, dead ones
+ * are accounted a last time and released. With all set every flow is visited,
+ * used before an on demand report.
+ */
+void af_client_acct_update(int all)
+{
+	af_acct_flow_t *flow;
+	int budget;
+	int dying;
+
+	spin_lock(&af_acct_lock);
+	if (all)
+		budget = af_acct_flow_num;
+	else
+		budget = DIV_ROUND_UP(af_acct_flow_num, AF_ACCT_PERIOD);
+	while (budget-- > 0 && !list_empty(&af_acct_flow_list))
+	{
+		flow = list_first_entry(&af_acct_flow_list, af_acct_flow_t, list);
+		dying = nf_ct_is_dying(flow->ct);
+		af_acct_flow_collect(flow);
+		if (!dying)
 		{
-			// 3?��o?��??3y????
-			memset(&node->visit_info[i], 0x0, sizeof(app_visit_info_t));
-			count++;
+			list_move_tail(&flow->list, &af_acct_flow_list);
+			continue;
 		}
+		list_del(&flow->list);
+		nf_ct_put(flow->ct);
+		kfree(flow);
+		af_acct_flow_num--;
 	}
+	spin_unlock(&af_acct_lock);
 }
 
-int __af_visit_info_report(af_client_info_t *node)
+static void af_client_acct_clear(void)
+{
+	af_acct_flow_t *flow, *n;
+
+	spin_lock(&af_acct_lock);
+	list_for_each_entry_safe(flow, n, &af_acct_flow_list, list)
+	{
+		list_del(&flow->list);
+		nf_ct_put(flow->ct);
+		kfree(flow);
+	}
+	af_acct_flow_num = 0;
+	spin_unlock(&af_acct_lock);
+}
+
+/* keep the netlink messages below MAX_OAF_NL_MSG_LEN */
+#define AF_REPORT_APPS_PER_MSG 6
+
+static void af_visit_info_send(af_client_info_t *node, cJSON *visit_info_array)
 {
 	unsigned char mac_str[32] = {0};
 	unsigned char ip_str[32] = {0};
-	int i;
-	int count = 0;
 	char *out = NULL;
-	cJSON *visit_obj = NULL;
-	cJSON *visit_info_array = NULL;
 	cJSON *root_obj = NULL;
 
 	root_obj = cJSON_CreateObject();
 	if (!root_obj)
 	{
 		AF_ERROR("create json obj failed");
-		return 0;
+		cJSON_Delete(visit_info_array);
+		return;
 	}
 	sprintf(mac_str, MAC_FMT, MAC_ARRAY(node->mac));
 	sprintf(ip_str, "%pI4", &node->ip);
 	cJSON_AddStringToObject(root_obj, "mac", mac_str);
 	cJSON_AddStringToObject(root_obj, "ip", ip_str);
 	cJSON_AddNumberToObject(root_obj, "app_num", node->visit_app_num);
-	visit_info_array = cJSON_CreateArray();
-	for (i = 0; i < MAX_RECORD_APP_NUM; i++)
-	{
-		if (node->visit_info[i].app_id == 0)
-			continue;
-		count++;
-		visit_obj = cJSON_CreateObject();
-		cJSON_AddNumberToObject(visit_obj, "appid", node->visit_info[i].app_id);
-		cJSON_AddNumberToObject(visit_obj, "latest_action", node->visit_info[i].latest_action);
-		cJSON_AddNumberToObject(visit_obj, "up_bytes", node->visit_info[i].total_up_bytes);
-		cJSON_AddNumberToObject(visit_obj, "down_bytes", node->visit_info[i].total_down_bytes);
-		memset((char *)&node->visit_info[i], 0x0, sizeof(app_visit_info_t));
-		cJSON_AddItemToArray(visit_info_array, visit_obj);
-	}
-
 	cJSON_AddItemToObject(root_obj, "visit_info", visit_info_array);
 	out = cJSON_Print(root_obj);
-	if (!out)
-		return 0;
-	cJSON_Minify(out);
-	if (count > 0 || node->report_count == 0)
+	if (out)
 	{
+		cJSON_Minify(out);
 		AF_LMT_INFO("report:%s count=%d\n", out, node->report_count);
 		node->report_count++;
 		af_send_msg_to_user(out, strlen(out));
+		kfree(out);
 	}
 	cJSON_Delete(root_obj);
-	kfree(out);
+}
+
+/*
+ * Report the apps used since the last report, traffic is sent in KiB as the
+ * JSON numbers are ints. Large clients are split over several messages.
+ */
+int __af_visit_info_report(af_client_info_t *node)
+{
+	app_visit_info_t *app;
+	int i;
+	int count = 0;
+	int total = 0;
+	cJSON *visit_obj = NULL;
+	cJSON *visit_info_array = NULL;
+
+	for (i = 0; i < AF_APP_HASH_SIZE; i++)
+	{
+		hlist_for_each_entry(app, &node->app_table[i], hlist)
+		{
+			if (!app->total_num && !app->up_bytes && !app->down_bytes)
+				continue;
+			if (!visit_info_array)
+			{
+				visit_info_array = cJSON_CreateArray();
+				if (!visit_info_array)
+					return 0;
+			}
+			visit_obj = cJSON_CreateObject();
+			cJSON_AddNumberToObject(visit_obj, "appid", app->app_id);
+			cJSON_AddNumberToObject(visit_obj, "latest_action", app->latest_action);
+			cJSON_AddNumberToObject(visit_obj, "total_num", app->total_num);
+			cJSON_AddNumberToObject(visit_obj, "drop_num", app->drop_num);
+			cJSON_AddNumberToObject(visit_obj, "up_kb", app->up_bytes >> 10);
+			cJSON_AddNumberToObject(visit_obj, "down_kb", app->down_bytes >> 10);
+			cJSON_AddNumberToObject(visit_obj, "up_pkts", app->up_pkts);
+			cJSON_AddNumberToObject(visit_obj, "down_pkts", app->down_pkts);
+			cJSON_AddItemToArray(visit_info_array, visit_obj);
+			/* keep the sub-KiB remainder for the next report */
+			app->up_bytes &= 1023;
+			app->down_bytes &= 1023;
+			app->up_pkts = 0;
+			app->down_pkts = 0;
+			app->total_num = 0;
+			app->drop_num = 0;
+			total++;
+			if (++count == AF_REPORT_APPS_PER_MSG)
+			{
+				af_visit_info_send(node, visit_info_array);
+				visit_info_array = NULL;
+				count = 0;
+			}
+		}
+	}
+
+	if (count > 0 || (total == 0 && node->report_count == 0))
+	{
+		if (!visit_info_array)
+			visit_info_array = cJSON_CreateArray();
+		if (visit_info_array)
+			af_visit_info_send(node, visit_info_array);
+	}
+	else if (visit_info_array)
+	{
+		cJSON_Delete(visit_info_array);
+	}
 	return 0;
 }
 void af_visit_info_report(void)
@@ -290,9 +612,9 @@ void af_visit_info_report(void)
 	{
 		list_for_each_entry(node, &af_client_list_table[i], hlist)
 		{
-			// flush_expired_visit_info(node);
 			AF_INFO("report %s\n", node->mac);
 			__af_visit_info_report(node);
+			flush_expired_visit_info(node);
 		}
 	}
 	AF_CLIENT_UNLOCK_W();
@@ -373,21 +695,9 @@ static u_int32_t af_client_hook(unsigned int hook,
 	} else if (AF_MODE_GATEWAY != af_work_mode)
 		return NF_ACCEPT;
 
-	AF_CLIENT_LOCK_W();
-	nfc = find_af_client(smac);
-	if (!nfc)
-	{
-		if (skb->dev)
-			AF_DEBUG("from dev:%s %pI4", skb->dev->name, &ip);
-		nfc = nf_client_add(smac);
-	}
-	if (nfc && ip != 0 && nfc->ip != ip)
-	{
-		AF_DEBUG("update node " MAC_FMT " ip %pI4--->%pI4\n", MAC_ARRAY(nfc->mac), &nfc->ip, &ip);
-		nfc->update_jiffies = jiffies;
-		nfc->ip = ip;
-	}
-	AF_CLIENT_UNLOCK_W();
+	nfc = find_and_update_af_client(smac, ip);
+	if (!nfc && skb->dev)
+		AF_DEBUG("from dev:%s %pI4", skb->dev->name, &ip);
 
 	return NF_ACCEPT;
 }
@@ -448,6 +758,9 @@ void af_client_exit(void)
 #else
 	nf_unregister_hooks(af_client_ops, ARRAY_SIZE(af_client_ops));
 #endif
+	af_client_acct_clear();
 	nf_client_list_clear();
+	/* wait for the af_client_free_rcu() callbacks of expired clients */
+	rcu_barrier();
 	return;
 }
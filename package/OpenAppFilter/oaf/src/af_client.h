@@ -6,7 +6,7 @@ extern rwlock_t af_client_lock;
 
 extern u32 nfc_debug_level;
 
-#define MAX_AF_CLIENT_HASH_SIZE 64
+#define MAX_AF_CLIENT_HASH_SIZE 256
 #define NF_CLIENT_TIMER_EXPIRE 1
 #define MAX_CLIENT_ACTIVE_TIME 90
 
@@ -28,32 +28,57 @@ enum NFC_PKT_DIR
 	PKT_DIR_UP
 };
 
-#define MAX_VISIT_HISTORY_TIME 24
 #define MAX_RECORD_APP_NUM 64
+#define AF_APP_HASH_SIZE 16
+#define AF_APP_STAT_MINUTES 15
+#define MAX_AF_ACCT_FLOWS 8192
 
+/* traffic of one app collected during one minute */
+typedef struct app_stat_bucket
+{
+	u32 minute;
+	u64 up_bytes;
+	u64 down_bytes;
+} app_stat_bucket_t;
+
+/*
+ * Per client, per app record, hashed by app_id in af_client_info.app_table.
+ * The counters are reset by every report, bucket[] keeps the traffic of the
+ * last AF_APP_STAT_MINUTES minutes indexed by minute % AF_APP_STAT_MINUTES.
+ */
 typedef struct app_visit_info
 {
+	struct hlist_node hlist;
 	unsigned int app_id;
 	unsigned int total_num;
 	unsigned int drop_num;
 	unsigned long latest_time;
 	unsigned int latest_action;
-	unsigned int total_down_bytes;
-	unsigned int total_up_bytes;
-	unsigned long history_time[MAX_VISIT_HISTORY_TIME];
-	unsigned int action[MAX_VISIT_HISTORY_TIME];
+	u64 up_bytes;
+	u64 down_bytes;
+	u64 up_pkts;
+	u64 down_pkts;
+	app_stat_bucket_t bucket[AF_APP_STAT_MINUTES];
 } app_visit_info_t;
 
+/*
+ * Clients are hashed by MAC in af_client_list_table and by IPv4 address in
+ * af_client_ip_table. Both tables are modified under af_client_lock and
+ * read under RCU from the packet path, nodes and their app records are
+ * freed from an RCU callback, af_client_free_rcu().
+ */
 typedef struct af_client_info
 {
 	struct list_head hlist;
+	struct hlist_node ip_hlist;
+	struct rcu_head rcu;
 	unsigned char mac[MAC_ADDR_LEN];
 	unsigned int ip;
 	unsigned long create_jiffies;
 	unsigned long update_jiffies;
 	unsigned int visit_app_num;
 	int report_count;
-	app_visit_info_t visit_info[MAX_RECORD_APP_NUM];
+	struct hlist_head app_table[AF_APP_HASH_SIZE];
 } af_client_info_t;
 
 int af_client_init(void);
@@ -69,5 +94,11 @@ void af_visit_info_report(void);
 void af_client_list_reset_report_num(void);
 af_client_info_t *nf_client_add(unsigned char *mac);
 af_client_info_t *find_and_add_af_client(unsigned char *mac);
+af_client_info_t *find_and_update_af_client(unsigned char *mac, unsigned int ip);
+
+struct nf_conn;
+app_visit_info_t *af_client_find_app(af_client_info_t *node, unsigned int app_id, int add);
+int af_client_acct_flow(struct nf_conn *ct, unsigned char *mac, unsigned int app_id);
+void af_client_acct_update(int all);
 
 #endif
@@ -22,6 +22,11 @@
 #include "cJSON.h"
 #include "af_log.h"
 #include "af_client.h"
+#include "af_utils.h"
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 17, 0)
+#define pde_data PDE_DATA
+#endif
 
 extern struct list_head af_client_list_table[MAX_AF_CLIENT_HASH_SIZE];
 struct af_client_iter_state
@@ -125,12 +130,49 @@ static int af_client_seq_show(struct seq_file *s, void *v)
     return 0;
 }
 
+/* per minute traffic of every client app, oldest minute first */
+static int af_client_app_seq_show(struct seq_file *s, void *v)
+{
+    af_client_info_t *node = (af_client_info_t *)v;
+    app_visit_info_t *app;
+    app_stat_bucket_t *bucket;
+    u32 minute = af_get_timestamp_sec() / 60;
+    int i, j;
+
+    if (v == SEQ_START_TOKEN)
+    {
+        seq_printf(s, "%-18s %-6s %-10s %-12s %-12s\n", "Mac", "AppId", "Minute", "UpBytes", "DownBytes");
+        return 0;
+    }
+    for (i = 0; i < AF_APP_HASH_SIZE; i++)
+    {
+        hlist_for_each_entry(app, &node->app_table[i], hlist)
+        {
+            for (j = AF_APP_STAT_MINUTES - 1; j >= 0; j--)
+            {
+                bucket = &app->bucket[(minute - j) % AF_APP_STAT_MINUTES];
+                if (bucket->minute != minute - j)
+                    continue;
+                seq_printf(s, MAC_FMT " %-6u %-10u %-12llu %-12llu\n", MAC_ARRAY(node->mac),
+                           app->app_id, bucket->minute, bucket->up_bytes, bucket->down_bytes);
+            }
+        }
+    }
+    return 0;
+}
+
 static const struct seq_operations nf_client_seq_ops = {
     .start = af_client_seq_start,
     .next = af_client_seq_next,
     .stop = af_client_seq_stop,
     .show = af_client_seq_show};
 
+static const struct seq_operations nf_client_app_seq_ops = {
+    .start = af_client_seq_start,
+    .next = af_client_seq_next,
+    .stop = af_client_seq_stop,
+    .show = af_client_app_seq_show};
+
 static int af_client_open(struct inode *inode, struct file *file)
 {
     struct seq_file *seq;
@@ -141,7 +183,7 @@ static int af_client_open(struct inode *inode, struct file *file)
     if (!iter)
         return -ENOMEM;
 
-    err = seq_open(file, &nf_client_seq_ops);
+    err = seq_open(file, pde_data(inode));
     if (err)
     {
         kfree(iter);
@@ -172,23 +214,34 @@ static const struct proc_ops af_client_fops = {
 #endif
 
 #define AF_CLIENT_PROC_STR "af_client"
+#define AF_CLIENT_APP_PROC_STR "af_client_app"
 
 int init_af_client_procfs(void)
 {
     struct proc_dir_entry *pde;
     struct net *net = &init_net;
-    pde = proc_create(AF_CLIENT_PROC_STR, 0440, net->proc_net, &af_client_fops);
+    pde = proc_create_data(AF_CLIENT_PROC_STR, 0440, net->proc_net, &af_client_fops,
+                           (void *)&nf_client_seq_ops);
 
     if (!pde)
     {
         AF_ERROR("nf_client proc file created error\n");
         return -1;
     }
+    pde = proc_create_data(AF_CLIENT_APP_PROC_STR, 0440, net->proc_net, &af_client_fops,
+                           (void *)&nf_client_app_seq_ops);
+    if (!pde)
+    {
+        AF_ERROR("nf_client app proc file created error\n");
+        remove_proc_entry(AF_CLIENT_PROC_STR, net->proc_net);
+        return -1;
+    }
     return 0;
 }
 
 void finit_af_client_procfs(void)
 {
     struct net *net = &init_net;
+    remove_proc_entry(AF_CLIENT_APP_PROC_STR, net->proc_net);
     remove_proc_entry(AF_CLIENT_PROC_STR, net->proc_net);
 }
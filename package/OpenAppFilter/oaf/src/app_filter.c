@@ -1001,37 +1001,23 @@ int match_app_filter_rule(int appid, af_client_info_t *client)
 
 #define NF_DROP_BIT 0x80000000
 #define NF_CLIENT_HELLO_BIT 0x40000000
+#define NF_ACCT_BIT 0x20000000
 
 
-static int af_get_visit_index(af_client_info_t *node, int app_id)
-{
-	int i;
-	for (i = 0; i < MAX_RECORD_APP_NUM; i++)
-	{
-		if (node->visit_info[i].app_id == app_id || node->visit_info[i].app_id == 0)
-		{
-			return i;
-		}
-	}
-	// default 0
-	return 0;
-}
-
 int af_update_client_app_info(af_client_info_t *node, int app_id, int drop)
 {
-	int index = -1;
+	app_visit_info_t *app;
 	if (!node)
 		return -1;
 
-	index = af_get_visit_index(node, app_id);
-	if (index < 0 || index >= MAX_RECORD_APP_NUM)
+	app = af_client_find_app(node, app_id, 1);
+	if (!app)
 		return 0;
-	node->visit_info[index].total_num++;
+	app->total_num++;
 	if (drop)
-		node->visit_info[index].drop_num++;
-	node->visit_info[index].app_id = app_id;
-	node->visit_info[index].latest_time = af_get_timestamp_sec();
-	node->visit_info[index].latest_action = drop;
+		app->drop_num++;
+	app->latest_time = af_get_timestamp_sec();
+	app->latest_action = drop;
 	return 0;
 }
 
@@ -1146,17 +1132,9 @@ u_int32_t app_filter_hook_bypass_handle(struct sk_buff *skb, struct net_device *
 	}
 	af_get_smac(skb, smac);
 
-	AF_CLIENT_LOCK_W();
-	client = find_and_add_af_client(smac);
+	client = find_and_update_af_client(smac, flow.src);
 	if (!client)
-	{
-		AF_CLIENT_UNLOCK_W();
 		return NF_ACCEPT;
-	}
-	client->update_jiffies = jiffies;
-	if (flow.src)
-		client->ip = flow.src;
-	AF_CLIENT_UNLOCK_W();
 
 
 	spin_lock(&af_conn_lock);
@@ -1242,6 +1220,20 @@ EXIT:
 	return ret;
 }
 
+/*
+ * Account the traffic of a classified conntrack to the client app. Only
+ * confirmed conntracks are taken: an unconfirmed one dropped by the verdict
+ * is freed without ever dying in the table and would keep its reference in
+ * the accounting list forever. The next packet registers it instead.
+ */
+static void af_acct_register(struct nf_conn *ct, af_client_info_t *client, u_int32_t app_id)
+{
+	if (!g_oaf_record_enable || (ct->mark & NF_ACCT_BIT) || !nf_ct_is_confirmed(ct))
+		return;
+	if (0 == af_client_acct_flow(ct, client->mac, app_id))
+		ct->mark |= NF_ACCT_BIT;
+}
+
 u_int32_t app_filter_hook_gateway_handle(struct sk_buff *skb, struct net_device *dev)
 {
 	unsigned long long total_packets = 0;
@@ -1274,15 +1266,12 @@ u_int32_t app_filter_hook_gateway_handle(struct sk_buff *skb, struct net_device
 	if (!flow.src)
 		af_get_smac(skb, smac);
 
-	AF_CLIENT_LOCK_R();
+	/* netfilter hooks run under rcu_read_lock(), client stays valid */
 	client = flow.src ? find_af_client_by_ip(flow.src) : find_af_client(smac);
 	if (!client)
-	{
-		AF_CLIENT_UNLOCK_R();
 		return NF_ACCEPT;
-	}
-	client->update_jiffies = jiffies;
-	AF_CLIENT_UNLOCK_R();
+	if (READ_ONCE(client->update_jiffies) != jiffies)
+		WRITE_ONCE(client->update_jiffies, jiffies);
 
 	if (ct->mark != 0)
 	{
@@ -1303,6 +1292,8 @@ u_int32_t app_filter_hook_gateway_handle(struct sk_buff *skb, struct net_device
 			{
 				return NF_DROP;
 			}
+			/* classified while still unconfirmed */
+			af_acct_register(ct, client, app_id);
 		}
 		else {
 			AF_LMT_DEBUG("ct->mark = %x\n", ct->mark);
@@ -1372,6 +1363,9 @@ u_int32_t app_filter_hook_gateway_handle(struct sk_buff *skb, struct net_device
 	}
 
 
+	if (!flow.drop)
+		af_acct_register(ct, client, flow.app_id);
+
 	if (g_oaf_record_enable){
 		AF_CLIENT_LOCK_W();
 		af_update_client_app_info(client, flow.app_id, flow.drop);
@@ -1502,6 +1496,7 @@ static void oaf_timer_func(unsigned long ptr)
 #endif
 {
 	static int count = 0;
+	af_client_acct_update(report_flag);
 	if (count % 60 == 0)
 		check_client_expire();
 	if (count % 60 == 0 || report_flag)
@@ -134,8 +134,8 @@ void appfilter_nl_handler(struct uloop_fd *u, unsigned int ev)
         struct json_object *visit_obj = json_object_array_get_idx(visit_array, i);
         struct json_object *appid_obj = json_object_object_get(visit_obj, "appid");
         struct json_object *action_obj = json_object_object_get(visit_obj, "latest_action");
-        struct json_object *up_obj = json_object_object_get(visit_obj, "up_bytes");
-        struct json_object *down_obj = json_object_object_get(visit_obj, "down_bytes");
+        struct json_object *up_obj = json_object_object_get(visit_obj, "up_kb");
+        struct json_object *down_obj = json_object_object_get(visit_obj, "down_kb");
         struct timeval cur_time;
 
         gettimeofday(&cur_time, NULL);
@@ -148,8 +148,10 @@ void appfilter_nl_handler(struct uloop_fd *u, unsigned int ev)
             continue;
         node->stat[type - 1][id - 1].total_time += REPORT_INTERVAL_SECS;
 
-        //	node->stat[type - 1][id - 1].total_down_bytes += json_object_get_int(down_obj);
-        //	node->stat[type - 1][id - 1].total_up_bytes += json_object_get_int(up_obj);
+        if (down_obj)
+            node->stat[type - 1][id - 1].total_down_bytes += (unsigned long long)json_object_get_int64(down_obj) << 10;
+        if (up_obj)
+            node->stat[type - 1][id - 1].total_up_bytes += (unsigned long long)json_object_get_int64(up_obj) << 10;
 
         int hash = hash_appid(appid);
         visit_info_t *head = node->visit_htable[hash];
@@ -262,6 +262,8 @@ void update_app_visit_time_list(char *mac, struct app_visit_stat_info *visit_inf
             {
                 visit_info->visit_list[min_index].total_time = node->stat[i][j].total_time;
                 visit_info->visit_list[min_index].app_id = (i + 1) * 1000 + j + 1;
+                visit_info->visit_list[min_index].up_bytes = node->stat[i][j].total_up_bytes;
+                visit_info->visit_list[min_index].down_bytes = node->stat[i][j].total_down_bytes;
             }
         }
     }
@@ -505,6 +507,8 @@ static int appfilter_handle_visit_time(struct ubus_context *ctx, struct ubus_obj
         json_object_object_add(app_info_obj, "id", json_object_new_int(info.visit_list[i].app_id));
         json_object_object_add(app_info_obj, "name", json_object_new_string(get_app_name_by_id(info.visit_list[i].app_id)));
         json_object_object_add(app_info_obj, "t", json_object_new_int(info.visit_list[i].total_time));
+        json_object_object_add(app_info_obj, "up", json_object_new_int64(info.visit_list[i].up_bytes));
+        json_object_object_add(app_info_obj, "down", json_object_new_int64(info.visit_list[i].down_bytes));
         json_object_array_add(app_info_array, app_info_obj);
     }
 
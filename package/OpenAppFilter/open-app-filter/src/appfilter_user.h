@@ -98,6 +98,8 @@ struct app_visit_info
     int app_id;
     char app_name[32];
     int total_time;
+    unsigned long long up_bytes;
+    unsigned long long down_bytes;
 };
 
 struct app_visit_stat_info
@@ -302,21 +302,48 @@ nand_upgrade_tar() {
 	local tar_file="$1"
 	local cmd="${2:-cat}"
 	local jffs2_markers="${CI_JFFS2_CLEAN_MARKERS:-0}"
+	local nandtar="$(command -v nandtar)"
+
+	# set by nandtar info
+	local board_dir kernel_length kernel_crc kernel_magic
+	local rootfs_length rootfs_crc rootfs_magic control_length control_crc control_magic
 
 	# WARNING: This fails if tar contains more than one 'sysupgrade-*' directory.
-	local board_dir="$($cmd < "$tar_file" | tar tf - | grep -m 1 '^sysupgrade-.*/$')"
-	board_dir="${board_dir%/}"
+	if [ -n "$nandtar" ]; then
+		# One pass for the board directory, the lengths and the rootfs
+		# magic. It reads the whole archive, so nothing is written to
+		# flash if it is corrupted.
+		local tar_info
+		echo "verifying sysupgrade tar file integrity"
+		if ! tar_info="$($cmd < "$tar_file" | nandtar info)"; then
+			echo "corrupted sysupgrade tar file"
+			return 1
+		fi
+		eval "$tar_info"
+	else
+		board_dir="$($cmd < "$tar_file" | tar tf - | grep -m 1 '^sysupgrade-.*/$')"
+		board_dir="${board_dir%/}"
+		[ "$CI_KERNPART" != "none" ] && \
+			kernel_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | wc -c) 2> /dev/null)
+		rootfs_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/root" | wc -c) 2> /dev/null)
+	fi
 
-	local kernel_mtd kernel_length
+	local kernel_mtd
 	if [ "$CI_KERNPART" != "none" ]; then
 		kernel_mtd="$(find_mtd_index "$CI_KERNPART")"
-		kernel_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | wc -c) 2> /dev/null)
 		[ "$kernel_length" = 0 ] && kernel_length=
+	else
+		kernel_length=
 	fi
-	local rootfs_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/root" | wc -c) 2> /dev/null)
 	[ "$rootfs_length" = 0 ] && rootfs_length=
 	local rootfs_type
-	[ "$rootfs_length" ] && rootfs_type="$(identify_tar "$tar_file" "$cmd" "$board_dir/root")"
+	if [ "$rootfs_length" ]; then
+		if [ -n "$nandtar" ]; then
+			rootfs_type="$(identify_magic_long "$rootfs_magic")"
+		else
+			rootfs_type="$(identify_tar "$tar_file" "$cmd" "$board_dir/root")"
+		fi
+	fi
 
 	local ubi_kernel_length
 	if [ "$kernel_length" ]; then
@@ -334,6 +361,13 @@ nand_upgrade_tar() {
 	local has_env=0
 	nand_upgrade_prepare_ubi "$rootfs_length" "$rootfs_type" "$ubi_kernel_length" "$has_env" || return 1
 
+	if [ -n "$nandtar" ]; then
+		nand_upgrade_tar_stream "$tar_file" "$cmd" "$board_dir" \
+			"$rootfs_length" "$rootfs_crc" "$kernel_length" "$kernel_crc" \
+			"$kernel_mtd" "$jffs2_markers"
+		return
+	fi
+
 	if [ "$rootfs_length" ]; then
 		local ubidev="$( nand_find_ubi "${CI_ROOT_UBIPART:-$CI_UBIPART}" )"
 		local root_ubivol="$( nand_find_volume $ubidev "$CI_ROOTPART" )"
@@ -361,6 +395,61 @@ nand_upgrade_tar() {
 	return 0
 }
 
+# Write the rootfs and kernel of the TAR file in a single pass. nandtar takes
+# the lengths from the tar headers, and only completes a UBI volume update
+# once the data matches the CRC the verifying pass saw. A kernel on a raw MTD
+# partition is passed on to mtd or nandwrite through stdout.
+nand_upgrade_tar_stream() {
+	local tar_file="$1"
+	local cmd="$2"
+	local board_dir="$3"
+	local rootfs_length="$4"
+	local rootfs_crc="$5"
+	local kernel_length="$6"
+	local kernel_crc="$7"
+	local kernel_mtd="$8"
+	local jffs2_markers="$9"
+	local args="-b $board_dir"
+	local targets
+
+	if [ "$rootfs_length" ]; then
+		local ubidev="$( nand_find_ubi "${CI_ROOT_UBIPART:-$CI_UBIPART}" )"
+		local root_ubivol="$( nand_find_volume $ubidev "$CI_ROOTPART" )"
+		args="$args -c root=$rootfs_crc"
+		targets="root=/dev/$root_ubivol"
+	fi
+
+	if [ "$kernel_length" ]; then
+		args="$args -c kernel=$kernel_crc"
+		if [ "$kernel_mtd" ]; then
+			targets="$targets kernel=-"
+		else
+			local ubidev="$( nand_find_ubi "${CI_KERN_UBIPART:-$CI_UBIPART}" )"
+			local kern_ubivol="$( nand_find_volume $ubidev "$CI_KERNPART" )"
+			targets="$targets kernel=/dev/$kern_ubivol"
+		fi
+	fi
+
+	[ -n "$targets" ] || return 0
+
+	if [ -z "$kernel_length" -o -z "$kernel_mtd" ]; then
+		$cmd < "$tar_file" | nandtar $args write $targets
+		return
+	fi
+
+	# the exit code of nandtar would get lost in the pipe to the MTD writer
+	local status="/tmp/nandtar.status"
+	if [ "$jffs2_markers" = 1 ]; then
+		flash_erase -j "/dev/mtd${kernel_mtd}" 0 0
+		{ $cmd < "$tar_file" | nandtar $args write $targets; echo $? > "$status"; } | \
+			nandwrite "/dev/mtd${kernel_mtd}" -
+	else
+		{ $cmd < "$tar_file" | nandtar $args write $targets; echo $? > "$status"; } | \
+			mtd write - "$CI_KERNPART"
+	fi
+	[ "$(cat "$status" 2> /dev/null)" = 0 ]
+}
+
 nand_verify_if_gzip_file() {
 	local file="$1"
 	local cmd="$2"
@@ -379,7 +468,12 @@ nand_verify_tar_file() {
 	local cmd="$2"
 
 	echo "verifying sysupgrade tar file integrity"
-	if ! $cmd < "$file" | tar xOf - > /dev/null; then
+	if command -v nandtar > /dev/null; then
+		$cmd < "$file" | nandtar info > /dev/null
+	else
+		$cmd < "$file" | tar xOf - > /dev/null
+	fi
+	if [ $? -ne 0 ]; then
 		echo "corrupted sysupgrade tar file"
 		return 1
 	fi
@@ -409,7 +503,9 @@ nand_do_flash_file() {
 			nand_upgrade_ubifs "$file" "$cmd"
 			;;
 		*)
-			nand_verify_tar_file "$file" "$cmd" || return 1
+			# with nandtar the upgrade checks the archive itself
+			command -v nandtar > /dev/null || \
+				nand_verify_tar_file "$file" "$cmd" || return 1
 			nand_upgrade_tar "$file" "$cmd"
 			;;
 	esac
@@ -479,14 +575,32 @@ nand_do_platform_check() {
 
 	local cmd="$(identify_if_gzip "$file")cat"
 	local file_type="$(identify "$file" "$cmd" "")"
-	local control_length=$( ($cmd < "$file" | tar xOf - "sysupgrade-${board_name//,/_}/CONTROL" | wc -c) 2> /dev/null)
+	local control_length tar_info tar_ok=1
+
+	if command -v nandtar > /dev/null; then
+		# a single pass finds CONTROL and checks the archive
+		tar_info="$($cmd < "$file" | nandtar -b "sysupgrade-${board_name//,/_}" \
+			-b "sysupgrade-${board_name//_/,}" info 2> /dev/null)" || tar_ok=0
+		control_length="$(echo "$tar_info" | sed -n 's/^control_length=//p')"
+		control_length="${control_length:-0}"
+	else
+		control_length=$( ($cmd < "$file" | tar xOf - "sysupgrade-${board_name//,/_}/CONTROL" | wc -c) 2> /dev/null)
 
-	if [ "$control_length" = 0 ]; then
-		control_length=$( ($cmd < "$file" | tar xOf - "sysupgrade-${board_name//_/,}/CONTROL" | wc -c) 2> /dev/null)
+		if [ "$control_length" = 0 ]; then
+			control_length=$( ($cmd < "$file" | tar xOf - "sysupgrade-${board_name//_/,}/CONTROL" | wc -c) 2> /dev/null)
+		fi
 	fi
 
 	if [ "$control_length" != 0 ]; then
-		nand_verify_tar_file "$file" "$cmd" || return 1
+		if [ -n "$tar_info" ]; then
+			echo "verifying sysupgrade tar file integrity"
+			if [ "$tar_ok" != 1 ]; then
+				echo "corrupted sysupgrade tar file"
+				return 1
+			fi
+		else
+			nand_verify_tar_file "$file" "$cmd" || return 1
+		fi
 	else
 		nand_verify_if_gzip_file "$file" "$cmd" || return 1
 		if [ "$file_type" != "fit" -a "$file_type" != "ubi" -a "$file_type" != "ubifs" ]; then
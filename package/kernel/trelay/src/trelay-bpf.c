@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * trelay-bpf.c: XDP fast path for the Trivial Ethernet Relay
+ *
+ * Frames are redirected to the peer device looked up by ingress ifindex
+ * in the peers map. EAPOL and anything not matching a peer is passed up
+ * to the stack, where the trelay rx_handler takes care of it.
+ */
+#include <uapi/linux/bpf.h>
+#include <uapi/linux/if_ether.h>
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_endian.h>
+
+enum {
+	TRELAY_STAT_RELAYED,
+	TRELAY_STAT_PASSED,
+	__TRELAY_STAT_MAX
+};
+
+struct {
+	__uint(type, BPF_MAP_TYPE_DEVMAP_HASH);
+	__uint(max_entries, 2);
+	__type(key, __u32);
+	__type(value, __u32);
+} peers SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__uint(max_entries, __TRELAY_STAT_MAX);
+	__type(key, __u32);
+	__type(value, __u64);
+} stats SEC(".maps");
+
+SEC("xdp")
+int trelay_xdp(struct xdp_md *ctx)
+{
+	void *data_end = (void *)(long)ctx->data_end;
+	void *data = (void *)(long)ctx->data;
+	struct ethhdr *eth = data;
+	__u32 key = TRELAY_STAT_PASSED;
+	long ret = XDP_PASS;
+	__u64 *count;
+
+	if ((void *)(eth + 1) <= data_end &&
+	    eth->h_proto != bpf_htons(ETH_P_PAE)) {
+		ret = bpf_redirect_map(&peers, ctx->ingress_ifindex, XDP_PASS);
+		if (ret == XDP_REDIRECT)
+			key = TRELAY_STAT_RELAYED;
+	}
+
+	count = bpf_map_lookup_elem(&stats, &key);
+	if (count)
+		*count += 1;
+
+	return ret;
+}
+
+char _license[] SEC("license") = "GPL";
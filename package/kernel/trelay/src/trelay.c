@@ -19,6 +19,8 @@
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/u64_stats_sync.h>
 
 #define trelay_log(loglevel, tr, fmt, ...) \
 	printk(loglevel "trelay: %s <-> %s: " fmt "\n", \
@@ -27,9 +29,21 @@
 static LIST_HEAD(trelay_devs);
 static struct dentry *debugfs_dir;
 
+/* counters for frames received on dev1 (dir[0]) and dev2 (dir[1]) */
+struct trelay_stats {
+	struct u64_stats_sync syncp;
+	struct {
+		u64_stats_t packets;
+		u64_stats_t bytes;
+		u64_stats_t dropped;
+		u64_stats_t passed;
+	} dir[2];
+};
+
 struct trelay {
 	struct list_head list;
 	struct net_device *dev1, *dev2;
+	struct trelay_stats __percpu *stats;
 	struct dentry *debugfs;
 	int to_remove;
 	char name[];
@@ -37,20 +51,42 @@ struct trelay {
 
 rx_handler_result_t trelay_handle_frame(struct sk_buff **pskb)
 {
+	struct trelay_stats *stats;
 	struct net_device *dev;
 	struct sk_buff *skb = *pskb;
+	struct trelay *tr;
+	unsigned int len;
+	int dir, ret;
 
-	dev = rcu_dereference(skb->dev->rx_handler_data);
-	if (!dev)
+	tr = rcu_dereference(skb->dev->rx_handler_data);
+	if (!tr)
 		return RX_HANDLER_PASS;
 
-	if (skb->protocol == htons(ETH_P_PAE))
+	dir = skb->dev == tr->dev2;
+	dev = dir ? tr->dev1 : tr->dev2;
+	stats = this_cpu_ptr(tr->stats);
+
+	if (skb->protocol == htons(ETH_P_PAE)) {
+		u64_stats_update_begin(&stats->syncp);
+		u64_stats_inc(&stats->dir[dir].passed);
+		u64_stats_update_end(&stats->syncp);
 		return RX_HANDLER_PASS;
+	}
 
 	skb_push(skb, ETH_HLEN);
+	len = skb->len;
 	skb->dev = dev;
 	skb_forward_csum(skb);
-	dev_queue_xmit(skb);
+	ret = dev_queue_xmit(skb);
+
+	u64_stats_update_begin(&stats->syncp);
+	if (likely(!net_xmit_eval(ret))) {
+		u64_stats_inc(&stats->dir[dir].packets);
+		u64_stats_add(&stats->dir[dir].bytes, len);
+	} else {
+		u64_stats_inc(&stats->dir[dir].dropped);
+	}
+	u64_stats_update_end(&stats->syncp);
 
 	return RX_HANDLER_CONSUMED;
 }
@@ -77,6 +113,7 @@ static int trelay_do_remove(struct trelay *tr)
 
 	trelay_log(KERN_INFO, tr, "stopped");
 
+	free_percpu(tr->stats);
 	kfree(tr);
 
 	return 0;
@@ -145,6 +182,44 @@ static const struct file_operations fops_remove = {
 	.release = trelay_remove_release,
 };
 
+static int trelay_stats_show(struct seq_file *s, void *unused)
+{
+	struct trelay *tr = s->private;
+	u64 packets[2] = {}, bytes[2] = {}, dropped[2] = {}, passed[2] = {};
+	const struct trelay_stats *stats;
+	u64 p, b, d, a;
+	unsigned int start;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(tr->stats, cpu);
+		for (i = 0; i < 2; i++) {
+			do {
+				start = u64_stats_fetch_begin(&stats->syncp);
+				p = u64_stats_read(&stats->dir[i].packets);
+				b = u64_stats_read(&stats->dir[i].bytes);
+				d = u64_stats_read(&stats->dir[i].dropped);
+				a = u64_stats_read(&stats->dir[i].passed);
+			} while (u64_stats_fetch_retry(&stats->syncp, start));
+
+			packets[i] += p;
+			bytes[i] += b;
+			dropped[i] += d;
+			passed[i] += a;
+		}
+	}
+
+	/* frames relayed by trelay-xdp never reach the rx_handler */
+	for (i = 0; i < 2; i++)
+		seq_printf(s, "%s -> %s (skb): packets %llu bytes %llu dropped %llu passed %llu\n",
+			   i ? tr->dev2->name : tr->dev1->name,
+			   i ? tr->dev1->name : tr->dev2->name,
+			   packets[i], bytes[i], dropped[i], passed[i]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(trelay_stats);
+
 
 static int trelay_do_add(char *name, char *devn1, char *devn2)
 {
@@ -156,6 +231,12 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!tr)
 		return -ENOMEM;
 
+	tr->stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	if (!tr->stats) {
+		kfree(tr);
+		return -ENOMEM;
+	}
+
 	rtnl_lock();
 	rcu_read_lock();
 
@@ -171,11 +252,15 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!dev1 || !dev2)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, dev2);
+	strcpy(tr->name, name);
+	tr->dev1 = dev1;
+	tr->dev2 = dev2;
+
+	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, tr);
 	if (ret < 0)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, dev1);
+	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, tr);
 	if (ret < 0) {
 		netdev_rx_handler_unregister(dev1);
 		goto out;
@@ -184,22 +269,22 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	dev_hold(dev1);
 	dev_hold(dev2);
 
-	strcpy(tr->name, name);
-	tr->dev1 = dev1;
-	tr->dev2 = dev2;
 	list_add_tail(&tr->list, &trelay_devs);
 
 	trelay_log(KERN_INFO, tr, "started");
 
 	tr->debugfs = debugfs_create_dir(name, debugfs_dir);
 	debugfs_create_file("remove", S_IWUSR, tr->debugfs, tr, &fops_remove);
+	debugfs_create_file("stats", S_IRUSR, tr->debugfs, tr, &trelay_stats_fops);
 	ret = 0;
 
 out:
 	rcu_read_unlock();
 	rtnl_unlock();
-	if (ret < 0)
+	if (ret < 0) {
+		free_percpu(tr->stats);
 		kfree(tr);
+	}
 
 	return ret;
 }
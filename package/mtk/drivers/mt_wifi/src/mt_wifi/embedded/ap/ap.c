@@ -1594,19 +1594,14 @@ VOID APInitForMain(RTMP_ADAPTER *pAd)
 	pAd->MacTab.MsduLifeTime = 5; /* default 5 seconds */
 	pAd->BcnCheckInfo[DBDC_BAND0].BcnInitedRnd = pAd->Mlme.PeriodicRound;
 	pAd->BcnCheckInfo[DBDC_BAND1].BcnInitedRnd = pAd->Mlme.PeriodicRound;
-#ifdef KERNEL_RPS_ADJUST
-	if (!pAd->ixia_mode_ctl.kernel_rps_en)
-#endif
-	{
-		if (IS_MT7915(pAd) || IS_MT7986(pAd) || IS_MT7916(pAd) || IS_MT7981(pAd)) {
-			UINT8 idx = 0;
-			for (idx = 0; idx < DBDC_BAND_NUM; idx++)
-				pAd->mcli_ctl[idx].tx_cnt_from_red = TRUE;
-		} else {
-			UINT8 idx = 0;
-			for (idx = 0; idx < DBDC_BAND_NUM; idx++)
-				pAd->mcli_ctl[idx].tx_cnt_from_red = FALSE;
-		}
+	if (IS_MT7915(pAd) || IS_MT7986(pAd) || IS_MT7916(pAd) || IS_MT7981(pAd)) {
+		UINT8 idx = 0;
+		for (idx = 0; idx < DBDC_BAND_NUM; idx++)
+			pAd->mcli_ctl[idx].tx_cnt_from_red = TRUE;
+	} else {
+		UINT8 idx = 0;
+		for (idx = 0; idx < DBDC_BAND_NUM; idx++)
+			pAd->mcli_ctl[idx].tx_cnt_from_red = FALSE;
 	}
 	OPSTATUS_SET_FLAG(pAd, fOP_AP_STATUS_MEDIA_STATE_CONNECTED);
 	RTMP_IndicateMediaState(pAd, NdisMediaStateConnected);
@@ -2136,17 +2131,16 @@ static VOID dynamic_txop_adjust(struct _RTMP_ADAPTER *pAd)
 			((pAd->OneSecMibBucket.OBSSAirtime[BandIdx]*2) > 1000000))
 			mcli_txop = TRUE;
 
-		/* consider ixia mode */
-		if (pAd->ixia_mode_ctl.isIxiaOn || pAd->mcli_ctl[BandIdx].large_rssi_gap_num == 0)
+		if (pAd->mcli_ctl[BandIdx].large_rssi_gap_num == 0)
 			mcli_txop = TRUE;
 
 		if (pAd->mcli_ctl[BandIdx].debug_on & MCLI_DEBUG_PER_BAND)
 			MTWF_DBG(pAd, DBG_CAT_AP, DBG_SUBCAT_ALL, DBG_LVL_INFO,
-				"Band%d, McliCheck[%d-%d/%d/%d], McliTxop(%d-Mib[%d/%d]-Ixia[%d/%d])\n",
+				"Band%d, McliCheck[%d-%d/%d/%d], McliTxop(%d-Mib[%d/%d]-RssiGap[%d])\n",
 				BandIdx, eap_mcli_check, pAd->multi_cli_nums_eap_th,
 				pAd->txop_ctl[BandIdx].multi_client_nums, pAd->txop_ctl[BandIdx].multi_rx_client_nums,
 				mcli_txop, pAd->OneSecMibBucket.Enabled[BandIdx], pAd->OneSecMibBucket.OBSSAirtime[BandIdx]*2,
-				pAd->ixia_mode_ctl.isIxiaOn, pAd->mcli_ctl[BandIdx].large_rssi_gap_num);
+				pAd->mcli_ctl[BandIdx].large_rssi_gap_num);
 
 		if (eap_mcli_check) {
 		/*	For Real sta test, We sense different eap_mutil_client case:
@@ -2278,12 +2272,6 @@ static VOID dynamic_amsdu_protect_adjust(struct _RTMP_ADAPTER *ad)
 	if (ad->mcli_ctl[band_idx].large_rssi_gap_num > 0)
 		skip_flg = TRUE;
 
-#ifdef KERNEL_RPS_ADJUST
-	if (ad->ixia_mode_ctl.kernel_rps_en) {
-		if (ad->ixia_mode_ctl.mode_entered == FALSE)
-			skip_flg = TRUE;
-	}
-#endif
 	/*only change protection scenario when sta more than multi_client_num_th*/
 	if (!mc_flg || spl_flg || skip_flg) {
 		if (ad->mcli_ctl[band_idx].tx_cnt_from_red == FALSE) {
@@ -2326,97 +2314,6 @@ static VOID dynamic_amsdu_protect_adjust(struct _RTMP_ADAPTER *ad)
 		}
 	}
 ADJ_AGG:
-#ifdef KERNEL_RPS_ADJUST
-#ifdef CONFIG_SOC_MT7621
-	{
-	RTMP_CHIP_CAP *pChipCap = hc_get_chip_cap(ad->hdev_ctrl);
-
-	if ((pChipCap->hw_version == 0) && (ad->ixia_mode_ctl.mode_entered)) {
-		UINT32 agglimit = 64;
-		BOOLEAN uplink = FALSE;
-
-		if ((ad->txop_ctl[band_idx].multi_client_nums == 0) &&
-			(ad->txop_ctl[band_idx].multi_rx_client_nums > 0) &&
-			(ad->mcli_ctl[band_idx].pkt_avg_len < 64) &&
-			(ad->mcli_ctl[band_idx].pkt_rx_avg_len > 64))
-			uplink = TRUE;
-
-		if ((band_idx == DBDC_BAND0) && uplink) {
-			if (ad->txop_ctl[band_idx].multi_rx_client_nums == 1)
-				agglimit = 0x05;
-
-			if (ad->txop_ctl[band_idx].multi_rx_client_nums > 1)
-				agglimit = 0x05;
-
-			if (ad->txop_ctl[band_idx].multi_rx_client_nums > 14) {
-				if (ad->ixia_mode_ctl.sta_nums >= 20)
-					agglimit = 0x06;
-				if (ad->ixia_mode_ctl.sta_nums >= 32)
-					agglimit = 0x07;
-			}
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len < ((88+128)>>1))
-				agglimit -= 2;
-			else if (ad->mcli_ctl[band_idx].pkt_rx_avg_len <= ((128+256)>>1))
-				agglimit -= 1;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((128+256)>>1))
-				agglimit += 3;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((256+512)>>1))
-				agglimit += 3;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((1024+512)>>1))
-				agglimit = 0xf;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((1518+1024)>>1))
-				agglimit = 0x0;
-		}
-		if ((band_idx == DBDC_BAND1) && uplink) {
-			if (ad->txop_ctl[band_idx].multi_rx_client_nums == 1)
-				agglimit = 0x05;
-
-			if (ad->txop_ctl[band_idx].multi_rx_client_nums > 1)
-				agglimit = 0x06;
-
-			if (ad->txop_ctl[band_idx].multi_rx_client_nums > 14) {
-				if (ad->ixia_mode_ctl.sta_nums >= 20)
-					agglimit = 0x07;
-				if (ad->ixia_mode_ctl.sta_nums >= 32)
-					agglimit = 0x08;
-			}
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len < ((88+128)>>1))
-				agglimit -= 2;
-			else if (ad->mcli_ctl[band_idx].pkt_rx_avg_len <= ((128+256)>>1))
-				agglimit -= 1;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((128+256)>>1))
-				agglimit += 3;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((256+512)>>1))
-				agglimit += 4;
-
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((1024+512)>>1))
-				agglimit = 0xf;
-
-			if (ad->mcli_ctl[band_idx].pkt_rx_avg_len > ((1518+1024)>>1))
-				agglimit = 0x0;
-
-		}
-
-		if (ad->mcli_ctl[band_idx].force_agglimit > 0)
-			agglimit = ad->mcli_ctl[band_idx].force_agglimit;
-
-		if ((ad->mcli_ctl[band_idx].cur_agglimit != agglimit) && uplink) {
-			asic_set_agglimit(ad, band_idx, WMM_AC_BE, wdev, agglimit);
-			ad->mcli_ctl[band_idx].cur_agglimit = agglimit;
-		}
-	}
-	}
-#endif
-#endif
 	return;
 
 }
@@ -2577,10 +2474,6 @@ static VOID dynamic_mcli_param_adjust(struct _RTMP_ADAPTER *pAd)
 	for (BandIdx = 0; BandIdx < DBDC_BAND_NUM; BandIdx++) {
 		mcli_tcp_check = FALSE;
 
-		/* consider ixia mode */
-		if (pAd->ixia_mode_ctl.isIxiaOn)
-			continue;
-
 		if ((pAd->txop_ctl[BandIdx].multi_client_nums >= pAd->multi_cli_nums_eap_th
 #ifdef RX_COUNT_DETECT
 			|| pAd->txop_ctl[BandIdx].multi_rx_client_nums >= pAd->multi_cli_nums_eap_th
@@ -3266,10 +3159,6 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 							  ((pEntry->avg_rx_pkts + pEntry->one_sec_rx_pkts) >> 1);
 		pEntry->one_sec_rx_pkts = 0;
 #endif /* RX_COUNT_DETECT */
-#ifdef KERNEL_RPS_ADJUST
-		if (pAd->ixia_mode_ctl.kernel_rps_en)
-			detect_1_pair_peak(pAd, pEntry, BandIdx);
-#endif
 #ifdef APCLI_SUPPORT
 		if (IS_ENTRY_PEER_AP(pEntry)) {
 			PSTA_ADMIN_CONFIG pApCliEntry = &pAd->StaCfg[pEntry->func_tb_idx];
@@ -3297,9 +3186,6 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 			}
 		}
 #endif /* APCLI_SUPPORT */
-#ifdef KERNEL_RPS_ADJUST
-	if (!pAd->ixia_mode_ctl.mode_entered)
-#endif
 #ifdef ERR_RECOVERY
         if (!IsStopingPdma(&pAd->ErrRecoveryCtl))
 #endif
@@ -3573,19 +3459,6 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 
 #ifdef RED_SUPPORT
 			if ((pAd->mcli_ctl[BandIdx].tx_cnt_from_red == TRUE) && (pAd->red_en)) {
-#ifdef KERNEL_RPS_ADJUST
-				if (pAd->ixia_mode_ctl.mode_entered) {
-					if (pEntry->one_sec_tx_mpdu_succ_pkts > INFRA_KEEP_STA_PKT_TH &&
-						pEntry->NoDataIdleCount != 0)
-						pEntry->NoDataIdleCount = 0;
-#ifdef RX_COUNT_DETECT
-					if (pEntry->one_sec_rx_pkts > INFRA_KEEP_STA_PKT_TH)
-						is_no_rx_cnt = FALSE;
-					else
-#endif
-						is_no_rx_cnt = TRUE;
-				}
-#endif
 				pEntry->one_sec_tx_mpdu_succ_pkts = 0;
 			}
 #endif
@@ -4465,19 +4338,7 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 		}
 	}
 #ifdef KERNEL_RPS_ADJUST
-	if (pAd->ixia_mode_ctl.kernel_rps_en) {
-#ifdef RTMP_MAC_PCI
-	RTMP_IRQ_LOCK(&pAd->irq_lock, IrqFlags);
-#endif /* RTMP_MAC_PCI */
-		dynamic_proc_rps_adjust(pAd);
-#ifdef RTMP_MAC_PCI
-	RTMP_IRQ_UNLOCK(&pAd->irq_lock, IrqFlags);
-#endif /* RTMP_MAC_PCI */
-}
-
-#endif
-#ifdef KERNEL_RPS_ADJUST
-	if (!pAd->ixia_mode_ctl.mode_entered)
+	RpsPolicyPeriodic(pAd);
 #endif
 	dynamic_txop_adjust(pAd);
 #ifdef DELAY_TCP_ACK_V2
@@ -4496,13 +4357,10 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 	dynamic_agg_per_sta_adjust(pAd);
 
 #ifdef KERNEL_RPS_ADJUST
-	if (!pAd->ixia_mode_ctl.kernel_rps_en)
+	if (!pAd->dyn_mode_ctl.kernel_rps_en)
 #endif
 	dynamic_sw_rps_control(pAd);
 
-#ifdef KERNEL_RPS_ADJUST
-	if (!pAd->ixia_mode_ctl.mode_entered)
-#endif
 	dynamic_ampdu_efficiency_adjust_all(pAd);
 
 	if (pAd->CommonCfg.bRalinkBurstMode && pMacTable->fAllStationGainGoodMCS)
@@ -4556,13 +4414,8 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 	RTMP_IRQ_UNLOCK(&pAd->irq_lock, IrqFlags);
 #endif /* RTMP_MAC_PCI */
 	for (BandIdx = 0; BandIdx < DBDC_BAND_NUM; BandIdx++) {
-#ifdef KERNEL_RPS_ADJUST
-		if (!pAd->ixia_mode_ctl.kernel_rps_en)
-#endif
-		{
-			pAd->txop_ctl[BandIdx].last_client_num = pAd->txop_ctl[BandIdx].multi_client_nums;
-			pAd->txop_ctl[BandIdx].last_rx_client_num = pAd->txop_ctl[BandIdx].multi_rx_client_nums;
-		}
+		pAd->txop_ctl[BandIdx].last_client_num = pAd->txop_ctl[BandIdx].multi_client_nums;
+		pAd->txop_ctl[BandIdx].last_rx_client_num = pAd->txop_ctl[BandIdx].multi_rx_client_nums;
 		pAd->mcli_ctl[BandIdx].last_large_rssi_gap_num = pAd->mcli_ctl[BandIdx].large_rssi_gap_num;
 		pAd->txop_ctl[BandIdx].last_tcp_nums =  pAd->txop_ctl[BandIdx].multi_tcp_nums;
 		pAd->txop_ctl[BandIdx].multi_client_nums = 0;
@@ -4577,15 +4430,15 @@ VOID MacTableMaintenance(RTMP_ADAPTER *pAd)
 	}
 
 #ifdef RED_SUPPORT
-	if (pAd->ixia_mode_ctl.fgProbeRspDetect == TRUE) {
-		if (pAd->ixia_mode_ctl.fgSkipRedQLenDrop == FALSE) {
+	if (pAd->dyn_mode_ctl.fgProbeRspDetect == TRUE) {
+		if (pAd->dyn_mode_ctl.fgSkipRedQLenDrop == FALSE) {
 			if (pAd->red_mcu_offload)
 				red_qlen_drop_setting(pAd, 1);
-			pAd->ixia_mode_ctl.fgSkipRedQLenDrop = TRUE;
+			pAd->dyn_mode_ctl.fgSkipRedQLenDrop = TRUE;
 		}
 	} else {
-		if (pAd->ixia_mode_ctl.fgSkipRedQLenDrop == TRUE) {
-			pAd->ixia_mode_ctl.fgSkipRedQLenDrop = FALSE;
+		if (pAd->dyn_mode_ctl.fgSkipRedQLenDrop == TRUE) {
+			pAd->dyn_mode_ctl.fgSkipRedQLenDrop = FALSE;
 			if (pAd->red_mcu_offload)
 				red_qlen_drop_setting(pAd, 0);
 		}
@@ -2305,6 +2305,9 @@ static struct {
 	{"txcmd_debug_sop",			set_txcmd_dbg_sop},
 #endif /* CFG_SUPPORT_FALCON_TXCMD_DBG */
 	{"mcli",                   set_mcli_cfg},
+#ifdef KERNEL_RPS_ADJUST
+	{"rps_policy",			Set_RpsPolicy_Proc},
+#endif /* KERNEL_RPS_ADJUST */
 #ifdef VOW_SUPPORT
 	/* VOW GROUP table */
 	{"vow_min_rate_token",  set_vow_min_rate_token},
@@ -3180,6 +3183,11 @@ static struct {
 #endif /* CFG_SUPPORT_FALCON_TXCMD_DBG */
 
 	{"hwctrl", Show_HwCtrlStatistic_Proc},
+	{"hwctrl_lat", Show_HwCtrlLatency_Proc},
+	{"mcu_rtt", Show_McuCmdRtt_Proc},
+#ifdef KERNEL_RPS_ADJUST
+	{"rps_load", Show_RpsLoad_Proc},
+#endif /* KERNEL_RPS_ADJUST */
 #ifdef DOT11_HE_AX
 	{"colorinfo", show_bsscolor_proc},
 #endif
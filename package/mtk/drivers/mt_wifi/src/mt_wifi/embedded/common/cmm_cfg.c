@@ -11336,7 +11336,6 @@ INT set_mcli_cfg(
 {
 	UINT32 rv, cmd, op, op2, op3, op4;
 	UCHAR band_idx = 0;
-	INT ret, len;
 	POS_COOKIE pObj = (POS_COOKIE) pAd->OS_Cookie;
 	struct wifi_dev *wdev = get_wdev_by_ioctl_idx_and_iftype(pAd, pObj->ioctl_if, pObj->ioctl_if_type);
 #ifdef KERNEL_RPS_ADJUST
@@ -11384,8 +11383,8 @@ INT set_mcli_cfg(
 				MTWF_PRINT("mcli_tcp:%u\n", pAd->txop_ctl[band_idx].last_tcp_nums);
 				MTWF_PRINT("pkt_avg_len:%u\n", pAd->mcli_ctl[band_idx].pkt_avg_len);
 				MTWF_PRINT("pkt_rx_avg_len:%u\n", pAd->mcli_ctl[band_idx].pkt_rx_avg_len);
-				MTWF_PRINT("proc_rps mode:%u\n", pAd->mcli_ctl[band_idx].proc_rps_mode);
-				MTWF_PRINT("rps_state_flag:0x%08X\n", pAd->mcli_ctl[band_idx].rps_state_flag);
+				MTWF_PRINT("rps_mask:0x%x applied:0x%x\n", pAd->rps_ctl.arBand[band_idx].u4Want,
+					pAd->rps_ctl.arBand[band_idx].u4Applied);
 				MTWF_PRINT("force_agglimit:%u\n",
 					pAd->mcli_ctl[band_idx].force_agglimit);
 				MTWF_PRINT("cur_agglimit:%u\n",
@@ -11441,40 +11440,6 @@ INT set_mcli_cfg(
 				chip_cap->RxSwRpsCpuMap[0], chip_cap->RxSwRpsNum);
 			break;
 #endif
-		case MCLI_FORCE_RPS_CFG:
-			if (band_idx < DBDC_BAND_NUM) {
-				pAd->mcli_ctl[band_idx].force_rps_cfg = TRUE;
-				len = sizeof(pAd->mcli_ctl[band_idx].force_proc_rps[ETH0_RPS_FILE]);
-				ret = snprintf(pAd->mcli_ctl[band_idx].force_proc_rps[ETH0_RPS_FILE], len, "%d", op);
-				if (os_snprintf_error(len, ret)) {
-					MTWF_PRINT("snprintf error!\n");
-					return FALSE;
-				}
-				len = sizeof(pAd->mcli_ctl[band_idx].force_proc_rps[BAND0_RPS_FILE]);
-				ret = snprintf(pAd->mcli_ctl[band_idx].force_proc_rps[BAND0_RPS_FILE], len, "%d", op2);
-				if (os_snprintf_error(len, ret)) {
-					MTWF_PRINT("snprintf error!\n");
-					return FALSE;
-				}
-				len = sizeof(pAd->mcli_ctl[band_idx].force_proc_rps[BAND1_RPS_FILE]);
-				ret = snprintf(pAd->mcli_ctl[band_idx].force_proc_rps[BAND1_RPS_FILE], len, "%d", op3);
-				if (os_snprintf_error(len, ret)) {
-					MTWF_PRINT("snprintf error!\n");
-					return FALSE;
-				}
-				len = sizeof(pAd->mcli_ctl[band_idx].force_proc_rps[TXFREE_IRQ_FILE]);
-				ret = snprintf(pAd->mcli_ctl[band_idx].force_proc_rps[TXFREE_IRQ_FILE], len, "%d", op4);
-				if (os_snprintf_error(len, ret)) {
-					MTWF_PRINT("snprintf error!\n");
-					return FALSE;
-				}
-				MTWF_PRINT("proc_rps [%s %s %s %s]\n",
-					pAd->mcli_ctl[band_idx].force_proc_rps[ETH0_RPS_FILE],
-					pAd->mcli_ctl[band_idx].force_proc_rps[BAND0_RPS_FILE],
-					pAd->mcli_ctl[band_idx].force_proc_rps[BAND1_RPS_FILE],
-					pAd->mcli_ctl[band_idx].force_proc_rps[TXFREE_IRQ_FILE]);
-			}
-			break;
 #endif
 		case MCLI_CLI_NUMS_EAP_TH:
 			pAd->multi_cli_nums_eap_th = op;
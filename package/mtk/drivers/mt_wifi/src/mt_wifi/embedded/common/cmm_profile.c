@@ -10608,9 +10608,9 @@ void rtmp_read_kernel_rps_parms_from_file(IN    PRTMP_ADAPTER pAd, char *tmpbuf,
 
 	/* for enable/disable */
 	if (RTMPGetKeyParameter("KernelRps", tmpbuf, 128, buffer, TRUE) && (strlen(tmpbuf) > 0)) {
-		pAd->ixia_mode_ctl.kernel_rps_en =  os_str_tol(tmpbuf, 0, 10);
+		pAd->dyn_mode_ctl.kernel_rps_en =  os_str_tol(tmpbuf, 0, 10);
 		MTWF_DBG(pAd, DBG_CAT_CFG, DBG_SUBCAT_ALL, DBG_LVL_INFO, "KernelRps --> %d\n",
-			pAd->ixia_mode_ctl.kernel_rps_en);
+			pAd->dyn_mode_ctl.kernel_rps_en);
 	}
 }
 #endif
@@ -42,6 +42,7 @@
 #ifdef REDUCE_ACK_DEBUG
 #define CNX_DPRINT(pAd, cnx, string)                           \
 	do {                                                    \
+		char _sip[RACK_ADDR_LEN], _dip[RACK_ADDR_LEN];     \
 		if ((pAd) == NULL || (pAd)->CommonCfg.ReduceAckEnable != REDUCE_ACK_ENABLE_WITOUT_DEL_CNX) {\
 			break;                                         \
 		}                                                  \
@@ -49,16 +50,10 @@
 			printk("[rack] cnx is NULL (%s)\n", string);   \
 			break;                                         \
 		}                                                  \
-		printk("[cnx] %u.%u.%u.%u:%u --> %u.%u.%u.%u:%u, seq=%u, rel_seq=%u, ack=%u, rel_ack=%u, win=%u, bif=%u (%s)\n",\
-			   ((cnx)->tuple.sip >> 24) & 0xFF,           \
-			   ((cnx)->tuple.sip >> 16) & 0xFF,           \
-			   ((cnx)->tuple.sip >> 8) & 0xFF,            \
-			   ((cnx)->tuple.sip >> 0) & 0xFF,            \
+		printk("[cnx] %s:%u --> %s:%u, seq=%u, rel_seq=%u, ack=%u, rel_ack=%u, win=%u, bif=%u (%s)\n",\
+			   rack_addr_str(&(cnx)->tuple, (cnx)->tuple.sip, _sip), \
 			   (cnx)->tuple.sport,                        \
-			   ((cnx)->tuple.dip >> 24) & 0xFF,           \
-			   ((cnx)->tuple.dip >> 16) & 0xFF,           \
-			   ((cnx)->tuple.dip >> 8) & 0xFF,            \
-			   ((cnx)->tuple.dip >> 0) & 0xFF,            \
+			   rack_addr_str(&(cnx)->tuple, (cnx)->tuple.dip, _dip), \
 			   (cnx)->tuple.dport,                        \
 			   (cnx)->seq,                                \
 			   (cnx)->rel_seq,                            \
@@ -71,23 +66,18 @@
 
 #define PKT_DPRINT(pAd, pkt, string)                           \
 	do {                                                    \
+		char _sip[RACK_ADDR_LEN], _dip[RACK_ADDR_LEN];     \
 		if ((pAd) == NULL || (pAd)->CommonCfg.ReduceAckEnable != REDUCE_ACK_ENABLE_WITOUT_DEL_CNX) {\
 			break;                                         \
 		}                                                  \
 		if ((pkt) == NULL) {                               \
 			printk("[pkt] pkt is NULL (%s)\n", string);   \
 		}                                                  \
-		printk("[pkt] %u.%u.%u.%u:%u --> %u.%u.%u.%u:%u, len=%u, opt_len=%u, flags=%x (%s)\n",\
-			   ((pkt)->sip >> 24) & 0xFF,                 \
-			   ((pkt)->sip >> 16) & 0xFF,                 \
-			   ((pkt)->sip >> 8) & 0xFF,                  \
-			   ((pkt)->sip >> 0) & 0xFF,                  \
-			   (pkt)->sport,                              \
-			   ((pkt)->dip >> 24) & 0xFF,                 \
-			   ((pkt)->dip >> 16) & 0xFF,                 \
-			   ((pkt)->dip >> 8) & 0xFF,                  \
-			   ((pkt)->dip >> 0) & 0xFF,                  \
-			   (pkt)->dport,                              \
+		printk("[pkt] %s:%u --> %s:%u, len=%u, opt_len=%u, flags=%x (%s)\n",\
+			   rack_addr_str(&(pkt)->tuple, (pkt)->tuple.sip, _sip), \
+			   (pkt)->tuple.sport,                        \
+			   rack_addr_str(&(pkt)->tuple, (pkt)->tuple.dip, _dip), \
+			   (pkt)->tuple.dport,                        \
 			   (pkt)->data_len,                           \
 			   (pkt)->opt_len,                            \
 			   (pkt)->flags,                              \
@@ -107,6 +97,41 @@
 #define MY_LOCK(pAd) do {RTMP_SEM_LOCK(&pAd->ReduceAckLock); } while (0)
 #define MY_UNLOCK(pAd) do {RTMP_SEM_UNLOCK(&pAd->ReduceAckLock); } while (0)
 
+/* Hash bucket update locks, lock order is bucket lock -> MY_LOCK */
+#define BUCKET_LOCK(pAd, hash) \
+	spin_lock_bh(&(pAd)->ackCnxBucketLock[(hash) & (REDUCE_ACK_LOCK_BUCKETS - 1)])
+#define BUCKET_UNLOCK(pAd, hash) \
+	spin_unlock_bh(&(pAd)->ackCnxBucketLock[(hash) & (REDUCE_ACK_LOCK_BUCKETS - 1)])
+
+#define RACK_ADDR_LEN	48
+
+/*
+========================================================================
+Routine Description:
+    Format an address of a connection tuple for printing
+
+Arguments:
+    rack_tuple   *tuple     The tuple the address belongs to.
+    UINT32       *addr      The source or destination address of tuple.
+    char         *buf       Output buffer of RACK_ADDR_LEN bytes.
+
+Return Value:
+    buf
+
+Note:
+    None
+========================================================================
+*/
+static char *rack_addr_str(rack_tuple *tuple, UINT32 *addr, char *buf)
+{
+	if (tuple->family == AF_INET6)
+		snprintf(buf, RACK_ADDR_LEN, "[%pI6c]", addr);
+	else
+		snprintf(buf, RACK_ADDR_LEN, "%pI4", addr);
+
+	return buf;
+}
+
 /*
 ========================================================================
 Routine Description:
@@ -124,13 +149,13 @@ Note:
 */
 static BOOLEAN match_black_list(rack_packet *pkt)
 {
-	if (pkt->sport == 21 || pkt->dport == 21)
+	if (pkt->tuple.sport == 21 || pkt->tuple.dport == 21)
 		return TRUE;
 
-	if (pkt->sport == 23 || pkt->dport == 23)
+	if (pkt->tuple.sport == 23 || pkt->tuple.dport == 23)
 		return TRUE;
 
-	if (pkt->sport == 22 || pkt->dport == 22)
+	if (pkt->tuple.sport == 22 || pkt->tuple.dport == 22)
 		return TRUE;
 
 	return FALSE;
@@ -235,86 +260,57 @@ static BOOLEAN decide_to_drop(RTMP_ADAPTER *pAd, rack_packet *pkt, rack_cnx *cnx
 /*
 ========================================================================
 Routine Description:
-    The hash function for incoming pkt
+    The hash function for a connection tuple
 
 Arguments:
-    rack_packet      *pkt       The info of incoming ACK packet.
+    rack_tuple       *tuple     The tuple in ACK direction.
 
 Return Value:
-    The calculated index of hash table
+    The hash value, the low bits select the hash bucket and its lock
 
 Note:
 
 ========================================================================
 */
-static UINT32 hash_cnx(rack_packet *pkt)
+static UINT32 hash_cnx(rack_tuple *tuple)
 {
-	UINT32 n, h, index;
-
-	if (pkt->type == TCP_ACK) {
-		n = jhash((void *)&(pkt->dip), sizeof(pkt->dip),
-				  (pkt->dport << 16));
-		h = jhash((void *)&(pkt->sip), sizeof(pkt->sip),
-				  (pkt->sport | n));
-	} else {
-		n = jhash((void *)&(pkt->sip), sizeof(pkt->sip),
-				  (pkt->sport << 16));
-		h = jhash((void *)&(pkt->dip), sizeof(pkt->dip),
-				  (pkt->dport | n));
-	}
-
-	index = ((u64)h * MAX_REDUCE_ACK_CNX_ENTRY) >> 32;
-	index = index % REDUCE_ACK_MAX_HASH_BUCKETS;
-	return index;
+	return jhash2((UINT32 *)tuple, sizeof(*tuple) / sizeof(UINT32), 0);
 }
 
 /*
 ========================================================================
 Routine Description:
-    The utility function find corresponding connection given a pkt
+    The utility function find corresponding connection given a tuple
 
 Arguments:
     RTMP_ADAPTER     *pAd       Pointer refer to the device handle.
-    rack_packet      *pkt       The info of incoming ACK packet.
+    rack_tuple       *tuple     The tuple in ACK direction.
+    UINT32           hash       hash_cnx() of tuple.
 
 Return Value:
     The corresponding connection entry or NULL if not found.
 
 Note:
-
+    The caller either holds rcu_read_lock() or the bucket lock of hash.
 ========================================================================
 */
-static rack_cnx *find_cnx(RTMP_ADAPTER *pAd, rack_packet *pkt)
+static rack_cnx *find_cnx(RTMP_ADAPTER *pAd, rack_tuple *tuple, UINT32 hash)
 {
 #if LINUX_VERSION_CODE  < KERNEL_VERSION(3, 9, 0)
 	struct hlist_node *tmp;
 #endif
 	rack_cnx *cnx = NULL;
-	BOOLEAN bFound = FALSE;
-	UINT32 hashIndex = hash_cnx(pkt);
+	struct hlist_head *head = &(pAd->ackCnxHashTbl[hash & (REDUCE_ACK_MAX_HASH_BUCKETS - 1)]);
 #if LINUX_VERSION_CODE  < KERNEL_VERSION(3, 9, 0)
-	hlist_for_each_entry(cnx, tmp, &(pAd->ackCnxHashTbl[hashIndex]), hnode) {
+	hlist_for_each_entry_rcu(cnx, tmp, head, hnode) {
 #else
-	hlist_for_each_entry(cnx, &(pAd->ackCnxHashTbl[hashIndex]), hnode) {
+	hlist_for_each_entry_rcu(cnx, head, hnode) {
 #endif
 
-		if (pkt->type == TCP_ACK && cnx->tuple.sip == pkt->sip &&
-			cnx->tuple.dip == pkt->dip &&
-			cnx->tuple.sport == pkt->sport &&
-			cnx->tuple.dport == pkt->dport) {
-			bFound = TRUE;
-			break;
-		}
-
-		if (pkt->type == TCP_DATA && cnx->tuple.dip == pkt->sip &&
-			cnx->tuple.sip == pkt->dip &&
-			cnx->tuple.dport == pkt->sport &&
-			cnx->tuple.sport == pkt->dport) {
-			bFound = TRUE;
-			break;
-		}
+		if (cnx->hash == hash && !memcmp(&cnx->tuple, tuple, sizeof(*tuple)))
+			return cnx;
 	}
-	return bFound ? cnx : NULL;
+	return NULL;
 }
 
 /*
@@ -406,7 +402,7 @@ static VOID parse_tcp_options(UCHAR *ptr, UINT32 length, rack_packet *pkt)
 			if (opsize < 2) /* "silly options" */
 				return;
 
-			if (opsize > length)
+			if ((UINT32)opsize > length)
 				return; /* don't parse partial options */
 
 			switch (opcode) {
@@ -478,17 +474,23 @@ Return Value:
     FALSE - others
 
 Note:
+    IPv4 and IPv6 (without extension headers) are supported. The tuple of
+    a DATA packet is swapped into ACK direction.
 
 ========================================================================
 */
 static BOOLEAN parse_tcp_packet(PNDIS_PACKET pPacket, rack_packet *pkt)
 {
-	PUCHAR pSrcBuf;
+	PUCHAR pSrcBuf, pTcpHdr;
 	BOOLEAN bRet = FALSE;
-	UINT32 pktLen, tcpdata_len;
+	UINT32 pktLen, tcpdata_len, ipLen, headerLen;
 	USHORT TypeLen = 0;
 	pSrcBuf = GET_OS_PKT_DATAPTR(pPacket);
 	pktLen = GET_OS_PKT_LEN(pPacket);
+
+	if (pktLen < 14 + 8)
+		return FALSE;
+
 	tcpdata_len = pktLen;
 	tcpdata_len -= 14;/* minus Ethernet header */
 	/* get Ethernet protocol field*/
@@ -498,46 +500,83 @@ static BOOLEAN parse_tcp_packet(PNDIS_PACKET pPacket, rack_packet *pkt)
 	if (TypeLen == 0x8100) {
 		pSrcBuf += 4;
 		tcpdata_len -= 4; /* minus VLAN header */
+		TypeLen = OS_NTOHS(*((UINT16 *)(pSrcBuf + 12)));
 	} else if ((TypeLen == 0x9100) || (TypeLen == 0x9200) || (TypeLen == 0x9300)) {
 		pSrcBuf += 8;
 		tcpdata_len -= 8; /* minus VLAN header */
+		TypeLen = OS_NTOHS(*((UINT16 *)(pSrcBuf + 12)));
 	}
 
+	memset(&pkt->tuple, 0, sizeof(pkt->tuple));
+
 	if ((TypeLen == 0x0800) /* Type: IP (0x0800) */
+		&& (tcpdata_len >= 20 + 20)
 		&& (pSrcBuf[23] == 0x06)) { /* Protocol: TCP (0x06) */
-		UINT16 headerLen = (*((UINT8 *)(pSrcBuf + 46))) / 4;
-		UINT16 opt_len = headerLen - 20;
-		tcpdata_len -= 20; /* minus IP header */
-		tcpdata_len -= headerLen; /* minus TCP header */
-		pkt->sip = OS_NTOHL(*((UINT32 *)(pSrcBuf + 26)));
-		pkt->dip = OS_NTOHL(*((UINT32 *)(pSrcBuf + 30)));
-		pkt->sport = OS_NTOHS(*((UINT16 *)(pSrcBuf + 34)));
-		pkt->dport = OS_NTOHS(*((UINT16 *)(pSrcBuf + 36)));
-		pkt->seq = OS_NTOHL(*((UINT32 *)(pSrcBuf + 38)));
-		pkt->ack = OS_NTOHL(*((UINT32 *)(pSrcBuf + 42)));
-		pkt->flags = (*((UINT8 *)(pSrcBuf + 47)));
-		pkt->wsize = OS_NTOHS(*((USHORT *)(pSrcBuf + 48)));
-		pkt->opt_len = opt_len;
-		pkt->opt_have_sack = 0;
-
-		if (opt_len > 0 /*&& (pkt->flags & TCPHDR_SYN)*/)
-			parse_tcp_options((UCHAR *)(pSrcBuf + 54), opt_len, pkt);
-
-		pkt->mss = 1460;/* / Use 1460 here to avoid tracking TCP handshake process. */
-		pkt->data_len = tcpdata_len;
-		RTMP_GetCurrentSystemTick(&(pkt->timestamp));
-
-		if ((pkt->flags & TCPHDR_ACK)) {
-			if (pkt->data_len > 6)
-				pkt->type = TCP_DATA;
-			else
-				pkt->type = TCP_ACK;
-
-			bRet = TRUE;
-		} else if (pkt->data_len > 6) {
+		ipLen = (pSrcBuf[14] & 0x0F) * 4;
+		pkt->tuple.family = AF_INET;
+		memcpy(&pkt->tuple.sip[0], pSrcBuf + 26, 4);
+		memcpy(&pkt->tuple.dip[0], pSrcBuf + 30, 4);
+	} else if ((TypeLen == 0x86DD) /* Type: IPv6 (0x86DD) */
+		&& (tcpdata_len >= 40 + 20)
+		&& (pSrcBuf[20] == 0x06)) { /* Next header: TCP (0x06), no extension headers */
+		ipLen = 40;
+		pkt->tuple.family = AF_INET6;
+		memcpy(pkt->tuple.sip, pSrcBuf + 22, 16);
+		memcpy(pkt->tuple.dip, pSrcBuf + 38, 16);
+	} else
+		return FALSE;
+
+	if (ipLen < 20 || tcpdata_len < ipLen + 20)
+		return FALSE;
+
+	pTcpHdr = pSrcBuf + 14 + ipLen;
+	headerLen = (pTcpHdr[12] >> 4) * 4;
+
+	if (headerLen < 20 || tcpdata_len < ipLen + headerLen)
+		return FALSE;
+
+	tcpdata_len -= ipLen; /* minus IP header */
+	tcpdata_len -= headerLen; /* minus TCP header */
+	pkt->tuple.sport = OS_NTOHS(*((UINT16 *)(pTcpHdr + 0)));
+	pkt->tuple.dport = OS_NTOHS(*((UINT16 *)(pTcpHdr + 2)));
+	pkt->seq = OS_NTOHL(*((UINT32 *)(pTcpHdr + 4)));
+	pkt->ack = OS_NTOHL(*((UINT32 *)(pTcpHdr + 8)));
+	pkt->flags = (*((UINT8 *)(pTcpHdr + 13)));
+	pkt->wsize = OS_NTOHS(*((USHORT *)(pTcpHdr + 14)));
+	pkt->opt_len = headerLen - 20;
+	pkt->opt_have_sack = 0;
+
+	if (pkt->opt_len > 0 /*&& (pkt->flags & TCPHDR_SYN)*/)
+		parse_tcp_options((UCHAR *)(pTcpHdr + 20), pkt->opt_len, pkt);
+
+	pkt->mss = 1460;/* / Use 1460 here to avoid tracking TCP handshake process. */
+	pkt->data_len = tcpdata_len;
+	RTMP_GetCurrentSystemTick(&(pkt->timestamp));
+
+	if ((pkt->flags & TCPHDR_ACK)) {
+		if (pkt->data_len > 6)
 			pkt->type = TCP_DATA;
-			bRet = TRUE;
-		}
+		else
+			pkt->type = TCP_ACK;
+
+		bRet = TRUE;
+	} else if (pkt->data_len > 6) {
+		pkt->type = TCP_DATA;
+		bRet = TRUE;
+	}
+
+	/* Connections are keyed in ACK direction */
+	if (bRet && pkt->type == TCP_DATA) {
+		rack_tuple *t = &pkt->tuple;
+		UINT32 addr[4];
+		UINT16 port;
+
+		memcpy(addr, t->sip, sizeof(addr));
+		memcpy(t->sip, t->dip, sizeof(addr));
+		memcpy(t->dip, addr, sizeof(addr));
+		port = t->sport;
+		t->sport = t->dport;
+		t->dport = port;
 	}
 
 	return bRet;
@@ -551,19 +590,19 @@ Routine Description:
 Arguments:
     RTMP_ADAPTER     *pAd       Pointer refer to the device handle.
     rack_packet  *incmoing_pkt  The parsed results will be set to pkt
+    UINT32           hash       hash_cnx() of the packet tuple
 
 Return Value:
     The new added connection entry
 
 Note:
-
+    Called with the bucket lock of hash held.
 ========================================================================
 */
-static rack_cnx *add_cnx(RTMP_ADAPTER *pAd, rack_packet *incoming_pkt)
+static rack_cnx *add_cnx(RTMP_ADAPTER *pAd, rack_packet *incoming_pkt, UINT32 hash)
 {
 	rack_cnx *cnx;
-	os_alloc_mem_suspend(NULL, (UCHAR **)&cnx, sizeof(rack_cnx));
-	UINT32 hashIndex = hash_cnx(incoming_pkt);
+	os_alloc_mem(NULL, (UCHAR **)&cnx, sizeof(rack_cnx));
 
 	if (cnx == NULL)
 		return NULL;
@@ -572,10 +611,8 @@ static rack_cnx *add_cnx(RTMP_ADAPTER *pAd, rack_packet *incoming_pkt)
 	/* search Window Scale optoin if any */
 	cnx->wscale = incoming_pkt->wscale;
 	/* setup CNX */
-	cnx->tuple.sip = incoming_pkt->sip;
-	cnx->tuple.dip = incoming_pkt->dip;
-	cnx->tuple.sport = incoming_pkt->sport;
-	cnx->tuple.dport = incoming_pkt->dport;
+	cnx->tuple = incoming_pkt->tuple;
+	cnx->hash = hash;
 	cnx->ack = incoming_pkt->ack;
 	cnx->ref_ack = cnx->ack - 1;
 
@@ -588,12 +625,34 @@ static rack_cnx *add_cnx(RTMP_ADAPTER *pAd, rack_packet *incoming_pkt)
 	cnx->state = STATE_INIT;
 	cnx->mss = incoming_pkt->mss;
 	/* add CNX into hlist and connection list */
-	hlist_add_head(&(cnx->hnode), &(pAd->ackCnxHashTbl[hashIndex]));
-	list_add(&(cnx->list), &(pAd->ackCnxList));
+	hlist_add_head_rcu(&(cnx->hnode), &(pAd->ackCnxHashTbl[hash & (REDUCE_ACK_MAX_HASH_BUCKETS - 1)]));
+	MY_LOCK(pAd);
+	list_add_rcu(&(cnx->list), &(pAd->ackCnxList));
 	pAd->ReduceAckConnections++;
+	MY_UNLOCK(pAd);
 	return cnx;
 }
 
+/*
+========================================================================
+Routine Description:
+    The utility function to delete a connection entry
+
+Arguments:
+    struct rcu_head  *head      The rcu_head of the CNX to be freed
+
+Return Value:
+    VOID
+
+Note:
+
+========================================================================
+*/
+static VOID free_cnx_rcu(struct rcu_head *head)
+{
+	os_free_mem(container_of(head, rack_cnx, rcu));
+}
+
 /*
 ========================================================================
 Routine Description:
@@ -607,28 +666,85 @@ Return Value:
     VOID
 
 Note:
-
+    Called with the bucket lock of cnx held. Lockless readers may still
+    see the CNX until the RCU grace period ends.
 ========================================================================
 */
 static VOID delete_cnx(RTMP_ADAPTER *pAd, rack_cnx *cnx)
 {
-	if (cnx) {
-		hlist_del(&(cnx->hnode));
-		list_del(&(cnx->list));
+	cnx->dead = TRUE;
+	hlist_del_rcu(&(cnx->hnode));
 #if REDUCE_ACK_PKT_CACHE
 
-		if (cnx->cache.raw_pkt != NULL) {
-			RELEASE_NDIS_PACKET(pAd, cnx->cache.raw_pkt, NDIS_STATUS_FAILURE);
-			cnx->cache.raw_pkt = NULL;
-			memset(&(cnx->cache.rack), 0, sizeof(cnx->cache.rack));
-		}
+	if (cnx->cache.raw_pkt != NULL) {
+		RELEASE_NDIS_PACKET(pAd, cnx->cache.raw_pkt, NDIS_STATUS_FAILURE);
+		cnx->cache.raw_pkt = NULL;
+		memset(&(cnx->cache.rack), 0, sizeof(cnx->cache.rack));
+	}
 
 #endif
-		os_free_mem(cnx);
-	}
+	MY_LOCK(pAd);
+	list_del_rcu(&(cnx->list));
 
 	if (pAd->ReduceAckConnections > 0)
 		pAd->ReduceAckConnections--;
+
+	MY_UNLOCK(pAd);
+	call_rcu(&(cnx->rcu), free_cnx_rcu);
+}
+
+/*
+========================================================================
+Routine Description:
+    The utility function to delete a connection entry found on the
+    connection list
+
+Arguments:
+    RTMP_ADAPTER     *pAd       Pointer refer to the device handle.
+    rack_cnx         *cnx       The CNX to be deleted
+
+Return Value:
+    VOID
+
+Note:
+    Called under rcu_read_lock(), the CNX may be deleted concurrently.
+========================================================================
+*/
+static VOID unlink_cnx(RTMP_ADAPTER *pAd, rack_cnx *cnx)
+{
+	BUCKET_LOCK(pAd, cnx->hash);
+
+	if (!cnx->dead)
+		delete_cnx(pAd, cnx);
+
+	BUCKET_UNLOCK(pAd, cnx->hash);
+}
+
+/*
+========================================================================
+Routine Description:
+    The utility function to delete all connection entries
+
+Arguments:
+    RTMP_ADAPTER     *pAd       Pointer refer to the device handle.
+
+Return Value:
+    VOID
+
+Note:
+
+========================================================================
+*/
+static VOID flush_all_cnx(RTMP_ADAPTER *pAd)
+{
+	rack_cnx *cnx = NULL;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(cnx, &(pAd->ackCnxList), list) {
+		CNX_DPRINT(pAd, cnx, "free CnxInfo by flush_all_cnx()");
+		unlink_cnx(pAd, cnx);
+	}
+	rcu_read_unlock();
 }
 
 /*
@@ -786,10 +902,12 @@ BOOLEAN ReduceTcpAck(RTMP_ADAPTER *pAd, PNDIS_PACKET pPacket)
 
 		if (bResult && match_black_list(&incomingPkt) == FALSE) {
 			if (incomingPkt.type == TCP_ACK) {
+				UINT32 hash = hash_cnx(&incomingPkt.tuple);
+
 				PKT_DPRINT(pAd, &incomingPkt, "incoming ack");
 				/* incoming an ACK */
-				MY_LOCK(pAd);
-				cnx = find_cnx(pAd, &incomingPkt);
+				BUCKET_LOCK(pAd, hash);
+				cnx = find_cnx(pAd, &incomingPkt.tuple, hash);
 
 				if (cnx != NULL) {
 					if (incomingPkt.flags & TCPHDR_FIN) {/* FIN is set */
@@ -824,7 +942,7 @@ BOOLEAN ReduceTcpAck(RTMP_ADAPTER *pAd, PNDIS_PACKET pPacket)
 					}
 				} else {
 					if (pAd->ReduceAckConnections < MAX_REDUCE_ACK_CNX_ENTRY) {
-						new_cnx = add_cnx(pAd, &incomingPkt);
+						new_cnx = add_cnx(pAd, &incomingPkt, hash);
 						CNX_DPRINT(pAd, cnx, "ack initial");
 					} else
 						PKT_DPRINT(pAd, &incomingPkt, "exceed max connections");
@@ -886,7 +1004,7 @@ BOOLEAN ReduceTcpAck(RTMP_ADAPTER *pAd, PNDIS_PACKET pPacket)
 					CNX_DPRINT(pAd, new_cnx, "new cnx");
 				}
 
-				MY_UNLOCK(pAd);
+				BUCKET_UNLOCK(pAd, hash);
 			}
 		}
 		}
@@ -931,19 +1049,27 @@ BOOLEAN ReduceAckUpdateDataCnx(RTMP_ADAPTER *pAd, PNDIS_PACKET pPacket)
 
 			if (bResult && match_black_list(&incomingPkt) == FALSE) {
 				if (incomingPkt.type == TCP_DATA) {
-					/* incoming an DATA */
-					MY_LOCK(pAd);
-					cnx = find_cnx(pAd, &incomingPkt);
+					UINT32 hash = hash_cnx(&incomingPkt.tuple);
+
+					/* incoming an DATA, untracked flows do not take the lock */
+					rcu_read_lock();
+					cnx = find_cnx(pAd, &incomingPkt.tuple, hash);
 
 					if (cnx != NULL) {
-						PKT_DPRINT(pAd, &incomingPkt, "incoming data");
-						update_cnx(cnx, &incomingPkt);
-						calculate_bif(cnx);
-						cnx->stats.total_data++;
-						CNX_DPRINT(pAd, cnx, "data-seq update");
+						BUCKET_LOCK(pAd, hash);
+
+						if (!cnx->dead) {
+							PKT_DPRINT(pAd, &incomingPkt, "incoming data");
+							update_cnx(cnx, &incomingPkt);
+							calculate_bif(cnx);
+							cnx->stats.total_data++;
+							CNX_DPRINT(pAd, cnx, "data-seq update");
+						}
+
+						BUCKET_UNLOCK(pAd, hash);
 					}
 
-					MY_UNLOCK(pAd);
+					rcu_read_unlock();
 				}
 			}
 		}
@@ -975,22 +1101,22 @@ static VOID cnx_flush_task(struct work_struct *work)
 	RTMP_GetCurrentSystemTick(&curTimestamp);
 
 	if (pComCfg->ReduceAckEnable && pAd->ReduceAckConnections > 0) {
-		rack_cnx *cnx = NULL, *cnxTmp = NULL;
-		MY_LOCK(pAd);
-		list_for_each_entry_safe(cnx, cnxTmp, &(pAd->ackCnxList), list) {
+		rack_cnx *cnx = NULL;
+		rcu_read_lock();
+		list_for_each_entry_rcu(cnx, &(pAd->ackCnxList), list) {
 			if (RTMP_TIME_AFTER(curTimestamp, (cnx->last_tstamp + pAd->CommonCfg.ReduceAckCnxTimeout))) {
 				/* The CNX has no activity for pAd->CommonCfg.ReduceAckCnxTimeout milli-seconds */
-				delete_cnx(pAd, cnx);
 				CNX_DPRINT(pAd, cnx, "free CnxInfo by cnx_flush_task()");
+				unlink_cnx(pAd, cnx);
 			} else if (cnx->state == STATE_TERMINATION &&
 					   RTMP_TIME_AFTER(curTimestamp, (cnx->fin_tstamp + REDUCE_ACK_FIN_CNX_TIMEOUT))) {
 				if (pAd->CommonCfg.ReduceAckEnable != REDUCE_ACK_ENABLE_WITOUT_DEL_CNX) {
-					delete_cnx(pAd, cnx);
 					CNX_DPRINT(pAd, cnx, "Delete CnxInfo by FIN");
+					unlink_cnx(pAd, cnx);
 				}
 			}
 		}
-		MY_UNLOCK(pAd);
+		rcu_read_unlock();
 	}
 
 	schedule_delayed_work(&(pAd->cnxFlushWork), REDUCE_ACK_CNX_POLLING_INTERVAL);
@@ -1020,13 +1146,14 @@ static VOID ack_flush_task(struct work_struct *work)
 
 	if (pComCfg->ReduceAckEnable && pAd->ReduceAckConnections > 0) {
 		rack_cnx *cnx = NULL;
-		MY_LOCK(pAd);
-		list_for_each_entry(cnx, &(pAd->ackCnxList), list) {
+		rcu_read_lock();
+		list_for_each_entry_rcu(cnx, &(pAd->ackCnxList), list) {
 			if (cnx->state != STATE_TERMINATION &&
 				RTMP_TIME_AFTER(curTimestamp, (cnx->last_tstamp + pAd->CommonCfg.ReduceAckTimeout))) {
 #if REDUCE_ACK_PKT_CACHE
+				BUCKET_LOCK(pAd, cnx->hash);
 
-				if (cnx != NULL && cnx->cache.raw_pkt != NULL) {
+				if (!cnx->dead && cnx->cache.raw_pkt != NULL) {
 					ap_data_pkt_enq(pAd, cnx->cache.raw_pkt);
 					cnx->cache.raw_pkt = NULL;
 
@@ -1036,10 +1163,11 @@ static VOID ack_flush_task(struct work_struct *work)
 					memset(&(cnx->cache.rack), 0, sizeof(cnx->cache.rack));
 				}
 
+				BUCKET_UNLOCK(pAd, cnx->hash);
 #endif /* REDUCE_ACK_PKT_CACHE */
 			}
 		}
-		MY_UNLOCK(pAd);
+		rcu_read_unlock();
 	}
 
 	schedule_delayed_work(&(pAd->ackFlushWork), REDUCE_ACK_POLLING_INTERVAL);
@@ -1057,7 +1185,7 @@ Return Value:
     VOID
 
 Note:
-
+    Called under rcu_read_lock(), counters are read without the bucket locks.
 ========================================================================
 */
 static VOID rack_show_ex(PRTMP_ADAPTER   pAdapter)
@@ -1070,22 +1198,17 @@ static VOID rack_show_ex(PRTMP_ADAPTER   pAdapter)
 		UINT32 total_data_received = 0, total_ack_dropped = 0, total_ack_received = 0;
 		UINT32 total_ack_timeout = 0;
 		rack_cnx *cnx = NULL;
+		char sip[RACK_ADDR_LEN], dip[RACK_ADDR_LEN];
 		j = 0;
-		list_for_each_entry(cnx, &(pAdapter->ackCnxList), list) {
+		list_for_each_entry_rcu(cnx, &(pAdapter->ackCnxList), list) {
 			total_data_received += cnx->stats.total_data;
 			total_ack_dropped += cnx->stats.dropped;
 			total_ack_received += cnx->stats.total;
 			total_ack_timeout += cnx->stats.timeout;
-			printk("(conn#%02d) %u.%u.%u.%u:%u --> %u.%u.%u.%u:%u (%u)\n",
-				   j, (cnx->tuple.sip >> 24) & 0xFF,
-				   (cnx->tuple.sip >> 16) & 0xFF,
-				   (cnx->tuple.sip >> 8) & 0xFF,
-				   (cnx->tuple.sip >> 0) & 0xFF,
+			printk("(conn#%02d) %s:%u --> %s:%u (%u)\n",
+				   j, rack_addr_str(&cnx->tuple, cnx->tuple.sip, sip),
 				   cnx->tuple.sport,
-				   (cnx->tuple.dip >> 24) & 0xFF,
-				   (cnx->tuple.dip >> 16) & 0xFF,
-				   (cnx->tuple.dip >> 8) & 0xFF,
-				   (cnx->tuple.dip >> 0) & 0xFF,
+				   rack_addr_str(&cnx->tuple, cnx->tuple.dip, dip),
 				   cnx->tuple.dport,
 				   cnx->state);
 			printk("    dropped/total/sent ack count = %u/%u/%u\n", cnx->stats.dropped, cnx->stats.total, cnx->stats.total - cnx->stats.dropped);
@@ -1153,6 +1276,9 @@ VOID ReduceAckInit(RTMP_ADAPTER *pAd)
 	for (i = 0; i < REDUCE_ACK_MAX_HASH_BUCKETS; i++)
 		INIT_HLIST_HEAD(&(pAd->ackCnxHashTbl[i]));
 
+	for (i = 0; i < REDUCE_ACK_LOCK_BUCKETS; i++)
+		spin_lock_init(&(pAd->ackCnxBucketLock[i]));
+
 	INIT_LIST_HEAD(&(pAd->ackCnxList));
 	/* allocate a lock resource for SMP environment */
 	NdisAllocateSpinLock(pAd, &pAd->ReduceAckLock);
@@ -1187,15 +1313,12 @@ Note:
 */
 VOID ReduceAckExit(RTMP_ADAPTER *pAd)
 {
-	rack_cnx *cnx = NULL, *cnxTmp = NULL;
 	/* stop CNX and ACK flush works */
 	cancel_delayed_work_sync(&(pAd->cnxFlushWork));
 	cancel_delayed_work_sync(&(pAd->ackFlushWork));
-	/* free CnxInfos */
-	list_for_each_entry_safe(cnx, cnxTmp, &(pAd->ackCnxList), list) {
-		delete_cnx(pAd, cnx);
-		CNX_DPRINT(pAd, cnx, "free CnxInfo by ReduceAckExit()");
-	}
+	/* free CnxInfos and wait for the RCU callbacks */
+	flush_all_cnx(pAd);
+	rcu_barrier();
 	/* free the lock resource for SMP environment */
 	NdisFreeSpinLock(&pAd->ReduceAckLock);
 	MTWF_DBG(NULL, DBG_CAT_TX, DBG_SUBCAT_ALL, DBG_LVL_DEBUG, "%s, ReduceAckExit, inf=%s)\n", __func__, pAd->net_dev->name);
@@ -1230,15 +1353,8 @@ VOID ReduceAckSetEnable(PRTMP_ADAPTER pAdapter, UINT32 enable)
 
 	pComCfg->ReduceAckEnable = enable;
 
-	if (prvEnable > REDUCE_ACK_DISABLE && pComCfg->ReduceAckEnable == REDUCE_ACK_DISABLE) {
-		rack_cnx *cnx = NULL, *cnxTmp = NULL;
-		MY_LOCK(pAdapter);
-		list_for_each_entry_safe(cnx, cnxTmp, &(pAdapter->ackCnxList), list) {
-			delete_cnx(pAdapter, cnx);
-			CNX_DPRINT(pAdapter, cnx, "free CnxInfo by ReduceAckSetEnable()");
-		}
-		MY_UNLOCK(pAdapter);
-	}
+	if (prvEnable > REDUCE_ACK_DISABLE && pComCfg->ReduceAckEnable == REDUCE_ACK_DISABLE)
+		flush_all_cnx(pAdapter);
 
 	MTWF_DBG(NULL, DBG_CAT_TX, DBG_SUBCAT_ALL, DBG_LVL_DEBUG, "%s, ReduceAckEnable=%d\n",  __func__, pComCfg->ReduceAckEnable);
 }
@@ -1312,7 +1428,7 @@ VOID ReduceAckShow(PRTMP_ADAPTER   pAdapter)
 	/* printk("sizeof(CnxInfo) = %u bytes\n", (sizeof(rack_cnx))); */
 	printk("sizeof(CnxInfo) = %u bytes\n", (UINT)sizeof(rack_cnx));
 	printk("SS Ignore Pkts = %u packets\n", REDUCE_ACK_IGNORE_CNT);
-	MY_LOCK(pAdapter);
+	rcu_read_lock();
 	rack_show_ex(pAdapter);
-	MY_UNLOCK(pAdapter);
+	rcu_read_unlock();
 }
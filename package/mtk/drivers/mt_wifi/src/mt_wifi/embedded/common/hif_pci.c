@@ -2379,7 +2379,7 @@ static PNDIS_PACKET pci_get_pkt_dynamic_page_ddone(
 			build_rx_pkt_skb(&pRxPacket, (VOID *)pRxCell->pNdisPacket,
 									build_skb_len, gather_size);
 #ifdef RX_RPS_SUPPORT
-			if (pAd->ixia_mode_ctl.kernel_rps_en) {
+			if (pAd->dyn_mode_ctl.kernel_rps_en) {
 			if (pChipCap->rx_qm_en) {
 				UINT16 wcid = 0;
 					struct rxd_grp_0 *rxd_grp0 =
@@ -3534,6 +3534,20 @@ done:
 	return pRxPacket;
 }
 
+#ifdef KERNEL_RPS_ADJUST
+/* called with the ring lock held, rx_processed counts one beyond the packets */
+static inline VOID pci_rx_ring_load_update(struct hif_pci_rx_ring *rx_ring,
+	UINT32 rx_processed, BOOLEAN resched, UINT64 start_ns)
+{
+	rx_ring->load_pkt_cnt += rx_processed ? (rx_processed - 1) : 0;
+	rx_ring->load_run_cnt++;
+	if (resched)
+		rx_ring->load_resched_cnt++;
+	rx_ring->load_busy_ns += ktime_get_ns() - start_ns;
+	rx_ring->load_cpus |= (1 << smp_processor_id());
+}
+#endif /* KERNEL_RPS_ADJUST */
+
 /*
 *
 */
@@ -3551,9 +3565,15 @@ static BOOLEAN pci_rx_dma_done_handle(RTMP_ADAPTER *pAd, UINT8 resource_idx)
 #ifdef CONFIG_TP_DBG
 	struct tp_debug *tp_dbg = &pAd->tr_ctl.tp_dbg;
 #endif
+#ifdef KERNEL_RPS_ADJUST
+	UINT64 start_ns;
+#endif
 
 	RxProcessed = RxPending = 0;
 
+#ifdef KERNEL_RPS_ADJUST
+	start_ns = ktime_get_ns();
+#endif
 	RTMP_SEM_LOCK(lock);
 
 	while (1) {
@@ -3614,6 +3634,9 @@ static BOOLEAN pci_rx_dma_done_handle(RTMP_ADAPTER *pAd, UINT8 resource_idx)
 #endif
 	}
 
+#ifdef KERNEL_RPS_ADJUST
+	pci_rx_ring_load_update(rx_ring, RxProcessed, bReschedule, start_ns);
+#endif
 	RTMP_SEM_UNLOCK(lock);
 
 #ifdef CONFIG_TP_DBG
@@ -3650,14 +3673,16 @@ static BOOLEAN pci_rx_dma_done_rxq_handle(RTMP_ADAPTER *pAd, UINT8 resource_idx)
 #ifdef CONFIG_TP_DBG
 	struct tp_debug *tp_dbg = &pAd->tr_ctl.tp_dbg;
 #endif
+#ifdef KERNEL_RPS_ADJUST
+	UINT64 start_ns;
+#endif
 
 	RxProcessed = RxPending = 0;
 
-	RTMP_SEM_LOCK(lock);
 #ifdef KERNEL_RPS_ADJUST
-	if (pAd->ixia_mode_ctl.mode_entered)
-		max_rx_process_cnt = 512;
+	start_ns = ktime_get_ns();
 #endif
+	RTMP_SEM_LOCK(lock);
 
 	while (1) {
 		if (RTMP_TEST_FLAG(pAd, fRTMP_ADAPTER_NIC_NOT_EXIST)
@@ -3731,6 +3756,9 @@ static BOOLEAN pci_rx_dma_done_rxq_handle(RTMP_ADAPTER *pAd, UINT8 resource_idx)
 			tm_ops->schedule_task(pAd, RX_DEQ_TASK, 0);
 	}
 
+#ifdef KERNEL_RPS_ADJUST
+	pci_rx_ring_load_update(rx_ring, RxProcessed, bReschedule, start_ns);
+#endif
 	RTMP_SEM_UNLOCK(lock);
 
 #ifdef CONFIG_TP_DBG
@@ -3766,9 +3794,15 @@ BOOLEAN pci_rx_event_dma_done_handle(RTMP_ADAPTER *pAd, UINT8 resource_idx)
 #ifdef CONFIG_TP_DBG
 	struct tp_debug *tp_dbg = &pAd->tr_ctl.tp_dbg;
 #endif
+#ifdef KERNEL_RPS_ADJUST
+	UINT64 start_ns;
+#endif
 
 	RxProcessed = RxPending = 0;
 
+#ifdef KERNEL_RPS_ADJUST
+	start_ns = ktime_get_ns();
+#endif
 	RTMP_SEM_LOCK(lock);
 
 	while (1) {
@@ -3806,6 +3840,9 @@ BOOLEAN pci_rx_event_dma_done_handle(RTMP_ADAPTER *pAd, UINT8 resource_idx)
 #endif
 	}
 
+#ifdef KERNEL_RPS_ADJUST
+	pci_rx_ring_load_update(rx_ring, RxProcessed, bReschedule, start_ns);
+#endif
 	RTMP_SEM_UNLOCK(lock);
 
 #ifdef CONFIG_TP_DBG
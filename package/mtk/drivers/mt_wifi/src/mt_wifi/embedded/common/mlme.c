@@ -2705,9 +2705,6 @@ struct _RTMP_CHIP_OP *ops = hc_get_chip_ops(pAd->hdev_ctrl);
 #endif /* MT_MAC */
 #endif /* DOT11_N_SUPPORT */
 		/* update RSSI each 1 second*/
-#ifdef KERNEL_RPS_ADJUST
-		if (!pAd->ixia_mode_ctl.mode_entered)
-#endif
 #ifdef ERR_RECOVERY
 	if (!IsStopingPdma(&pAd->ErrRecoveryCtl))
 #endif
@@ -1816,11 +1816,6 @@ INT32 ge_rx_enq_dataq_pkt(RTMP_ADAPTER *pAd, PNDIS_PACKET pkt)
 
 	OS_SPIN_LOCK_BH(&pAd->rx_que_lock[cpu]);
 
-#ifdef KERNEL_RPS_ADJUST
-	if (pAd->ixia_mode_ctl.mode_entered == TRUE)
-		qlen_upper_bound = 8192;
-#endif
-
 	if ((pAd->rx_que[cpu].Number + pAd->rx_post_que[cpu].Number)
 			< qlen_upper_bound) {
 		InsertTailQueue(&pAd->rx_que[cpu], PACKET_TO_QUEUE_ENTRY(pkt));
@@ -1918,10 +1913,6 @@ inline VOID ge_rx_pkt_deq_func(RTMP_ADAPTER *pAd)
 	UINT32 max_rx_process_count = MAX_RX_PROCESS_CNT << 1;
 #ifdef RX_RPS_SUPPORT
 	struct ba_control *ba_ctl = &pAd->tr_ctl.ba_ctl;
-#ifdef KERNEL_RPS_ADJUST
-	if (pAd->ixia_mode_ctl.mode_entered)
-	max_rx_process_count = MAX_RX_PROCESS_CNT;
-#endif
 	if (ba_ctl->ba_timeout_check_per_cpu[smp_processor_id()]) {
 		ba_timeout_flush(pAd);
 		max_rx_process_count = 512;
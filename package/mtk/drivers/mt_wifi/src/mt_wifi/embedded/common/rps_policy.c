@@ -0,0 +1,137 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	rps_policy.c
+
+	Abstract:
+	Default RPS policy. It sizes the set of CPUs the net devices of a band
+	hand their rx packets to after the packet rate the band receives and
+	how busy the rx handler is, with some hysteresis so that a short burst
+	does not move the mask around. The set only changes when its size
+	does, and it leaves out the CPUs the rx handler runs on as long as
+	there are others, since those already spend their time on the rings.
+*/
+
+#include "rt_config.h"
+
+VOID RpsPolicyCfgInit(P_RPS_POLICY_CFG_T prCfg, UINT32 u4CpuMask)
+{
+	prCfg->u4CpuMask = u4CpuMask;
+	prCfg->u4PpsPerCpu = RPS_POLICY_PPS_PER_CPU;
+	prCfg->u4BusyPct = RPS_POLICY_BUSY_PCT;
+	prCfg->u4LowPct = RPS_POLICY_LOW_PCT;
+	prCfg->u4UpHold = RPS_POLICY_UP_HOLD;
+	prCfg->u4DownHold = RPS_POLICY_DOWN_HOLD;
+}
+
+VOID RpsPolicyStateInit(P_RPS_POLICY_STATE_T prState)
+{
+	prState->u4Mask = 0;
+	prState->u4Num = 1;
+	prState->u4UpCnt = 0;
+	prState->u4DownCnt = 0;
+}
+
+UINT32 RpsPolicyCpuNum(UINT32 u4Mask)
+{
+	UINT32 u4Num = 0;
+
+	while (u4Mask) {
+		u4Mask &= u4Mask - 1;
+		u4Num++;
+	}
+
+	return u4Num;
+}
+
+/* the lowest u4Num CPUs of u4Allowed, those not in u4Avoid first */
+UINT32 RpsPolicyPickCpus(UINT32 u4Allowed, UINT32 u4Avoid, UINT32 u4Num)
+{
+	UINT32 au4Pool[2] = {u4Allowed & ~u4Avoid, u4Allowed & u4Avoid};
+	UINT32 u4Mask = 0, u4Pool, u4Cpu;
+
+	for (u4Pool = 0; u4Pool < 2; u4Pool++) {
+		for (u4Cpu = 0; (u4Cpu < 32) && u4Num; u4Cpu++) {
+			if (au4Pool[u4Pool] & (1U << u4Cpu)) {
+				u4Mask |= (1U << u4Cpu);
+				u4Num--;
+			}
+		}
+	}
+
+	return u4Mask;
+}
+
+/*
+========================================================================
+Routine Description:
+	Decide the RPS mask of a band for the next interval.
+
+Arguments:
+	prCfg			- policy parameters
+	prState			- what the policy decided so far for the band
+	prLoad			- load of the band in the last interval
+
+Return Value:
+	RPS mask, 0 if the packets are best left on the CPU that takes them
+	from the ring.
+
+Note:
+	The band needs one CPU per u4PpsPerCpu packets per second, and one
+	more than it has when the rx handler is busy for more than u4BusyPct
+	of the interval. It grows after u4UpHold intervals in a row that need
+	more, and gives one CPU back after u4DownHold intervals in a row that
+	would fit into one CPU less at u4LowPct of its capacity.
+========================================================================
+*/
+UINT32 RpsPolicyDecide(P_RPS_POLICY_CFG_T prCfg, P_RPS_POLICY_STATE_T prState,
+			P_RPS_LOAD_T prLoad)
+{
+	UINT32 u4Max = RpsPolicyCpuNum(prCfg->u4CpuMask);
+	UINT32 u4Pps, u4BusyPct, u4Need, u4Num = prState->u4Num;
+	BOOLEAN fgBusy;
+
+	if ((prLoad->u4IntervalMs == 0) || (prCfg->u4PpsPerCpu == 0) || (u4Max == 0))
+		return prState->u4Mask;
+
+	/* 32 bit divisions only, this also runs on 32 bit hosts */
+	u4Pps = (prLoad->u4RxPkts / prLoad->u4IntervalMs) * 1000 +
+		((prLoad->u4RxPkts % prLoad->u4IntervalMs) * 1000) / prLoad->u4IntervalMs;
+	u4BusyPct = prLoad->u4BusyUs / (prLoad->u4IntervalMs * 10);
+	fgBusy = (u4BusyPct >= prCfg->u4BusyPct);
+
+	u4Need = (u4Pps + prCfg->u4PpsPerCpu - 1) / prCfg->u4PpsPerCpu;
+	if (fgBusy && (u4Need <= u4Num))
+		u4Need = u4Num + 1;
+	if (u4Need > u4Max)
+		u4Need = u4Max;
+	if (u4Need == 0)
+		u4Need = 1;
+
+	if (u4Need > u4Num) {
+		prState->u4DownCnt = 0;
+		if (++prState->u4UpCnt >= prCfg->u4UpHold)
+			u4Num = u4Need;
+	} else if ((u4Num > 1) && !fgBusy &&
+		((UINT64)u4Pps * 100 < (UINT64)(u4Num - 1) * prCfg->u4PpsPerCpu * prCfg->u4LowPct)) {
+		prState->u4UpCnt = 0;
+		if (++prState->u4DownCnt >= prCfg->u4DownHold)
+			u4Num--;
+	} else {
+		prState->u4UpCnt = 0;
+		prState->u4DownCnt = 0;
+	}
+
+	if (u4Num == prState->u4Num)
+		return prState->u4Mask;
+
+	prState->u4Num = u4Num;
+	prState->u4UpCnt = 0;
+	prState->u4DownCnt = 0;
+	prState->u4Mask = (u4Num > 1) ?
+		RpsPolicyPickCpus(prCfg->u4CpuMask, prLoad->u4Cpus, u4Num) : 0;
+
+	return prState->u4Mask;
+}
@@ -139,6 +139,11 @@ NDIS_STATUS RTMPAllocAdapterBlock(VOID *handle, VOID **ppAdapter, INT type)
 #endif /* GREENAP_SUPPORT */
 		/*Allocate interface lock*/
 		NdisAllocateSpinLock(pAd, &pAd->VirtualIfLock);
+#ifdef KERNEL_RPS_ADJUST
+		/* on by default, "set mcli" changes it for good, not per open */
+		for (index = 0; index < DBDC_BAND_NUM; index++)
+			pAd->mcli_ctl[index].kernel_rps_adjust_enable = TRUE;
+#endif /* KERNEL_RPS_ADJUST */
 #ifdef RLM_CAL_CACHE_SUPPORT
 		rlmCalCacheInit(pAd, &pAd->rlmCalCache);
 #endif /* RLM_CAL_CACHE_SUPPORT */
@@ -829,8 +829,7 @@ VOID RTMPDrvOpen(VOID *pAdSrc)
 
 #endif /* RED_SUPPORT */
 #ifdef KERNEL_RPS_ADJUST
-	if (pAd->ixia_mode_ctl.kernel_rps_en)
-		proc_rps_file_open(pAd);
+	RpsPolicyInit(pAd);
 #endif
 	for (band_idx = BAND0; band_idx < DBDC_BAND_NUM; band_idx++) {
 		if (pAd->rts_retrylimit[band_idx] > 0)
@@ -1206,8 +1205,7 @@ VOID RTMPDrvClose(VOID *pAdSrc, VOID *net_dev)
 	/* Close Hw ctrl*/
 	HwCtrlExit(pAd);
 #ifdef KERNEL_RPS_ADJUST
-	if (pAd->ixia_mode_ctl.kernel_rps_en)
-		proc_rps_file_close(pAd);
+	RpsPolicyExit(pAd);
 #endif
 #ifdef REDUCE_TCP_ACK_SUPPORT
 	ReduceAckExit(pAd);
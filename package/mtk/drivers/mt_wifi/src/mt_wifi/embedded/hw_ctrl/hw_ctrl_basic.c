@@ -25,7 +25,37 @@ extern HW_CMD_TABLE_T *HwCmdTable[];
 /*==========================================================/
  //	Basic Command API implement															/
 /==========================================================*/
-static inline HwCmdHdlr HwCtrlValidCmd(HwCmdQElmt *CmdQelmt)
+static HW_CMD_TABLE_T *HwCtrlCmdEntry(UINT32 CmdType, UINT32 CmdIndex)
+{
+	HW_CMD_TABLE_T *pHwCmdTable = NULL;
+	UINT32 j = 0;
+
+	if ((CmdType >= HWCMD_TYPE_END) || (CmdIndex >= HWCMD_ID_END))
+		return NULL;
+
+	pHwCmdTable = HwCmdTable[CmdType];
+
+	if (!pHwCmdTable)
+		return NULL;
+
+	/* traverse to the match ID */
+	while (pHwCmdTable[j].CmdID != HWCMD_ID_END) {
+		if (pHwCmdTable[j].CmdID == CmdIndex)
+			return &pHwCmdTable[j];
+		j++;
+	}
+
+	return NULL;
+}
+
+static VOID HwCtrlLatencyRecord(UINT32 *pHist, UINT32 *pMax, UINT64 Ns)
+{
+	UINT64 Us64 = div_u64(Ns, 1000);
+
+	LatHistRecord(pHist, pMax, (Us64 > 0xffffffff) ? 0xffffffff : (UINT32)Us64);
+}
+
+static inline HwCmdHdlr HwCtrlValidCmd(HwCmdQElmt *CmdQelmt, HW_CMD_TABLE_T **ppEntry)
 {
 	UINT32 CmdType =  CmdQelmt->type;
 	UINT32 CmdIndex = CmdQelmt->command;
@@ -61,6 +91,7 @@ static inline HwCmdHdlr HwCtrlValidCmd(HwCmdQElmt *CmdQelmt)
 	do {
 		if (pHwTargetTable[CurIndex].CmdID == CmdIndex) {
 			Handler = pHwTargetTable[CurIndex].CmdHdlr;
+			*ppEntry = &pHwTargetTable[CurIndex];
 			pHwTargetTable[CurIndex].RfCnt++;
 			NdisGetSystemUpTime(&(pHwTargetTable[CurIndex].LastRfTime));
 			break;
@@ -81,7 +112,6 @@ static inline HwCmdHdlr HwCtrlValidCmd(HwCmdQElmt *CmdQelmt)
 static VOID HwCtrlDequeueCmd(HwCmdQ *cmdq, HwCmdQElmt **pcmdqelmt)
 {
 	HW_CMD_TABLE_T *pHwCmdTable = NULL;
-	UINT32 j = 0;
 	*pcmdqelmt = cmdq->head;
 
 	if (*pcmdqelmt != NULL) {
@@ -91,6 +121,10 @@ static VOID HwCtrlDequeueCmd(HwCmdQ *cmdq, HwCmdQElmt **pcmdqelmt)
 		if (cmdq->size == 0)
 			cmdq->tail = NULL;
 
+		/* from now on a new request has to be queued again */
+		if ((*pcmdqelmt)->Coalesce)
+			cmdq->CoalescePending[(*pcmdqelmt)->command] = 0;
+
 		/* Decrease the Total */
 		if (cmdq->util_flag & HW_CMDQ_UTIL_WAIT_TIME_ADJ) {
 			if ((*pcmdqelmt)->NeedWait) {
@@ -108,20 +142,9 @@ static VOID HwCtrlDequeueCmd(HwCmdQ *cmdq, HwCmdQElmt **pcmdqelmt)
 
 		/* Decrease  per ID's wait time */
 		if (cmdq->util_flag & HW_CMDQ_UTIL_TIME) {
-			if ((*pcmdqelmt)->type < HWCMD_TYPE_END) {
-				pHwCmdTable = HwCmdTable[(*pcmdqelmt)->type];
-				if (pHwCmdTable && ((*pcmdqelmt)->command < HWCMD_ID_END)) {
-					j = 0;
-					/* traverse to the match ID */
-					while (pHwCmdTable[j].CmdID != HWCMD_ID_END) {
-						if (pHwCmdTable[j].CmdID == (*pcmdqelmt)->command) {
-							pHwCmdTable[j].TotalWaitTime -= ((*pcmdqelmt)->WaitTime);
-							break;
-						}
-						j++;
-					}
-				}
-			}
+			pHwCmdTable = HwCtrlCmdEntry((*pcmdqelmt)->type, (*pcmdqelmt)->command);
+			if (pHwCmdTable)
+				pHwCmdTable->TotalWaitTime -= ((*pcmdqelmt)->WaitTime);
 		}
 	}
 }
@@ -138,6 +161,11 @@ static VOID free_hwcmd(os_kref *ref)
 		cmd->buffer = NULL;
 	}
 
+	if (cmd->UserRspBuffer && cmd->RspBuffer) {
+		os_free_mem(cmd->RspBuffer);
+		cmd->RspBuffer = NULL;
+	}
+
 	os_free_mem(cmd);
 }
 
@@ -147,9 +175,18 @@ static VOID HwCtrlCmdHandler(RTMP_ADAPTER *pAd)
 	NTSTATUS		ntStatus;
 	HwCmdHdlr		Handler = NULL;
 	HW_CTRL_T *pHwCtrl = &pAd->HwCtrl;
+	HW_CMD_TABLE_T *pHwCmdEntry = NULL;
 	UINT32			process_cnt = 0;
+	UINT64			start_ns;
+	struct cmd_msg_batch	batch;
 
-	while (pAd && pHwCtrl->HwCtrlQ.size > 0) {
+	if (!pAd)
+		return;
+
+	/* WTBL and key updates of consecutive commands share the firmware round trips */
+	AndesCmdBatchBegin(pAd, &batch);
+
+	while (pHwCtrl->HwCtrlQ.size > 0) {
 
 		if (RTMP_TEST_FLAG(pAd, fRTMP_ADAPTER_NIC_NOT_EXIST) ||
 			!RTMP_TEST_FLAG(pAd, fRTMP_ADAPTER_START_UP)) {
@@ -177,13 +214,25 @@ static VOID HwCtrlCmdHandler(RTMP_ADAPTER *pAd)
 			goto free_cmd;
 
 
-		Handler = HwCtrlValidCmd(cmdqelmt);
+		pHwCmdEntry = NULL;
+		Handler = HwCtrlValidCmd(cmdqelmt, &pHwCmdEntry);
 
 		if (Handler) {
+			start_ns = ktime_get_ns();
 			ntStatus = Handler(pAd, cmdqelmt);
 
+			/* whoever looks at the result expects the firmware to be done */
+			if (cmdqelmt->NeedWait || cmdqelmt->CallbackFun)
+				AndesCmdBatchFlush(pAd, &batch);
+
 			if (cmdqelmt->CallbackFun)
 				cmdqelmt->CallbackFun(pAd, cmdqelmt->CallbackArgs);
+
+			/* only this thread updates the histograms, like RfCnt */
+			HwCtrlLatencyRecord(pHwCmdEntry->QueueHist, &pHwCmdEntry->MaxQueueUs,
+						start_ns - cmdqelmt->EnqTime);
+			HwCtrlLatencyRecord(pHwCmdEntry->ExecHist, &pHwCmdEntry->MaxExecUs,
+						ktime_get_ns() - start_ns);
 		}
 #ifdef DBG_STARVATION
 		starv_dbg_put(&cmdqelmt->starv);
@@ -195,6 +244,8 @@ free_cmd:
 
 		os_kref_put(&cmdqelmt->refcnt, free_hwcmd);
 	}	/* end of while */
+
+	AndesCmdBatchEnd(pAd, &batch);
 }
 
 static INT HwCtrlThread(ULONG Context)
@@ -228,8 +279,7 @@ static INT HwCtrlThread(ULONG Context)
 			break;
 
 #ifdef KERNEL_RPS_ADJUST
-		if (pAd->ixia_mode_ctl.rps_mask & APPLY_NEED_BH_APPLY_FLAG)
-			apply_proc_rps_setting_bh(pAd);
+		RpsPolicyApplyBh(pAd);
 #endif
 
 		/*every time check command formate event*/
@@ -579,6 +629,7 @@ UINT32 HwCtrlInit(RTMP_ADAPTER *pAd)
 	cmdq->tail = NULL;
 	cmdq->size = 0;
 	cmdq->CmdQState = RTMP_TASK_STAT_INITED;
+	os_zero_mem(cmdq->CoalescePending, sizeof(cmdq->CoalescePending));
 
 	cmdq->util_flag = (HW_CMDQ_UTIL_TIME | HW_CMDQ_UTIL_CONDITION_DROP);
 
@@ -653,9 +704,9 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 	NDIS_STATUS	status = NDIS_STATUS_SUCCESS;
 	PHwCmdQElmt	cmdqelmt = NULL;
 	PHwCmdQ	cmdq = NULL;
-	UINT32 wait_time = 0, adjust_total_wait_time = 0, j = 0;
+	UINT32 wait_time = 0, adjust_total_wait_time = 0;
 	HW_CTRL_T *pHwCtrl = &pAd->HwCtrl;
-	BOOLEAN bDump = FALSE, bDrop = FALSE;
+	BOOLEAN bDump = FALSE, bDrop = FALSE, bCoalesce = FALSE;
 	HW_CMD_TABLE_T *pHwCmdTable = NULL;
 
 	if (RTMP_TEST_FLAG(pAd, fRTMP_ADAPTER_NIC_NOT_EXIST)) {
@@ -663,6 +714,21 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 		return NDIS_STATUS_FAILURE;
 	}
 
+	/* a periodic update still waiting in the queue will do the work of this one */
+	if (HwCtrlTxd.Coalesce && !HwCtrlTxd.NeedWait && !HwCtrlTxd.CallbackFun &&
+		(HwCtrlTxd.InformationBufferLength == 0) && (HwCtrlTxd.CmdId < HWCMD_ID_END)) {
+		NdisAcquireSpinLock(&pHwCtrl->HwCtrlQLock);
+		if (pHwCtrl->HwCtrlQ.CoalescePending[HwCtrlTxd.CmdId]) {
+			pHwCmdTable = HwCtrlCmdEntry(HwCtrlTxd.CmdType, HwCtrlTxd.CmdId);
+			if (pHwCmdTable)
+				pHwCmdTable->CoalesceCnt++;
+			NdisReleaseSpinLock(&pHwCtrl->HwCtrlQLock);
+			return NDIS_STATUS_SUCCESS;
+		}
+		NdisReleaseSpinLock(&pHwCtrl->HwCtrlQLock);
+		bCoalesce = TRUE;
+	}
+
 	status = os_alloc_mem(pAd, (PUCHAR *)&cmdqelmt, sizeof(HwCmdQElmt));
 
 	if (cmdqelmt == NULL) {
@@ -701,6 +767,24 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 	cmdqelmt->RspBufferLen = HwCtrlTxd.RespBufferLength;
 	cmdqelmt->CallbackFun = HwCtrlTxd.CallbackFun;
 	cmdqelmt->CallbackArgs = HwCtrlTxd.CallbackArgs;
+	cmdqelmt->Coalesce = bCoalesce;
+
+	/*
+	 * The handler may still run after the waiter gave up, so it writes the
+	 * response into memory of the command, which is copied back only if the
+	 * waiter is still there.
+	 */
+	if (HwCtrlTxd.NeedWait && HwCtrlTxd.pRespBuffer && (HwCtrlTxd.RespBufferLength > 0)) {
+		cmdqelmt->RspBuffer = NULL;
+		status = os_alloc_mem(pAd, (PUCHAR *)&cmdqelmt->RspBuffer, HwCtrlTxd.RespBufferLength);
+		if (cmdqelmt->RspBuffer == NULL) {
+			MTWF_DBG(pAd, DBG_CAT_HW, DBG_SUBCAT_ALL, DBG_LVL_ERROR, "---> os_alloc_mem failed!!\n");
+			status =  NDIS_STATUS_RESOURCES;
+			goto end;
+		}
+		os_move_mem(cmdqelmt->RspBuffer, HwCtrlTxd.pRespBuffer, HwCtrlTxd.RespBufferLength);
+		cmdqelmt->UserRspBuffer = HwCtrlTxd.pRespBuffer;
+	}
 
 	/*create reference count*/
 	os_kref_init(&cmdqelmt->refcnt);
@@ -745,21 +829,9 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 
 		if (bDrop) {
 			/* record the drop cnt */
-			if (cmdqelmt->type < HWCMD_TYPE_END) {
-				pHwCmdTable = HwCmdTable[cmdqelmt->type];
-				if (pHwCmdTable && (cmdqelmt->command < HWCMD_ID_END)) {
-					j = 0;
-					/* traverse to the match ID */
-					while (pHwCmdTable[j].CmdID != HWCMD_ID_END) {
-						if (pHwCmdTable[j].CmdID == cmdqelmt->command) {
-							pHwCmdTable[j].DropCnt++;
-							break;
-						}
-						j++;
-					}
-					pHwCmdTable[cmdqelmt->command].DropCnt++;
-				}
-			}
+			pHwCmdTable = HwCtrlCmdEntry(cmdqelmt->type, cmdqelmt->command);
+			if (pHwCmdTable)
+				pHwCmdTable->DropCnt++;
 			NdisReleaseSpinLock(&pHwCtrl->HwCtrlQLock);
 			status = NDIS_STATUS_FAILURE;
 			goto end;
@@ -782,6 +854,10 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 	cmdq->tail = cmdqelmt;
 	cmdqelmt->next = NULL;
 	cmdq->size++;
+	cmdqelmt->EnqTime = ktime_get_ns();
+
+	if (cmdqelmt->Coalesce)
+		cmdq->CoalescePending[cmdqelmt->command] = 1;
 
 	/* Record original wait time  & Sum Total */
 	cmdqelmt->WaitTime = wait_time;
@@ -806,20 +882,9 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 
 	/* Increase per ID's wait time */
 	if (pHwCtrl->HwCtrlQ.util_flag & HW_CMDQ_UTIL_TIME) {
-		if (cmdqelmt->type < HWCMD_TYPE_END) {
-			pHwCmdTable = HwCmdTable[cmdqelmt->type];
-			if (pHwCmdTable && (cmdqelmt->command < HWCMD_ID_END)) {
-				/* traverse to the match ID */
-				j = 0;
-				while (pHwCmdTable[j].CmdID != HWCMD_ID_END) {
-					if (pHwCmdTable[j].CmdID == cmdqelmt->command) {
-						pHwCmdTable[j].TotalWaitTime += adjust_total_wait_time;
-						break;
-					}
-					j++;
-				}
-			}
-		}
+		pHwCmdTable = HwCtrlCmdEntry(cmdqelmt->type, cmdqelmt->command);
+		if (pHwCmdTable)
+			pHwCmdTable->TotalWaitTime += adjust_total_wait_time;
 	}
 
 	NdisReleaseSpinLock(&pHwCtrl->HwCtrlQLock);
@@ -838,7 +903,8 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 		status = NDIS_STATUS_TIMEOUT;
 		MTWF_DBG(pAd, DBG_CAT_HW, DBG_SUBCAT_ALL, DBG_LVL_ERROR, "HwCtrl CmdTimeout, TYPE:%d,ID:%d, adjust_total_wait_time=%lu, old_wait_time=%lu!!\n",
 			cmdqelmt->type, cmdqelmt->command, RTMPMsecsToJiffies(adjust_total_wait_time), RTMPMsecsToJiffies(wait_time));
-	}
+	} else if (cmdqelmt->UserRspBuffer)
+		os_move_mem(cmdqelmt->UserRspBuffer, cmdqelmt->RspBuffer, cmdqelmt->RspBufferLen);
 end:
 	os_kref_put(&cmdqelmt->refcnt, free_hwcmd);
 	return status;
@@ -856,8 +922,8 @@ VOID Show_HwCmdTable(RTMP_ADAPTER *pAd, BOOLEAN bReset)
 	while (pHwCmdTable != NULL) {
 		j = 0;
 		while (pHwCmdTable[j].CmdID != HWCMD_ID_END) {
-			MTWF_PRINT("\tCMDID: %d, Handler: %p, RfCnt: %d, DropCnt=%u, LastRfTime=%lu, TotalWaitTime=%u\n",
-					 pHwCmdTable[j].CmdID, pHwCmdTable[j].CmdHdlr, pHwCmdTable[j].RfCnt, pHwCmdTable[j].DropCnt, ((pHwCmdTable[j].LastRfTime * 1000) / OS_HZ), pHwCmdTable[j].TotalWaitTime);
+			MTWF_PRINT("\tCMDID: %d, Handler: %p, RfCnt: %d, DropCnt=%u, CoalesceCnt=%u, LastRfTime=%lu, TotalWaitTime=%u\n",
+					 pHwCmdTable[j].CmdID, pHwCmdTable[j].CmdHdlr, pHwCmdTable[j].RfCnt, pHwCmdTable[j].DropCnt, pHwCmdTable[j].CoalesceCnt, ((pHwCmdTable[j].LastRfTime * 1000) / OS_HZ), pHwCmdTable[j].TotalWaitTime);
 			if (bReset) {
 				pHwCmdTable[j].RfCnt = 0;
 				pHwCmdTable[j].DropCnt = 0;
@@ -894,6 +960,61 @@ INT Show_HwCtrlStatistic_Proc(RTMP_ADAPTER *pAd, RTMP_STRING *arg)
 	return TRUE;
 }
 
+/*
+ * iwpriv ra0 show hwctrl_lat[=1]: per command ID, the time from enqueue until
+ * the handler starts and the time spent in the handler. Percentiles are the
+ * upper bound of their log2 bucket, "1" clears the histograms afterwards.
+ */
+INT Show_HwCtrlLatency_Proc(RTMP_ADAPTER *pAd, RTMP_STRING *arg)
+{
+	HW_CMD_TABLE_T *pHwCmdTable = NULL;
+	UINT32 QueueCnt, ExecCnt, Bin;
+	UCHAR i = 0, j = 0;
+	LONG reset = 0;
+
+	if (!(arg == NULL || strlen(arg) == 0))
+		reset = os_str_tol(arg, 0, 10);
+
+	MTWF_PRINT("\tHwCtrlTask CMD Latency (us):\n");
+	pHwCmdTable = HwCmdTable[i];
+	while (pHwCmdTable != NULL) {
+		j = 0;
+		while (pHwCmdTable[j].CmdID != HWCMD_ID_END) {
+			HW_CMD_TABLE_T *pEntry = &pHwCmdTable[j];
+
+			QueueCnt = 0;
+			ExecCnt = 0;
+			for (Bin = 0; Bin < LAT_HIST_BINS; Bin++) {
+				QueueCnt += pEntry->QueueHist[Bin];
+				ExecCnt += pEntry->ExecHist[Bin];
+			}
+
+			if (QueueCnt || pEntry->CoalesceCnt) {
+				MTWF_PRINT("\tTYPE: %d, CMDID: %d, Cnt=%u, Coalesced=%u, Queue p50/p99/max=%u/%u/%u, Exec p50/p99/max=%u/%u/%u\n",
+					i, pEntry->CmdID, QueueCnt, pEntry->CoalesceCnt,
+					LatHistPercentile(pEntry->QueueHist, QueueCnt, 500),
+					LatHistPercentile(pEntry->QueueHist, QueueCnt, 990),
+					pEntry->MaxQueueUs,
+					LatHistPercentile(pEntry->ExecHist, ExecCnt, 500),
+					LatHistPercentile(pEntry->ExecHist, ExecCnt, 990),
+					pEntry->MaxExecUs);
+			}
+
+			if (reset) {
+				os_zero_mem(pEntry->QueueHist, sizeof(pEntry->QueueHist));
+				os_zero_mem(pEntry->ExecHist, sizeof(pEntry->ExecHist));
+				pEntry->MaxQueueUs = 0;
+				pEntry->MaxExecUs = 0;
+				pEntry->CoalesceCnt = 0;
+			}
+			j++;
+		}
+		pHwCmdTable = HwCmdTable[++i];
+	}
+
+	return TRUE;
+}
+
 UINT32 HWCtrlOpsReg(RTMP_ADAPTER *pAd)
 {
 	HW_CTRL_T *pHwCtrl = &pAd->HwCtrl;
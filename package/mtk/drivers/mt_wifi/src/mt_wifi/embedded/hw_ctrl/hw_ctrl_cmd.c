@@ -47,6 +47,23 @@ static INT32 HW_CTRL_BASIC_ENQ(RTMP_ADAPTER *pAd, UINT32 CmdType, UINT32 CmdId,
 	return ret;
 }
 
+/*Periodic refresh without arguments, merged with the same cmd if that is still queued*/
+static INT32 HW_CTRL_PERIODIC_ENQ(RTMP_ADAPTER *pAd, UINT32 CmdType, UINT32 CmdId)
+{
+	HW_CTRL_TXD HwCtrlTxd;
+
+#ifdef WF_RESET_SUPPORT
+	if (pAd->wf_reset_in_progress == TRUE)
+		return NDIS_STATUS_SUCCESS;
+#endif
+
+	os_zero_mem(&HwCtrlTxd, sizeof(HW_CTRL_TXD));
+	HwCtrlTxd.CmdType = CmdType;
+	HwCtrlTxd.CmdId = CmdId;
+	HwCtrlTxd.Coalesce = TRUE;
+	return HwCtrlEnqueueCmd(pAd, HwCtrlTxd);
+}
+
 #define HW_CTRL_TXD_BASIC(_pAd, _CmdType, _CmdId, _Len, _pBuffer, _HwCtrlTxd) \
 	{ \
 		_HwCtrlTxd.CmdType = _CmdType; \
@@ -59,6 +76,7 @@ static INT32 HW_CTRL_BASIC_ENQ(RTMP_ADAPTER *pAd, UINT32 CmdType, UINT32 CmdId,
 		_HwCtrlTxd.RespBufferLength = 0; \
 		_HwCtrlTxd.CallbackFun = NULL; \
 		_HwCtrlTxd.CallbackArgs = NULL; \
+		_HwCtrlTxd.Coalesce = FALSE; \
 	}
 
 #define HW_CTRL_TXD_RSP(_pAd, _RspLen, _RspBuffer, _wait_time, _HwCtrlTxd) \
@@ -342,14 +360,14 @@ VOID RTMP_SET_PS_FLOW_CTRL(PRTMP_ADAPTER pAd)
 VOID RTMP_UPDATE_RAW_COUNTER(PRTMP_ADAPTER pAd)
 {
 	UINT32 ret;
-	ret = HW_CTRL_BASIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_DAW_COUNTER, 0, NULL);
+	ret = HW_CTRL_PERIODIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_DAW_COUNTER);
 }
 
 VOID RTMP_UPDATE_MIB_COUNTER(PRTMP_ADAPTER pAd)
 {
 	UINT32 ret;
 
-	ret = HW_CTRL_BASIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_MIB_COUNTER, 0, NULL);
+	ret = HW_CTRL_PERIODIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_MIB_COUNTER);
 }
 
 #ifdef OFFCHANNEL_ZERO_LOSS
@@ -357,7 +375,7 @@ VOID RTMP_UPDATE_CHANNEL_STATS(PRTMP_ADAPTER pAd)
 {
 	UINT32 ret;
 
-	ret = HW_CTRL_BASIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_CHANNEL_STATS, 0, NULL);
+	ret = HW_CTRL_PERIODIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_CHANNEL_STATS);
 }
 #endif
 
@@ -661,20 +679,15 @@ VOID RTMP_SET_UPDATE_PER(PRTMP_ADAPTER pAd, UINT16 Wcid)
 VOID RTMP_SET_UPDATE_RSSI(PRTMP_ADAPTER pAd)
 {
 	UINT32 ret;
-	HW_CTRL_TXD HwCtrlTxd;
-	os_zero_mem(&HwCtrlTxd, sizeof(HW_CTRL_TXD));
-	HW_CTRL_TXD_BASIC(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_RSSI, 0, NULL, HwCtrlTxd);
-	ret = HwCtrlEnqueueCmd(pAd, HwCtrlTxd);
+
+	ret = HW_CTRL_PERIODIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_RSSI);
 }
 
 VOID RTMP_SET_UPDATE_SNR(PRTMP_ADAPTER pAd)
 {
 	UINT32 ret;
-	HW_CTRL_TXD HwCtrlTxd;
 
-	os_zero_mem(&HwCtrlTxd, sizeof(HW_CTRL_TXD));
-	HW_CTRL_TXD_BASIC(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_SNR, 0, NULL, HwCtrlTxd);
-	ret = HwCtrlEnqueueCmd(pAd, HwCtrlTxd);
+	ret = HW_CTRL_PERIODIC_ENQ(pAd, HWCMD_TYPE_RADIO, HWCMD_ID_UPDATE_SNR);
 }
 
 #ifdef	ETSI_RX_BLOCKER_SUPPORT /* RX Blocker Solution */
@@ -710,8 +723,8 @@ VOID RTMP_CHECK_RSSI(PRTMP_ADAPTER pAd)
 VOID NICUpdateRawCountersNew(
 	IN PRTMP_ADAPTER pAd)
 {
-	if (HW_CTRL_BASIC_ENQ(pAd, HWCMD_TYPE_PS, HWCMD_ID_PERODIC_CR_ACCESS_NIC_UPDATE_RAW_COUNTERS, 0,
-						  NULL) != NDIS_STATUS_SUCCESS)
+	if (HW_CTRL_PERIODIC_ENQ(pAd, HWCMD_TYPE_PS,
+				HWCMD_ID_PERODIC_CR_ACCESS_NIC_UPDATE_RAW_COUNTERS) != NDIS_STATUS_SUCCESS)
 		MTWF_DBG(pAd, DBG_CAT_PS, DBG_SUBCAT_ALL, DBG_LVL_ERROR, "Failed to enqueue cmd\n");
 }
 
@@ -45,7 +45,6 @@
 #define MCLI_DEBUG_ON		4
 #define MCLI_RX_RPS_ENABLE	5
 #define MCLI_RX_RPS_CPUMAP	6
-#define MCLI_FORCE_RPS_CFG	7
 #define MCLI_FORCE_TX_PROCESS_CNT	8
 #define MCLI_CLI_NUMS_EAP_TH		9
 
@@ -30,6 +30,7 @@
 #define __REDUCE_TCPACK_H__
 
 #define REDUCE_ACK_MAX_HASH_BUCKETS		2048
+#define REDUCE_ACK_LOCK_BUCKETS			64					/* hash buckets share this many update locks */
 #define MAX_REDUCE_ACK_CNX_ENTRY			256					/* 256 connections at max */
 #define MAX_CONSECUTIVE_DROP_CNT			5
 #define MAX_CONSECUTIVE_DATA_CNT			10
@@ -78,11 +79,23 @@ enum {
 	REDUCE_ACK_ENABLE_LAST = 3,
 };
 
-typedef struct _rack_packet {
-	UINT32 sip;
-	UINT32 dip;
+/*
+ * Connection 4-tuple, always in the direction of the ACKs (the DATA tuple is
+ * swapped while parsing). Addresses are kept in network order, IPv4 only uses
+ * the first word. Unused words and padding are zero so tuples can be hashed
+ * and compared as a whole.
+ */
+typedef struct _rack_tuple {
+	UINT32 sip[4];
+	UINT32 dip[4];
 	UINT16 sport;
 	UINT16 dport;
+	UINT8 family;		/* AF_INET or AF_INET6 */
+	UINT8 rsv[3];
+} rack_tuple;
+
+typedef struct _rack_packet {
+	rack_tuple tuple;
 	UINT32 type;		/* TCP_ACK or TCP_DATA */
 	UINT32 ack;
 	UINT32 seq;
@@ -99,17 +112,16 @@ typedef struct _rack_packet {
 /* Each rack_cnx may be linked to two tables:
    1. Hash table by (sip, dip, sport, dport): pAd->ackCnxHashTbl
    2. Link list for all connections for flushing purpose: pApd->ackCnxList
+   Both are walked under RCU. Connection state is updated under the lock of
+   its hash bucket, the list is changed under pAd->ReduceAckLock.
  */
 typedef struct _rack_cnx {
 	/*
 	 * Parameters which retrieved from TCP data/ack packets
 	 */
-	struct {
-		UINT32 sip;
-		UINT32 dip;
-		UINT16 sport;
-		UINT16 dport;
-	} tuple;                /* 4-tuple */
+	rack_tuple tuple;       /* 4-tuple */
+	UINT32 hash;            /* hash of tuple */
+	BOOLEAN dead;           /* unlinked from the hash table, waiting for RCU */
 	UINT32 ack;				/* acknowledgement # of last ACK packet */
 	UINT32 seq;				/* sequence # of last DATA packet */
 	UINT8  wscale;			/* window scale (WS) parsed from TCP option of SYN packet */
@@ -184,6 +196,7 @@ typedef struct _rack_cnx {
 
 	struct hlist_node	hnode;
 	struct list_head	list;
+	struct rcu_head		rcu;
 } rack_cnx;
 
 /* External APIs */
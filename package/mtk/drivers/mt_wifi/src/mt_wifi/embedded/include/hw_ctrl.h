@@ -233,8 +233,11 @@ typedef struct _HwCmdQElmt {
 	RTMP_OS_COMPLETION ack_done;
 	VOID *RspBuffer;
 	UINT32 RspBufferLen;
+	VOID *UserRspBuffer; /* copied from RspBuffer if the waiter did not time out */
 	HwCmdCb CallbackFun;
 	VOID *CallbackArgs;
+	BOOLEAN Coalesce;
+	UINT64 EnqTime; /* ns */
 	NDIS_SPIN_LOCK lock;
 	os_kref refcnt;
 #ifdef DBG_STARVATION
@@ -260,6 +263,7 @@ typedef struct _HwCmdQ {
 	ULONG LastQfullTime; /* jffies */
 	UINT32 TotalWaitCnt;
 	UINT32 TotalWaitTime; /* ms */
+	UINT8 CoalescePending[HWCMD_ID_END]; /* coalescable cmd of this ID is queued */
 } HwCmdQ, *PHwCmdQ;
 
 typedef struct _HW_CTRL_TXD {
@@ -273,6 +277,7 @@ typedef struct _HW_CTRL_TXD {
 	UINT32			RespBufferLength;
 	HwCmdCb		CallbackFun;
 	VOID			*CallbackArgs;
+	BOOLEAN			Coalesce;	/* periodic, skip if the same cmd is still queued */
 } HW_CTRL_TXD;
 
 
@@ -548,6 +553,7 @@ NDIS_STATUS HwCtrlEnqueueCmd(
 	HW_CTRL_TXD HwCtrlTxd);
 
 INT Show_HwCtrlStatistic_Proc(struct _RTMP_ADAPTER *pAd, RTMP_STRING *arg);
+INT Show_HwCtrlLatency_Proc(struct _RTMP_ADAPTER *pAd, RTMP_STRING *arg);
 
 
 /*Security*/
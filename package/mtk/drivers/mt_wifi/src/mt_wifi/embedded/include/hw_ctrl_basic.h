@@ -6,6 +6,8 @@
 typedef NTSTATUS(*HwCmdHdlr)(RTMP_ADAPTER * pAd, HwCmdQElmt * CMDQelmt);
 typedef NTSTATUS(*HwFlagHdlr)(RTMP_ADAPTER * pAd);
 
+#include "lat_hist.h"
+
 typedef struct {
 	UINT32 CmdID;
 	HwCmdHdlr CmdHdlr;
@@ -13,6 +15,11 @@ typedef struct {
 	UINT32 DropCnt;
 	ULONG LastRfTime; /* jffies */
 	UINT32 TotalWaitTime; /* ms */
+	UINT32 CoalesceCnt; /* merged into a queued instance */
+	UINT32 QueueHist[LAT_HIST_BINS]; /* enqueue to handler start */
+	UINT32 ExecHist[LAT_HIST_BINS]; /* handler and callback */
+	UINT32 MaxQueueUs;
+	UINT32 MaxExecUs;
 } HW_CMD_TABLE_T;
 
 
@@ -1,83 +1,52 @@
-#include    "rt_config.h"
-
 #ifndef _KERNEL_RPS_ADJUST_H_
 #define _KERNEL_RPS_ADJUST_H_
-/* mcli kernel rps state */
-#define MCLI_RPS_RESET_FLAG		(1 << 0)
-#define	MCLI_RPS_APPLY_FLAG		(1 << 1)
-#define MCLI_IXIA_STA_DETECT_FLAG	(1 << 2)
 
-#define DEFAULT_NET_DEV_TX_QLEN	1000
+#include "rps_policy.h"
+
+#define RPS_RX_RING_MAX			16		/* rx rings whose load is tracked */
+#define RPS_PERIOD_MS			1000
+#define RPS_CPUS_PATH_LEN		64
+
+/* rps_trace lines of the MCLI_DEBUG_RPS_CFG_MODE debug, parsed by embedded/tools/rps_replay */
+#define RPS_TRACE_TAG			"rps_trace"
 
-typedef enum {
-	NORMAL_RPS_MODE,
-	BAND0_DETECT_MODE,
-	BAND1_DETECT_MODE,
-	RESET_RPS_MODE,
-	MIN_RPS_MODE,
-	BAND0_DL_RPS_MODE,
-	BAND0_UDP_DL_RPS_MODE,
-	BAND0_UDP_DL_TXFREE_IRQ_MODE,
-	BAND0_UL_RPS_MODE,
-	BAND1_DL_RPS_MODE,
-	BAND1_UDP_DL_RPS_MODE,
-	BAND1_UDP_DL_RPS_TXFREE_IRQ_MODE,
-	BAND1_UL_RPS_MODE,
-	BAND1_UL_TXFREE_IRQ_MODE,
-	BAND1_UDP_UL_RPS_TXFREE_IRQ_MODE,
-	BAND1_UDP_UL_RPS_MODE,
-	BAND1_DL_TXFREE_IRQ_MODE,
-	BAND0_UL_RPS_TXFREE_IRQ_MODE,
-	BAND0_UDP_UL_RPS_TXFREE_IRQ_MODE,
-	BAND0_BAND1_BIDIR_MODE,
-	MIN_1_PAIR_RPS_MODE,
-	BAND0_1_PAIR_UL_MODE,
-	BAND0_1_PAIR_UL_UDP_MODE,
-	BAND1_1_PAIR_UL_MODE,
-	BAND0_1_PAIR_DL_MODE,
-	BAND0_1_PAIR_UDP_DL_TX_FREE_IRQ_MODE,
-	BAND1_1_PAIR_DL_MODE,
-	BAND1_1_PAIR_L_PKT_UL_MODE,
-	BAND1_1_PAIR_L_PKT_DL_MODE,
-	MAX_1_PAIR_RPS_MODE,
-	MAX_PROC_RPS_MODE
-} PROC_RPS_MODE;
+typedef struct _RPS_RING_SNAP_T {
+	UINT32 u4PktCnt;
+	UINT32 u4RunCnt;
+	UINT32 u4ReschedCnt;
+	UINT64 u8BusyNs;
+} RPS_RING_SNAP_T;
 
-typedef enum {
-	ETH0_RPS_FILE,
-	BAND0_RPS_FILE,
-	BAND1_RPS_FILE,
-	MAX_PROC_NET_RPS_FILE,
-	TXFREE_IRQ_FILE = MAX_PROC_NET_RPS_FILE,
-	BACKLOG_QUEUE_FILE,
-	RCU_STALL_TIMEOUT_FILE,
-	MAX_KERNEL_PROC_RPS_FILE,
-	HNAT_HOOK_TOGGLE_FILE = MAX_KERNEL_PROC_RPS_FILE,
-	HNAT_ALL_ENTRY_FILE,
-	MAX_APPLY_PROC_RPS_FILE,
-	MAX_PROC_RPS_FILE = MAX_APPLY_PROC_RPS_FILE,
-	NEET_BH_APPLY_FILE = 31
-} PROC_RPS_FILE;
+typedef struct _RPS_DEV_T {
+	VOID *pNetDev;					/* net device of the wdev_list slot */
+	UINT32 u4Applied;				/* mask last written to it */
+} RPS_DEV_T;
 
-typedef enum {
-	LAN_NET_DEV,
-	BAND0_NET_DEV,
-	BAND1_NET_DEV,
-	MAX_NET_DEV
-} PROC_NET_DEV;
+typedef struct _RPS_BAND_CTL_T {
+	RPS_LOAD_T rLoad;				/* last interval */
+	RPS_POLICY_STATE_T rState;		/* of the default policy */
+	UINT32 u4Want;					/* mask the policy asks for */
+	UINT32 u4Applied;				/* mask last written to the band's net devices */
+	UINT32 u4UserDev;				/* net devices left alone, userspace set their mask */
+	UINT32 u4Changes;
+	BOOLEAN fgHook;					/* u4Want comes from WLAN_HOOK_RPS_POLICY */
+	BOOLEAN fgPending;				/* u4Want still to be applied */
+} RPS_BAND_CTL_T;
 
-#define APPLY_ETH0_RPS_FLAG				(1<<ETH0_RPS_FILE)
-#define APPLY_BAND0_RPS_FLAG				(1<<BAND0_RPS_FILE)
-#define APPLY_BAND1_RPS_FLAG				(1<<BAND1_RPS_FILE)
-#define APPLY_IRQ_FLAG					(1<<TXFREE_IRQ_FILE)
-#define APPLY_QLEN_FLAG					(1<<BACKLOG_QUEUE_FILE)
-#define APPLY_RCU_TIMEOUT_FLAG				(1<<RCU_STALL_TIMEOUT_FILE)
-#define APPLY_HOOK_TOGGLE_FLAG				(1<<HNAT_HOOK_TOGGLE_FILE)
-#define APPLY_ALL_ENTRY_FLAG                            (1<<HNAT_ALL_ENTRY_FILE)
-#define APPLY_RPS_RESET_FLAG				(1<<MAX_PROC_RPS_FILE)
-#define APPLY_NEED_BH_APPLY_FLAG			(1<<NEET_BH_APPLY_FILE)
+typedef struct _RPS_CTL_T {
+	BOOLEAN fgInited;
+	BOOLEAN fgEnable;				/* run the default policy, KernelRps */
+	RPS_POLICY_CFG_T rCfg;
+	UINT32 u4LastMs;
+	RPS_RING_SNAP_T arSnap[RPS_RX_RING_MAX];
+	RPS_BAND_CTL_T arBand[DBDC_BAND_NUM];
+	RPS_DEV_T arDev[WDEV_NUM_MAX];	/* by wdev_list index */
+} RPS_CTL_T;
 
-void dynamic_proc_rps_adjust(struct _RTMP_ADAPTER *pAd);
-void detect_1_pair_peak(struct _RTMP_ADAPTER *pAd, struct _MAC_TABLE_ENTRY *pEntry, UCHAR BandIdx);
-BOOLEAN apply_proc_rps_setting_bh(struct _RTMP_ADAPTER *pAd);
+VOID RpsPolicyInit(struct _RTMP_ADAPTER *pAd);
+VOID RpsPolicyExit(struct _RTMP_ADAPTER *pAd);
+VOID RpsPolicyPeriodic(struct _RTMP_ADAPTER *pAd);
+VOID RpsPolicyApplyBh(struct _RTMP_ADAPTER *pAd);
+INT Show_RpsLoad_Proc(struct _RTMP_ADAPTER *pAd, RTMP_STRING *arg);
+INT Set_RpsPolicy_Proc(struct _RTMP_ADAPTER *pAd, RTMP_STRING *arg);
 #endif /* _KERNEL_RPS_ADJUST_H_ */
@@ -0,0 +1,51 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	lat_hist.h
+
+	Abstract:
+	Latency histogram with one bin per power of two microseconds, as kept
+	for HwCtrl commands and for firmware command round trips. Percentiles
+	are reported as the upper bound of the bin they fall into.
+*/
+
+#ifndef __LAT_HIST_H__
+#define __LAT_HIST_H__
+
+#define LAT_HIST_BINS				20		/* log2 usec, the last bin takes everything above */
+
+static inline VOID LatHistRecord(UINT32 *pau4Hist, UINT32 *pu4MaxUs, UINT32 u4Us)
+{
+	UINT32 u4Bin = 0, v = u4Us;
+
+	while ((v > 1) && (u4Bin < LAT_HIST_BINS - 1)) {
+		v >>= 1;
+		u4Bin++;
+	}
+
+	pau4Hist[u4Bin]++;
+
+	if (u4Us > *pu4MaxUs)
+		*pu4MaxUs = u4Us;
+}
+
+/* upper bound of the bin that holds the given share of the u4Cnt samples */
+static inline UINT32 LatHistPercentile(const UINT32 *pau4Hist, UINT32 u4Cnt, UINT32 u4Permille)
+{
+	UINT32 u4Bin, u4Sum = 0;
+
+	if (u4Cnt == 0)
+		return 0;
+
+	for (u4Bin = 0; u4Bin < LAT_HIST_BINS - 1; u4Bin++) {
+		u4Sum += pau4Hist[u4Bin];
+		if ((UINT64)u4Sum * 1000 >= (UINT64)u4Cnt * u4Permille)
+			break;
+	}
+
+	return 2 << u4Bin;
+}
+
+#endif /* __LAT_HIST_H__ */
@@ -48,6 +48,7 @@
 
 #include "common/link_list.h"
 #include "wifi_sys_notify.h"
+#include "mcu/andes_pipe.h"
 
 
 struct _RTMP_ADAPTER;
@@ -72,8 +73,9 @@ enum cmd_msg_error_type {
 	error_rx_receive_fail,
 };
 
+struct cmd_msg_batch;
+
 struct MCU_CTRL {
-	UINT8 cmd_seq;
 	ULONG flags; /* Use long, becasue we want to do atomic bit operation */
 #ifdef LINUX
 #ifndef WORKQUEUE_BH
@@ -95,6 +97,11 @@ struct MCU_CTRL {
 	NDIS_SPIN_LOCK rx_doneq_lock;
 	DL_LIST rx_doneq;
 	NDIS_SPIN_LOCK msg_lock;
+	NDIS_SPIN_LOCK seq_lock;
+	ANDES_SEQ_CTRL_T seq_ctrl;
+	ANDES_RTT_CTRL_T rtt;
+	struct cmd_msg_batch *batch;
+	VOID *batch_owner;		/* task whose waited commands go to batch */
 	ULONG tx_kickout_fail_count;
 	ULONG tx_timeout_fail_count;
 	ULONG rx_receive_fail_count;
@@ -125,6 +132,21 @@ enum {
 
 
 struct cmd_msg;
+
+/*
+ * WTBL updates (and with them the key installs) that the owner of an open
+ * batch sends are not waited for one by one. Up to ANDES_PIPE_WINDOW of them
+ * are in flight, the oldest is waited for when the window is full and the
+ * rest when the batch is flushed. Commands that return data or whose status
+ * the caller acts on are still sent one at a time.
+ */
+struct cmd_msg_batch {
+	struct cmd_msg *msg[ANDES_PIPE_WINDOW];
+	UINT32 head;
+	UINT32 num;
+	INT32 ret;		/* first failure since the last flush */
+};
+
 typedef VOID(*MSG_EVENT_HANDLER)(struct _RTMP_ADAPTER *ad, char *payload, UINT16 payload_len);
 
 struct cmd_msg_cb {
@@ -140,6 +162,11 @@ struct cmd_msg_cb {
 #endif
 #define MT_CMD_TX_HOOK AndesSendCmdMsg
 
+static inline UINT32 AndesTimeUs(VOID)
+{
+	return (UINT32)div_u64(ktime_get_ns(), 1000);
+}
+
 enum BW_SETTING {
 	BW20 = 1,
 	BW40 = 2,
@@ -219,6 +246,11 @@ VOID AndesQueueHeadCmdMsg(DL_LIST *list, struct cmd_msg *msg,
 UINT32 AndesQueueLen(struct MCU_CTRL *ctl, DL_LIST *list);
 NDIS_SPIN_LOCK *AndesGetSpinLock(struct MCU_CTRL *ctl, DL_LIST *list);
 UCHAR AndesGetCmdMsgSeq(struct _RTMP_ADAPTER *ad);
+VOID AndesCmdMsgUnmatchedRsp(struct _RTMP_ADAPTER *ad, UINT8 seq);
+VOID AndesCmdBatchBegin(struct _RTMP_ADAPTER *ad, struct cmd_msg_batch *batch);
+INT32 AndesCmdBatchFlush(struct _RTMP_ADAPTER *ad, struct cmd_msg_batch *batch);
+INT32 AndesCmdBatchEnd(struct _RTMP_ADAPTER *ad, struct cmd_msg_batch *batch);
+INT Show_McuCmdRtt_Proc(struct _RTMP_ADAPTER *ad, RTMP_STRING *arg);
 VOID _AndesQueueTailCmdMsg(DL_LIST *list, struct cmd_msg *msg, enum cmd_msg_state state);
 VOID AndesRxProcessCmdMsg(struct _RTMP_ADAPTER *pAd, struct cmd_msg *rx_msg);
 struct cmd_msg *AndesAllocCmdMsgGe(struct _RTMP_ADAPTER *ad, unsigned int length, BOOLEAN bOldCmdFmt);
@@ -0,0 +1,72 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	andes_pipe.h
+
+	Abstract:
+	Bookkeeping for several firmware commands in flight at the same time:
+	the sequence numbers that tie a response to its command, and the round
+	trip statistics per command. Callers hold MCU_CTRL.seq_lock and pass the
+	time in ms; embedded/tools/mcu_pipe_sim runs it against a mock firmware.
+*/
+
+#ifndef __ANDES_PIPE_H__
+#define __ANDES_PIPE_H__
+
+#include "lat_hist.h"
+
+#define ANDES_SEQ_NUM				16		/* seq 1..15, 0 is for unsolicited events */
+#define ANDES_PIPE_WINDOW			8		/* waited commands one batch keeps in flight */
+#define ANDES_SEQ_STALE_MS			3000	/* seq of a timed out command rests this long */
+#define ANDES_SEQ_RECLAIM_MS		65000	/* longer than the longest response wait */
+#define ANDES_RTT_SLOTS				32		/* command types tracked */
+
+#define ANDES_MS_AFTER_EQ(a, b)		((INT32)((a) - (b)) >= 0)
+
+typedef struct _ANDES_SEQ_CTRL_T {
+	UINT8 u1Last;					/* last sequence number handed out */
+	UINT16 u2Busy;					/* bit n: seq n belongs to a command */
+	UINT16 u2Stale;					/* bit n: seq n timed out, its response may still come */
+	UINT32 au4Since[ANDES_SEQ_NUM];	/* ms, when seq n was handed out or went stale */
+	UINT32 u4InFlight;
+	UINT32 u4MaxInFlight;
+	UINT32 u4StaleCnt;				/* commands that timed out */
+	UINT32 u4LateRspCnt;			/* responses that matched no command */
+	UINT32 u4ReclaimCnt;			/* seq taken back from a command that never freed it */
+	UINT32 u4ExhaustCnt;			/* no seq could be handed out */
+} ANDES_SEQ_CTRL_T, *P_ANDES_SEQ_CTRL_T;
+
+typedef struct _ANDES_RTT_STAT_T {
+	UINT8 u1Type;
+	UINT8 u1ExtType;
+	UINT32 u4Cnt;
+	UINT32 u4TimeoutCnt;
+	UINT32 u4MaxUs;
+	UINT64 u8SumUs;
+	UINT32 au4Hist[LAT_HIST_BINS];
+} ANDES_RTT_STAT_T, *P_ANDES_RTT_STAT_T;
+
+typedef struct _ANDES_RTT_CTRL_T {
+	ANDES_RTT_STAT_T arStat[ANDES_RTT_SLOTS];
+	UINT32 u4Used;
+	UINT32 u4Dropped;				/* samples of types that found no free slot */
+} ANDES_RTT_CTRL_T, *P_ANDES_RTT_CTRL_T;
+
+VOID AndesSeqInit(P_ANDES_SEQ_CTRL_T prSeq);
+
+UINT8 AndesSeqAlloc(P_ANDES_SEQ_CTRL_T prSeq, UINT32 u4NowMs);
+
+VOID AndesSeqFree(P_ANDES_SEQ_CTRL_T prSeq, UINT8 u1Seq, UINT32 u4NowMs, BOOLEAN fgTimeout);
+
+VOID AndesSeqUnmatchedRsp(P_ANDES_SEQ_CTRL_T prSeq, UINT8 u1Seq);
+
+VOID AndesRttInit(P_ANDES_RTT_CTRL_T prRtt);
+
+VOID AndesRttRecord(P_ANDES_RTT_CTRL_T prRtt, UINT8 u1Type, UINT8 u1ExtType,
+			UINT32 u4Us, BOOLEAN fgTimeout);
+
+UINT32 AndesRttPercentile(P_ANDES_RTT_STAT_T prStat, UINT32 u4Permille);
+
+#endif /* __ANDES_PIPE_H__ */
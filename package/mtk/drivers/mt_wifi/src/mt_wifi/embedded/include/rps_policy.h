@@ -0,0 +1,77 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	rps_policy.h
+
+	Abstract:
+	Receive load of a band as the driver measures it on its rx rings, and
+	the policy that turns it into an RPS mask for the net devices of the
+	band. The driver only exports the load and applies what a policy asks
+	for, the policy is either a module plugged in at WLAN_HOOK_RPS_POLICY
+	or the default one below. embedded/tools/rps_replay feeds the default
+	policy with rps_trace lines captured on a device.
+*/
+
+#ifndef __RPS_POLICY_H__
+#define __RPS_POLICY_H__
+
+#define RPS_POLICY_PPS_PER_CPU			150000	/* rx packets/s one CPU takes through the stack */
+#define RPS_POLICY_BUSY_PCT				70		/* rx handler busy share that asks for one more CPU */
+#define RPS_POLICY_LOW_PCT				60		/* load share of one CPU less below which one is given back */
+#define RPS_POLICY_UP_HOLD				2		/* intervals the load must stay high before growing */
+#define RPS_POLICY_DOWN_HOLD			10		/* intervals the load must stay low before shrinking */
+
+/* load of one band over one interval */
+typedef struct _RPS_LOAD_T {
+	UINT32 u4IntervalMs;
+	UINT32 u4RxPkts;				/* taken from the rx data rings */
+	UINT32 u4EvtPkts;				/* taken from the rx event rings, mostly tx free reports */
+	UINT32 u4Runs;					/* rx handler runs */
+	UINT32 u4Resched;				/* runs that ran out of budget */
+	UINT32 u4BusyUs;				/* time spent in the rx handlers */
+	UINT32 u4Cpus;					/* CPUs the rx handlers ran on */
+} RPS_LOAD_T, *P_RPS_LOAD_T;
+
+typedef struct _RPS_POLICY_CFG_T {
+	UINT32 u4CpuMask;				/* CPUs the policy may steer to */
+	UINT32 u4PpsPerCpu;
+	UINT32 u4BusyPct;
+	UINT32 u4LowPct;
+	UINT32 u4UpHold;
+	UINT32 u4DownHold;
+} RPS_POLICY_CFG_T, *P_RPS_POLICY_CFG_T;
+
+typedef struct _RPS_POLICY_STATE_T {
+	UINT32 u4Mask;					/* mask the policy asks for, 0 for no steering */
+	UINT32 u4Num;					/* CPUs in it, 1 when not steering */
+	UINT32 u4UpCnt;
+	UINT32 u4DownCnt;
+} RPS_POLICY_STATE_T, *P_RPS_POLICY_STATE_T;
+
+/*
+ * priv of WLAN_HOOK_RPS_POLICY, once per band and interval. A policy
+ * module that sets fgDecided owns the band, u4Mask is applied to the net
+ * devices of the band unless userspace has set a mask of its own there.
+ */
+typedef struct _RPS_POLICY_REQ_T {
+	UINT8 u1Band;
+	RPS_LOAD_T rLoad;
+	UINT32 u4Applied;				/* mask the driver wrote last */
+	UINT32 u4Mask;
+	BOOLEAN fgDecided;
+} RPS_POLICY_REQ_T, *P_RPS_POLICY_REQ_T;
+
+VOID RpsPolicyCfgInit(P_RPS_POLICY_CFG_T prCfg, UINT32 u4CpuMask);
+
+VOID RpsPolicyStateInit(P_RPS_POLICY_STATE_T prState);
+
+UINT32 RpsPolicyDecide(P_RPS_POLICY_CFG_T prCfg, P_RPS_POLICY_STATE_T prState,
+			P_RPS_LOAD_T prLoad);
+
+UINT32 RpsPolicyPickCpus(UINT32 u4Allowed, UINT32 u4Avoid, UINT32 u4Num);
+
+UINT32 RpsPolicyCpuNum(UINT32 u4Mask);
+
+#endif /* __RPS_POLICY_H__ */
@@ -6911,22 +6911,10 @@ struct txop_ctl {
 #define MCLI_DEBUG_RMAC_DROP    (1 << 5)
 #define MCLI_DEBUG_MULTICLIENT  (1 << 6)
 
-struct ixia_mode_ctl_type {
-	BOOLEAN mode_entered;
-	UINT8 band;
-	UINT16 sta_nums;
-	UINT32 num_entry;
-#ifdef KERNEL_RPS_ADJUST
-	UINT32 rps_mask;
-	UINT32 max_mgmt_que_num_backup;
-	UINT32 max_data_que_num_backup;
-	BOOLEAN tx_tasklet_sch;
-	BOOLEAN rx_tasklet_sch;
-#endif
+struct dyn_mode_ctl_type {
 	BOOLEAN kernel_rps_en;
 	BOOLEAN fgProbeRspDetect;
 	BOOLEAN fgSkipRedQLenDrop;
-	BOOLEAN isIxiaOn;
 };
 
 struct multi_cli_ctl {
@@ -6956,24 +6944,13 @@ struct multi_cli_ctl {
 	UINT16 large_rssi_gap_num;
 	UINT16 last_large_rssi_gap_num;
 #ifdef KERNEL_RPS_ADJUST
-	BOOLEAN rps_apply;
-	BOOLEAN rps_adjust;
 	BOOLEAN	kernel_rps_adjust_enable;
 	UINT8	force_agglimit;
 	UINT8	cur_agglimit;
 	UINT8	cur_txop;
-	BOOLEAN force_rps_cfg;
 	UINT32  force_tx_process_cnt;
-	UINT32  proc_rps_mode;
-	UINT32  rps_state_flag;
 	BOOLEAN iMacflag;
-	UINT32 peak_tx_clients;
-	UINT32 peak_rx_clients;
-	UINT32 peak_tx_pkts;
-	UINT32 peak_rx_pkts;
 	UINT32 peer_req_cnt;
-	UINT32 silent_period_cnt;
-	char force_proc_rps[MAX_PROC_RPS_FILE][8];
 #endif
 };
 #ifdef PKTLOSS_CHK
@@ -7799,6 +7776,7 @@ struct _RTMP_ADAPTER {
 
 #ifdef REDUCE_TCP_ACK_SUPPORT
 	struct hlist_head ackCnxHashTbl[REDUCE_ACK_MAX_HASH_BUCKETS];
+	spinlock_t ackCnxBucketLock[REDUCE_ACK_LOCK_BUCKETS];
 	struct list_head ackCnxList;
 	UINT32 ReduceAckConnections;
 	struct delayed_work ackFlushWork;
@@ -8817,7 +8795,10 @@ struct _RTMP_ADAPTER {
 	INT32 RSSI[MAX_ANT_NUM];
 	INT32 RCPI[MAX_ANT_NUM];
 #endif
-	struct ixia_mode_ctl_type ixia_mode_ctl;
+	struct dyn_mode_ctl_type dyn_mode_ctl;
+#ifdef KERNEL_RPS_ADJUST
+	RPS_CTL_T rps_ctl;
+#endif
 	UINT16 multi_cli_nums_eap_th;
 	BOOLEAN aggManualEn;
 	UINT8 per_dn_th;
@@ -10212,8 +10193,6 @@ INT set_pktloss_chk(
 #endif
 INT set_mcli_cfg(IN  PRTMP_ADAPTER pAd, IN  RTMP_STRING * arg);
 #ifdef KERNEL_RPS_ADJUST
-void proc_rps_file_open(RTMP_ADAPTER *pAd);
-void proc_rps_file_close(RTMP_ADAPTER *pAd);
 void rtmp_read_kernel_rps_parms_from_file(
 	IN      PRTMP_ADAPTER pAd,
 	char *tmpbuf,
@@ -157,6 +157,32 @@ VOID AndesAppendHeadCmdMsg(struct cmd_msg *msg, char *data, unsigned int len)
 		memcpy(OS_PKT_HEAD_BUF_EXTEND(net_pkt, len), data, len);
 }
 
+static inline UINT32 AndesTimeMs(VOID)
+{
+	return (UINT32)div_u64(ktime_get_ns(), 1000000);
+}
+
+/*
+ * The command that got msg->seq gives it back when it is freed, for a
+ * fragmented unified command that is the last fragment.
+ */
+static VOID AndesPutCmdMsgSeq(struct MCU_CTRL *ctl, struct cmd_msg *msg)
+{
+	unsigned long flags;
+
+	if ((msg->seq == 0) || !OS_TEST_BIT(MCU_INIT, &ctl->flags))
+		return;
+
+#ifdef WIFI_UNIFIED_COMMAND
+	if (msg->total_frag && (msg->frag_num != msg->total_frag))
+		return;
+#endif /* WIFI_UNIFIED_COMMAND */
+
+	RTMP_SPIN_LOCK_IRQSAVE(&ctl->seq_lock, &flags);
+	AndesSeqFree(&ctl->seq_ctrl, msg->seq, AndesTimeMs(), (msg->state == tx_timeout_fail));
+	RTMP_SPIN_UNLOCK_IRQRESTORE(&ctl->seq_lock, &flags);
+}
+
 VOID AndesFreeCmdMsg(struct cmd_msg *msg)
 {
 	RTMP_ADAPTER *ad = NULL;
@@ -182,6 +208,8 @@ VOID AndesFreeCmdMsg(struct cmd_msg *msg)
 		goto free_memory;
 	}
 
+	AndesPutCmdMsgSeq(ctl, msg);
+
 	if (IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg))
 		RTMP_OS_EXIT_COMPLETION(&msg->ack_done);
 
@@ -220,6 +248,8 @@ VOID AndesForceFreeCmdMsg(struct cmd_msg *msg)
 		goto free_memory;
 	}
 
+	AndesPutCmdMsgSeq(ctl, msg);
+
 	if (IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg))
 		RTMP_OS_EXIT_COMPLETION(&msg->ack_done);
 
@@ -308,27 +338,33 @@ NDIS_SPIN_LOCK *AndesGetSpinLock(struct MCU_CTRL *ctl, DL_LIST *list)
 UCHAR AndesGetCmdMsgSeq(struct _RTMP_ADAPTER *ad)
 {
 	struct MCU_CTRL *ctl = &ad->MCUCtrl;
-	struct cmd_msg *msg;
 	unsigned long flags;
 	UINT8 msg_seq;
 
-	RTMP_SPIN_LOCK_IRQSAVE(&ctl->ackq_lock, &flags);
-get_seq:
-	ctl->cmd_seq >= 0xf ? ctl->cmd_seq = 1 : ctl->cmd_seq++;
-	DlListForEach(msg, &ctl->ackq, struct cmd_msg, list) {
-		if (msg->seq == ctl->cmd_seq) {
-			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_INFO,
-					 "command(seq: %d) is still running\n", ctl->cmd_seq);
-			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_INFO,
-					 "command response nums = %d\n", GetCmdRspNum(ad));
-			goto get_seq;
-		}
-	}
-	msg_seq = ctl->cmd_seq;
-	RTMP_SPIN_UNLOCK_IRQRESTORE(&ctl->ackq_lock, &flags);
+	RTMP_SPIN_LOCK_IRQSAVE(&ctl->seq_lock, &flags);
+	msg_seq = AndesSeqAlloc(&ctl->seq_ctrl, AndesTimeMs());
+	RTMP_SPIN_UNLOCK_IRQRESTORE(&ctl->seq_lock, &flags);
+
+	if (msg_seq == 0)
+		MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_ERROR,
+				 "all command seq are still running, ackq qlen = %d, command dropped\n",
+				  AndesQueueLen(ctl, &ctl->ackq));
+
 	return msg_seq;
 }
 
+VOID AndesCmdMsgUnmatchedRsp(struct _RTMP_ADAPTER *ad, UINT8 seq)
+{
+	struct MCU_CTRL *ctl = &ad->MCUCtrl;
+	unsigned long flags;
+
+	MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_INFO,
+			 "no command waits for the response (seq: %d)\n", seq);
+	RTMP_SPIN_LOCK_IRQSAVE(&ctl->seq_lock, &flags);
+	AndesSeqUnmatchedRsp(&ctl->seq_ctrl, seq);
+	RTMP_SPIN_UNLOCK_IRQRESTORE(&ctl->seq_lock, &flags);
+}
+
 
 VOID _AndesQueueTailCmdMsg(DL_LIST *list, struct cmd_msg *msg, enum cmd_msg_state state)
 {
@@ -551,7 +587,11 @@ VOID AndesCtrlInit(RTMP_ADAPTER *ad)
 	if (!OS_TEST_BIT(MCU_INIT, &ctl->flags)) {
 		/*general init*/
 		RTMP_CLEAR_FLAG(ad, fRTMP_ADAPTER_MCU_SEND_IN_BAND_CMD);
-		ctl->cmd_seq = 0;
+		NdisAllocateSpinLock(ad, &ctl->seq_lock);
+		AndesSeqInit(&ctl->seq_ctrl);
+		AndesRttInit(&ctl->rtt);
+		ctl->batch = NULL;
+		ctl->batch_owner = NULL;
 		RTMP_OS_TASKLET_INIT(ad, &ctl->cmd_msg_task, AndesCmdMsgBh, (unsigned long)ad);
 		NdisAllocateSpinLock(ad, &ctl->txq_lock);
 		AndesQueueInit(ctl, &ctl->txq);
@@ -612,6 +652,7 @@ VOID AndesCtrlExit(RTMP_ADAPTER *ad)
 		NdisFreeSpinLock(&ctl->tx_doneq_lock);
 		AndesCleanupCmdMsg(ad, &ctl->rx_doneq);
 		NdisFreeSpinLock(&ctl->rx_doneq_lock);
+		NdisFreeSpinLock(&ctl->seq_lock);
 		MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_INFO, "tx_kickout_fail_count = %ld\n", ctl->tx_kickout_fail_count);
 		MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_INFO, "tx_timeout_fail_count = %ld\n", ctl->tx_timeout_fail_count);
 		MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_INFO, "rx_receive_fail_count = %ld\n", ctl->rx_receive_fail_count);
@@ -658,9 +699,16 @@ static INT32 AndesDequeueAndKickOutCmdMsgs(RTMP_ADAPTER *ad)
 			} else
 #endif /* WIFI_UNIFIED_COMMAND */
 			{
-				if (IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg))
+				if (IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg)) {
 					msg->seq = AndesGetCmdMsgSeq(ad);
-				else
+
+					/* seq 0 is the one of the events, fail rather than send it */
+					if (msg->seq == 0) {
+						AndesForceFreeCmdMsg(msg);
+						ret = NDIS_STATUS_FAILURE;
+						break;
+					}
+				} else
 					msg->seq = 0;
 				if (arch_ops->fill_cmd_header != NULL)
 					arch_ops->fill_cmd_header(ad, msg, net_pkt);
@@ -707,6 +755,19 @@ static INT32 AndesWaitForCompleteTimeout(struct cmd_msg *msg, ULONG timeout)
 	return ret;
 }
 
+static VOID AndesRecordCmdMsgRtt(struct MCU_CTRL *ctl, struct cmd_msg *msg, enum cmd_msg_state state)
+{
+	unsigned long flags;
+
+	if ((state != tx_done) && (state != tx_timeout_fail))
+		return;
+
+	RTMP_SPIN_LOCK_IRQSAVE(&ctl->seq_lock, &flags);
+	AndesRttRecord(&ctl->rtt, msg->attr.type, msg->attr.ext_type,
+				   msg->rsp_us - msg->send_us, (state == tx_timeout_fail));
+	RTMP_SPIN_UNLOCK_IRQRESTORE(&ctl->seq_lock, &flags);
+}
+
 #ifdef WF_RESET_SUPPORT
 #ifdef CONFIG_CONNINFRA_SUPPORT
 enum consys_drv_type {
@@ -722,15 +783,27 @@ int conninfra_pwr_off(enum consys_drv_type drv_type);
 #endif /* CONFIG_CONNINFRA_SUPPORT */
 #endif
 
-INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
+/*
+========================================================================
+Routine Description:
+	Check, queue and kick out one command.
+
+Arguments:
+	ad				- adapter
+	msg				- command, freed here if it is not sent
+	ret				- status for the caller if it does not wait
+
+Return Value:
+	TRUE if the caller has to wait for the response with
+	AndesWaitCmdMsgRsp().
+========================================================================
+*/
+static BOOLEAN AndesSubmitCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg, INT32 *ret)
 {
 	struct MCU_CTRL *ctl = &ad->MCUCtrl;
-	BOOLEAN is_cmd_need_wait = IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg);
-	int ret = NDIS_STATUS_SUCCESS;
 	static BOOLEAN is_dump_stack = FALSE;
-#ifdef CONFIG_AP_SUPPORT
-	int exp_type = 0;
-#endif
+
+	*ret = NDIS_STATUS_SUCCESS;
 
 	if (in_interrupt() && IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg)) {
 		MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_ERROR,
@@ -743,7 +816,8 @@ INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
 			is_dump_stack = TRUE;
 		}
 		AndesForceFreeCmdMsg(msg);
-		return NDIS_STATUS_FAILURE;
+		*ret = NDIS_STATUS_FAILURE;
+		return FALSE;
 	}
 
 	if (!RTMP_TEST_FLAG(ad, fRTMP_ADAPTER_MCU_SEND_IN_BAND_CMD)     ||
@@ -765,7 +839,8 @@ INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
 				  msg->attr.type, msg->attr.ext_type);
 
 		AndesForceFreeCmdMsg(msg);
-		return NDIS_STATUS_FAILURE;
+		*ret = NDIS_STATUS_FAILURE;
+		return FALSE;
 	}
 
 #ifdef ERR_RECOVERY
@@ -775,7 +850,8 @@ INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
 			"(SER Period): Command type = %x, Extension command type = %x\n",
 			 msg->attr.type, msg->attr.ext_type);
 		AndesForceFreeCmdMsg(msg);
-		return NDIS_STATUS_FAILURE;
+		*ret = NDIS_STATUS_FAILURE;
+		return FALSE;
 	}
 #endif /* ERR_RECOVERY */
 
@@ -785,7 +861,8 @@ INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
 			"MDVT Block,Command type = %x, Extension command type = %x\n",
 			 msg->attr.type, msg->attr.ext_type);
 		AndesForceFreeCmdMsg(msg);
-		return NDIS_STATUS_FAILURE;
+		*ret = NDIS_STATUS_FAILURE;
+		return FALSE;
 	}
 #endif
 
@@ -793,235 +870,472 @@ INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
 	starv_dbg_init(&ctl->block, &msg->starv);
 	starv_dbg_get(&msg->starv);
 #endif /*DBG_STARVATION*/
+	msg->send_us = AndesTimeUs();
 	AndesQueueTailCmdMsg(&ctl->txq, msg, tx_start);
-retransmit:
-	if (AndesDequeueAndKickOutCmdMsgs(ad) != NDIS_STATUS_SUCCESS)
-		goto bailout;
+
+	*ret = AndesDequeueAndKickOutCmdMsgs(ad);
+	if (*ret != NDIS_STATUS_SUCCESS)
+		return FALSE;
 
 #ifdef WF_RESET_SUPPORT
-	if(ad->wf_reset_in_progress == TRUE)
-		goto bailout;
+	if (ad->wf_reset_in_progress == TRUE)
+		return FALSE;
 #endif
 
-	/* Wait for response */
-	if (is_cmd_need_wait) {
-		enum cmd_msg_state state = 0;
-		ULONG IsComplete;
+	return IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg);
+}
+
+/*
+========================================================================
+Routine Description:
+	Wait for the response of a command that AndesSubmitCmdMsg() sent,
+	retransmit it on timeout if it allows retries.
+
+Arguments:
+	ad				- adapter
+	msg				- command, handed to tx_doneq to be freed
+
+Return Value:
+	NDIS_STATUS_FAILURE on timeout, the firmware status for STAREC
+	updates.
+========================================================================
+*/
+static INT32 AndesWaitCmdMsgRsp(PRTMP_ADAPTER ad, struct cmd_msg *msg)
+{
+	struct MCU_CTRL *ctl = &ad->MCUCtrl;
+	int ret = NDIS_STATUS_SUCCESS;
+	enum cmd_msg_state state;
+	ULONG IsComplete;
+#ifdef CONFIG_AP_SUPPORT
+	int exp_type = 0;
+#endif
 
-		IsComplete = AndesWaitForCompleteTimeout(msg, msg->attr.ctrl.wait_ms_time);
+wait:
+	state = 0;
+	IsComplete = AndesWaitForCompleteTimeout(msg, msg->attr.ctrl.wait_ms_time);
 
-		if (!OS_TEST_BIT(MCU_INIT, &ctl->flags)) {
-			/*If need wait, clean up will trigger complete for here to free msg*/
-			AndesFreeCmdMsg(msg);
-			MTWF_DBG(ad, DBG_CAT_HW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-				"fail for MCU_INIT\n");
-			goto bailout;
-		}
+	if (!OS_TEST_BIT(MCU_INIT, &ctl->flags)) {
+		/*If need wait, clean up will trigger complete for here to free msg*/
+		AndesFreeCmdMsg(msg);
+		MTWF_DBG(ad, DBG_CAT_HW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+			"fail for MCU_INIT\n");
+		return ret;
+	}
 
-		if (!IsComplete) {
-			P_FWCMD_TIMEOUT_RECORD pToRec = NULL;
-			BOOLEAN bDump = TRUE;
+	if (!IsComplete) {
+		P_FWCMD_TIMEOUT_RECORD pToRec = NULL;
+		BOOLEAN bDump = TRUE;
 
-			ret = NDIS_STATUS_FAILURE;
+		ret = NDIS_STATUS_FAILURE;
 
-			/* record timeout info */
-			pToRec = &ad->FwCmdTimeoutRecord[ad->FwCmdTimeoutCnt % FW_CMD_TO_RECORD_CNT];
-			NdisGetSystemUpTime(&pToRec->timestamp);
-			pToRec->type = 		msg->attr.type;
-			pToRec->ext_type = 	msg->attr.ext_type;
-			pToRec->seq = 		msg->seq;
-			pToRec->state = 	msg->state;
-			ad->FwCmdTimeoutCnt++;
+		/* record timeout info */
+		pToRec = &ad->FwCmdTimeoutRecord[ad->FwCmdTimeoutCnt % FW_CMD_TO_RECORD_CNT];
+		NdisGetSystemUpTime(&pToRec->timestamp);
+		pToRec->type = 		msg->attr.type;
+		pToRec->ext_type = 	msg->attr.ext_type;
+		pToRec->seq = 		msg->seq;
+		pToRec->state = 	msg->state;
+		ad->FwCmdTimeoutCnt++;
 #ifdef WF_RESET_SUPPORT
-			ad->FwCmdTimeoutcheckCnt++;
+		ad->FwCmdTimeoutcheckCnt++;
 #endif
-			/* check timeout print count */
-			if ((ad->FwCmdTimeoutCnt > ad->FwCmdTimeoutPrintCnt) &&
-				(ad->FwCmdTimeoutPrintCnt != 0))
-				bDump = FALSE;
+		/* check timeout print count */
+		if ((ad->FwCmdTimeoutCnt > ad->FwCmdTimeoutPrintCnt) &&
+			(ad->FwCmdTimeoutPrintCnt != 0))
+			bDump = FALSE;
 
 #ifdef ERR_RECOVERY
-			/* check timeout (possibly) caused by SER */
-			{
-				UINT32 Highpart = 0;
-				UINT32 Lowpart = 0;
-
-				/* extra timeout allowance 3 sec for cmd timeout */
-				#define SER_TIMEOUT_ALLOWANCE 3000
-
-				AsicGetTsfTime(ad, &Highpart, &Lowpart, HW_BSSID_0);
-				if ((Lowpart - ad->HwCtrl.ser_times[SER_TIME_ID_T0]) <
-					 ((CMD_MSG_TIMEOUT + SER_TIMEOUT_ALLOWANCE) * 1000)) {
-					MTWF_DBG(ad, DBG_CAT_HW, CATHW_SER, DBG_LVL_INFO,
-							  "FWCmdTimeout(SER Period): command (%x), ext_cmd_type (%x), seq(%d), delta(%dus)\n",
-							  msg->attr.type, msg->attr.ext_type,
-							  msg->seq,
-							  Lowpart - ad->HwCtrl.ser_times[SER_TIME_ID_T0]);
-					bDump = FALSE;
-				}
-			}
-#endif
-
-			if (bDump) {
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "FWCmdTimeout: command (%x), ext_cmd_type (%x), seq(%d), timeout(%dms)\n",
+		/* check timeout (possibly) caused by SER */
+		{
+			UINT32 Highpart = 0;
+			UINT32 Lowpart = 0;
+
+			/* extra timeout allowance 3 sec for cmd timeout */
+			#define SER_TIMEOUT_ALLOWANCE 3000
+
+			AsicGetTsfTime(ad, &Highpart, &Lowpart, HW_BSSID_0);
+			if ((Lowpart - ad->HwCtrl.ser_times[SER_TIME_ID_T0]) <
+				 ((CMD_MSG_TIMEOUT + SER_TIMEOUT_ALLOWANCE) * 1000)) {
+				MTWF_DBG(ad, DBG_CAT_HW, CATHW_SER, DBG_LVL_INFO,
+						  "FWCmdTimeout(SER Period): command (%x), ext_cmd_type (%x), seq(%d), delta(%dus)\n",
 						  msg->attr.type, msg->attr.ext_type,
 						  msg->seq,
-						  (msg->attr.ctrl.wait_ms_time == 0) ?
-						  CMD_MSG_TIMEOUT : msg->attr.ctrl.wait_ms_time);
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "pAd->Flags  = 0x%.8lx\n", ad->Flags);
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "txq qlen = %d\n", AndesQueueLen(ctl, &ctl->txq));
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "rxq qlen = %d\n", AndesQueueLen(ctl, &ctl->rxq));
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "kickq qlen = %d\n", AndesQueueLen(ctl, &ctl->kickq));
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "ackq qlen = %d\n", AndesQueueLen(ctl, &ctl->ackq));
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "tx_doneq.qlen = %d\n", AndesQueueLen(ctl, &ctl->tx_doneq));
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "rx_done qlen = %d\n", AndesQueueLen(ctl, &ctl->rx_doneq));
+						  Lowpart - ad->HwCtrl.ser_times[SER_TIME_ID_T0]);
+				bDump = FALSE;
 			}
+		}
+#endif
 
-			if (msg->state == wait_cmd_out_and_ack) {
-				/*unlink acq recycle msg*/
-				hif_mcu_unlink_ackq(msg);
-			} else if (msg->state == wait_ack)
-				AndesUnlinkCmdMsg(msg, &ctl->ackq);
+		if (bDump) {
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "FWCmdTimeout: command (%x), ext_cmd_type (%x), seq(%d), timeout(%dms)\n",
+					  msg->attr.type, msg->attr.ext_type,
+					  msg->seq,
+					  (msg->attr.ctrl.wait_ms_time == 0) ?
+					  CMD_MSG_TIMEOUT : msg->attr.ctrl.wait_ms_time);
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "pAd->Flags  = 0x%.8lx\n", ad->Flags);
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "txq qlen = %d\n", AndesQueueLen(ctl, &ctl->txq));
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "rxq qlen = %d\n", AndesQueueLen(ctl, &ctl->rxq));
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "kickq qlen = %d\n", AndesQueueLen(ctl, &ctl->kickq));
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "ackq qlen = %d\n", AndesQueueLen(ctl, &ctl->ackq));
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "tx_doneq.qlen = %d\n", AndesQueueLen(ctl, &ctl->tx_doneq));
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "rx_done qlen = %d\n", AndesQueueLen(ctl, &ctl->rx_doneq));
+		}
 
-			AndesIncErrorCount(ctl, error_tx_timeout_fail);
-			state = tx_timeout_fail;
+		if (msg->state == wait_cmd_out_and_ack) {
+			/*unlink acq recycle msg*/
+			hif_mcu_unlink_ackq(msg);
+		} else if (msg->state == wait_ack)
+			AndesUnlinkCmdMsg(msg, &ctl->ackq);
 
-			if (msg->retry_times > 0)
-				msg->retry_times--;
+		AndesIncErrorCount(ctl, error_tx_timeout_fail);
+		state = tx_timeout_fail;
 
-			if (bDump) {
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "msg state = %d\n", msg->state);
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "msg->retry_times = %d\n", msg->retry_times);
-				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-						 "FwCmdTimeoutCnt  = %d\n", ad->FwCmdTimeoutCnt);
+		if (msg->retry_times > 0)
+			msg->retry_times--;
+
+		if (bDump) {
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "msg state = %d\n", msg->state);
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "msg->retry_times = %d\n", msg->retry_times);
+			MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+					 "FwCmdTimeoutCnt  = %d\n", ad->FwCmdTimeoutCnt);
 
 #ifdef CONFIG_AP_SUPPORT
-				/* FW status check and core_dump to file */
+			/* FW status check and core_dump to file */
 #if defined(MT7915) || defined(MT7986) || defined(MT7916) || defined(MT7981)
-				if (IS_MT7915(ad) || IS_MT7986(ad) || IS_MT7916(ad) || IS_MT7981(ad))
-					exp_type = ChkExceptionType(ad);
+			if (IS_MT7915(ad) || IS_MT7986(ad) || IS_MT7916(ad) || IS_MT7981(ad))
+				exp_type = ChkExceptionType(ad);
 #endif
 
-				if (ad->FwCmdTimeoutCnt < FW_CMD_TO_DBG_INFO_PRINT_CNT) {
-					if (exp_type == 0) {
-						MTWF_PRINT("FW is normal\n");
-						Show_FwDbgInfo_Proc(ad, NULL);
-						show_trinfo_proc(ad, NULL);
-					} else {
-						MTWF_PRINT("FW is exception\n\n\n\n");
-						Show_FwDbgInfo_Proc(ad, NULL);
-						show_trinfo_proc(ad, NULL);
-
-						RtmpusecDelay(5000);
-						if (ad->bIsBeenDumped == FALSE) {
-							ad->bIsBeenDumped = TRUE;
-							Show_CoreDump_Proc(ad, NULL);
-						}
+			if (ad->FwCmdTimeoutCnt < FW_CMD_TO_DBG_INFO_PRINT_CNT) {
+				if (exp_type == 0) {
+					MTWF_PRINT("FW is normal\n");
+					Show_FwDbgInfo_Proc(ad, NULL);
+					show_trinfo_proc(ad, NULL);
+				} else {
+					MTWF_PRINT("FW is exception\n\n\n\n");
+					Show_FwDbgInfo_Proc(ad, NULL);
+					show_trinfo_proc(ad, NULL);
+
+					RtmpusecDelay(5000);
+					if (ad->bIsBeenDumped == FALSE) {
+						ad->bIsBeenDumped = TRUE;
+						Show_CoreDump_Proc(ad, NULL);
+					}
 
 #ifdef WF_RESET_SUPPORT
-						RTMP_CHIP_OP *chip_op = hc_get_chip_ops(ad->hdev_ctrl);
+					RTMP_CHIP_OP *chip_op = hc_get_chip_ops(ad->hdev_ctrl);
 #ifdef CONFIG_CONNINFRA_SUPPORT
-						conninfra_pwr_off(CONNDRV_TYPE_WIFI);
+					conninfra_pwr_off(CONNDRV_TYPE_WIFI);
+					mdelay(15);
+					conninfra_pwr_on(CONNDRV_TYPE_WIFI);
+					mdelay(15);
+#endif /* CONFIG_CONNINFRA_SUPPORT */
+					if (IS_MT7916(ad)) {
+						UINT32 macVal;
+						RTMP_IO_READ32(ad->hdev_ctrl, 0x70002600, &macVal);
+						macVal |= 0x1;
+						RTMP_IO_WRITE32(ad->hdev_ctrl, 0x70002600, macVal);
 						mdelay(15);
-						conninfra_pwr_on(CONNDRV_TYPE_WIFI);
+						macVal &= 0xfffffffe;
+						RTMP_IO_WRITE32(ad->hdev_ctrl, 0x70002600, macVal);
 						mdelay(15);
-#endif /* CONFIG_CONNINFRA_SUPPORT */
-						if (IS_MT7916(ad)) {
-							UINT32 macVal;
-							RTMP_IO_READ32(ad->hdev_ctrl, 0x70002600, &macVal);
-							macVal |= 0x1;
-							RTMP_IO_WRITE32(ad->hdev_ctrl, 0x70002600, macVal);
-							mdelay(15);
-							macVal &= 0xfffffffe;
-							RTMP_IO_WRITE32(ad->hdev_ctrl, 0x70002600, macVal);
-							mdelay(15);
-						}
-
-						ad->wf_reset_wm_count++;
-						if (chip_op->do_wifi_reset)
-							chip_op->do_wifi_reset(ad);
+					}
+
+					ad->wf_reset_wm_count++;
+					if (chip_op->do_wifi_reset)
+						chip_op->do_wifi_reset(ad);
 #endif
 
 
-					}
 				}
+			}
 #endif /* CONFIG_AP_SUPPORT */
 
-				ASSERT(FALSE);
+			ASSERT(FALSE);
 #ifdef WF_RESET_SUPPORT
-				struct _RTMP_CHIP_OP *ops = hc_get_chip_ops(ad->hdev_ctrl);
+			struct _RTMP_CHIP_OP *ops = hc_get_chip_ops(ad->hdev_ctrl);
 
-				if (ops->heart_beat_check)
-					ops->heart_beat_check(ad);
+			if (ops->heart_beat_check)
+				ops->heart_beat_check(ad);
 #endif
 
-				if (ad->FwCmdTimeoutCnt == ad->FwCmdTimeoutPrintCnt) {
-					struct _RTMP_CHIP_OP *ops = hc_get_chip_ops(ad->hdev_ctrl);
-					UCHAR BandIdx;
-
-					if (ops->hw_auto_debug_trigger) {
-						for (BandIdx = 0; BandIdx < DBDC_BAND_NUM; BandIdx++)
-							ops->hw_auto_debug_trigger(ad, BandIdx, ENUM_AHDBUG_L1_WFDMA, 0);
-					}
+			if (ad->FwCmdTimeoutCnt == ad->FwCmdTimeoutPrintCnt) {
+				struct _RTMP_CHIP_OP *ops = hc_get_chip_ops(ad->hdev_ctrl);
+				UCHAR BandIdx;
 
-					MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
-							 "!!! FWCmdTimeout stop dumping... !!!\n");
+				if (ops->hw_auto_debug_trigger) {
+					for (BandIdx = 0; BandIdx < DBDC_BAND_NUM; BandIdx++)
+						ops->hw_auto_debug_trigger(ad, BandIdx, ENUM_AHDBUG_L1_WFDMA, 0);
 				}
+
+				MTWF_DBG(ad, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_WARN,
+						 "!!! FWCmdTimeout stop dumping... !!!\n");
 			}
+		}
+	} else {
+		if (msg->state == tx_kickout_fail) {
+			state = tx_kickout_fail;
+			msg->retry_times--;
 		} else {
-			if (msg->state == tx_kickout_fail) {
-				state = tx_kickout_fail;
-				msg->retry_times--;
-			} else {
-				if (msg->state == wait_cmd_out_and_ack) {
-					hif_mcu_unlink_ackq(msg);
-				} else if (msg->state == wait_ack)
-					AndesUnlinkCmdMsg(msg, &ctl->ackq);
-
-				state = tx_done;
-				msg->retry_times = 0;
-			}
+			if (msg->state == wait_cmd_out_and_ack) {
+				hif_mcu_unlink_ackq(msg);
+			} else if (msg->state == wait_ack)
+				AndesUnlinkCmdMsg(msg, &ctl->ackq);
+
+			state = tx_done;
+			msg->retry_times = 0;
+		}
 #ifdef WF_RESET_SUPPORT
-			ad->FwCmdTimeoutcheckCnt = 0;
+		ad->FwCmdTimeoutcheckCnt = 0;
 #endif
-		}
+	}
 
-		if (is_cmd_need_wait && (msg->retry_times > 0)) {
-			RTMP_OS_EXIT_COMPLETION(&msg->ack_done);
-			RTMP_OS_INIT_COMPLETION(&msg->ack_done);
-			msg->net_pkt = msg->retry_pkt;
-			msg->retry_pkt = NULL;
-			state = tx_retransmit;
-			AndesQueueHeadCmdMsg(&ctl->txq, msg, state);
-			goto retransmit;
-		} else {
-			if (msg->attr.ext_type == EXT_CMD_STAREC_UPDATE) {
-				/* Only StaRec update command read FW's response to minimize the impact.
-				 FW's response will become the final return value.
-				*/
-				ret = msg->cmd_return_status;
-			}
+	if (msg->retry_times > 0) {
+		RTMP_OS_EXIT_COMPLETION(&msg->ack_done);
+		RTMP_OS_INIT_COMPLETION(&msg->ack_done);
+		msg->net_pkt = msg->retry_pkt;
+		msg->retry_pkt = NULL;
+		state = tx_retransmit;
+		msg->send_us = AndesTimeUs();
+		AndesQueueHeadCmdMsg(&ctl->txq, msg, state);
+
+		if (AndesDequeueAndKickOutCmdMsgs(ad) != NDIS_STATUS_SUCCESS)
+			return ret;
 
-			MTWF_DBG(NULL, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_DEBUG,
-					 "%s: msg state = %d\n", __func__, state);
-			/* msg will be free after enqueuing to tx_doneq. So msg is not able to pass FW's response to caller. */
-			AndesQueueTailCmdMsg(&ctl->tx_doneq, msg, state);
+#ifdef WF_RESET_SUPPORT
+		if (ad->wf_reset_in_progress == TRUE)
+			return ret;
+#endif
+		goto wait;
+	} else {
+		if (msg->attr.ext_type == EXT_CMD_STAREC_UPDATE) {
+			/* Only StaRec update command read FW's response to minimize the impact.
+			 FW's response will become the final return value.
+			*/
+			ret = msg->cmd_return_status;
 		}
+
+		MTWF_DBG(NULL, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_DEBUG,
+				 "%s: msg state = %d\n", __func__, state);
+		AndesRecordCmdMsgRtt(ctl, msg, state);
+		/* msg will be free after enqueuing to tx_doneq. So msg is not able to pass FW's response to caller. */
+		AndesQueueTailCmdMsg(&ctl->tx_doneq, msg, state);
 	}
-bailout:
+
 	return ret;
 }
 
+/*
+ * Only commands whose response nobody reads and whose status only ends up in
+ * a log are worth deferring, the WTBL updates are the bulk of them when many
+ * stations and keys are set up.
+ */
+static BOOLEAN AndesCmdMsgBatchable(struct cmd_msg *msg)
+{
+	if (!IS_CMD_MSG_NEED_SYNC_WITH_FW_FLAG_SET(msg) ||
+		(msg->attr.rsp.wb_buf_in_calbk != NULL))
+		return FALSE;
+
+#ifdef WIFI_UNIFIED_COMMAND
+	if (IS_CMD_MSG_UNI_CMD_FLAG_SET(msg))
+		return FALSE;
+#endif /* WIFI_UNIFIED_COMMAND */
+
+	return ((msg->attr.type == EXT_CID) && (msg->attr.ext_type == EXT_CMD_ID_WTBL_UPDATE));
+}
+
+static VOID AndesCmdBatchWaitOldest(PRTMP_ADAPTER ad, struct cmd_msg_batch *batch)
+{
+	struct cmd_msg *msg = batch->msg[batch->head];
+	INT32 ret;
+
+	batch->msg[batch->head] = NULL;
+	batch->head = (batch->head + 1) % ANDES_PIPE_WINDOW;
+	batch->num--;
+
+	ret = AndesWaitCmdMsgRsp(ad, msg);
+
+	if ((ret != NDIS_STATUS_SUCCESS) && (batch->ret == NDIS_STATUS_SUCCESS))
+		batch->ret = ret;
+}
+
+static INT32 AndesCmdBatchAdd(PRTMP_ADAPTER ad, struct cmd_msg_batch *batch, struct cmd_msg *msg)
+{
+	INT32 ret;
+
+	if (batch->num >= ANDES_PIPE_WINDOW)
+		AndesCmdBatchWaitOldest(ad, batch);
+
+	if (!AndesSubmitCmdMsg(ad, msg, &ret)) {
+		if ((ret != NDIS_STATUS_SUCCESS) && (batch->ret == NDIS_STATUS_SUCCESS))
+			batch->ret = ret;
+		return ret;
+	}
+
+	batch->msg[(batch->head + batch->num) % ANDES_PIPE_WINDOW] = msg;
+	batch->num++;
+	return NDIS_STATUS_SUCCESS;
+}
+
+/*
+========================================================================
+Routine Description:
+	Let the batchable commands the calling task sends from now on be in
+	flight together.
+
+Arguments:
+	ad				- adapter
+	batch			- state of the batch, owned by the caller
+
+Return Value:
+	None
+
+Note:
+	Only one task at a time can have a batch open, for any other the
+	batch stays inert and its commands are waited for one by one. The
+	firmware handles commands in order, so a waited command sent while
+	the batch is open still sees all earlier WTBL updates applied.
+========================================================================
+*/
+VOID AndesCmdBatchBegin(RTMP_ADAPTER *ad, struct cmd_msg_batch *batch)
+{
+	struct MCU_CTRL *ctl = &ad->MCUCtrl;
+	unsigned long flags;
+
+	os_zero_mem(batch, sizeof(*batch));
+	batch->ret = NDIS_STATUS_SUCCESS;
+
+	if (in_interrupt() || !OS_TEST_BIT(MCU_INIT, &ctl->flags))
+		return;
+
+	OS_SPIN_LOCK_IRQSAVE(&ctl->msg_lock, &flags);
+	if (ctl->batch_owner == NULL) {
+		ctl->batch = batch;
+		ctl->batch_owner = (VOID *)current;
+	}
+	OS_SPIN_UNLOCK_IRQRESTORE(&ctl->msg_lock, &flags);
+}
+
+/* wait for everything the batch has in flight, returns the first failure */
+INT32 AndesCmdBatchFlush(RTMP_ADAPTER *ad, struct cmd_msg_batch *batch)
+{
+	INT32 ret;
+
+	while (batch->num > 0)
+		AndesCmdBatchWaitOldest(ad, batch);
+
+	ret = batch->ret;
+	batch->ret = NDIS_STATUS_SUCCESS;
+	return ret;
+}
+
+INT32 AndesCmdBatchEnd(RTMP_ADAPTER *ad, struct cmd_msg_batch *batch)
+{
+	struct MCU_CTRL *ctl = &ad->MCUCtrl;
+	unsigned long flags;
+	INT32 ret;
+
+	ret = AndesCmdBatchFlush(ad, batch);
+
+	OS_SPIN_LOCK_IRQSAVE(&ctl->msg_lock, &flags);
+	if (ctl->batch == batch) {
+		ctl->batch = NULL;
+		ctl->batch_owner = NULL;
+	}
+	OS_SPIN_UNLOCK_IRQRESTORE(&ctl->msg_lock, &flags);
+
+	return ret;
+}
+
+INT32 AndesSendCmdMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
+{
+	struct MCU_CTRL *ctl = &ad->MCUCtrl;
+	INT32 ret;
+
+	/* only the owner reads ctl->batch, it stays valid until it ends the batch */
+	if ((ctl->batch_owner == (VOID *)current) && !in_interrupt() &&
+		AndesCmdMsgBatchable(msg))
+		return AndesCmdBatchAdd(ad, ctl->batch, msg);
+
+	if (AndesSubmitCmdMsg(ad, msg, &ret))
+		ret = AndesWaitCmdMsgRsp(ad, msg);
+
+	return ret;
+}
+
+/*
+ * iwpriv ra0 show mcu_rtt[=1]: round trip of the waited firmware commands per
+ * command type, from queueing until the response is matched. Percentiles are
+ * the upper bound of their log2 bucket, "1" clears the statistics afterwards.
+ */
+INT Show_McuCmdRtt_Proc(RTMP_ADAPTER *ad, RTMP_STRING *arg)
+{
+	struct MCU_CTRL *ctl = &ad->MCUCtrl;
+	ANDES_SEQ_CTRL_T seq_ctrl;
+	P_ANDES_RTT_CTRL_T rtt = NULL;
+	unsigned long flags;
+	LONG reset = 0;
+	UINT32 i;
+
+	if (!(arg == NULL || strlen(arg) == 0))
+		reset = os_str_tol(arg, 0, 10);
+
+	if (!OS_TEST_BIT(MCU_INIT, &ctl->flags))
+		return TRUE;
+
+	os_alloc_mem(NULL, (UCHAR **)&rtt, sizeof(*rtt));
+
+	if (!rtt)
+		return FALSE;
+
+	RTMP_SPIN_LOCK_IRQSAVE(&ctl->seq_lock, &flags);
+	os_move_mem(&seq_ctrl, &ctl->seq_ctrl, sizeof(seq_ctrl));
+	os_move_mem(rtt, &ctl->rtt, sizeof(*rtt));
+
+	if (reset) {
+		AndesRttInit(&ctl->rtt);
+		ctl->seq_ctrl.u4MaxInFlight = ctl->seq_ctrl.u4InFlight;
+		ctl->seq_ctrl.u4StaleCnt = 0;
+		ctl->seq_ctrl.u4LateRspCnt = 0;
+		ctl->seq_ctrl.u4ReclaimCnt = 0;
+		ctl->seq_ctrl.u4ExhaustCnt = 0;
+	}
+	RTMP_SPIN_UNLOCK_IRQRESTORE(&ctl->seq_lock, &flags);
+
+	MTWF_PRINT("\tSeq InFlight=%u, MaxInFlight=%u, Busy=0x%04x, Stale=0x%04x\n",
+			   seq_ctrl.u4InFlight, seq_ctrl.u4MaxInFlight, seq_ctrl.u2Busy, seq_ctrl.u2Stale);
+	MTWF_PRINT("\tTimeout=%u, LateRsp=%u, Reclaim=%u, Exhaust=%u, Batch=%s\n",
+			   seq_ctrl.u4StaleCnt, seq_ctrl.u4LateRspCnt, seq_ctrl.u4ReclaimCnt,
+			   seq_ctrl.u4ExhaustCnt, ctl->batch_owner ? "open" : "none");
+	MTWF_PRINT("\tCMD Round Trip (us):\n");
+
+	for (i = 0; i < rtt->u4Used; i++) {
+		P_ANDES_RTT_STAT_T stat = &rtt->arStat[i];
+
+		MTWF_PRINT("\tCID: 0x%02x, ExtCID: 0x%02x, Cnt=%u, Timeout=%u, avg/p50/p99/max=%u/%u/%u/%u\n",
+				   stat->u1Type, stat->u1ExtType, stat->u4Cnt, stat->u4TimeoutCnt,
+				   stat->u4Cnt ? (UINT32)div_u64(stat->u8SumUs, stat->u4Cnt) : 0,
+				   AndesRttPercentile(stat, 500), AndesRttPercentile(stat, 990),
+				   stat->u4MaxUs);
+	}
+
+	if (rtt->u4Dropped)
+		MTWF_PRINT("\tCMD types not tracked: %u samples\n", rtt->u4Dropped);
+
+	os_free_mem(rtt);
+	return TRUE;
+}
+
 INT32 MtCmdSendMsg(PRTMP_ADAPTER ad, struct cmd_msg *msg)
 {
 	INT32 ret = 0;
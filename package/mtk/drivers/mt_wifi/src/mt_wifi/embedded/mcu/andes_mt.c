@@ -4450,6 +4450,7 @@ static VOID HandleSeqNonZeroNormalEvents(RTMP_ADAPTER *pAd,
 	struct cmd_msg *msg, *msg_tmp;
 	struct MCU_CTRL *ctl = &pAd->MCUCtrl;
 	unsigned long flags = 0;
+	BOOLEAN matched = FALSE;
 
 	peerSeq = GetEventFwRxdSequenceNumber(event_rxd);
 	GetMCUCtrlAckQueueSpinLock(&ctl, &flags);
@@ -4463,6 +4464,8 @@ static VOID HandleSeqNonZeroNormalEvents(RTMP_ADAPTER *pAd,
 					 "%s (seq=%d)\n", __func__, msg->seq);
 
 			msg->receive_time_in_jiffies = jiffies;
+			msg->rsp_us = AndesTimeUs();
+			matched = TRUE;
 			MTWF_DBG(NULL, DBG_CAT_FW, DBG_SUBCAT_ALL, DBG_LVL_DEBUG,
 					 "%s: CMD_ID(0x%x 0x%x),total spent %ld ms\n", __func__,
 					  msg->attr.type, msg->attr.ext_type, ((msg->receive_time_in_jiffies - msg->sending_time_in_jiffies) * 1000 / OS_HZ));
@@ -4488,6 +4491,9 @@ static VOID HandleSeqNonZeroNormalEvents(RTMP_ADAPTER *pAd,
 		}
 	}
 	ReleaseMCUCtrlAckQueueSpinLock(&ctl, &flags);
+
+	if (!matched)
+		AndesCmdMsgUnmatchedRsp(pAd, peerSeq);
 }
 
 #ifdef WIFI_UNIFIED_COMMAND
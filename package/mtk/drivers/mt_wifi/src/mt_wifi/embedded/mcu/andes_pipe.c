@@ -0,0 +1,178 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	andes_pipe.c
+
+	Abstract:
+	Sequence numbers and round trip statistics of the firmware commands.
+	A sequence number is handed out when a command is built and belongs to
+	it until the command is freed, so that any number of commands may wait
+	for their responses at the same time. The number of a command that
+	timed out rests for a while before it is handed out again, its late
+	response would otherwise complete the next command that gets it.
+*/
+
+#include "rt_config.h"
+
+#define ANDES_SEQ_BIT(_seq)			((UINT16)(1 << (_seq)))
+
+VOID AndesSeqInit(P_ANDES_SEQ_CTRL_T prSeq)
+{
+	os_zero_mem(prSeq, sizeof(*prSeq));
+}
+
+/*
+========================================================================
+Routine Description:
+	Hand out the next free sequence number.
+
+Arguments:
+	prSeq			- sequence number state
+	u4NowMs			- current time
+
+Return Value:
+	1..15, 0 if every number belongs to a command that may still be
+	answered.
+
+Note:
+	Numbers are handed out round robin as before. When all of them are
+	taken, a resting number is preferred over one a command still waits
+	on, and a number is only taken back from its command once it has been
+	held for longer than any command waits.
+========================================================================
+*/
+UINT8 AndesSeqAlloc(P_ANDES_SEQ_CTRL_T prSeq, UINT32 u4NowMs)
+{
+	UINT8 u1Seq = prSeq->u1Last;
+	UINT8 u1Stale = 0, u1Oldest = 0;
+	UINT32 i;
+
+	for (i = 1; i < ANDES_SEQ_NUM; i++) {
+		u1Seq = (u1Seq >= ANDES_SEQ_NUM - 1) ? 1 : u1Seq + 1;
+
+		if (prSeq->u2Busy & ANDES_SEQ_BIT(u1Seq)) {
+			if (!u1Oldest ||
+				!ANDES_MS_AFTER_EQ(prSeq->au4Since[u1Seq], prSeq->au4Since[u1Oldest]))
+				u1Oldest = u1Seq;
+			continue;
+		}
+
+		if (prSeq->u2Stale & ANDES_SEQ_BIT(u1Seq)) {
+			if (!ANDES_MS_AFTER_EQ(u4NowMs, prSeq->au4Since[u1Seq] + ANDES_SEQ_STALE_MS)) {
+				if (!u1Stale ||
+					!ANDES_MS_AFTER_EQ(prSeq->au4Since[u1Seq], prSeq->au4Since[u1Stale]))
+					u1Stale = u1Seq;
+				continue;
+			}
+
+			prSeq->u2Stale &= ~ANDES_SEQ_BIT(u1Seq);
+		}
+
+		goto found;
+	}
+
+	if (u1Stale) {
+		u1Seq = u1Stale;
+		prSeq->u2Stale &= ~ANDES_SEQ_BIT(u1Seq);
+		goto found;
+	}
+
+	if (u1Oldest &&
+		ANDES_MS_AFTER_EQ(u4NowMs, prSeq->au4Since[u1Oldest] + ANDES_SEQ_RECLAIM_MS)) {
+		/* lost by a caller that got a number but never sent the command */
+		u1Seq = u1Oldest;
+		prSeq->u2Busy &= ~ANDES_SEQ_BIT(u1Seq);
+		prSeq->u4InFlight--;
+		prSeq->u4ReclaimCnt++;
+		goto found;
+	}
+
+	prSeq->u4ExhaustCnt++;
+	return 0;
+
+found:
+	prSeq->u2Busy |= ANDES_SEQ_BIT(u1Seq);
+	prSeq->au4Since[u1Seq] = u4NowMs;
+	prSeq->u1Last = u1Seq;
+	prSeq->u4InFlight++;
+
+	if (prSeq->u4InFlight > prSeq->u4MaxInFlight)
+		prSeq->u4MaxInFlight = prSeq->u4InFlight;
+
+	return u1Seq;
+}
+
+VOID AndesSeqFree(P_ANDES_SEQ_CTRL_T prSeq, UINT8 u1Seq, UINT32 u4NowMs, BOOLEAN fgTimeout)
+{
+	if ((u1Seq == 0) || (u1Seq >= ANDES_SEQ_NUM) ||
+		!(prSeq->u2Busy & ANDES_SEQ_BIT(u1Seq)))
+		return;
+
+	prSeq->u2Busy &= ~ANDES_SEQ_BIT(u1Seq);
+	prSeq->u4InFlight--;
+
+	if (fgTimeout) {
+		prSeq->u2Stale |= ANDES_SEQ_BIT(u1Seq);
+		prSeq->au4Since[u1Seq] = u4NowMs;
+		prSeq->u4StaleCnt++;
+	}
+}
+
+/* a response whose command is gone, most likely the late one of a timeout */
+VOID AndesSeqUnmatchedRsp(P_ANDES_SEQ_CTRL_T prSeq, UINT8 u1Seq)
+{
+	prSeq->u4LateRspCnt++;
+
+	if ((u1Seq == 0) || (u1Seq >= ANDES_SEQ_NUM))
+		return;
+
+	if (!(prSeq->u2Busy & ANDES_SEQ_BIT(u1Seq)))
+		prSeq->u2Stale &= ~ANDES_SEQ_BIT(u1Seq);
+}
+
+VOID AndesRttInit(P_ANDES_RTT_CTRL_T prRtt)
+{
+	os_zero_mem(prRtt, sizeof(*prRtt));
+}
+
+VOID AndesRttRecord(P_ANDES_RTT_CTRL_T prRtt, UINT8 u1Type, UINT8 u1ExtType,
+			UINT32 u4Us, BOOLEAN fgTimeout)
+{
+	P_ANDES_RTT_STAT_T prStat = NULL;
+	UINT32 i;
+
+	for (i = 0; i < prRtt->u4Used; i++) {
+		if ((prRtt->arStat[i].u1Type == u1Type) &&
+			(prRtt->arStat[i].u1ExtType == u1ExtType)) {
+			prStat = &prRtt->arStat[i];
+			break;
+		}
+	}
+
+	if (!prStat) {
+		if (prRtt->u4Used >= ANDES_RTT_SLOTS) {
+			prRtt->u4Dropped++;
+			return;
+		}
+
+		prStat = &prRtt->arStat[prRtt->u4Used++];
+		prStat->u1Type = u1Type;
+		prStat->u1ExtType = u1ExtType;
+	}
+
+	if (fgTimeout) {
+		prStat->u4TimeoutCnt++;
+		return;
+	}
+
+	LatHistRecord(prStat->au4Hist, &prStat->u4MaxUs, u4Us);
+	prStat->u4Cnt++;
+	prStat->u8SumUs += u4Us;
+}
+
+UINT32 AndesRttPercentile(P_ANDES_RTT_STAT_T prStat, UINT32 u4Permille)
+{
+	return LatHistPercentile(prStat->au4Hist, prStat->u4Cnt, u4Permille);
+}
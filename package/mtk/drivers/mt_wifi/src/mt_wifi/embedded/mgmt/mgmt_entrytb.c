@@ -2155,7 +2155,7 @@ BOOLEAN MacTableDeleteEntry(RTMP_ADAPTER *pAd, USHORT wcid, UCHAR *pAddr)
 
 #ifdef RED_SUPPORT
 	if (pAd->MacTab.Size == 0)
-		pAd->ixia_mode_ctl.fgProbeRspDetect = FALSE;
+		pAd->dyn_mode_ctl.fgProbeRspDetect = FALSE;
 #endif
 #ifdef DABS_QOS
 	for (idx = 0; idx < MAX_QOS_PARAM_TBL; idx++) {
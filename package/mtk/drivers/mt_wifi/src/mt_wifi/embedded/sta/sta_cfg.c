@@ -749,6 +749,8 @@ static struct {
 	{"devinfo", show_devinfo_proc},
 	{"stainfo", Show_MacTable_Proc},
 	{"hwctrl", Show_HwCtrlStatistic_Proc},
+	{"hwctrl_lat", Show_HwCtrlLatency_Proc},
+	{"mcu_rtt", Show_McuCmdRtt_Proc},
 	{"trinfo", show_trinfo_proc},
 	{"tpinfo", show_tpinfo_proc},
 	{"sysinfo", show_sysinfo_proc},
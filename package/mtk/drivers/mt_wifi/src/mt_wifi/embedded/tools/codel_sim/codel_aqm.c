@@ -0,0 +1,184 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	codel_aqm.c
+
+	Abstract:
+	CoDel drop decision for one queue. The caller stamps packets when they
+	are queued, asks CodelDequeueDrop() whether to drop a packet when it
+	leaves the software queue, and reports the time it spent in the
+	hardware queue through CodelTxDone() once it has been transmitted.
+	The sojourn time seen by the control law is the software queue delay of
+	the packet plus the most recent hardware queue delay, which is where
+	most of the buffering of the offloaded MACs happens.
+*/
+
+#include "rt_config.h"
+
+/*
+ * One Newton iteration of 1/sqrt(count), as in the Linux implementation:
+ * new = old * (3 - count * old^2) / 2
+ */
+static VOID codel_newton_step(P_CODEL_VARS_T prVars)
+{
+	UINT32 invsqrt = ((UINT32)prVars->u2RecInvSqrt) << CODEL_REC_INV_SQRT_SHIFT;
+	UINT32 invsqrt2 = ((UINT64)invsqrt * invsqrt) >> 32;
+	UINT64 val = (3ULL << 32) - ((UINT64)prVars->u4Count * invsqrt2);
+
+	val >>= 2;	/* avoid overflow in the following multiply */
+	val = (val * invsqrt) >> (32 - 2 + 1);
+
+	prVars->u2RecInvSqrt = val >> CODEL_REC_INV_SQRT_SHIFT;
+}
+
+/* t + interval / sqrt(count) */
+static UINT32 codel_control_law(UINT32 t, UINT32 interval, UINT16 rec_inv_sqrt)
+{
+	return t + (UINT32)(((UINT64)interval *
+		((UINT32)rec_inv_sqrt << CODEL_REC_INV_SQRT_SHIFT)) >> 32);
+}
+
+static BOOLEAN codel_should_drop(P_CODEL_VARS_T prVars, P_CODEL_PARAMS_T prParams,
+			UINT32 u4Now, UINT32 u4Sojourn, UINT32 u4Backlog)
+{
+	if (u4Sojourn < prParams->u4Target || u4Backlog < prParams->u4MinBacklog) {
+		/* went below target, stay below for at least an interval */
+		prVars->u4FirstAboveTime = 0;
+		return FALSE;
+	}
+
+	if (prVars->u4FirstAboveTime == 0) {
+		/* just went above, drop only if it stays there for an interval */
+		prVars->u4FirstAboveTime = (u4Now + prParams->u4Interval) | 1;
+		return FALSE;
+	}
+
+	return CODEL_TIME_AFTER_EQ(u4Now, prVars->u4FirstAboveTime);
+}
+
+VOID CodelInitParams(P_CODEL_PARAMS_T prParams, UINT32 u4TargetUs, UINT32 u4IntervalUs)
+{
+	prParams->u4Target = CODEL_US2TIME(u4TargetUs);
+	prParams->u4Interval = CODEL_US2TIME(u4IntervalUs);
+	prParams->u4MinBacklog = CODEL_MIN_BACKLOG_DEFAULT;
+}
+
+VOID CodelInitVars(P_CODEL_VARS_T prVars)
+{
+	prVars->u4Count = 0;
+	prVars->u4LastCount = 0;
+	prVars->u4FirstAboveTime = 0;
+	prVars->u4DropNext = 0;
+	prVars->u4HwDelay = 0;
+	prVars->u4HwDelayTime = 0;
+	prVars->u4LastSojourn = 0;
+	prVars->u4DropCnt = 0;
+	prVars->u2RecInvSqrt = 0;
+	prVars->fgDropping = FALSE;
+}
+
+/*
+========================================================================
+Routine Description:
+	Record how long a transmitted packet stayed in the hardware queue.
+
+Arguments:
+	prVars			- queue state
+	u4Now			- current time
+	u4HwDelay		- time from leaving the software queue to tx done
+
+Return Value:
+	None
+
+Note:
+	Only the latest sample is kept. It is used by CodelDequeueDrop() for
+	one interval, an idle hardware queue does not report any samples.
+========================================================================
+*/
+VOID CodelTxDone(P_CODEL_VARS_T prVars, UINT32 u4Now, UINT32 u4HwDelay)
+{
+	prVars->u4HwDelay = u4HwDelay;
+	prVars->u4HwDelayTime = u4Now;
+}
+
+/*
+========================================================================
+Routine Description:
+	Decide whether the packet leaving the software queue is dropped.
+
+Arguments:
+	prVars			- queue state
+	prParams		- target and interval
+	u4Now			- current time
+	u4SwSojourn		- time the packet spent in the software queue
+	u4Backlog		- packets of this queue held by the driver and hardware
+
+Return Value:
+	TRUE if the packet must be dropped, the caller frees it.
+
+Note:
+	This is the CoDel dequeue state machine, applied to one packet per call
+	instead of looping over the queue head.
+========================================================================
+*/
+BOOLEAN CodelDequeueDrop(P_CODEL_VARS_T prVars, P_CODEL_PARAMS_T prParams,
+			UINT32 u4Now, UINT32 u4SwSojourn, UINT32 u4Backlog)
+{
+	UINT32 u4Sojourn = u4SwSojourn;
+	UINT32 u4Delta;
+	BOOLEAN fgOkToDrop;
+
+	if (prVars->u4HwDelayTime &&
+		CODEL_TIME_BEFORE(u4Now, prVars->u4HwDelayTime + prParams->u4Interval))
+		u4Sojourn += prVars->u4HwDelay;
+
+	prVars->u4LastSojourn = u4Sojourn;
+	fgOkToDrop = codel_should_drop(prVars, prParams, u4Now, u4Sojourn, u4Backlog);
+
+	if (prVars->fgDropping) {
+		if (!fgOkToDrop) {
+			/* sojourn time below target, leave drop state */
+			prVars->fgDropping = FALSE;
+			return FALSE;
+		}
+
+		if (!CODEL_TIME_AFTER_EQ(u4Now, prVars->u4DropNext))
+			return FALSE;
+
+		/* drop faster as long as the queue stays above target */
+		prVars->u4Count++;
+		codel_newton_step(prVars);
+		prVars->u4DropNext = codel_control_law(prVars->u4DropNext,
+					prParams->u4Interval, prVars->u2RecInvSqrt);
+		prVars->u4DropCnt++;
+		return TRUE;
+	}
+
+	if (!fgOkToDrop)
+		return FALSE;
+
+	prVars->fgDropping = TRUE;
+
+	/*
+	 * If the drop state was left only a little while ago, resume close to
+	 * the rate that controlled the queue last time.
+	 */
+	u4Delta = prVars->u4Count - prVars->u4LastCount;
+
+	if (u4Delta > 1 &&
+		CODEL_TIME_BEFORE(u4Now - prVars->u4DropNext, 16 * prParams->u4Interval)) {
+		prVars->u4Count = u4Delta;
+		codel_newton_step(prVars);
+	} else {
+		prVars->u4Count = 1;
+		prVars->u2RecInvSqrt = ~0U >> CODEL_REC_INV_SQRT_SHIFT;
+	}
+
+	prVars->u4LastCount = prVars->u4Count;
+	prVars->u4DropNext = codel_control_law(u4Now, prParams->u4Interval,
+				prVars->u2RecInvSqrt);
+	prVars->u4DropCnt++;
+	return TRUE;
+}
@@ -0,0 +1,68 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	codel_aqm.h
+
+	Abstract:
+	Sojourn time based active queue management (CoDel, RFC 8289) for the
+	per-STA per-AC data queues. The caller passes in the current time and
+	the queue's backlog, the state machine keeps no clock or lock of its
+	own; codel_sim drives it with simulated time. It is not built into
+	the driver: the chips in this tree run RED in the WA firmware, and
+	the host RED path it was written for (RED_SUPPORT_BY_HOST) is not
+	enabled for any of them.
+*/
+
+#ifndef _CODEL_AQM_H_
+#define _CODEL_AQM_H_
+
+/*
+ * Time is kept in units of 1024ns, so that it can be derived from a
+ * nanosecond clock with a shift, and conversions avoid 64 bit divisions.
+ * Comparisons are wrap-safe.
+ */
+#define CODEL_SHIFT							(10)
+#define CODEL_US2TIME(_us)					((UINT32)(((UINT64)(_us) * 1000) >> CODEL_SHIFT))
+#define CODEL_TIME2US(_t)					((UINT32)(((UINT64)(_t) * 1049) >> CODEL_SHIFT))
+#define CODEL_TIME_AFTER(_a, _b)			((INT32)((_a) - (_b)) > 0)
+#define CODEL_TIME_AFTER_EQ(_a, _b)			((INT32)((_a) - (_b)) >= 0)
+#define CODEL_TIME_BEFORE(_a, _b)			CODEL_TIME_AFTER(_b, _a)
+
+#define CODEL_TARGET_DEFAULT				(5000)		/* us */
+#define CODEL_INTERVAL_DEFAULT				(100000)	/* us */
+#define CODEL_MIN_BACKLOG_DEFAULT			(2)			/* packets */
+
+#define CODEL_REC_INV_SQRT_BITS				(16)
+#define CODEL_REC_INV_SQRT_SHIFT			(32 - CODEL_REC_INV_SQRT_BITS)
+
+typedef struct _CODEL_PARAMS_T {
+	UINT32 u4Target;		/* acceptable standing queue delay */
+	UINT32 u4Interval;		/* width of the moving minimum window */
+	UINT32 u4MinBacklog;	/* never drop below this many queued packets */
+} CODEL_PARAMS_T, *P_CODEL_PARAMS_T;
+
+typedef struct _CODEL_VARS_T {
+	UINT32 u4Count;			/* packets dropped since entering drop state */
+	UINT32 u4LastCount;		/* u4Count when the last drop state was left */
+	UINT32 u4FirstAboveTime;	/* when sojourn time went above target, 0 if below */
+	UINT32 u4DropNext;		/* time to drop the next packet */
+	UINT32 u4HwDelay;		/* latest time a packet spent in the hardware queue */
+	UINT32 u4HwDelayTime;	/* when u4HwDelay was sampled */
+	UINT32 u4LastSojourn;	/* estimate used for the latest decision */
+	UINT32 u4DropCnt;
+	UINT16 u2RecInvSqrt;	/* 1/sqrt(u4Count) in Q0.16 */
+	BOOLEAN fgDropping;
+} CODEL_VARS_T, *P_CODEL_VARS_T;
+
+VOID CodelInitParams(P_CODEL_PARAMS_T prParams, UINT32 u4TargetUs, UINT32 u4IntervalUs);
+
+VOID CodelInitVars(P_CODEL_VARS_T prVars);
+
+VOID CodelTxDone(P_CODEL_VARS_T prVars, UINT32 u4Now, UINT32 u4HwDelay);
+
+BOOLEAN CodelDequeueDrop(P_CODEL_VARS_T prVars, P_CODEL_PARAMS_T prParams,
+			UINT32 u4Now, UINT32 u4SwSojourn, UINT32 u4Backlog);
+
+#endif /* _CODEL_AQM_H_ */
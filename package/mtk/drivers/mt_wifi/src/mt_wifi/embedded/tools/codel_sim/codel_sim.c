@@ -0,0 +1,428 @@
+/*
+ * codel_sim - compare the per station AQM engines of ra_ac_q_mgmt.c on a
+ * simulated AP with stations of different PHY rates.
+ *
+ * The CoDel state machine in codel_aqm.c is built against the stand-ins in
+ * host/rt_config.h. Every station has a software queue that feeds a hardware
+ * queue shared by all stations (the PLE tokens), which is drained by an
+ * airtime round robin sending A-MPDUs. CoDel decides at the software dequeue
+ * with the software delay of the packet plus the latest hardware delay
+ * reported at tx done, where the host RED path would call it. The threshold
+ * engine is modelled after RedBadNode() and RedMarkPktDrop() with ATC off,
+ * it also runs with CoDel as the limit for senders that do not back off.
+ *
+ * Usage: codel_sim [-m none|red|codel] [-t sec] [-T target_us] [-I interval_us]
+ *		[-q hw_tokens] [-r rtt_us] <phy_mbps,tcp|offered_mbps> ...
+ *	e.g. codel_sim 866,tcp 866,tcp 54,tcp 6.5,20
+ */
+
+#include <math.h>
+#include <unistd.h>
+
+#include "codel_aqm.c"
+
+#define MAX_STA			16
+#define RING_SIZE		16384
+#define PKT_BITS		(1500 * 8)
+#define AMPDU_MAX		32
+#define AMPDU_OVERHEAD	100		/* us per PPDU, contention and block ack */
+#define PPDU_MAX_TIME	4000	/* us */
+#define SW_QUEUE_MAX	8192
+#define TICK			10		/* us */
+#define HIST_BIN		100		/* us */
+#define HIST_BINS		50000
+#define RED_CHECK		100000	/* us, like the RED period */
+
+enum { AQM_NONE, AQM_RED, AQM_CODEL };
+
+static const char *aqm_name[] = { "none", "red", "codel" };
+
+struct ring {
+	UINT64 t[RING_SIZE];
+	UINT64 t2[RING_SIZE];
+	unsigned int head, tail;
+};
+
+struct sta {
+	double phy;
+	double offered;
+	int tcp;
+
+	struct ring sw, hw, ack;
+
+	/* sources */
+	double credit;
+	double cwnd;
+	double ssthresh;
+	unsigned int inflight;
+	UINT64 recover;
+
+	/* aqm */
+	CODEL_VARS_T codel;
+	unsigned int dropth, bad_cnt, good_cnt, bad;
+
+	/* statistics */
+	unsigned long long delivered, drops, tail_drops, sojourn_sum;
+	unsigned int hist[HIST_BINS];
+};
+
+static struct sta sta[MAX_STA];
+static int nsta;
+
+static unsigned int ring_len(struct ring *r)
+{
+	return r->tail - r->head;
+}
+
+static void ring_push(struct ring *r, UINT64 t, UINT64 t2)
+{
+	r->t[r->tail % RING_SIZE] = t;
+	r->t2[r->tail % RING_SIZE] = t2;
+	r->tail++;
+}
+
+static void ring_pop(struct ring *r, UINT64 *t, UINT64 *t2)
+{
+	*t = r->t[r->head % RING_SIZE];
+	*t2 = r->t2[r->head % RING_SIZE];
+	r->head++;
+}
+
+static double airtime(struct sta *s)
+{
+	return PKT_BITS / s->phy;
+}
+
+/* a lost packet is noticed by the sender one round trip later */
+static void sta_loss(struct sta *s, UINT64 now, UINT64 rtt)
+{
+	s->drops++;
+	if (s->tcp)
+		ring_push(&s->ack, now + rtt, 1);
+}
+
+static int red_drop(struct sta *s, int aqm)
+{
+	unsigned int active = 0;
+	int i;
+
+	if (aqm == AQM_NONE)
+		return 0;
+
+	for (i = 0; i < nsta; i++)
+		if (ring_len(&sta[i].sw) + ring_len(&sta[i].hw))
+			active++;
+
+	if (active <= 1 || !s->bad)
+		return 0;
+
+	return ring_len(&s->sw) + ring_len(&s->hw) >= s->dropth;
+}
+
+static void red_check(unsigned int target_us)
+{
+	int i;
+
+	for (i = 0; i < nsta; i++) {
+		struct sta *s = &sta[i];
+		unsigned int th = target_us / (unsigned int)ceil(airtime(s));
+
+		if (th < 20)
+			th = 20;
+		else if (th > 600)
+			th = 600;
+		s->dropth = th * 30 / 10;
+
+		if (ring_len(&s->sw) + ring_len(&s->hw) >= s->dropth) {
+			s->bad_cnt++;
+			s->good_cnt = 0;
+		} else {
+			s->good_cnt++;
+			s->bad_cnt = 0;
+		}
+
+		if (s->bad_cnt >= 10) {
+			s->bad_cnt = 0;
+			s->bad = 1;
+		}
+
+		if (s->good_cnt >= 7) {
+			s->good_cnt = 0;
+			s->bad = 0;
+		}
+	}
+}
+
+static void enqueue(struct sta *s, UINT64 now, UINT64 rtt, int aqm)
+{
+	if (s->tcp)
+		s->inflight++;
+
+	if (red_drop(s, aqm)) {
+		sta_loss(s, now, rtt);
+		return;
+	}
+
+	if (ring_len(&s->sw) >= SW_QUEUE_MAX) {
+		s->tail_drops++;
+		sta_loss(s, now, rtt);
+		return;
+	}
+
+	ring_push(&s->sw, now, 0);
+}
+
+static void sources(UINT64 now, UINT64 rtt, int aqm)
+{
+	int i;
+
+	for (i = 0; i < nsta; i++) {
+		struct sta *s = &sta[i];
+		UINT64 t, loss;
+
+		if (!s->tcp) {
+			s->credit += s->offered * TICK / PKT_BITS;
+			while (s->credit >= 1) {
+				s->credit -= 1;
+				enqueue(s, now, rtt, aqm);
+			}
+			continue;
+		}
+
+		while (ring_len(&s->ack) && s->ack.t[s->ack.head % RING_SIZE] <= now) {
+			ring_pop(&s->ack, &t, &loss);
+			s->inflight--;
+
+			if (!loss) {
+				s->cwnd += s->cwnd < s->ssthresh ? 1 : 1 / s->cwnd;
+			} else if (now >= s->recover) {
+				/* one window reduction per round trip */
+				s->cwnd = s->cwnd / 2 < 2 ? 2 : s->cwnd / 2;
+				s->ssthresh = s->cwnd;
+				s->recover = now + rtt;
+			}
+		}
+
+		while (s->inflight < s->cwnd && ring_len(&s->ack) < RING_SIZE - AMPDU_MAX)
+			enqueue(s, now, rtt, aqm);
+	}
+}
+
+static void schedule(UINT64 now, UINT64 rtt, unsigned int tokens, int aqm,
+			P_CODEL_PARAMS_T prParams)
+{
+	static int rr;
+	unsigned int used = 0;
+	int i, idle = 0;
+
+	for (i = 0; i < nsta; i++)
+		used += ring_len(&sta[i].hw);
+
+	while (used < tokens && idle < nsta) {
+		struct sta *s = &sta[rr];
+		UINT64 enq, unused;
+
+		rr = (rr + 1) % nsta;
+
+		if (!ring_len(&s->sw)) {
+			idle++;
+			continue;
+		}
+
+		idle = 0;
+		ring_pop(&s->sw, &enq, &unused);
+
+		if (aqm == AQM_CODEL &&
+			CodelDequeueDrop(&s->codel, prParams, CODEL_US2TIME(now),
+				CODEL_US2TIME(now - enq), ring_len(&s->sw) + ring_len(&s->hw) + 1)) {
+			sta_loss(s, now, rtt);
+			continue;
+		}
+
+		ring_push(&s->hw, enq, now);
+		used++;
+	}
+}
+
+static void ppdu_done(struct sta *s, unsigned int n, UINT64 now, UINT64 rtt)
+{
+	UINT64 enq, deq, delay;
+
+	while (n--) {
+		ring_pop(&s->hw, &enq, &deq);
+		delay = now - enq;
+
+		CodelTxDone(&s->codel, CODEL_US2TIME(now), CODEL_US2TIME(now - deq));
+
+		s->delivered++;
+		s->sojourn_sum += delay;
+		s->hist[delay / HIST_BIN < HIST_BINS ? delay / HIST_BIN : HIST_BINS - 1]++;
+
+		if (s->tcp)
+			ring_push(&s->ack, now + rtt, 0);
+	}
+}
+
+static double percentile(struct sta *s, double p)
+{
+	unsigned long long want = s->delivered * p, sum = 0;
+	int i;
+
+	for (i = 0; i < HIST_BINS; i++) {
+		sum += s->hist[i];
+		if (sum > want)
+			return (i + 0.5) * HIST_BIN / 1000.0;
+	}
+
+	return HIST_BINS * HIST_BIN / 1000.0;
+}
+
+static void run(int aqm, double sec, unsigned int target_us, unsigned int interval_us,
+		unsigned int tokens, UINT64 rtt)
+{
+	CODEL_PARAMS_T rParams;
+	UINT64 now, end = sec * 1000000, busy = 0, next_red = RED_CHECK;
+	struct sta *air = NULL;
+	unsigned int air_n = 0;
+	double total = 0;
+	int i, rr = 0;
+
+	CodelInitParams(&rParams, target_us, interval_us);
+
+	for (i = 0; i < nsta; i++) {
+		struct sta *s = &sta[i];
+		double phy = s->phy, offered = s->offered;
+		int tcp = s->tcp;
+
+		memset(s, 0, sizeof(*s));
+		s->phy = phy;
+		s->offered = offered;
+		s->tcp = tcp;
+		s->cwnd = 10;
+		s->ssthresh = 1e9;
+		CodelInitVars(&s->codel);
+	}
+
+	for (now = 0; now < end; now += TICK) {
+		sources(now, rtt, aqm);
+		schedule(now, rtt, tokens, aqm, &rParams);
+
+		if (now >= next_red) {
+			red_check(target_us);
+			next_red += RED_CHECK;
+		}
+
+		if (now < busy)
+			continue;
+
+		if (air) {
+			ppdu_done(air, air_n, now, rtt);
+			air = NULL;
+		}
+
+		for (i = 0; i < nsta; i++) {
+			struct sta *s = &sta[(rr + i) % nsta];
+
+			if (!ring_len(&s->hw))
+				continue;
+
+			air = s;
+			air_n = PPDU_MAX_TIME / airtime(s);
+			if (air_n > AMPDU_MAX)
+				air_n = AMPDU_MAX;
+			if (air_n > ring_len(&s->hw))
+				air_n = ring_len(&s->hw);
+			if (!air_n)
+				air_n = 1;
+			busy = now + AMPDU_OVERHEAD + (UINT64)ceil(air_n * airtime(s));
+			rr = (rr + i + 1) % nsta;
+			break;
+		}
+	}
+
+	printf("%-6s sta  phy(Mbps)  load   tput(Mbps)  mean(ms)  p50(ms)  p99(ms)  drops\n",
+		aqm_name[aqm]);
+
+	for (i = 0; i < nsta; i++) {
+		struct sta *s = &sta[i];
+		double tput = s->delivered * PKT_BITS / sec / 1000000;
+		char load[16];
+
+		if (s->tcp)
+			snprintf(load, sizeof(load), "tcp");
+		else
+			snprintf(load, sizeof(load), "%.1f", s->offered);
+
+		total += tput;
+		printf("       %3d  %9.1f  %-5s  %10.1f  %8.1f  %7.1f  %7.1f  %llu\n",
+			i, s->phy, load, tput,
+			s->delivered ? s->sojourn_sum / 1000.0 / s->delivered : 0.0,
+			percentile(s, 0.5), percentile(s, 0.99), s->drops);
+	}
+
+	printf("       total throughput %.1f Mbps\n\n", total);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int target = 20000, interval = CODEL_INTERVAL_DEFAULT, tokens = 1024;
+	double sec = 10, rtt = 20000;
+	int opt, aqm = -1, i;
+
+	while ((opt = getopt(argc, argv, "m:t:T:I:q:r:")) != -1) {
+		switch (opt) {
+		case 'm':
+			for (aqm = AQM_NONE; aqm <= AQM_CODEL; aqm++)
+				if (!strcmp(optarg, aqm_name[aqm]))
+					break;
+			if (aqm > AQM_CODEL)
+				goto usage;
+			break;
+		case 't':
+			sec = atof(optarg);
+			break;
+		case 'T':
+			target = atoi(optarg);
+			break;
+		case 'I':
+			interval = atoi(optarg);
+			break;
+		case 'q':
+			tokens = atoi(optarg);
+			break;
+		case 'r':
+			rtt = atof(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	for (i = optind; i < argc && nsta < MAX_STA; i++) {
+		char *load = strchr(argv[i], ',');
+		struct sta *s = &sta[nsta++];
+
+		s->phy = atof(argv[i]);
+		if (!load || s->phy <= 0)
+			goto usage;
+
+		if (!strcmp(load + 1, "tcp"))
+			s->tcp = 1;
+		else if ((s->offered = atof(load + 1)) <= 0)
+			goto usage;
+	}
+
+	if (!nsta || sec <= 0 || !tokens || !target || !interval)
+		goto usage;
+
+	for (i = AQM_NONE; i <= AQM_CODEL; i++)
+		if (aqm < 0 || aqm == i)
+			run(i, sec, target, interval, tokens, rtt);
+
+	return 0;
+
+usage:
+	fprintf(stderr, "Usage: codel_sim [-m none|red|codel] [-t sec] [-T target_us] [-I interval_us]\n"
+		"\t\t[-q hw_tokens] [-r rtt_us] <phy_mbps,tcp|offered_mbps> ...\n");
+	return 1;
+}
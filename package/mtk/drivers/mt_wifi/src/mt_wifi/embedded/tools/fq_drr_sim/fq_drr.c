@@ -0,0 +1,105 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	fq_drr.c
+
+	Abstract:
+	Deficit round robin over the active stations of one AC. The caller
+	links a station with FqDrrActivate() when it queues a packet for it,
+	asks FqDrrSelect() which station to serve, and reports the airtime of
+	what it handed to the MAC through FqDrrCharge(). A station that used up
+	its deficit moves to the tail and gets its quantum back, a station that
+	has nothing left is unlinked when it reaches the head again.
+*/
+
+#include "rt_config.h"
+
+VOID FqDrrInitEntry(P_FQ_DRR_ENTRY_T prEntry, UINT32 u4Quantum)
+{
+	prEntry->Entry.Next = NULL;
+	prEntry->i4Deficit = 0;
+	prEntry->u4Quantum = u4Quantum;
+	prEntry->fgActive = FALSE;
+}
+
+VOID FqDrrActivate(PQUEUE_HEADER prList, P_FQ_DRR_ENTRY_T prEntry)
+{
+	if (prEntry->fgActive)
+		return;
+
+	prEntry->i4Deficit = prEntry->u4Quantum;
+	prEntry->fgActive = TRUE;
+	InsertTailQueue(prList, &prEntry->Entry);
+}
+
+/*
+========================================================================
+Routine Description:
+	Find the station to serve next.
+
+Arguments:
+	prList			- active list of the AC
+	pfnBacklog		- tells whether a station still has packets queued
+	pvCtx			- passed to pfnBacklog
+
+Return Value:
+	The station at the head of the list with deficit left, NULL if no
+	station has packets.
+
+Note:
+	The station stays at the head until FqDrrCharge() finds its deficit
+	used up. Every station is visited at most twice, once to give back
+	its quantum and once to serve it, and stations without packets are
+	unlinked on the way, so the cost is bound by the number of stations
+	with traffic.
+========================================================================
+*/
+P_FQ_DRR_ENTRY_T FqDrrSelect(PQUEUE_HEADER prList, FQ_DRR_BACKLOG_FUNC pfnBacklog, VOID *pvCtx)
+{
+	P_FQ_DRR_ENTRY_T prEntry;
+	PQUEUE_ENTRY pEntry;
+	UINT32 u4Visit = prList->Number * 2;
+
+	while (prList->Head && u4Visit-- > 0) {
+		prEntry = container_of(prList->Head, FQ_DRR_ENTRY_T, Entry);
+
+		if (!pfnBacklog(prEntry, pvCtx)) {
+			pEntry = RemoveHeadQueue(prList);
+			prEntry->i4Deficit = 0;
+			prEntry->fgActive = FALSE;
+			continue;
+		}
+
+		if (prEntry->i4Deficit > 0)
+			return prEntry;
+
+		/* still in debt from a long PPDU, wait for another round */
+		prEntry->i4Deficit += prEntry->u4Quantum;
+
+		if (prList->Number > 1) {
+			pEntry = RemoveHeadQueue(prList);
+			InsertTailQueue(prList, pEntry);
+		}
+	}
+
+	return NULL;
+}
+
+VOID FqDrrCharge(PQUEUE_HEADER prList, P_FQ_DRR_ENTRY_T prEntry, UINT32 u4Airtime)
+{
+	PQUEUE_ENTRY pEntry;
+
+	prEntry->i4Deficit -= u4Airtime;
+
+	if (!prEntry->fgActive || prEntry->i4Deficit > 0)
+		return;
+
+	prEntry->i4Deficit += prEntry->u4Quantum;
+
+	if ((prList->Head == &prEntry->Entry) && (prList->Number > 1)) {
+		pEntry = RemoveHeadQueue(prList);
+		InsertTailQueue(prList, pEntry);
+	}
+}
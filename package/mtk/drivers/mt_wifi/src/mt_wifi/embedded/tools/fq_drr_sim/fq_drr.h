@@ -0,0 +1,41 @@
+/*
+ ***************************************************************************
+ ***************************************************************************
+
+	Module Name:
+	fq_drr.h
+
+	Abstract:
+	Airtime weighted deficit round robin over the stations that have
+	packets queued in one AC. Only stations with traffic are linked into
+	the active list, so that picking the next station and charging it for
+	what it sent do not depend on the number of associated stations.
+	fq_drr_sim compares it with a scan of the station array. It is not
+	built into the driver: FQ_SCH_SUPPORT is only enabled for MT7622,
+	which has no support files in this tree.
+*/
+
+#ifndef __FQ_DRR_H__
+#define __FQ_DRR_H__
+
+#define FQ_DRR_QUANTUM						(5484)	/* usec, one PPDU */
+
+typedef struct _FQ_DRR_ENTRY_T {
+	QUEUE_ENTRY Entry;
+	INT32 i4Deficit;	/* airtime the station may still use in this round */
+	UINT32 u4Quantum;	/* airtime added every round */
+	BOOLEAN fgActive;	/* linked into the active list */
+} FQ_DRR_ENTRY_T, *P_FQ_DRR_ENTRY_T;
+
+/* returns FALSE if the station has nothing queued any more */
+typedef BOOLEAN (*FQ_DRR_BACKLOG_FUNC)(P_FQ_DRR_ENTRY_T prEntry, VOID *pvCtx);
+
+VOID FqDrrInitEntry(P_FQ_DRR_ENTRY_T prEntry, UINT32 u4Quantum);
+
+VOID FqDrrActivate(PQUEUE_HEADER prList, P_FQ_DRR_ENTRY_T prEntry);
+
+P_FQ_DRR_ENTRY_T FqDrrSelect(PQUEUE_HEADER prList, FQ_DRR_BACKLOG_FUNC pfnBacklog, VOID *pvCtx);
+
+VOID FqDrrCharge(PQUEUE_HEADER prList, P_FQ_DRR_ENTRY_T prEntry, UINT32 u4Airtime);
+
+#endif /* __FQ_DRR_H__ */
@@ -0,0 +1,272 @@
+/*
+ * fq_drr_sim - compare the station selection of the FQ_ARRAY_SCH scheduler
+ * of fq_qm.c with a deficit round robin for a growing number of stations.
+ *
+ * The DRR list handling in fq_drr.c is built against the stand-ins in
+ * host/rt_config.h. The array scheduler is modelled after
+ * fq_del_list_v2(): it walks the wcids from the last served one until it
+ * finds a station with packets, and gives it thMax MSDUs when the MAC is
+ * short of tokens (-p) or as many as fit in an A-MPDU otherwise.
+ *
+ * A fraction of the stations is always backlogged, the others get a short
+ * burst now and then, so that the set of active stations keeps changing.
+ * Every station has its own MSDU airtime. Reported are the wcids or list
+ * entries looked at per decision, the time per decision including the
+ * enqueue side and Jain's index of the airtime the backlogged stations got.
+ *
+ * Usage: fq_drr_sim [-n decisions] [-b backlogged_percent] [-p] [-s seed]
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include "fq_drr.c"
+
+#define MAX_STA				1024
+#define MAX_FQ_VHT_AMPDU_NUM	256
+#define MAX_VHT_THMAX		256
+#define MIN_HT_THMAX		4
+#define MAX_FQ_PPDU_TIME	5484	/* usec */
+#define BURST_PKTS			8
+#define INFINITE_PKTS		0x7fffffff
+
+struct sta {
+	FQ_DRR_ENTRY_T drr;
+	UINT32 mpdu_time;	/* usec per MSDU */
+	UINT32 thmax;
+	INT32 queued;
+	int backlogged;
+	double airtime;
+};
+
+struct sim {
+	struct sta sta[MAX_STA + 1];
+	unsigned int nsta;
+	unsigned int srch_pos;
+	QUEUE_HEADER drr;
+	UINT64 visits;
+	UINT64 served;
+};
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) & 0xffffff;
+}
+
+static UINT64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sim_init(struct sim *s, unsigned int nsta, unsigned int backlog_pct)
+{
+	unsigned int i;
+
+	memset(s, 0, sizeof(*s));
+	s->nsta = nsta;
+	InitializeQueueHeader(&s->drr);
+
+	for (i = 1; i <= nsta; i++) {
+		struct sta *sta = &s->sta[i];
+
+		/* 20..1280 usec per MSDU, log uniform, MCS9 2SS down to legacy */
+		sta->mpdu_time = 20 << (rnd() % 7);
+		sta->mpdu_time += rnd() % sta->mpdu_time;
+		sta->thmax = MAX_FQ_PPDU_TIME / sta->mpdu_time;
+		if (sta->thmax < MIN_HT_THMAX)
+			sta->thmax = MIN_HT_THMAX;
+		if (sta->thmax > MAX_VHT_THMAX)
+			sta->thmax = MAX_VHT_THMAX;
+		sta->backlogged = (rnd() % 100) < backlog_pct;
+		FqDrrInitEntry(&sta->drr, MAX_FQ_PPDU_TIME);
+	}
+}
+
+static void sim_start(struct sim *s, int drr)
+{
+	unsigned int i;
+
+	for (i = 1; i <= s->nsta; i++) {
+		struct sta *sta = &s->sta[i];
+
+		if (!sta->backlogged)
+			continue;
+		sta->queued = INFINITE_PKTS;
+		if (drr)
+			FqDrrActivate(&s->drr, &sta->drr);
+	}
+}
+
+static BOOLEAN sim_backlog(P_FQ_DRR_ENTRY_T prEntry, VOID *pvCtx)
+{
+	struct sim *s = pvCtx;
+	struct sta *sta = container_of(prEntry, struct sta, drr);
+
+	s->visits++;
+	return sta->queued > 0;
+}
+
+/* fq_enq_req(), a burst for one of the idle stations every few decisions */
+static void sim_enqueue(struct sim *s, int drr)
+{
+	struct sta *sta;
+
+	if (rnd() % 4)
+		return;
+
+	sta = &s->sta[1 + rnd() % s->nsta];
+	if (sta->queued > 0)
+		return;
+
+	sta->queued = 1 + rnd() % BURST_PKTS;
+	if (drr)
+		FqDrrActivate(&s->drr, &sta->drr);
+}
+
+static INT32 sim_quota(struct sta *sta, INT32 quota, int pressure)
+{
+	if (pressure && quota > (INT32)sta->thmax)
+		quota = sta->thmax;
+	if (quota > MAX_FQ_VHT_AMPDU_NUM)
+		quota = MAX_FQ_VHT_AMPDU_NUM;
+	if (quota > sta->queued)
+		quota = sta->queued;
+	return quota;
+}
+
+static void sim_send(struct sim *s, struct sta *sta, INT32 quota)
+{
+	if (sta->queued != INFINITE_PKTS)
+		sta->queued -= quota;
+	sta->airtime += (double)quota * sta->mpdu_time;
+	s->served++;
+}
+
+/* fq_del_list_v2() */
+static struct sta *array_dequeue(struct sim *s, int pressure)
+{
+	unsigned int n;
+
+	for (n = 0; n < s->nsta; n++) {
+		struct sta *sta;
+
+		s->srch_pos++;
+		if (s->srch_pos > s->nsta)
+			s->srch_pos = 1;
+		s->visits++;
+		sta = &s->sta[s->srch_pos];
+
+		if (sta->queued > 0) {
+			sim_send(s, sta, sim_quota(sta, MAX_FQ_VHT_AMPDU_NUM, pressure));
+			return sta;
+		}
+	}
+
+	return NULL;
+}
+
+/* fq_del_list_drr() and fq_del_report_v2() */
+static struct sta *drr_dequeue(struct sim *s, int pressure)
+{
+	P_FQ_DRR_ENTRY_T prEntry;
+	struct sta *sta;
+	INT32 quota;
+
+	prEntry = FqDrrSelect(&s->drr, sim_backlog, s);
+	if (!prEntry)
+		return NULL;
+
+	sta = container_of(prEntry, struct sta, drr);
+	quota = (prEntry->i4Deficit + sta->mpdu_time - 1) / sta->mpdu_time;
+	quota = sim_quota(sta, quota, pressure);
+	sim_send(s, sta, quota);
+	FqDrrCharge(&s->drr, prEntry, quota * sta->mpdu_time);
+	return sta;
+}
+
+static double jain(struct sim *s)
+{
+	double sum = 0, sum2 = 0;
+	unsigned int i, n = 0;
+
+	for (i = 1; i <= s->nsta; i++) {
+		if (!s->sta[i].backlogged)
+			continue;
+		sum += s->sta[i].airtime;
+		sum2 += s->sta[i].airtime * s->sta[i].airtime;
+		n++;
+	}
+
+	return (n && sum2 > 0) ? (sum * sum) / (n * sum2) : 1.0;
+}
+
+static void run(unsigned int nsta, unsigned int decisions, unsigned int backlog_pct,
+		int pressure, int drr)
+{
+	static struct sim s;
+	unsigned int start_seed = seed, i;
+	UINT64 t;
+
+	sim_init(&s, nsta, backlog_pct);
+	sim_start(&s, drr);
+
+	t = now_ns();
+	for (i = 0; i < decisions; i++) {
+		sim_enqueue(&s, drr);
+		if (drr)
+			drr_dequeue(&s, pressure);
+		else
+			array_dequeue(&s, pressure);
+	}
+	t = now_ns() - t;
+
+	printf("%5u %-6s %10.1f %12.1f %8.3f\n", nsta, drr ? "drr" : "array",
+		(double)s.visits / decisions, (double)t / decisions, jain(&s));
+
+	/* both schedulers see the same stations and arrivals */
+	seed = start_seed;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int decisions = 200000, backlog_pct = 10, nsta;
+	int pressure = 0, c;
+
+	while ((c = getopt(argc, argv, "n:b:ps:")) != -1) {
+		switch (c) {
+		case 'n':
+			decisions = atoi(optarg);
+			break;
+		case 'b':
+			backlog_pct = atoi(optarg);
+			break;
+		case 'p':
+			pressure = 1;
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n decisions] [-b backlogged_percent] [-p] [-s seed]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	printf("%u%% of the stations backlogged, %s\n", backlog_pct,
+		pressure ? "MAC short of tokens (thMax quota)" : "MAC has tokens (A-MPDU quota)");
+	printf("%5s %-6s %10s %12s %8s\n", "sta", "sched", "visits", "ns/decision", "jain");
+
+	for (nsta = 8; nsta <= MAX_STA; nsta <<= 1) {
+		run(nsta, decisions, backlog_pct, pressure, 0);
+		run(nsta, decisions, backlog_pct, pressure, 1);
+	}
+
+	return 0;
+}
@@ -0,0 +1,17 @@
+# Host build of a driver source file against the stand-ins in
+# host/rt_config.h. A tool's Makefile sets TOOL, the header it needs after
+# the basic types (HOST_TOOL_HEADER) and optionally LDLIBS, then includes
+# this file.
+
+CC ?= gcc
+CFLAGS ?= -O2 -g -Wall
+CPPFLAGS += -I. -I../host -I../../include \
+	-DHOST_TOOL_HEADER='"$(HOST_TOOL_HEADER)"'
+
+all: $(TOOL)
+
+$(TOOL): $(TOOL).c $(wildcard *.h) ../host/rt_config.h
+	$(CC) $(CPPFLAGS) $(CFLAGS) $< -o $@ $(LDLIBS)
+
+clean:
+	rm -f *.o $(TOOL)
@@ -0,0 +1,84 @@
+/*
+ * Userspace stand-ins for the driver types and queue macros, shared by the
+ * host tools that build a driver source file unchanged. What a tool needs
+ * beyond them comes from the header its Makefile names in HOST_TOOL_HEADER.
+ */
+#ifndef __HOST_RT_CONFIG_H__
+#define __HOST_RT_CONFIG_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef int INT;
+typedef unsigned int UINT;
+typedef unsigned long ULONG;
+typedef unsigned char UCHAR;
+typedef unsigned char *PUCHAR;
+typedef unsigned short USHORT;
+typedef unsigned char BOOLEAN;
+typedef void VOID;
+typedef void *PVOID;
+
+#define TRUE	1
+#define FALSE	0
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define os_zero_mem(ptr, len)	memset(ptr, 0, len)
+
+/* from embedded/include/rtmp_type.h */
+typedef struct _QUEUE_ENTRY {
+	struct _QUEUE_ENTRY *Next;
+} QUEUE_ENTRY, *PQUEUE_ENTRY;
+
+typedef struct _QUEUE_HEADER {
+	PQUEUE_ENTRY Head;
+	PQUEUE_ENTRY Tail;
+	UINT Number;
+	ULONG state;
+} QUEUE_HEADER, *PQUEUE_HEADER;
+
+/* from embedded/include/qm.h */
+#define InitializeQueueHeader(QueueHeader)              \
+	{                                                       \
+		(QueueHeader)->Head = (QueueHeader)->Tail = NULL;   \
+		(QueueHeader)->Number = 0;                          \
+	}
+
+#define RemoveHeadQueue(QueueHeader)                \
+	(QueueHeader)->Head;                                \
+	{                                                   \
+		PQUEUE_ENTRY pNext;                             \
+		if ((QueueHeader)->Head != NULL) {				\
+			pNext = (QueueHeader)->Head->Next;          \
+			(QueueHeader)->Head->Next = NULL;		\
+			(QueueHeader)->Head = pNext;                \
+			if (pNext == NULL)                          \
+				(QueueHeader)->Tail = NULL;             \
+			(QueueHeader)->Number--;                    \
+		}												\
+	}
+
+#define InsertTailQueue(QueueHeader, QueueEntry)				\
+	{                                                               \
+		((PQUEUE_ENTRY)QueueEntry)->Next = NULL;                    \
+		if ((QueueHeader)->Tail)                                    \
+			(QueueHeader)->Tail->Next = (PQUEUE_ENTRY)(QueueEntry); \
+		else                                                        \
+			(QueueHeader)->Head = (PQUEUE_ENTRY)(QueueEntry);       \
+		(QueueHeader)->Tail = (PQUEUE_ENTRY)(QueueEntry);           \
+		(QueueHeader)->Number++;                                    \
+	}
+
+#include HOST_TOOL_HEADER
+
+#endif /* __HOST_RT_CONFIG_H__ */
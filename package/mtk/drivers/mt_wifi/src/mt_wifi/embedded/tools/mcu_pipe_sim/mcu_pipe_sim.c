@@ -0,0 +1,341 @@
+/*
+ * mcu_pipe_sim - run the sequence number and round trip bookkeeping of
+ * embedded/mcu/andes_pipe.c against a mock firmware endpoint.
+ *
+ * The host builds a command (-b usec), the firmware serves its commands in
+ * order (-f usec each) and the response costs the host another -r usec in
+ * the rx path before the waiter is woken up. With a window of 1 every
+ * command waits for its own response as AndesSendCmdMsg() always did, with
+ * a larger window up to that many commands are in flight, as in a
+ * AndesCmdBatchBegin() batch.
+ *
+ * The fault run drops the response of some commands (-d ppm) and
+ * delays others past the timeout (-l ppm), once with the sequence
+ * number of a timed out command resting and once freed at once like
+ * before. Responses are matched by sequence number like
+ * HandleSeqNonZeroNormalEvents() does; a response that completes a
+ * command other than the one it was sent for is counted as wrong.
+ *
+ * Usage: mcu_pipe_sim [-n commands] [-b usec] [-f usec] [-r usec]
+ *                     [-d ppm] [-l ppm] [-t timeout_ms] [-s seed]
+ */
+
+#include <unistd.h>
+
+#include "../../mcu/andes_pipe.c"
+
+#define MAX_EVT			256
+#define CMD_TYPE		0xed	/* EXT_CID */
+#define CMD_EXT_TYPE	0x32	/* EXT_CMD_ID_WTBL_UPDATE */
+
+enum {
+	EVT_RSP,
+	EVT_TIMEOUT,
+};
+
+struct evt {
+	UINT64 at;		/* usec */
+	int type;
+	UINT32 id;		/* command the event belongs to */
+	UINT8 seq;
+};
+
+struct cmd {
+	UINT32 id;
+	UINT8 seq;
+	UINT64 send;
+	int done;
+};
+
+struct sim {
+	ANDES_SEQ_CTRL_T seq;
+	ANDES_RTT_CTRL_T rtt;
+	struct evt evt[MAX_EVT];
+	unsigned int nevt;
+	struct cmd cmd[ANDES_SEQ_NUM];	/* in flight, by sequence number */
+	UINT64 now;
+	UINT64 fw_free;
+	UINT32 next_id;
+	UINT32 inflight;
+	UINT32 completed;
+	UINT32 timeouts;
+	UINT32 wrong;
+	UINT32 dup;
+};
+
+struct param {
+	UINT32 ncmd;
+	UINT32 build_us;
+	UINT32 fw_us;
+	UINT32 rsp_us;
+	UINT32 drop_ppm;
+	UINT32 late_ppm;
+	UINT32 timeout_ms;
+};
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) & 0xffffff;
+}
+
+static void evt_add(struct sim *s, UINT64 at, int type, UINT32 id, UINT8 seq)
+{
+	struct evt *e;
+
+	if (s->nevt >= MAX_EVT) {
+		fprintf(stderr, "event list full\n");
+		exit(1);
+	}
+
+	e = &s->evt[s->nevt++];
+	e->at = at;
+	e->type = type;
+	e->id = id;
+	e->seq = seq;
+}
+
+/* the earliest response, or the timeout of the oldest command in flight */
+static int evt_next(struct sim *s, const struct param *p, struct evt *out)
+{
+	struct cmd *oldest = NULL;
+	unsigned int i, n = 0;
+
+	for (i = 1; i < ANDES_SEQ_NUM; i++) {
+		if (!s->cmd[i].done && (!oldest || s->cmd[i].send < oldest->send))
+			oldest = &s->cmd[i];
+	}
+
+	for (i = 1; i < s->nevt; i++) {
+		if (s->evt[i].at < s->evt[n].at)
+			n = i;
+	}
+
+	if (oldest && (!s->nevt ||
+		oldest->send + p->timeout_ms * 1000ULL < s->evt[n].at)) {
+		out->at = oldest->send + p->timeout_ms * 1000ULL;
+		out->type = EVT_TIMEOUT;
+		out->id = oldest->id;
+		out->seq = oldest->seq;
+		return 1;
+	}
+
+	if (!s->nevt)
+		return 0;
+
+	*out = s->evt[n];
+	s->evt[n] = s->evt[--s->nevt];
+	return 1;
+}
+
+static void complete(struct sim *s, struct cmd *c, int timeout, int rest)
+{
+	UINT32 ms = s->now / 1000;
+
+	AndesSeqFree(&s->seq, c->seq, ms, timeout && rest);
+	AndesRttRecord(&s->rtt, CMD_TYPE, CMD_EXT_TYPE, s->now - c->send, timeout);
+	c->done = 1;
+	s->inflight--;
+
+	if (timeout)
+		s->timeouts++;
+	else
+		s->completed++;
+}
+
+/* HandleSeqNonZeroNormalEvents() and the timeout of AndesWaitCmdMsgRsp() */
+static void handle(struct sim *s, const struct param *p, struct evt *e, int rest)
+{
+	struct cmd *c = &s->cmd[e->seq];
+
+	if (e->at > s->now)
+		s->now = e->at;
+
+	if (e->type == EVT_TIMEOUT) {
+		if (!c->done && c->id == e->id)
+			complete(s, c, 1, rest);
+		return;
+	}
+
+	s->now += p->rsp_us;
+
+	if (c->done) {
+		AndesSeqUnmatchedRsp(&s->seq, e->seq);
+		return;
+	}
+
+	if (c->id != e->id)
+		s->wrong++;
+
+	complete(s, c, 0, rest);
+}
+
+static int submit(struct sim *s, const struct param *p)
+{
+	UINT64 start;
+	UINT32 r;
+	UINT8 seq;
+	struct cmd *c;
+
+	seq = AndesSeqAlloc(&s->seq, s->now / 1000);
+	if (!seq)
+		return 0;
+
+	c = &s->cmd[seq];
+	if (!c->done)
+		s->dup++;
+
+	s->now += p->build_us;
+	c->id = s->next_id++;
+	c->seq = seq;
+	c->send = s->now;
+	c->done = 0;
+	s->inflight++;
+
+	start = (s->now > s->fw_free) ? s->now : s->fw_free;
+	s->fw_free = start + p->fw_us;
+
+	r = rnd() % 1000000;
+	if (r < p->drop_ppm) {
+		/* lost */
+	} else if (r < p->drop_ppm + p->late_ppm) {
+		/* answered after the host gave up, within two seconds */
+		evt_add(s, c->send + p->timeout_ms * 1000ULL + rnd() % 2000000,
+			EVT_RSP, c->id, seq);
+	} else {
+		evt_add(s, s->fw_free, EVT_RSP, c->id, seq);
+	}
+
+	return 1;
+}
+
+static void run(struct sim *s, const struct param *p, UINT32 window, int rest)
+{
+	struct evt e;
+	UINT32 i;
+
+	memset(s, 0, sizeof(*s));
+	AndesSeqInit(&s->seq);
+	AndesRttInit(&s->rtt);
+	s->next_id = 1;
+
+	for (i = 0; i < ANDES_SEQ_NUM; i++)
+		s->cmd[i].done = 1;
+
+	while (s->next_id <= p->ncmd) {
+		if (s->inflight < window && submit(s, p))
+			continue;
+
+		if (!evt_next(s, p, &e))
+			break;
+
+		handle(s, p, &e, rest);
+	}
+
+	/* let the stragglers come in */
+	while (evt_next(s, p, &e))
+		handle(s, p, &e, rest);
+}
+
+static void print_run(struct sim *s, UINT32 window)
+{
+	P_ANDES_RTT_STAT_T prStat = &s->rtt.arStat[0];
+
+	printf("%6u %10.0f %8u %8u %8u %8u\n", window,
+		s->now ? (double)s->completed * 1000000 / s->now : 0.0,
+		prStat->u4Cnt ? (UINT32)(prStat->u8SumUs / prStat->u4Cnt) : 0,
+		AndesRttPercentile(prStat, 500), AndesRttPercentile(prStat, 990),
+		prStat->u4MaxUs);
+}
+
+static void print_fault(struct sim *s, const char *name)
+{
+	printf("%-8s %9u %9u %9u %9u %9u %9u %5u\n", name, s->completed, s->timeouts,
+		s->seq.u4LateRspCnt, s->wrong, s->seq.u4StaleCnt, s->seq.u4ExhaustCnt, s->dup);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct sim s;
+	struct param p = {
+		.ncmd = 1000000,
+		.build_us = 15,
+		.fw_us = 40,
+		.rsp_us = 25,
+		.drop_ppm = 50,
+		.late_ppm = 100,
+		.timeout_ms = 3000,
+	};
+	unsigned int start_seed;
+	UINT32 drop_ppm, late_ppm, window;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:b:f:r:d:l:t:s:")) != -1) {
+		switch (c) {
+		case 'n':
+			p.ncmd = atoi(optarg);
+			break;
+		case 'b':
+			p.build_us = atoi(optarg);
+			break;
+		case 'f':
+			p.fw_us = atoi(optarg);
+			break;
+		case 'r':
+			p.rsp_us = atoi(optarg);
+			break;
+		case 'd':
+			p.drop_ppm = atoi(optarg);
+			break;
+		case 'l':
+			p.late_ppm = atoi(optarg);
+			break;
+		case 't':
+			p.timeout_ms = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n commands] [-b usec] [-f usec] [-r usec]\n"
+				"\t[-d ppm] [-l ppm] [-t timeout_ms] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	start_seed = seed;
+	drop_ppm = p.drop_ppm;
+	late_ppm = p.late_ppm;
+
+	printf("%u commands, build %u usec, firmware %u usec, response %u usec\n",
+		p.ncmd, p.build_us, p.fw_us, p.rsp_us);
+	printf("%6s %10s %8s %8s %8s %8s\n", "window", "cmd/s", "avg", "p50<", "p99<", "max");
+
+	p.drop_ppm = p.late_ppm = 0;
+	for (window = 1; window <= ANDES_PIPE_WINDOW; window <<= 1) {
+		seed = start_seed;
+		run(&s, &p, window, 1);
+		print_run(&s, window);
+	}
+
+	p.drop_ppm = drop_ppm;
+	p.late_ppm = late_ppm;
+	window = ANDES_PIPE_WINDOW;
+
+	printf("\nwindow %u, %u ppm responses dropped, %u ppm late, timeout %u ms\n",
+		window, p.drop_ppm, p.late_ppm, p.timeout_ms);
+	printf("%-8s %9s %9s %9s %9s %9s %9s %5s\n", "seq", "done", "timeout", "unmatched",
+		"wrong", "rested", "exhaust", "dup");
+
+	seed = start_seed;
+	run(&s, &p, window, 1);
+	print_fault(&s, "rest");
+
+	seed = start_seed;
+	run(&s, &p, window, 0);
+	print_fault(&s, "no rest");
+
+	return 0;
+}
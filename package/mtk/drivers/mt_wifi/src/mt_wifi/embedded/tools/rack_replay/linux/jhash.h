@@ -0,0 +1,63 @@
+/* Bob Jenkins' lookup3 as in the kernel's <linux/jhash.h>, jhash2() only */
+#ifndef __RACK_REPLAY_JHASH_H__
+#define __RACK_REPLAY_JHASH_H__
+
+#define rol32(w, s)	(((w) << (s)) | ((w) >> (32 - (s))))
+
+#define __jhash_mix(a, b, c)			\
+{						\
+	a -= c;  a ^= rol32(c, 4);  c += b;	\
+	b -= a;  b ^= rol32(a, 6);  a += c;	\
+	c -= b;  c ^= rol32(b, 8);  b += a;	\
+	a -= c;  a ^= rol32(c, 16); c += b;	\
+	b -= a;  b ^= rol32(a, 19); a += c;	\
+	c -= b;  c ^= rol32(b, 4);  b += a;	\
+}
+
+#define __jhash_final(a, b, c)			\
+{						\
+	c ^= b; c -= rol32(b, 14);		\
+	a ^= c; a -= rol32(c, 11);		\
+	b ^= a; b -= rol32(a, 25);		\
+	c ^= b; c -= rol32(b, 16);		\
+	a ^= c; a -= rol32(c, 4);		\
+	b ^= a; b -= rol32(a, 14);		\
+	c ^= b; c -= rol32(b, 24);		\
+}
+
+#define JHASH_INITVAL		0xdeadbeef
+
+static inline UINT32 jhash2(const UINT32 *k, UINT32 length, UINT32 initval)
+{
+	UINT32 a, b, c;
+
+	a = b = c = JHASH_INITVAL + (length << 2) + initval;
+
+	while (length > 3) {
+		a += k[0];
+		b += k[1];
+		c += k[2];
+		__jhash_mix(a, b, c);
+		length -= 3;
+		k += 3;
+	}
+
+	switch (length) {
+	case 3:
+		c += k[2];
+		/* fall through */
+	case 2:
+		b += k[1];
+		/* fall through */
+	case 1:
+		a += k[0];
+		__jhash_final(a, b, c);
+		break;
+	case 0:
+		break;
+	}
+
+	return c;
+}
+
+#endif /* __RACK_REPLAY_JHASH_H__ */
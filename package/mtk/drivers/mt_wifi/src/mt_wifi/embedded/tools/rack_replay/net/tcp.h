@@ -0,0 +1,31 @@
+/* TCP definitions used by cmm_tcprack.c, as in the kernel's <net/tcp.h> */
+#ifndef __RACK_REPLAY_TCP_H__
+#define __RACK_REPLAY_TCP_H__
+
+#define TCPHDR_FIN		0x01
+#define TCPHDR_SYN		0x02
+#define TCPHDR_RST		0x04
+#define TCPHDR_PSH		0x08
+#define TCPHDR_ACK		0x10
+
+#define TCPOPT_NOP		1
+#define TCPOPT_EOL		0
+#define TCPOPT_MSS		2
+#define TCPOPT_WINDOW		3
+#define TCPOPT_SACK_PERM	4
+#define TCPOPT_SACK		5
+#define TCPOPT_TIMESTAMP	8
+
+#define TCPOLEN_MSS		4
+#define TCPOLEN_WINDOW		3
+#define TCPOLEN_SACK_BASE	2
+#define TCPOLEN_SACK_PERBLOCK	8
+
+static inline int before(UINT32 seq1, UINT32 seq2)
+{
+	return (INT32)(seq1 - seq2) < 0;
+}
+
+#define after(seq2, seq1)	before(seq1, seq2)
+
+#endif /* __RACK_REPLAY_TCP_H__ */
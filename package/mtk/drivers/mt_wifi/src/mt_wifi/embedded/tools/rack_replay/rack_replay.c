@@ -0,0 +1,205 @@
+/*
+ * rack_replay - feed the TCP flows of a pcap file through the RACK
+ * (Reduce TCP ACK) engine and report the ACK drop ratio and CPU cost.
+ *
+ * The engine in embedded/common/cmm_tcprack.c is built unchanged against
+ * the stand-ins in host/rt_config.h and rack_replay.h. Every captured
+ * frame is handed to ReduceAckUpdateDataCnx() and ReduceTcpAck() like on
+ * the AP forwarding path, so a capture of uploads from a station shows
+ * how many of the returning ACKs would be thinned. The flush works run on
+ * capture time.
+ *
+ * Usage: rack_replay [-v] <file.pcap>
+ *	Ethernet and Linux cooked (tcpdump -i any) captures are supported.
+ */
+
+#include <time.h>
+
+#include "../../common/cmm_tcprack.c"
+
+#define LINKTYPE_ETHERNET	1
+#define LINKTYPE_LINUX_SLL	113
+
+struct rcu_head *rack_rcu_pending;
+ULONG jiffies;
+
+struct pcap_reader {
+	FILE *f;
+	int swap;
+	int nsec;
+	UINT32 linktype;
+};
+
+static UINT32 pcap_u32(struct pcap_reader *r, UINT32 v)
+{
+	return r->swap ? __builtin_bswap32(v) : v;
+}
+
+static int pcap_open(struct pcap_reader *r, const char *file)
+{
+	UINT32 hdr[6];
+
+	r->f = fopen(file, "rb");
+	if (!r->f || fread(hdr, sizeof(hdr), 1, r->f) != 1)
+		return -1;
+
+	switch (hdr[0]) {
+	case 0xa1b2c3d4:
+		r->swap = 0;
+		r->nsec = 0;
+		break;
+	case 0xd4c3b2a1:
+		r->swap = 1;
+		r->nsec = 0;
+		break;
+	case 0xa1b23c4d:
+		r->swap = 0;
+		r->nsec = 1;
+		break;
+	case 0x4d3cb2a1:
+		r->swap = 1;
+		r->nsec = 1;
+		break;
+	default:
+		return -1;
+	}
+
+	r->linktype = pcap_u32(r, hdr[5]);
+
+	if (r->linktype != LINKTYPE_ETHERNET && r->linktype != LINKTYPE_LINUX_SLL)
+		return -1;
+
+	return 0;
+}
+
+/* Read the next frame as Ethernet, returns its length or -1 at the end */
+static int pcap_next(struct pcap_reader *r, UCHAR *buf, UINT32 size, ULONG *msec)
+{
+	UINT32 hdr[4], caplen, skip = 0;
+
+	if (fread(hdr, sizeof(hdr), 1, r->f) != 1)
+		return -1;
+
+	caplen = pcap_u32(r, hdr[2]);
+	*msec = (ULONG)pcap_u32(r, hdr[0]) * 1000 +
+		pcap_u32(r, hdr[1]) / (r->nsec ? 1000000 : 1000);
+
+	/* the 16 byte cooked header ends with the protocol, like Ethernet */
+	if (r->linktype == LINKTYPE_LINUX_SLL)
+		skip = 2;
+
+	if (caplen > size - skip || fread(buf + skip, caplen, 1, r->f) != 1)
+		return -1;
+
+	if (r->linktype == LINKTYPE_LINUX_SLL) {
+		if (caplen < 16)
+			return 0;
+
+		memmove(buf + 12, buf + skip + 14, caplen - 14);
+		memset(buf, 0, 12);
+		caplen -= 2;
+	}
+
+	return caplen;
+}
+
+int main(int argc, char **argv)
+{
+	static UCHAR frame[65536 + 2];
+	static RTMP_ADAPTER ad;
+	struct net_device ndev = { "replay0" };
+	struct _rack_replay_pkt pkt;
+	struct pcap_reader r;
+	struct timespec t0, t1;
+	rack_packet parsed;
+	rack_cnx *cnx;
+	ULONG msec, next_cnx = 0, next_ack = 0;
+	unsigned long long ns = 0, frames = 0, acks = 0, data = 0, dropped = 0;
+	unsigned int v4 = 0, v6 = 0;
+	int len, verbose = 0;
+
+	if (argc > 2 && !strcmp(argv[1], "-v")) {
+		verbose = 1;
+		argv++;
+		argc--;
+	}
+
+	if (argc != 2 || pcap_open(&r, argv[1])) {
+		fprintf(stderr, "Usage: rack_replay [-v] <ethernet or cooked pcap file>\n");
+		return 1;
+	}
+
+	ad.net_dev = &ndev;
+	ad.MacTab.Content[0].RACKEnalbedSta = TRUE;
+	ReduceAckInit(&ad);
+
+	while ((len = pcap_next(&r, frame, sizeof(frame), &msec)) >= 0) {
+		jiffies = msec * HZ / 1000;
+
+		if (!next_cnx) {
+			next_cnx = jiffies + REDUCE_ACK_CNX_POLLING_INTERVAL;
+			next_ack = jiffies + REDUCE_ACK_POLLING_INTERVAL;
+		}
+
+		if (RTMP_TIME_AFTER(jiffies, next_cnx)) {
+			cnx_flush_task(&ad.cnxFlushWork.work);
+			next_cnx = jiffies + REDUCE_ACK_CNX_POLLING_INTERVAL;
+		}
+
+		if (RTMP_TIME_AFTER(jiffies, next_ack)) {
+			ack_flush_task(&ad.ackFlushWork.work);
+			next_ack = jiffies + REDUCE_ACK_POLLING_INTERVAL;
+		}
+
+		pkt.data = frame;
+		pkt.len = len;
+		pkt.released = FALSE;
+		frames++;
+
+		if (parse_tcp_packet(&pkt, &parsed)) {
+			if (parsed.type == TCP_ACK)
+				acks++;
+			else
+				data++;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		ReduceAckUpdateDataCnx(&ad, &pkt);
+		if (ReduceTcpAck(&ad, &pkt))
+			dropped++;
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		ns += (t1.tv_sec - t0.tv_sec) * 1000000000ULL + t1.tv_nsec - t0.tv_nsec;
+	}
+
+	list_for_each_entry_rcu(cnx, &ad.ackCnxList, list) {
+		char sip[INET6_ADDRSTRLEN], dip[INET6_ADDRSTRLEN];
+
+		if (cnx->tuple.family == AF_INET6)
+			v6++;
+		else
+			v4++;
+
+		if (!verbose)
+			continue;
+
+		inet_ntop(cnx->tuple.family, cnx->tuple.sip, sip, sizeof(sip));
+		inet_ntop(cnx->tuple.family, cnx->tuple.dip, dip, sizeof(dip));
+		printf("%s.%u -> %s.%u: acks %u dropped %u data %u state %u ratio %u:1\n",
+			sip, cnx->tuple.sport, dip, cnx->tuple.dport,
+			cnx->stats.total, cnx->stats.dropped, cnx->stats.total_data,
+			cnx->state, cnx->ack_ratio);
+	}
+
+	printf("frames:      %llu (tcp data %llu, tcp ack %llu)\n", frames, data, acks);
+	printf("connections: %u tracked at the end (ipv4 %u, ipv6 %u)\n",
+		ad.ReduceAckConnections, v4, v6);
+	printf("acks:        %llu dropped (%.1f%%)\n", dropped,
+		acks ? 100.0 * dropped / acks : 0.0);
+	printf("cost:        %.0f ns/frame\n", frames ? (double)ns / frames : 0.0);
+
+	ReduceAckExit(&ad);
+	fclose(r.f);
+
+	return 0;
+}
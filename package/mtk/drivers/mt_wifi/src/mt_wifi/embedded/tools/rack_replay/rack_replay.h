@@ -0,0 +1,198 @@
+/*
+ * Kernel interfaces used by embedded/common/cmm_tcprack.c, on top of the
+ * shared host/rt_config.h, so that rack_replay can build it unchanged.
+ * Locks and RCU are single threaded no-ops, freeing is deferred to
+ * rcu_barrier() like in the kernel.
+ */
+#ifndef __RACK_REPLAY_H__
+#define __RACK_REPLAY_H__
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define HZ	1000
+#define LINUX_VERSION_CODE		KERNEL_VERSION(6, 6, 0)
+#define KERNEL_VERSION(a, b, c)	(((a) << 16) + ((b) << 8) + (c))
+
+/* lists */
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+struct hlist_head {
+	struct hlist_node *first;
+};
+
+struct hlist_node {
+	struct hlist_node *next, **pprev;
+};
+
+struct rcu_head {
+	struct rcu_head *next;
+	void (*func)(struct rcu_head *head);
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void list_add_rcu(struct list_head *new, struct list_head *head)
+{
+	new->next = head->next;
+	new->prev = head;
+	head->next->prev = new;
+	head->next = new;
+}
+
+static inline void list_del_rcu(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+}
+
+#define list_for_each_entry_rcu(pos, head, member) \
+	for (pos = container_of((head)->next, __typeof__(*pos), member); \
+	     &pos->member != (head); \
+	     pos = container_of(pos->member.next, __typeof__(*pos), member))
+
+#define INIT_HLIST_HEAD(ptr)	((ptr)->first = NULL)
+
+static inline void hlist_add_head_rcu(struct hlist_node *n, struct hlist_head *h)
+{
+	n->next = h->first;
+	n->pprev = &h->first;
+	if (h->first)
+		h->first->pprev = &n->next;
+	h->first = n;
+}
+
+static inline void hlist_del_rcu(struct hlist_node *n)
+{
+	*n->pprev = n->next;
+	if (n->next)
+		n->next->pprev = n->pprev;
+}
+
+#define hlist_for_each_entry_rcu(pos, head, member) \
+	for (pos = (head)->first ? container_of((head)->first, __typeof__(*pos), member) : NULL; \
+	     pos; \
+	     pos = pos->member.next ? container_of(pos->member.next, __typeof__(*pos), member) : NULL)
+
+/* locking and RCU */
+typedef int spinlock_t;
+typedef int NDIS_SPIN_LOCK;
+
+#define spin_lock_init(l)		(*(l) = 0)
+#define spin_lock_bh(l)			((*(l))++)
+#define spin_unlock_bh(l)		((*(l))--)
+#define RTMP_SEM_LOCK(l)		spin_lock_bh(l)
+#define RTMP_SEM_UNLOCK(l)		spin_unlock_bh(l)
+#define NdisAllocateSpinLock(pAd, l)	spin_lock_init(l)
+#define NdisFreeSpinLock(l)		do {} while (0)
+#define rcu_read_lock()			do {} while (0)
+#define rcu_read_unlock()		do {} while (0)
+
+extern struct rcu_head *rack_rcu_pending;
+
+static inline void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head))
+{
+	head->func = func;
+	head->next = rack_rcu_pending;
+	rack_rcu_pending = head;
+}
+
+static inline void rcu_barrier(void)
+{
+	struct rcu_head *head;
+
+	while ((head = rack_rcu_pending) != NULL) {
+		rack_rcu_pending = head->next;
+		head->func(head);
+	}
+}
+
+/* deferred work is driven by the replay loop */
+struct work_struct {
+	int pending;
+};
+
+struct delayed_work {
+	struct work_struct work;
+	void (*func)(struct work_struct *work);
+};
+
+#define INIT_DELAYED_WORK(w, f)		((w)->func = (f))
+#define schedule_delayed_work(w, t)	((w)->work.pending = 1)
+#define cancel_delayed_work_sync(w)	((w)->work.pending = 0)
+
+/* time is taken from the capture */
+extern ULONG jiffies;
+
+#define RTMP_GetCurrentSystemTick(p)	(*(p) = jiffies)
+#define RTMP_TIME_AFTER(a, b)		((long)((b) - (a)) < 0)
+
+/* packets */
+typedef struct _rack_replay_pkt {
+	UCHAR *data;
+	UINT32 len;
+	BOOLEAN released;
+} *PNDIS_PACKET;
+
+#define GET_OS_PKT_DATAPTR(p)		((p)->data)
+#define GET_OS_PKT_LEN(p)		((p)->len)
+#define RTMP_GET_PACKET_WCID(p)		0
+#define RELEASE_NDIS_PACKET(pAd, p, s)	((p)->released = TRUE)
+#define NDIS_STATUS_SUCCESS		0
+#define NDIS_STATUS_FAILURE		1
+#define OS_NTOHS(x)			ntohs(x)
+#define OS_NTOHL(x)			ntohl(x)
+
+static inline INT os_alloc_mem(VOID *pAd, UCHAR **mem, ULONG size)
+{
+	(VOID)pAd;
+	*mem = malloc(size);
+	return *mem ? NDIS_STATUS_SUCCESS : NDIS_STATUS_FAILURE;
+}
+
+#define os_free_mem(p)			free(p)
+
+#define printk				printf
+#define MTWF_DBG(...)			do {} while (0)
+
+typedef struct _RTMP_ADAPTER RTMP_ADAPTER, *PRTMP_ADAPTER;
+
+#include "cmm_tcprack.h"
+
+typedef struct {
+	BOOLEAN RACKEnalbedSta;
+} MAC_TABLE_ENTRY;
+
+typedef struct _COMMON_CONFIG {
+	UINT32 ReduceAckEnable;
+	UINT32 ReduceAckProbability;
+	UINT32 ReduceAckTimeout;
+	UINT32 ReduceAckCnxTimeout;
+} COMMON_CONFIG;
+
+struct net_device {
+	char name[16];
+};
+
+struct _RTMP_ADAPTER {
+	COMMON_CONFIG CommonCfg;
+	struct {
+		MAC_TABLE_ENTRY Content[1];
+	} MacTab;
+	struct net_device *net_dev;
+	struct hlist_head ackCnxHashTbl[REDUCE_ACK_MAX_HASH_BUCKETS];
+	spinlock_t ackCnxBucketLock[REDUCE_ACK_LOCK_BUCKETS];
+	struct list_head ackCnxList;
+	UINT32 ReduceAckConnections;
+	struct delayed_work ackFlushWork;
+	struct delayed_work cnxFlushWork;
+	NDIS_SPIN_LOCK ReduceAckLock;
+};
+
+#endif /* __RACK_REPLAY_H__ */
@@ -0,0 +1,286 @@
+/*
+ * rps_replay - run the default RPS policy of embedded/common/rps_policy.c
+ * over a recorded receive load trace.
+ *
+ * The driver prints one rps_trace line per band and second while bit 4
+ * (MCLI_DEBUG_RPS_CFG_MODE) of "iwpriv ra0 set mcli=4-16" is set:
+ *
+ *   rps_trace <ms> <band> <interval_ms> <rx_pkts> <evt_pkts> <runs>
+ *             <resched> <busy_us> <cpus_hex>
+ *
+ * The lines are picked out of anything else, so dmesg or a console log
+ * can be fed as is. Every mask change is printed, and per band how often
+ * the mask changed, how many intervals took more packets than the CPUs
+ * the policy gave them can take, and how many CPUs it used on average.
+ * It exits with 1 when the policy steers to a CPU outside the cpumask,
+ * grows or shrinks before its hold time, or gives back more than one
+ * CPU at a time.
+ *
+ * -g writes a synthetic trace instead: a ramp up to -r pps and back, short
+ * bursts over a light load, or an idle link, or all three in a row.
+ *
+ * Usage: rps_replay [-c cpumask] [-p pps_per_cpu] [-b busy_pct] [-l low_pct]
+ *                   [-u up_hold] [-d down_hold] [-v] [file...]
+ *        rps_replay -g ramp|burst|idle|mix [-n intervals] [-r pps] [-s seed]
+ */
+
+#include <unistd.h>
+
+#include "../../common/rps_policy.c"
+
+#define MAX_BAND		4
+#define LINE_LEN		512
+#define TRACE_TAG		"rps_trace"
+#define RX_US_PER_PKT	2		/* rx handler cost in the synthetic trace */
+
+struct band_stat {
+	RPS_POLICY_STATE_T state;
+	int seen;
+	UINT32 intervals;
+	UINT32 changes;
+	UINT32 over;			/* intervals above the capacity of the CPUs in use */
+	UINT64 cpu_sum;
+	UINT32 since;			/* intervals since the last change */
+	UINT32 violations;
+};
+
+static unsigned int seed = 1;
+
+static unsigned int rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) & 0xffffff;
+}
+
+static void gen_line(UINT32 t, UINT32 pps)
+{
+	UINT32 busy = pps * RX_US_PER_PKT;
+	UINT32 runs = pps / 64 + 1;
+
+	if (busy > 1000000)
+		busy = 1000000;
+
+	printf("%s %u 0 1000 %u %u %u %u %u %x\n", TRACE_TAG, t * 1000, pps, pps / 4,
+		runs, (busy > 800000) ? runs / 2 : 0, busy, 1);
+}
+
+static UINT32 noise(UINT32 pps)
+{
+	return pps + (pps ? rnd() % (pps / 10 + 1) : rnd() % 50);
+}
+
+static UINT32 gen(const char *kind, UINT32 t0, UINT32 n, UINT32 peak)
+{
+	UINT32 i, pps;
+
+	for (i = 0; i < n; i++) {
+		if (!strcmp(kind, "ramp")) {
+			pps = (i < n / 2) ? (UINT64)peak * i * 2 / n : (UINT64)peak * (n - i) * 2 / n;
+		} else if (!strcmp(kind, "burst")) {
+			pps = ((i % 30) < 3) ? peak : peak / 20;
+		} else if (!strcmp(kind, "idle")) {
+			pps = 0;
+		} else {
+			fprintf(stderr, "unknown trace %s\n", kind);
+			exit(1);
+		}
+
+		gen_line(t0 + i, noise(pps));
+	}
+
+	return t0 + n;
+}
+
+static int check(struct band_stat *b, const RPS_POLICY_CFG_T *cfg, UINT32 old_num,
+		UINT32 mask, UINT32 band)
+{
+	UINT32 num = b->state.u4Num;
+	int bad = 0;
+
+	if (mask & ~cfg->u4CpuMask) {
+		printf("  band%u: mask 0x%x outside cpumask 0x%x\n", band, mask, cfg->u4CpuMask);
+		bad = 1;
+	}
+
+	if ((num > 1) && (RpsPolicyCpuNum(mask) != num)) {
+		printf("  band%u: mask 0x%x does not hold %u CPUs\n", band, mask, num);
+		bad = 1;
+	}
+
+	if ((num > old_num) && (b->since < cfg->u4UpHold)) {
+		printf("  band%u: grew after %u intervals, hold %u\n", band, b->since, cfg->u4UpHold);
+		bad = 1;
+	}
+
+	if (num < old_num) {
+		if (old_num - num > 1) {
+			printf("  band%u: gave back %u CPUs at once\n", band, old_num - num);
+			bad = 1;
+		}
+
+		if (b->since < cfg->u4DownHold) {
+			printf("  band%u: shrank after %u intervals, hold %u\n", band, b->since,
+				cfg->u4DownHold);
+			bad = 1;
+		}
+	}
+
+	return bad;
+}
+
+static int replay(FILE *f, const RPS_POLICY_CFG_T *cfg, struct band_stat *stat, int verbose)
+{
+	char line[LINE_LEN], *p;
+	RPS_LOAD_T load;
+	UINT32 t, band, mask, old_mask, old_num, pps;
+	int bad = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		p = strstr(line, TRACE_TAG);
+		if (!p)
+			continue;
+
+		memset(&load, 0, sizeof(load));
+		if (sscanf(p + strlen(TRACE_TAG), "%u %u %u %u %u %u %u %u %x", &t, &band,
+			&load.u4IntervalMs, &load.u4RxPkts, &load.u4EvtPkts, &load.u4Runs,
+			&load.u4Resched, &load.u4BusyUs, &load.u4Cpus) != 9 || band >= MAX_BAND)
+			continue;
+
+		if (!stat[band].seen) {
+			RpsPolicyStateInit(&stat[band].state);
+			stat[band].seen = 1;
+		}
+
+		old_mask = stat[band].state.u4Mask;
+		old_num = stat[band].state.u4Num;
+		stat[band].since++;
+		mask = RpsPolicyDecide((P_RPS_POLICY_CFG_T)cfg, &stat[band].state, &load);
+		pps = load.u4IntervalMs ? (UINT64)load.u4RxPkts * 1000 / load.u4IntervalMs : 0;
+
+		if (verbose || (mask != old_mask))
+			printf("%10u band%u pps %8u busy %3u%% cpus %u mask 0x%x%s\n", t, band, pps,
+				load.u4IntervalMs ? load.u4BusyUs / (load.u4IntervalMs * 10) : 0,
+				stat[band].state.u4Num, mask, (mask != old_mask) ? " *" : "");
+
+		if (stat[band].state.u4Num != old_num) {
+			if (check(&stat[band], cfg, old_num, mask, band)) {
+				stat[band].violations++;
+				bad = 1;
+			}
+
+			stat[band].changes++;
+			stat[band].since = 0;
+		}
+
+		stat[band].intervals++;
+		stat[band].cpu_sum += stat[band].state.u4Num;
+		if (pps > stat[band].state.u4Num * cfg->u4PpsPerCpu)
+			stat[band].over++;
+	}
+
+	return bad;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-c cpumask] [-p pps_per_cpu] [-b busy_pct] [-l low_pct]\n"
+		"\t[-u up_hold] [-d down_hold] [-v] [file...]\n"
+		"       %s -g ramp|burst|idle|mix [-n intervals] [-r pps] [-s seed]\n", name, name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct band_stat stat[MAX_BAND];
+	RPS_POLICY_CFG_T cfg;
+	const char *kind = NULL;
+	UINT32 n = 300, peak = 600000, band, t;
+	int c, i, verbose = 0, bad = 0;
+	FILE *f;
+
+	RpsPolicyCfgInit(&cfg, 0xf);
+
+	while ((c = getopt(argc, argv, "c:p:b:l:u:d:vg:n:r:s:")) != -1) {
+		switch (c) {
+		case 'c':
+			cfg.u4CpuMask = strtoul(optarg, NULL, 16);
+			break;
+		case 'p':
+			cfg.u4PpsPerCpu = atoi(optarg);
+			break;
+		case 'b':
+			cfg.u4BusyPct = atoi(optarg);
+			break;
+		case 'l':
+			cfg.u4LowPct = atoi(optarg);
+			break;
+		case 'u':
+			cfg.u4UpHold = atoi(optarg);
+			break;
+		case 'd':
+			cfg.u4DownHold = atoi(optarg);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		case 'g':
+			kind = optarg;
+			break;
+		case 'n':
+			n = atoi(optarg);
+			break;
+		case 'r':
+			peak = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (kind) {
+		if (!strcmp(kind, "mix")) {
+			t = gen("idle", 0, n / 3, peak);
+			t = gen("ramp", t, n / 3, peak);
+			gen("burst", t, n - 2 * (n / 3), peak);
+		} else {
+			gen(kind, 0, n, peak);
+		}
+		return 0;
+	}
+
+	printf("cpumask 0x%x, %u pps per CPU, busy %u%%, low %u%%, hold up %u down %u\n",
+		cfg.u4CpuMask, cfg.u4PpsPerCpu, cfg.u4BusyPct, cfg.u4LowPct,
+		cfg.u4UpHold, cfg.u4DownHold);
+
+	if (optind >= argc) {
+		bad |= replay(stdin, &cfg, stat, verbose);
+	} else {
+		for (i = optind; i < argc; i++) {
+			f = fopen(argv[i], "r");
+			if (!f) {
+				perror(argv[i]);
+				return 1;
+			}
+			bad |= replay(f, &cfg, stat, verbose);
+			fclose(f);
+		}
+	}
+
+	printf("\n%-6s %9s %8s %8s %9s %10s\n", "band", "intervals", "changes", "over",
+		"avg_cpus", "violations");
+
+	for (band = 0; band < MAX_BAND; band++) {
+		if (!stat[band].seen)
+			continue;
+
+		printf("%-6u %9u %8u %8u %9.2f %10u\n", band, stat[band].intervals,
+			stat[band].changes, stat[band].over,
+			stat[band].intervals ? (double)stat[band].cpu_sum / stat[band].intervals : 0.0,
+			stat[band].violations);
+	}
+
+	return bad;
+}
@@ -437,6 +437,14 @@ struct hif_pci_rx_ring {
 	struct dly_ctl_cfg *ul_dly_ctl_tbl;
 	UINT32 ul_dly_ctl_tbl_size;
 	UINT32 event_type;
+#ifdef KERNEL_RPS_ADJUST
+	/* rx load, read by RpsPolicyPeriodic() */
+	UINT32 load_pkt_cnt;
+	UINT32 load_run_cnt;
+	UINT32 load_resched_cnt;
+	UINT32 load_cpus;
+	UINT64 load_busy_ns;
+#endif /* KERNEL_RPS_ADJUST */
 } ____cacheline_aligned;
 
 enum {
@@ -471,6 +471,8 @@ struct cmd_msg {
 
 	ULONG              sending_time_in_jiffies;        /* record the time in jiffies for send-the-command */
 	ULONG              receive_time_in_jiffies;        /* record the time in jiffies for N9-firmware-response */
+	UINT32             send_us;                        /* queued for the firmware, for the round trip statistics */
+	UINT32             rsp_us;                         /* response matched, 0 if none yet */
 
 	DL_LIST             list;
 	RTMP_OS_COMPLETION  ack_done;
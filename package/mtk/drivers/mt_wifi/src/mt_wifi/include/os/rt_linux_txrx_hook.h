@@ -24,6 +24,7 @@ typedef enum {
 	WLAN_HOOK_RESUME,
 	WLAN_HOOK_HB_CHK,
 	WLAN_HOOK_WARP_512_SUPPORT,
+	WLAN_HOOK_RPS_POLICY,
 	WLAN_HOOK_END
 } WLAN_HOOK_PT;
 
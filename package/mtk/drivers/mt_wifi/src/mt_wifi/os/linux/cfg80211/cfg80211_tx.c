@@ -217,7 +217,7 @@ VOID ProbeResponseHandler(
 
 #ifdef RED_SUPPORT
 	if (MAC_ADDR_EQUAL(ProbeReqParam->Addr2, IXIA_PROBE_ADDR))
-		pAd->ixia_mode_ctl.fgProbeRspDetect = TRUE;
+		pAd->dyn_mode_ctl.fgProbeRspDetect = TRUE;
 #endif
 #ifdef OCE_SUPPORT
 	if (IS_OCE_ENABLE(wdev)
@@ -131,11 +131,6 @@ static INT tm_tasklet_qm_schedule_task(RTMP_ADAPTER *pAd, enum task_type type, U
 	switch (type) {
 	case TX_DEQ_TASK:
 		if (pAd->tx_dequeue_scheduable[idx]) {
-#ifdef KERNEL_RPS_ADJUST
-			if (pAd->ixia_mode_ctl.tx_tasklet_sch)
-				tasklet_schedule(&pAd->tx_deque_tasklet[idx]);
-			else
-#endif
 			RTMP_OS_TASKLET_SCHE(&pAd->tx_deque_tasklet[idx]);
 		}
 
@@ -144,11 +139,6 @@ static INT tm_tasklet_qm_schedule_task(RTMP_ADAPTER *pAd, enum task_type type, U
 	case RX_DEQ_TASK:
 #ifdef RX_RPS_SUPPORT
 		if (pAd->rx_dequeue_sw_rps_enable) {
-#ifdef KERNEL_RPS_ADJUST
-			if (pAd->ixia_mode_ctl.rx_tasklet_sch)
-				tasklet_schedule(&pAd->rx_deque_tasklet[smp_processor_id()]);
-			else
-#endif
 			RTMP_OS_TASKLET_SCHE(&pAd->rx_deque_tasklet[smp_processor_id()]);
 		}
 #else
@@ -11,6 +11,19 @@ let disable;
 let cpus;
 let all_cpus;
 let local_flows = 0;
+let adaptive = 0;
+
+// resident mode tuning: a CPU counts as overloaded once its network softirq
+// rate exceeds imbalance * average, and the layout is only recomputed after
+// that (or a softnet time squeeze) was seen for hysteresis samples in a row
+// and at least hold_samples after the previous rebalance. The softirq rates
+// only decide when to rebalance; the new layout is placed from the measured
+// per-device packet rates (dev.scale).
+let imbalance = 1.5;
+let hysteresis = 3;
+let hold_samples = 6;
+let min_rate = 1000;
+let applied = {};
 
 while (length(ARGV) > 0) {
 	let arg = shift(ARGV);
@@ -30,9 +43,27 @@ while (length(ARGV) > 0) {
 	case '-l':
 		local_flows = +shift(ARGV);
 		break;
+	case '-a':
+		adaptive = +shift(ARGV);
+		break;
 	}
 }
 
+if (disable)
+	adaptive = 0;
+
+function write_value(path, val)
+{
+	val = `${val}`;
+	if (applied[path] == val)
+		return;
+	if (debug || do_nothing)
+		warn(`echo ${val} > ${path}\n`);
+	if (!do_nothing)
+		writefile(path, val);
+	applied[path] = val;
+}
+
 function task_name(pid)
 {
 	let stat = open(`/proc/${pid}/status`, "r");
@@ -49,10 +80,13 @@ function set_task_cpu(pid, cpu) {
 	let name = task_name(pid);
 	if (!name)
 		return;
+	if (applied[`task:${pid}`] == `${cpu}`)
+		return;
 	if (debug || do_nothing)
 		warn(`taskset -p -c ${cpu} ${name}\n`);
 	if (!do_nothing)
 		system(`taskset -p -c ${cpu} ${pid}`);
+	applied[`task:${pid}`] = `${cpu}`;
 }
 
 function cpu_mask(cpu)
@@ -71,19 +105,20 @@ function set_netdev_cpu(dev, cpu, rx_queue) {
 	let val = cpu_mask(cpu);
 	if (disable)
 		val = 0;
-	for (let queue in queues) {
-		if (debug || do_nothing)
-			warn(`echo ${val} > ${queue}\n`);
-		if (!do_nothing)
-			writefile(queue, `${val}`);
-	}
+	for (let queue in queues)
+		write_value(queue, val);
 	queues = glob(`/sys/class/net/${dev}/queues/${rx_queue}/rps_flow_cnt`);
-	for (let queue in queues) {
-		if (debug || do_nothing)
-			warn(`echo ${local_flows} > ${queue}\n`);
-		if (!do_nothing)
-			writefile(queue, `${local_flows}`);
-	}
+	for (let queue in queues)
+		write_value(queue, local_flows);
+}
+
+function set_dev_irq_cpu(dev, cpu) {
+	for (let irq in dev.irqs)
+		write_value(`/proc/irq/${irq}/smp_affinity`, cpu_mask(cpu));
+}
+
+function layout_add(dev, what, cpu) {
+	push(dev.layout, `${what}=${cpu == null ? "-" : cpu < 0 ? "all" : cpu}`);
 }
 
 function task_device_match(name, device)
@@ -141,61 +176,122 @@ function get_next_cpu(weight, prev_cpu)
 	return cpu;
 }
 
-let phys_devs = {};
-let netdev_phys = {};
-let netdevs = map(glob("/sys/class/net/*"), (dev) => basename(dev));
+let phys_devs;
+let netdevs;
+let netdev_state_last;
 
-for (let dev in netdevs) {
-	let pdev_path = realpath(`/sys/class/net/${dev}/device`);
-	if (!pdev_path)
-		continue;
-
-	if (length(glob(`/sys/class/net/${dev}/lower_*`)) > 0)
-		continue;
+function dev_irqs(pdev, interrupts)
+{
+	let irqs = map(glob(`${pdev.path}/msi_irqs/*`), (v) => basename(v));
+	if (length(irqs) > 0)
+		return irqs;
+
+	let names = [ basename(pdev.path) ];
+	for (let netdev in pdev.netdev)
+		push(names, netdev);
+	for (let line in interrupts) {
+		let irq_match = match(line, /^\s*(\d+):.*\s(\S+)$/);
+		if (!irq_match)
+			continue;
 
-	let pdev = phys_devs[pdev_path];
-	if (!pdev) {
-		pdev = phys_devs[pdev_path] = {
-			path: pdev_path,
-			driver: basename(readlink(`${pdev_path}/driver`)),
-			netdev: [],
-			phy: [],
-			tasks: [],
-			rx_tasks: [],
-			rx_queues: map(glob(`/sys/class/net/${dev}/queues/rx-*/rps_cpus`),
-			               (v) => basename(dirname(v))),
-		};
+		for (let name in names) {
+			if (irq_match[2] == name || index(irq_match[2], `${name}-`) == 0) {
+				push(irqs, irq_match[1]);
+				break;
+			}
+		}
 	}
 
-	let phyidx = trim(readfile(`/sys/class/net/${dev}/phy80211/index`));
-	if (phyidx != null) {
-		let phy = `phy${phyidx}`;
-		if (index(pdev.phy, phy) < 0)
-			push(pdev.phy, phy);
-	}
+	return irqs;
+}
 
-	push(pdev.netdev, dev);
-	netdev_phys[dev] = pdev;
+// Identify each netdev by name, ifindex and carrier change count, so that
+// a driver reload or a down/up between two samples is seen as a change
+function netdev_state() {
+	return map(glob("/sys/class/net/*"), (path) =>
+		`${basename(path)}:${trim(readfile(`${path}/ifindex`))}:${trim(readfile(`${path}/carrier_changes`))}`);
 }
 
-for (let path in glob("/proc/*/exe")) {
-	readlink(path);
-	if (error() != "No such file or directory")
-		continue;
+function scan_devices() {
+	let prev_devs = phys_devs ?? {};
 
-	let pid = basename(dirname(path));
-	let name = task_name(pid);
+	phys_devs = {};
+	netdevs = map(glob("/sys/class/net/*"), (dev) => basename(dev));
+	netdev_state_last = netdev_state();
+
+	// sysfs and procfs values may have been reset by a driver restart and
+	// task ids are reused, so write everything again
+	applied = {};
+
+	for (let dev in netdevs) {
+		let pdev_path = realpath(`/sys/class/net/${dev}/device`);
+		if (!pdev_path)
+			continue;
+
+		if (length(glob(`/sys/class/net/${dev}/lower_*`)) > 0)
+			continue;
+
+		let pdev = phys_devs[pdev_path];
+		if (!pdev) {
+			pdev = phys_devs[pdev_path] = {
+				path: pdev_path,
+				driver: basename(readlink(`${pdev_path}/driver`)),
+				netdev: [],
+				phy: [],
+				tasks: [],
+				rx_tasks: [],
+				rx_queues: map(glob(`/sys/class/net/${dev}/queues/rx-*/rps_cpus`),
+				               (v) => basename(dirname(v))),
+				irqs: [],
+				scale: 1.0,
+				layout: [],
+			};
+		}
+
+		let phyidx = trim(readfile(`/sys/class/net/${dev}/phy80211/index`));
+		if (phyidx != null) {
+			let phy = `phy${phyidx}`;
+			if (index(pdev.phy, phy) < 0)
+				push(pdev.phy, phy);
+		}
+
+		push(pdev.netdev, dev);
+	}
+
+	// devices that are still there keep their measured packet rate
 	for (let devname in phys_devs) {
-		let dev = phys_devs[devname];
-		if (!task_device_match(name, dev))
+		let prev_dev = prev_devs[devname];
+		if (prev_dev?.rate == null)
+			continue;
+		phys_devs[devname].rate = prev_dev.rate;
+		phys_devs[devname].scale = prev_dev.scale;
+	}
+
+	for (let path in glob("/proc/*/exe")) {
+		readlink(path);
+		if (error() != "No such file or directory")
 			continue;
 
-		push(dev.tasks, pid);
+		let pid = basename(dirname(path));
+		let name = task_name(pid);
+		for (let devname in phys_devs) {
+			let dev = phys_devs[devname];
+			if (!task_device_match(name, dev))
+				continue;
 
-		let napi_match = match(name, /napi\/([^-]*)-(\d+)/);
-		if (napi_match && napi_match[2] > 0)
-			push(dev.rx_tasks, pid);
-		break;
+			push(dev.tasks, pid);
+
+			let napi_match = match(name, /napi\/([^-]*)-(\d+)/);
+			if (napi_match && napi_match[2] > 0)
+				push(dev.rx_tasks, pid);
+			break;
+		}
+	}
+
+	if (adaptive) {
+		let interrupts = split(readfile("/proc/interrupts") ?? "", "\n");
+		for (let devname in phys_devs)
+			phys_devs[devname].irqs = dev_irqs(phys_devs[devname], interrupts);
 	}
 }
 
@@ -211,10 +307,12 @@ function assign_dev_queues_cpu(dev) {
 		if (num >= length(cpus))
 			cpu = i % length(cpus);
 		else if (task)
-			cpu = get_next_cpu(napi_weight);
+			cpu = get_next_cpu(napi_weight * dev.scale);
 		else
 			cpu = -1;
 		set_task_cpu(task, cpu);
+		if (task)
+			layout_add(dev, `napi${i}`, cpu);
 
 		let rxq = dev.rx_queues[i];
 		if (!rxq)
@@ -225,9 +323,10 @@ function assign_dev_queues_cpu(dev) {
 		else if (all_cpus)
 			cpu = -1;
 		else
-			cpu = get_next_cpu(napi_weight, cpu);
+			cpu = get_next_cpu(napi_weight * dev.scale, cpu);
 		for (let netdev in dev.netdev)
 			set_netdev_cpu(netdev, cpu, rxq);
+		layout_add(dev, rxq, cpu);
 	}
 }
 
@@ -236,10 +335,13 @@ function assign_dev_cpu(dev) {
 		length(dev.rx_tasks) > 1)
 		return assign_dev_queues_cpu(dev);
 
-	if (length(dev.tasks) > 0) {
-		let cpu = dev.napi_cpu = get_next_cpu(napi_weight);
+	// Without NAPI threads the poll runs on the CPU taking the interrupt
+	if (length(dev.tasks) > 0 || length(dev.irqs) > 0) {
+		let cpu = dev.napi_cpu = get_next_cpu(napi_weight * dev.scale);
 		for (let task in dev.tasks)
 			set_task_cpu(task, cpu);
+		set_dev_irq_cpu(dev, cpu);
+		layout_add(dev, "napi", cpu);
 	}
 
 	if (length(dev.netdev) > 0) {
@@ -247,33 +349,181 @@ function assign_dev_cpu(dev) {
 		if (all_cpus)
 			cpu = -1;
 		else
-			cpu = get_next_cpu(rx_weight, dev.napi_cpu);
+			cpu = get_next_cpu(rx_weight * dev.scale, dev.napi_cpu);
 		for (let netdev in dev.netdev)
 			set_netdev_cpu(netdev, cpu);
+		layout_add(dev, "rps", cpu);
 	}
 }
 
-// Assign ethernet devices first
-for (let devname in phys_devs) {
-	let dev = phys_devs[devname];
-	if (!length(dev.phy))
-		assign_dev_cpu(dev);
+function assign_all() {
+	for (let cpu in cpus)
+		cpu.load = 0.0;
+
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		dev.napi_cpu = null;
+		dev.layout = [];
+	}
+
+	// Assign ethernet devices first
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (!length(dev.phy))
+			assign_dev_cpu(dev);
+	}
+
+	// Add bias to avoid assigning other tasks to CPUs with ethernet NAPI
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (!length(dev.tasks) || dev.napi_cpu == null)
+			continue;
+		cpu_add_weight(dev.napi_cpu, eth_bias);
+	}
+
+	// Assign WLAN devices
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (length(dev.phy) > 0)
+			assign_dev_cpu(dev);
+	}
+
+	if (debug > 1)
+		warn(sprintf("devices: %.J\ncpus: %.J\n", phys_devs, cpus));
 }
 
-// Add bias to avoid assigning other tasks to CPUs with ethernet NAPI
-for (let devname in phys_devs) {
-	let dev = phys_devs[devname];
-	if (!length(dev.tasks) || dev.napi_cpu == null)
-		continue;
-	cpu_add_weight(dev.napi_cpu, eth_bias);
+function report_layout() {
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (!length(dev.layout))
+			continue;
+		warn(sprintf("layout: %s scale=%.2f %s\n", join(",", dev.netdev),
+			     dev.scale, join(" ", dev.layout)));
+	}
 }
 
-// Assign WLAN devices
-for (let devname in phys_devs) {
-	let dev = phys_devs[devname];
-	if (length(dev.phy) > 0)
-		assign_dev_cpu(dev);
+function read_counter(path) {
+	return int(trim(readfile(path) ?? "0"));
+}
+
+// Absolute counters: network softirqs and softnet time squeezes per CPU,
+// packets per physical device
+function sample() {
+	let ret = { softirq: {}, squeeze: {}, dev: {} };
+
+	let lines = split(readfile("/proc/softirqs") ?? "", "\n");
+	let ids = map(split(trim(lines[0] ?? ""), /\s+/), (v) => int(substr(v, 3)));
+	for (let line in lines) {
+		let fields = split(trim(line), /\s+/);
+		let name = shift(fields);
+		if (name != "NET_RX:" && name != "NET_TX:")
+			continue;
+		for (let i = 0; i < length(fields) && i < length(ids); i++)
+			ret.softirq[ids[i]] = (ret.softirq[ids[i]] ?? 0) + int(fields[i]);
+	}
+
+	lines = filter(split(readfile("/proc/net/softnet_stat") ?? "", "\n"), (v) => length(v) > 0);
+	for (let i = 0; i < length(lines); i++) {
+		let fields = split(trim(lines[i]), /\s+/);
+		let id = length(fields) > 12 ? hex(fields[12]) : i;
+		ret.squeeze[id] = hex(fields[2]);
+	}
+
+	for (let devname in phys_devs) {
+		let count = 0;
+		for (let netdev in phys_devs[devname].netdev)
+			count += read_counter(`/sys/class/net/${netdev}/statistics/rx_packets`) +
+				 read_counter(`/sys/class/net/${netdev}/statistics/tx_packets`);
+		ret.dev[devname] = count;
+	}
+
+	return ret;
+}
+
+// check_balance() refers to these, ucode does not hoist functions
+function min_scale(scale) {
+	return scale < 0.25 ? 0.25 : scale;
+}
+
+function max_scale(scale) {
+	return scale > 4.0 ? 4.0 : scale;
+}
+
+// Compare two samples, update the measured device weights and return
+// whether the current layout is out of balance
+function check_balance(prev, cur) {
+	let total = 0, max = 0, squeezed = false;
+
+	for (let cpu in cpus) {
+		let rate = ((cur.softirq[cpu.id] ?? 0) - (prev.softirq[cpu.id] ?? 0)) / adaptive;
+		total += rate;
+		if (rate > max)
+			max = rate;
+		if ((cur.squeeze[cpu.id] ?? 0) > (prev.squeeze[cpu.id] ?? 0))
+			squeezed = true;
+	}
+
+	let dev_total = 0, ndev = 0;
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		let rate = ((cur.dev[devname] ?? 0) - (prev.dev[devname] ?? 0)) / adaptive;
+		dev.rate = dev.rate != null ? (dev.rate + rate) / 2 : rate;
+		dev_total += dev.rate;
+		ndev++;
+	}
+
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		let scale = dev_total > 0 ? dev.rate * ndev / dev_total : 1.0;
+		dev.scale = max_scale(min_scale(scale));
+	}
+
+	if (debug)
+		warn(sprintf("softirq rate %.0f/s, busiest cpu %.0f/s%s\n", total, max,
+			     squeezed ? ", time squeeze" : ""));
+
+	if (squeezed)
+		return true;
+
+	return total >= min_rate && max > imbalance * total / length(cpus);
 }
 
-if (debug > 1)
-	warn(sprintf("devices: %.J\ncpus: %.J\n", phys_devs, cpus));
+scan_devices();
+assign_all();
+if (do_nothing)
+	report_layout();
+
+if (!adaptive)
+	exit(0);
+
+let prev = sample();
+let triggered = 0, held = 0;
+
+while (true) {
+	sleep(adaptive * 1000);
+
+	if (join(" ", netdev_state()) != join(" ", netdev_state_last)) {
+		scan_devices();
+		assign_all();
+		if (debug || do_nothing)
+			report_layout();
+		prev = sample();
+		triggered = held = 0;
+		continue;
+	}
+
+	let cur = sample();
+	if (check_balance(prev, cur))
+		triggered++;
+	else
+		triggered = 0;
+	prev = cur;
+
+	if (++held < hold_samples || triggered < hysteresis)
+		continue;
+
+	assign_all();
+	if (debug || do_nothing)
+		report_layout();
+	triggered = held = 0;
+}
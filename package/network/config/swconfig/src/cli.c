@@ -42,6 +42,7 @@ enum {
 	CMD_HELP,
 	CMD_SHOW,
 	CMD_PORTMAP,
+	CMD_STATS,
 };
 
 static void
@@ -218,11 +219,37 @@ show_vlan(struct switch_dev *dev, int vlan, bool all)
 	show_attrs(dev, dev->vlan_ops, &val);
 }
 
+static int
+show_port_mibs(struct switch_dev *dev, int port)
+{
+	struct switch_mib_stats stats;
+	int i, j;
+	int ret;
+
+	ret = swlib_get_port_mibs(dev, &stats);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < stats.n_ports; i++) {
+		if (port >= 0 && i != port)
+			continue;
+
+		printf("Port %d: (age %u ms)\n", i, stats.age_ms[i]);
+		for (j = 0; j < stats.n_counters; j++)
+			printf("\t%-12s: %" PRIu64 "\n",
+				stats.names && stats.names[j] ? stats.names[j] : "?",
+				stats.counters[i * stats.n_counters + j]);
+	}
+	swlib_free_port_mibs(&stats);
+
+	return 0;
+}
+
 static void
 print_usage(void)
 {
 	printf("swconfig list\n");
-	printf("swconfig dev <dev> [port <port>|vlan <vlan>] (help|set <key> <value>|get <key>|load <config>|show)\n");
+	printf("swconfig dev <dev> [port <port>|vlan <vlan>] (help|set <key> <value>|get <key>|load <config>|show|stats)\n");
 	exit(1);
 }
 
@@ -311,6 +338,10 @@ int main(int argc, char **argv)
 			cmd = CMD_PORTMAP;
 		} else if (!strcmp(arg, "show")) {
 			cmd = CMD_SHOW;
+		} else if (!strcmp(arg, "stats")) {
+			if (cvlan >= 0)
+				print_usage();
+			cmd = CMD_STATS;
 		} else {
 			print_usage();
 		}
@@ -400,6 +431,11 @@ int main(int argc, char **argv)
 				show_vlan(dev, i, true);
 		}
 		break;
+	case CMD_STATS:
+		retval = show_port_mibs(dev, cport);
+		if (retval < 0)
+			nl_perror(-retval, "Failed to get port statistics");
+		break;
 	}
 
 out:
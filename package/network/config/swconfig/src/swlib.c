@@ -20,6 +20,7 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <getopt.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -86,7 +87,7 @@ wait_handler(struct nl_msg *msg, void *arg)
 
 /* helper function for performing netlink requests */
 static int
-swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
+__swlib_call(int cmd, bool dump, int (*call)(struct nl_msg *, void *),
 		int (*data)(struct nl_msg *, void *), void *arg)
 {
 	struct nl_msg *msg;
@@ -101,7 +102,7 @@ swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
 		exit(1);
 	}
 
-	if (!data)
+	if (dump)
 		flags |= NLM_F_DUMP;
 
 	genlmsg_put(msg, NL_AUTO_PID, NL_AUTO_SEQ, genl_family_get_id(family), 0, flags, cmd, 0);
@@ -128,7 +129,7 @@ swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
 	if (call)
 		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, call, arg);
 
-	if (data)
+	if (!dump)
 		nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, wait_handler, &finished);
 	else
 		nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, wait_handler, &finished);
@@ -149,6 +150,13 @@ nla_put_failure:
 	return err;
 }
 
+static int
+swlib_call(int cmd, int (*call)(struct nl_msg *, void *),
+		int (*data)(struct nl_msg *, void *), void *arg)
+{
+	return __swlib_call(cmd, !data, call, data, arg);
+}
+
 static int
 send_attr(struct nl_msg *msg, void *arg)
 {
@@ -535,6 +543,139 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 }
 
 
+static int
+send_dev_id(struct nl_msg *msg, void *arg)
+{
+	struct switch_dev *dev = arg;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, dev->id);
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+struct mib_arg {
+	struct switch_dev *dev;
+	struct switch_mib_stats *stats;
+	int err;
+};
+
+static int
+store_mib_names(struct switch_mib_stats *stats, struct nlattr *nla)
+{
+	struct nlattr *p;
+	int remaining;
+	int n = 0;
+
+	if (stats->names)
+		return 0;
+
+	stats->names = swlib_alloc(sizeof(char *) * stats->n_counters);
+	if (!stats->names)
+		return -ENOMEM;
+
+	nla_for_each_nested(p, nla, remaining) {
+		if (n >= stats->n_counters)
+			break;
+		stats->names[n++] = strdup(nla_get_string(p));
+	}
+
+	return 0;
+}
+
+static int
+store_port_mib(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct mib_arg *ma = arg;
+	struct switch_mib_stats *stats = ma->stats;
+	struct switch_mib_record rec;
+	struct nlattr *nla;
+	unsigned int n;
+
+	if (nla_parse(tb, SWITCH_ATTR_MAX - 1, genlmsg_attrdata(gnlh, 0),
+			genlmsg_attrlen(gnlh, 0), NULL) < 0)
+		goto done;
+
+	nla = tb[SWITCH_ATTR_OP_VALUE_MIB];
+	if (!nla || nla_len(nla) < sizeof(rec))
+		goto done;
+
+	memcpy(&rec, nla_data(nla), sizeof(rec));
+	if (rec.port >= ma->dev->ports)
+		goto done;
+
+	n = (nla_len(nla) - sizeof(rec)) / sizeof(uint64_t);
+	if (n > rec.n_counters)
+		n = rec.n_counters;
+
+	if (!stats->counters) {
+		stats->n_ports = ma->dev->ports;
+		stats->n_counters = n;
+		stats->counters = swlib_alloc(sizeof(uint64_t) * n * stats->n_ports);
+		stats->age_ms = swlib_alloc(sizeof(unsigned int) * stats->n_ports);
+		if (!stats->counters || !stats->age_ms) {
+			ma->err = -ENOMEM;
+			goto done;
+		}
+	}
+
+	if (n > stats->n_counters)
+		n = stats->n_counters;
+
+	if (tb[SWITCH_ATTR_OP_MIB_NAMES] &&
+	    store_mib_names(stats, tb[SWITCH_ATTR_OP_MIB_NAMES]) < 0) {
+		ma->err = -ENOMEM;
+		goto done;
+	}
+
+	memcpy(&stats->counters[rec.port * stats->n_counters],
+	       (char *) nla_data(nla) + sizeof(rec), n * sizeof(uint64_t));
+	stats->age_ms[rec.port] = rec.age_ms;
+	ma->err = 0;
+
+done:
+	return NL_SKIP;
+}
+
+int
+swlib_get_port_mibs(struct switch_dev *dev, struct switch_mib_stats *stats)
+{
+	struct mib_arg arg;
+	int err;
+
+	memset(stats, 0, sizeof(*stats));
+	arg.dev = dev;
+	arg.stats = stats;
+	arg.err = -EOPNOTSUPP;
+
+	err = __swlib_call(SWITCH_CMD_GET_PORT_MIB, true, store_port_mib,
+			send_dev_id, &arg);
+	if (!err)
+		err = arg.err;
+	if (err)
+		swlib_free_port_mibs(stats);
+
+	return err;
+}
+
+void
+swlib_free_port_mibs(struct switch_mib_stats *stats)
+{
+	int i;
+
+	if (stats->names) {
+		for (i = 0; i < stats->n_counters; i++)
+			free(stats->names[i]);
+		free(stats->names);
+	}
+	free(stats->counters);
+	free(stats->age_ms);
+	memset(stats, 0, sizeof(*stats));
+}
+
 struct attrlist_arg {
 	int id;
 	int atype;
@@ -178,6 +178,16 @@ struct switch_port_link {
 	uint32_t eee;
 };
 
+struct switch_mib_stats {
+	int n_ports;
+	int n_counters;
+	char **names;
+	/* per port, time since the driver refreshed its snapshot */
+	unsigned int *age_ms;
+	/* n_ports * n_counters, indexed by port * n_counters + counter */
+	uint64_t *counters;
+};
+
 /**
  * swlib_list: list all switches
  */
@@ -259,6 +269,21 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *attr,
 int swlib_get_attr(struct switch_dev *dev, struct switch_attr *attr,
 		struct switch_val *val);
 
+/**
+ * swlib_get_port_mibs: get the cached MIB counters of all ports
+ * @dev: switch device struct
+ * @stats: filled with the counters of all ports from a single netlink dump
+ * returns 0 on success
+ * the result must be freed with swlib_free_port_mibs()
+ */
+int swlib_get_port_mibs(struct switch_dev *dev, struct switch_mib_stats *stats);
+
+/**
+ * swlib_free_port_mibs: free the data allocated by swlib_get_port_mibs
+ * @stats: MIB counters struct
+ */
+void swlib_free_port_mibs(struct switch_mib_stats *stats);
+
 /**
  * swlib_apply_from_uci: set up the switch from a uci configuration
  * @dev: switch device struct
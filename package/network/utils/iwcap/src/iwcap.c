@@ -27,6 +27,8 @@
 #include <syslog.h>
 #include <errno.h>
 #include <byteswap.h>
+#include <poll.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
@@ -35,15 +37,28 @@
 #include <net/if.h>
 #include <netinet/in.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 
 #define ARPHRD_IEEE80211_RADIOTAP	803
 
 #define DLT_IEEE802_11_RADIO		127
 #define LEN_IEEE802_11_HDR			32
 
+/* radiotap header size the frame type check can look past in the kernel
+ * snap, drivers with many present words and extensions stay well below */
+#define LEN_RADIOTAP_MAX			256
+
 #define FRAMETYPE_MASK				0xFC
 #define FRAMETYPE_BEACON			0x80
 #define FRAMETYPE_DATA				0x08
+#define FRAMETYPE_TYPE_MASK			0x0C
+
+/* TPACKET_V3 capture ring: 16 blocks of 128 KB, handed over by the kernel
+ * once full or after 50 ms */
+#define RING_BLOCK_SIZE				(128 * 1024)
+#define RING_BLOCK_NR				16
+#define RING_FRAME_SIZE				2048
+#define RING_BLOCK_TMO				50
 
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define le16(x) __bswap_16(x)
@@ -57,10 +72,22 @@ uint8_t run_daemon = 0;
 
 uint32_t frames_captured = 0;
 uint32_t frames_filtered = 0;
+uint32_t frames_dropped  = 0;
 
 int capture_sock = -1;
 const char *ifname = NULL;
 
+uint8_t pktbuf[0xFFFF];
+
+
+struct capture_ring {
+	uint8_t *map;            /* mmap()ed ring, NULL when using recvfrom() */
+	uint32_t block;          /* block to read next */
+	struct tpacket_block_desc *bd; /* block currently being read */
+	struct tpacket3_hdr *fh; /* next frame in current block */
+	uint32_t left;           /* frames left in current block */
+} cring;
+
 
 struct ringbuf {
 	uint32_t len;            /* number of slots */
@@ -219,20 +246,18 @@ struct ringbuf * ringbuf_init(uint32_t num_item, uint16_t len_item)
 	return NULL;
 }
 
-struct ringbuf_entry * ringbuf_add(struct ringbuf *r)
+struct ringbuf_entry * ringbuf_add(struct ringbuf *r,
+								   uint32_t sec, uint32_t usec)
 {
-	struct timeval t;
 	struct ringbuf_entry *e;
 
-	gettimeofday(&t, NULL);
-
 	e = r->buf + (r->fill++ * r->slen);
 	r->fill %= r->len;
 
 	memset(e, 0, r->slen);
 
-	e->sec = t.tv_sec;
-	e->usec = t.tv_usec;
+	e->sec = sec;
+	e->usec = usec;
 
 	return e;
 }
@@ -268,6 +293,178 @@ void msg(const char *fmt, ...)
 }
 
 
+int attach_filter(uint8_t mgmt, uint8_t beacon, uint8_t data, uint32_t snap)
+{
+	struct sock_filter code[12];
+	struct sock_fprog prog = { .filter = code };
+	int i, n = 0, drop[3], ndrop = 0;
+
+	/* X = radiotap header length (little endian), A = frame control */
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 3);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 2);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0);
+
+	if (mgmt)
+	{
+		drop[ndrop++] = n;
+		code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
+												 FRAMETYPE_TYPE_MASK, 0, 0);
+	}
+
+	if (beacon || data)
+		code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_AND | BPF_K,
+												 FRAMETYPE_MASK);
+
+	if (beacon)
+	{
+		drop[ndrop++] = n;
+		code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+												 FRAMETYPE_BEACON, 0, 0);
+	}
+
+	if (data)
+	{
+		drop[ndrop++] = n;
+		code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+												 FRAMETYPE_DATA, 0, 0);
+	}
+
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, snap);
+	code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+	/* all drop branches point at the final "ret #0" */
+	for (i = 0; i < ndrop; i++)
+		code[drop[i]].jt = n - 2 - drop[i];
+
+	prog.len = n;
+
+	return setsockopt(capture_sock, SOL_SOCKET, SO_ATTACH_FILTER,
+					  &prog, sizeof(prog));
+}
+
+int ring_init(void)
+{
+	int version = TPACKET_V3;
+	struct tpacket_req3 req = {
+		.tp_block_size     = RING_BLOCK_SIZE,
+		.tp_block_nr       = RING_BLOCK_NR,
+		.tp_frame_size     = RING_FRAME_SIZE,
+		.tp_frame_nr       = RING_BLOCK_SIZE / RING_FRAME_SIZE * RING_BLOCK_NR,
+		.tp_retire_blk_tov = RING_BLOCK_TMO
+	};
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_VERSION,
+				   &version, sizeof(version)) < 0)
+		return -1;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING,
+				   &req, sizeof(req)) < 0)
+		return -1;
+
+	cring.map = mmap(NULL, RING_BLOCK_SIZE * RING_BLOCK_NR,
+					 PROT_READ | PROT_WRITE, MAP_SHARED, capture_sock, 0);
+
+	if (cring.map == MAP_FAILED)
+	{
+		/* drop the ring again so that recvfrom() receives frames */
+		cring.map = NULL;
+		memset(&req, 0, sizeof(req));
+		setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING,
+				   &req, sizeof(req));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Fetch the next frame, either from the mmap ring or with recvfrom().
+ * Returns the captured length, or 0 if no frame is available right now:
+ * a ring block was handed back to the kernel or a signal arrived.
+ */
+ssize_t capture_next(uint8_t **data, uint32_t *olen,
+					 uint32_t *sec, uint32_t *usec)
+{
+	struct pollfd pfd = { .fd = capture_sock, .events = POLLIN | POLLERR };
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *fh;
+	struct timeval tv;
+	ssize_t len;
+
+	if (!cring.map)
+	{
+		len = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
+
+		if (len < 0)
+			return (errno == EINTR) ? 0 : -1;
+
+		gettimeofday(&tv, NULL);
+
+		*data = pktbuf;
+		*olen = len;
+		*sec  = tv.tv_sec;
+		*usec = tv.tv_usec;
+
+		return len;
+	}
+
+	if (cring.bd && !cring.left)
+	{
+		__atomic_store_n(&cring.bd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+						 __ATOMIC_RELEASE);
+
+		cring.bd = NULL;
+		cring.block = (cring.block + 1) % RING_BLOCK_NR;
+
+		return 0;
+	}
+
+	if (!cring.bd)
+	{
+		bd = (void *)(cring.map + cring.block * RING_BLOCK_SIZE);
+
+		if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+			  TP_STATUS_USER))
+		{
+			poll(&pfd, 1, -1);
+			return 0;
+		}
+
+		cring.bd   = bd;
+		cring.left = bd->hdr.bh1.num_pkts;
+		cring.fh   = (void *)bd + bd->hdr.bh1.offset_to_first_pkt;
+
+		if (!cring.left)
+			return 0;
+	}
+
+	fh = cring.fh;
+	cring.fh = (void *)fh + fh->tp_next_offset;
+	cring.left--;
+
+	*data = (uint8_t *)fh + fh->tp_mac;
+	*olen = fh->tp_len;
+	*sec  = fh->tp_sec;
+	*usec = fh->tp_nsec / 1000;
+
+	return fh->tp_snaplen;
+}
+
+void update_stats(void)
+{
+	struct tpacket_stats_v3 st;
+	socklen_t len = sizeof(st);
+
+	/* the kernel resets its counters on every read */
+	if (!getsockopt(capture_sock, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+		frames_dropped += st.tp_drops;
+}
+
+
 int main(int argc, char **argv)
 {
 	int i, n;
@@ -281,8 +478,9 @@ int main(int argc, char **argv)
 	radiotap_hdr_t *rhdr;
 
 	uint8_t frametype;
-	uint8_t pktbuf[0xFFFF];
+	uint8_t *pkt;
 	ssize_t pktlen;
+	uint32_t olen, sec, usec;
 
 	FILE *o;
 
@@ -293,6 +491,7 @@ int main(int argc, char **argv)
 	uint8_t foreground     = 0;
 	uint8_t filter_data    = 0;
 	uint8_t filter_beacon  = 0;
+	uint8_t filter_mgmt    = 0;
 	uint8_t header_written = 0;
 
 	uint32_t ringsz   = 1024 * 1024; /* 1 Mbyte ring buffer */
@@ -301,7 +500,7 @@ int main(int argc, char **argv)
 	const char *output = NULL;
 
 
-	while ((opt = getopt(argc, argv, "i:r:c:o:sfhBD")) != -1)
+	while ((opt = getopt(argc, argv, "i:r:c:o:sfhBDM")) != -1)
 	{
 		switch (opt)
 		{
@@ -351,6 +550,10 @@ int main(int argc, char **argv)
 			filter_data = 1;
 			break;
 
+		case 'M':
+			filter_mgmt = 1;
+			break;
+
 		case 'f':
 			foreground = 1;
 			break;
@@ -359,7 +562,7 @@ int main(int argc, char **argv)
 			msg(
 				"Usage:\n"
 				"  %s -i {iface} -s [-b] [-d]\n"
-				"  %s -i {iface} -o {file} [-r len] [-c len] [-B] [-D] [-f]\n"
+				"  %s -i {iface} -o {file} [-r len] [-c len] [-B] [-D] [-M] [-f]\n"
 				"\n"
 				"  -i iface\n"
 				"    Specify interface to use, must be in monitor mode and\n"
@@ -379,6 +582,8 @@ int main(int argc, char **argv)
 				"    Don't store beacon frames in ring, default is keep.\n\n"
 				"  -D\n"
 				"    Don't store data frames in ring, default is keep.\n\n"
+				"  -M\n"
+				"    Only store management frames in ring.\n\n"
 				"  -f\n"
 				"    Do not daemonize but keep running in foreground.\n\n"
 				"  -h\n"
@@ -426,6 +631,25 @@ int main(int argc, char **argv)
 		return 6;
 	}
 
+	/* filter and ring need to be in place before frames get queued, the
+	 * kernel snap must keep the frame control for the type check even when
+	 * -c truncates into the radiotap header, the ring copy is cut later */
+	if ((filter_mgmt || filter_beacon || filter_data || !streaming) &&
+		attach_filter(filter_mgmt, filter_beacon, filter_data,
+					  streaming ? 0xFFFF :
+					  (pktcap > LEN_RADIOTAP_MAX + LEN_IEEE802_11_HDR) ? pktcap :
+					  LEN_RADIOTAP_MAX + LEN_IEEE802_11_HDR))
+	{
+		msg("Unable to attach socket filter: %s\n",
+			strerror(errno));
+	}
+
+	if (ring_init())
+	{
+		msg("Unable to set up capture ring, falling back to recvfrom(): %s\n",
+			strerror(errno));
+	}
+
 	if (bind(capture_sock, (struct sockaddr *)&local, sizeof(local)) == -1)
 	{
 		msg("Unable to bind to interface: %s\n",
@@ -482,6 +706,13 @@ int main(int argc, char **argv)
 	msg(" * Beacon frames are %sfiltered\n", filter_beacon ? "" : "not ");
 	msg(" * Data frames are %sfiltered\n", filter_data ? "" : "not ");
 
+	if (filter_mgmt)
+		msg(" * Only management frames are kept\n");
+
+	if (cring.map)
+		msg(" * Using %d bytes mmap capture ring\n",
+			RING_BLOCK_SIZE * RING_BLOCK_NR);
+
 	signal(SIGINT, sig_teardown);
 	signal(SIGTERM, sig_teardown);
 
@@ -501,6 +732,7 @@ int main(int argc, char **argv)
 			}
 			else
 			{
+				setvbuf(o, NULL, _IOFBF, 64 * 1024);
 				write_pcap_header(o);
 
 				/* sig_dump packet buffer */
@@ -515,9 +747,11 @@ int main(int argc, char **argv)
 				}
 
 				fclose(o);
+				update_stats();
 
 				msg(" * %d frames captured\n", frames_captured);
 				msg(" * %d frames filtered\n", frames_filtered);
+				msg(" * %d frames dropped\n", frames_dropped);
 				msg(" * %d frames dumped\n", n);
 			}
 
@@ -527,6 +761,9 @@ int main(int argc, char **argv)
 		{
 			msg("Shutting down ...\n");
 
+			update_stats();
+			msg(" * %d frames dropped\n", frames_dropped);
+
 			if (promisc)
 				set_promisc(0);
 
@@ -536,11 +773,21 @@ int main(int argc, char **argv)
 			return 0;
 		}
 
-		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
+		pktlen = capture_next(&pkt, &olen, &sec, &usec);
+
+		/* flush streamed frames once per ring block */
+		if (pktlen == 0)
+		{
+			if (header_written)
+				fflush(stdout);
+
+			continue;
+		}
+
 		frames_captured++;
 
 		/* check received frametype, if we should filter it, rewind the ring */
-		rhdr = (radiotap_hdr_t *)pktbuf;
+		rhdr = (radiotap_hdr_t *)pkt;
 
 		if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
 		{
@@ -548,10 +795,11 @@ int main(int argc, char **argv)
 			continue;
 		}
 
-		frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
+		frametype = *(uint8_t *)(pkt + le16(rhdr->it_len));
 
 		if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
-		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON) ||
+		    (filter_mgmt   && (frametype & FRAMETYPE_TYPE_MASK) != 0))
 		{
 			frames_filtered++;
 			continue;
@@ -565,17 +813,19 @@ int main(int argc, char **argv)
 				header_written = 1;
 			}
 
-			write_pcap_frame(stdout, NULL, NULL, pktlen, pktlen);
-			fwrite(pktbuf, 1, pktlen, stdout);
-			fflush(stdout);
+			write_pcap_frame(stdout, &sec, &usec, pktlen, olen);
+			fwrite(pkt, 1, pktlen, stdout);
+
+			if (!cring.map)
+				fflush(stdout);
 		}
 		else
 		{
-			e = ringbuf_add(ring);
-			e->olen = pktlen;
+			e = ringbuf_add(ring, sec, usec);
+			e->olen = olen;
 			e->len = (pktlen > pktcap) ? pktcap : pktlen;
 
-			memcpy((void *)e + sizeof(*e), pktbuf, e->len);
+			memcpy((void *)e + sizeof(*e), pkt, e->len);
 		}
 	}
 
@@ -0,0 +1,552 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * nandtar - read a sysupgrade tar from stdin in a single pass
+ *
+ * "nandtar info" checks every header of the archive and reads it up to its
+ * end, and prints the board directory and the length, CRC32 and first four
+ * bytes of its kernel, root and CONTROL members as shell assignments:
+ *
+ *   board_dir='sysupgrade-foo'
+ *   kernel_length=2621440
+ *   kernel_crc=1c291ca3
+ *   ...
+ *
+ * "nandtar write root=/dev/ubi0_1 kernel=-" streams the members to UBI
+ * volumes, files or stdout. A UBI volume is started with UBI_IOCVOLUP for
+ * the length from the tar header, and with -c member=crc the last part of
+ * the member is only written once its CRC32 matches what info saw, so a
+ * volume whose data differs is left with its update marker set.
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <mtd/ubi-user.h>
+
+#define TAR_BLOCK	512
+#define BUF_SIZE	(64 * 1024)
+#define MAX_BOARDS	4
+#define NAME_MAX_LEN	1024
+
+struct tar_header {
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+};
+
+struct member {
+	const char *name;	/* below the board directory */
+	const char *var;	/* prefix of its shell variables */
+	const char *target;
+	uint64_t length;
+	uint32_t crc;
+	uint32_t want_crc;
+	int has_crc;
+	unsigned char magic[4];
+	int found;
+};
+
+static struct member members[] = {
+	{ .name = "kernel", .var = "kernel" },
+	{ .name = "root", .var = "rootfs" },
+	{ .name = "CONTROL", .var = "control" },
+};
+
+#define N_MEMBERS	(sizeof(members) / sizeof(members[0]))
+
+static const char *boards[MAX_BOARDS];
+static int n_boards;
+static char board_dir[256];
+static uint32_t crc_table[4][256];
+static unsigned char buf[BUF_SIZE];
+static uint64_t offset;
+
+static void crc32_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crc_table[0][i] = c;
+	}
+
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 4; j++)
+			crc_table[j][i] = crc_table[0][crc_table[j - 1][i] & 0xff] ^
+					  (crc_table[j - 1][i] >> 8);
+}
+
+/* four bytes per step, the CRC is computed over every byte written to flash */
+static uint32_t crc32_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+	for (; len >= 4; len -= 4, p += 4) {
+		crc ^= p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		crc = crc_table[3][crc & 0xff] ^ crc_table[2][(crc >> 8) & 0xff] ^
+		      crc_table[1][(crc >> 16) & 0xff] ^ crc_table[0][crc >> 24];
+	}
+
+	while (len--)
+		crc = crc_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+static ssize_t read_full(int fd, void *data, size_t len)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = read(fd, (char *)data + done, len - done);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return -1;
+		if (r == 0)
+			break;
+		done += r;
+	}
+
+	offset += done;
+	return done;
+}
+
+static int write_full(int fd, const void *data, size_t len)
+{
+	ssize_t r;
+
+	while (len) {
+		r = write(fd, data, len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		data = (const char *)data + r;
+		len -= r;
+	}
+
+	return 0;
+}
+
+/* octal as tar writes it, or the base-256 GNU tar uses for large sizes */
+static int parse_number(const char *p, int len, uint64_t *val)
+{
+	int i = 0;
+
+	*val = 0;
+	if ((unsigned char)p[0] & 0x80) {
+		*val = (unsigned char)p[0] & 0x7f;
+		for (i = 1; i < len; i++)
+			*val = (*val << 8) | (unsigned char)p[i];
+		return 0;
+	}
+
+	while (i < len && p[i] == ' ')
+		i++;
+	for (; i < len && p[i] >= '0' && p[i] <= '7'; i++)
+		*val = (*val << 3) | (p[i] - '0');
+
+	return (i < len && p[i] && p[i] != ' ') ? -1 : 0;
+}
+
+static int header_valid(const unsigned char *block)
+{
+	const struct tar_header *hdr = (const struct tar_header *)block;
+	int64_t ssum = 0;
+	uint64_t usum = 0, chksum;
+	size_t i;
+
+	if (parse_number(hdr->chksum, sizeof(hdr->chksum), &chksum))
+		return 0;
+
+	for (i = 0; i < TAR_BLOCK; i++) {
+		unsigned char c = block[i];
+
+		if (i >= offsetof(struct tar_header, chksum) &&
+		    i < offsetof(struct tar_header, typeflag))
+			c = ' ';
+		usum += c;
+		ssum += (signed char)c;
+	}
+
+	return chksum == usum || (int64_t)chksum == ssum;
+}
+
+static int block_empty(const unsigned char *block)
+{
+	int i;
+
+	for (i = 0; i < TAR_BLOCK; i++)
+		if (block[i])
+			return 0;
+
+	return 1;
+}
+
+static void set_board_dir(const char *name)
+{
+	const char *slash = strchr(name, '/');
+	size_t len = slash ? (size_t)(slash - name) : strlen(name);
+	int i;
+
+	if (board_dir[0] || strncmp(name, "sysupgrade-", 11) || len >= sizeof(board_dir))
+		return;
+
+	if (n_boards) {
+		for (i = 0; i < n_boards; i++)
+			if (strlen(boards[i]) == len && !strncmp(boards[i], name, len))
+				break;
+		if (i == n_boards)
+			return;
+	}
+
+	memcpy(board_dir, name, len);
+	board_dir[len] = 0;
+}
+
+static struct member *find_member(const char *name)
+{
+	size_t len = strlen(board_dir);
+	unsigned int i;
+
+	if (!len || strncmp(name, board_dir, len) || name[len] != '/')
+		return NULL;
+
+	for (i = 0; i < N_MEMBERS; i++)
+		if (!strcmp(name + len + 1, members[i].name))
+			return &members[i];
+
+	return NULL;
+}
+
+static int open_target(struct member *m)
+{
+	int64_t bytes = m->length;
+	struct stat st;
+	int fd;
+
+	if (!strcmp(m->target, "-"))
+		return STDOUT_FILENO;
+
+	fd = open(m->target, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "nandtar: cannot open %s: %s\n", m->target, strerror(errno));
+		return -1;
+	}
+
+	if (!fstat(fd, &st) && S_ISCHR(st.st_mode) && ioctl(fd, UBI_IOCVOLUP, &bytes)) {
+		fprintf(stderr, "nandtar: cannot start update of %s: %s\n", m->target,
+			strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* read the data of a member, and write it out if it has a target */
+static int process_data(struct member *m, uint64_t size)
+{
+	uint64_t left = size;
+	uint32_t crc = 0xffffffff;
+	size_t len;
+	int fd = -1, ret = 0;
+
+	if (m) {
+		m->length = size;
+		m->found = 1;
+		memset(m->magic, 0, sizeof(m->magic));
+		if (m->target && (fd = open_target(m)) < 0)
+			ret = -1;
+	}
+
+	while (left) {
+		len = left < BUF_SIZE ? left : BUF_SIZE;
+		if (read_full(STDIN_FILENO, buf, len) != (ssize_t)len) {
+			fprintf(stderr, "nandtar: archive truncated\n");
+			ret = -1;
+			break;
+		}
+
+		if (m && left == size)
+			memcpy(m->magic, buf, len < 4 ? len : 4);
+		left -= len;
+
+		if (!m)
+			continue;
+
+		crc = crc32_update(crc, buf, len);
+		if (fd < 0)
+			continue;
+
+		/* hold back the end of the member until its data is known good */
+		if (!left && m->has_crc && (crc ^ 0xffffffff) != m->want_crc) {
+			fprintf(stderr, "nandtar: %s changed since it was checked, crc %08x, expected %08x\n",
+				m->name, crc ^ 0xffffffff, m->want_crc);
+			ret = -1;
+			break;
+		}
+
+		if (write_full(fd, buf, len)) {
+			fprintf(stderr, "nandtar: cannot write %s: %s\n", m->target, strerror(errno));
+			ret = -1;
+			break;
+		}
+	}
+
+	/* drain what is left of a member that failed */
+	while (left) {
+		len = left < BUF_SIZE ? left : BUF_SIZE;
+		if (read_full(STDIN_FILENO, buf, len) != (ssize_t)len)
+			break;
+		left -= len;
+	}
+
+	if (fd >= 0 && fd != STDOUT_FILENO && close(fd) && !ret) {
+		fprintf(stderr, "nandtar: cannot finish %s: %s\n", m->target, strerror(errno));
+		ret = -1;
+	}
+
+	if (m)
+		m->crc = crc ^ 0xffffffff;
+
+	return left ? -2 : ret;
+}
+
+/* returns 0 for a complete archive that was read and written without error */
+static int walk(void)
+{
+	unsigned char block[TAR_BLOCK];
+	struct tar_header *hdr = (struct tar_header *)block;
+	char name[NAME_MAX_LEN];
+	char longname[NAME_MAX_LEN];
+	struct member *m;
+	uint64_t size, pad;
+	int has_longname = 0, ret = 0, r;
+	ssize_t len;
+
+	for (;;) {
+		len = read_full(STDIN_FILENO, block, TAR_BLOCK);
+		if (len != TAR_BLOCK) {
+			fprintf(stderr, "nandtar: archive truncated\n");
+			return -1;
+		}
+
+		if (block_empty(block))
+			break;
+
+		if (!header_valid(block) ||
+		    parse_number(hdr->size, sizeof(hdr->size), &size)) {
+			fprintf(stderr, "nandtar: bad tar header at offset %llu\n",
+				(unsigned long long)(offset - TAR_BLOCK));
+			return -1;
+		}
+
+		if (has_longname) {
+			snprintf(name, sizeof(name), "%s", longname);
+			has_longname = 0;
+		} else if (!memcmp(hdr->magic, "ustar", 5) && hdr->prefix[0]) {
+			snprintf(name, sizeof(name), "%.*s/%.*s",
+				 (int)sizeof(hdr->prefix), hdr->prefix,
+				 (int)sizeof(hdr->name), hdr->name);
+		} else {
+			snprintf(name, sizeof(name), "%.*s", (int)sizeof(hdr->name), hdr->name);
+		}
+
+		m = NULL;
+		switch (hdr->typeflag) {
+		case 'L':
+			/* GNU long name of the next member */
+			if (size >= sizeof(longname)) {
+				fprintf(stderr, "nandtar: name too long\n");
+				return -1;
+			}
+			if (read_full(STDIN_FILENO, longname, size) != (ssize_t)size) {
+				fprintf(stderr, "nandtar: archive truncated\n");
+				return -1;
+			}
+			longname[size] = 0;
+			has_longname = 1;
+			pad = (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+			if (read_full(STDIN_FILENO, buf, pad) != (ssize_t)pad)
+				return -1;
+			continue;
+		case '0':
+		case '\0':
+		case '7':
+			if (!strncmp(name, "./", 2))
+				memmove(name, name + 2, strlen(name + 2) + 1);
+			set_board_dir(name);
+			m = find_member(name);
+			break;
+		case '5':
+			if (!strncmp(name, "./", 2))
+				memmove(name, name + 2, strlen(name + 2) + 1);
+			set_board_dir(name);
+			break;
+		}
+
+		r = process_data(m, size);
+		if (r == -2)
+			return -1;
+		if (r)
+			ret = -1;
+
+		pad = (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+		if (read_full(STDIN_FILENO, buf, pad) != (ssize_t)pad) {
+			fprintf(stderr, "nandtar: archive truncated\n");
+			return -1;
+		}
+	}
+
+	/* let the decompressor finish, tar pads the archive to its record size */
+	while (read_full(STDIN_FILENO, buf, BUF_SIZE) > 0)
+		;
+
+	return ret;
+}
+
+static int print_info(void)
+{
+	const char *p;
+	unsigned int i;
+
+	/* the output is eval'ed by nand.sh */
+	for (p = board_dir; *p; p++) {
+		if (!strchr("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._,+-", *p)) {
+			fprintf(stderr, "nandtar: unexpected character in board dir %s\n", board_dir);
+			return -1;
+		}
+	}
+
+	if (board_dir[0])
+		printf("board_dir='%s'\n", board_dir);
+
+	for (i = 0; i < N_MEMBERS; i++) {
+		struct member *m = &members[i];
+
+		if (!m->found)
+			continue;
+
+		printf("%s_length=%llu\n", m->var, (unsigned long long)m->length);
+		printf("%s_crc=%08x\n", m->var, m->crc);
+		printf("%s_magic=%02x%02x%02x%02x\n", m->var,
+		       m->magic[0], m->magic[1], m->magic[2], m->magic[3]);
+	}
+
+	return 0;
+}
+
+static struct member *member_arg(char *arg, char **val)
+{
+	char *sep = strchr(arg, '=');
+	unsigned int i;
+
+	if (!sep || !sep[1])
+		return NULL;
+
+	*sep = 0;
+	*val = sep + 1;
+	for (i = 0; i < N_MEMBERS; i++)
+		if (!strcmp(arg, members[i].name))
+			return &members[i];
+
+	return NULL;
+}
+
+static int usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-b <board dir>]... info\n"
+		"       %s [-b <board dir>]... [-c <member>=<crc>]... write <member>=<file|->...\n"
+		"Members: kernel, root, CONTROL; the archive is read from stdin\n",
+		prog, prog);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	struct member *m;
+	char *val, *end;
+	unsigned int i;
+	int ch, write_mode, ret;
+
+	while ((ch = getopt(argc, argv, "b:c:")) != -1) {
+		switch (ch) {
+		case 'b':
+			if (n_boards == MAX_BOARDS)
+				return usage(argv[0]);
+			boards[n_boards++] = optarg;
+			break;
+		case 'c':
+			m = member_arg(optarg, &val);
+			if (!m)
+				return usage(argv[0]);
+			m->want_crc = strtoul(val, &end, 16);
+			if (*end)
+				return usage(argv[0]);
+			m->has_crc = 1;
+			break;
+		default:
+			return usage(argv[0]);
+		}
+	}
+
+	if (optind >= argc)
+		return usage(argv[0]);
+
+	if (!strcmp(argv[optind], "info"))
+		write_mode = 0;
+	else if (!strcmp(argv[optind], "write"))
+		write_mode = 1;
+	else
+		return usage(argv[0]);
+
+	for (optind++; optind < argc; optind++) {
+		m = member_arg(argv[optind], &val);
+		if (!write_mode || !m)
+			return usage(argv[0]);
+		m->target = val;
+	}
+
+	crc32_init();
+	ret = walk();
+
+	if (!write_mode) {
+		if (print_info())
+			ret = -1;
+		return ret ? 1 : 0;
+	}
+
+	for (i = 0; i < N_MEMBERS; i++) {
+		if (members[i].target && !members[i].found) {
+			fprintf(stderr, "nandtar: %s not found in %s\n", members[i].name,
+				board_dir[0] ? board_dir : "archive");
+			ret = -1;
+		}
+	}
+
+	return ret ? 1 : 0;
+}
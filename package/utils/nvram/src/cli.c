@@ -25,6 +25,15 @@
 #include "nvram.h"
 
 
+static uint64_t cli_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 static nvram_handle_t * nvram_open_rdonly(void)
 {
 	char *file = nvram_find_staging();
@@ -104,6 +113,39 @@ static int do_set(nvram_handle_t *nvram, const char *pair)
 	return stat;
 }
 
+static int do_batch(nvram_handle_t *nvram, int *commit)
+{
+	char line[4096];
+	int stat = 0;
+	int len;
+
+	/* One "set var=value", "unset var" or "commit" per line */
+	while( fgets(line, sizeof(line), stdin) != NULL )
+	{
+		len = strlen(line);
+
+		while( len > 0 && (line[len-1] == '\n' || line[len-1] == '\r') )
+			line[--len] = 0;
+
+		if( !len || line[0] == '#' )
+			continue;
+
+		if( !strncmp(line, "set ", 4) )
+			stat |= do_set(nvram, line + 4);
+		else if( !strncmp(line, "unset ", 6) )
+			stat |= do_unset(nvram, line + 6);
+		else if( !strcmp(line, "commit") )
+			*commit = 1;
+		else
+		{
+			fprintf(stderr, "Invalid batch command '%s' !\n", line);
+			stat = 1;
+		}
+	}
+
+	return stat;
+}
+
 static int do_info(nvram_handle_t *nvram)
 {
 	nvram_header_t *hdr = nvram_header(nvram);
@@ -137,12 +179,17 @@ static void usage(void)
 {
 	fprintf(stderr,
 		"Usage:\n"
-		"	nvram show\n"
-		"	nvram info\n"
-		"	nvram get variable\n"
-		"	nvram set variable=value [set ...]\n"
-		"	nvram unset variable [unset ...]\n"
-		"	nvram commit\n"
+		"	nvram [-t] show\n"
+		"	nvram [-t] info\n"
+		"	nvram [-t] get variable\n"
+		"	nvram [-t] set variable=value [set ...]\n"
+		"	nvram [-t] unset variable [unset ...]\n"
+		"	nvram [-t] commit\n"
+		"	nvram [-t] batch < commands\n"
+		"\n"
+		"Batch mode reads 'set variable=value', 'unset variable' and\n"
+		"'commit' lines from stdin and writes the changes at once.\n"
+		"Option -t prints the time spent in each step to stderr.\n"
 	);
 }
 
@@ -153,8 +200,16 @@ int main( int argc, const char *argv[] )
 	int write = 0;
 	int stat = 1;
 	int done = 0;
+	int timing = 0;
+	uint64_t t0, t1, t2;
 	int i;
 
+	if( argc > 1 && !strcmp(argv[1], "-t") ) {
+		timing = 1;
+		argv++;
+		argc--;
+	}
+
 	if( argc < 2 ) {
 		usage();
 		return 1;
@@ -163,11 +218,13 @@ int main( int argc, const char *argv[] )
 	/* Ugly... iterate over arguments to see whether we can expect a write */
 	if( ( !strcmp(argv[1], "set")  && 2 < argc ) ||
 		( !strcmp(argv[1], "unset") && 2 < argc ) ||
-		!strcmp(argv[1], "commit") )
+		!strcmp(argv[1], "commit") || !strcmp(argv[1], "batch") )
 		write = 1;
 
 
+	t0 = cli_usec();
 	nvram = write ? nvram_open_staging() : nvram_open_rdonly();
+	t1 = cli_usec();
 
 	if( nvram != NULL && argc > 1 )
 	{
@@ -215,6 +272,11 @@ int main( int argc, const char *argv[] )
 				commit = 1;
 				done++;
 			}
+			else if( !strcmp(argv[i], "batch") )
+			{
+				stat = do_batch(nvram, &commit);
+				done++;
+			}
 			else
 			{
 				fprintf(stderr, "Unknown option '%s' !\n", argv[i]);
@@ -223,13 +285,31 @@ int main( int argc, const char *argv[] )
 			}
 		}
 
-		if( write )
-			stat = nvram_commit(nvram);
+		t2 = cli_usec();
+
+		/* Only rewrite the staging file if something changed */
+		if( write && nvram->dirty )
+			stat = nvram_commit(nvram) || stat;
+
+		if( timing )
+			fprintf(stderr, "nvram: open %lluus (parse %uus, %s), "
+				"commands %lluus, write %lluus\n",
+				(unsigned long long)(t1 - t0), nvram->parse_usec,
+				nvram->index ? "indexed" : "parsed",
+				(unsigned long long)(t2 - t1),
+				(unsigned long long)(cli_usec() - t2));
 
 		nvram_close(nvram);
 
 		if( commit )
-			stat = staging_to_nvram();
+		{
+			t2 = cli_usec();
+			stat = staging_to_nvram() || stat;
+
+			if( timing )
+				fprintf(stderr, "nvram: commit %lluus\n",
+					(unsigned long long)(cli_usec() - t2));
+		}
 	}
 
 	if( !nvram )
@@ -26,17 +26,29 @@ size_t nvram_part_size = 0;
  * -- Helper functions --
  */
 
-/* String hash */
+/* String hash (FNV-1a) */
 static uint32_t hash(const char *s)
 {
-	uint32_t hash = 0;
+	uint32_t hash = 2166136261U;
 
-	while (*s)
-		hash = 31 * hash + *s++;
+	while (*s) {
+		hash ^= (uint8_t) *s++;
+		hash *= 16777619U;
+	}
 
 	return hash;
 }
 
+/* Monotonic time in microseconds */
+static uint64_t _nvram_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /* Free all tuples. */
 static void _nvram_free(nvram_handle_t *h)
 {
@@ -139,6 +151,192 @@ static int _nvram_rehash(nvram_handle_t *h)
 	return 0;
 }
 
+/* Unmap the variable index, tuples have to be parsed from now on. */
+static void _nvram_index_drop(nvram_handle_t *h)
+{
+	if (!h->index)
+		return;
+
+	munmap(h->index, h->index_len);
+	h->index = NULL;
+	h->index_len = 0;
+}
+
+/* Fill in the index header fields identifying the NVRAM contents. */
+static void _nvram_index_key(nvram_handle_t *h, nvram_index_header_t *key)
+{
+	nvram_header_t *header = nvram_header(h);
+	struct stat s;
+
+	memset(key, 0, sizeof(*key));
+
+	if (!fstat(h->fd, &s)) {
+		key->dev        = s.st_dev;
+		key->ino        = s.st_ino;
+		key->mtime_sec  = s.st_mtim.tv_sec;
+		key->mtime_nsec = s.st_mtim.tv_nsec;
+	}
+
+	key->magic             = NVRAM_INDEX_MAGIC;
+	key->version           = NVRAM_INDEX_VERSION;
+	key->nv_len            = header->len;
+	key->nv_crc_ver_init   = header->crc_ver_init;
+	key->nv_config_refresh = header->config_refresh;
+	key->nv_config_ncdl    = header->config_ncdl;
+	key->offset            = h->offset;
+}
+
+/* Map the shared index if it matches the opened NVRAM. */
+static int _nvram_index_load(nvram_handle_t *h)
+{
+	nvram_index_header_t key, *x;
+	nvram_index_entry_t *e;
+	uint32_t *bucket, i;
+	size_t len;
+	struct stat s;
+	char *map;
+	int fd;
+
+	if ((fd = open(NVRAM_INDEX, O_RDONLY)) < 0)
+		return -1;
+
+	/* Only trust an index we wrote ourselves */
+	if (fstat(fd, &s) || s.st_uid != geteuid() || (s.st_mode & 022) ||
+	    (size_t)s.st_size < sizeof(*x)) {
+		close(fd);
+		return -1;
+	}
+
+	len = s.st_size;
+	map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return -1;
+
+	x = (nvram_index_header_t *) map;
+	_nvram_index_key(h, &key);
+
+	/* Compare everything up to the entry count */
+	if (memcmp(x, &key, offsetof(nvram_index_header_t, count)) ||
+	    !x->buckets || (x->buckets & (x->buckets - 1)) ||
+	    x->count > len / sizeof(*e) || x->buckets > len / sizeof(*bucket) ||
+	    sizeof(*x) + x->buckets * sizeof(*bucket) + x->count * sizeof(*e) +
+	    x->strings != len || !x->strings || map[len - 1])
+		goto fail;
+
+	bucket = (uint32_t *) &x[1];
+	e = (nvram_index_entry_t *) &bucket[x->buckets];
+
+	for (i = 0; i < x->buckets; i++)
+		if (bucket[i] > x->count)
+			goto fail;
+
+	/* Chains must point backwards so that lookups always terminate */
+	for (i = 0; i < x->count; i++)
+		if (e[i].next > i || e[i].name >= x->strings ||
+		    e[i].value >= x->strings)
+			goto fail;
+
+	h->index = map;
+	h->index_len = len;
+
+	return 0;
+
+fail:
+	munmap(map, len);
+	return -1;
+}
+
+/* Write the parsed tuples out as shared index. */
+static void _nvram_index_save(nvram_handle_t *h)
+{
+	nvram_index_header_t *x;
+	nvram_index_entry_t *e;
+	nvram_tuple_t *t;
+	uint32_t *bucket, count = 0, buckets = 64, strings = 0, n = 0, i, b;
+	char tmp[] = NVRAM_INDEX ".XXXXXX", *buf, *str;
+	size_t len;
+	int fd;
+
+	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
+		for (t = h->nvram_hash[i]; t; t = t->next) {
+			strings += strlen(t->name) + strlen(t->value) + 2;
+			count++;
+		}
+	}
+
+	while (buckets < count)
+		buckets <<= 1;
+
+	len = sizeof(*x) + buckets * sizeof(*bucket) + count * sizeof(*e) + strings;
+	if (!strings || !(buf = calloc(1, len)))
+		return;
+
+	x = (nvram_index_header_t *) buf;
+	bucket = (uint32_t *) &x[1];
+	e = (nvram_index_entry_t *) &bucket[buckets];
+	str = (char *) &e[count];
+
+	_nvram_index_key(h, x);
+	x->count   = count;
+	x->buckets = buckets;
+	x->strings = strings;
+
+	strings = 0;
+	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
+		for (t = h->nvram_hash[i]; t; t = t->next, n++) {
+			e[n].hash  = hash(t->name);
+			e[n].name  = strings;
+			strings   += sprintf(str + strings, "%s", t->name) + 1;
+			e[n].value = strings;
+			strings   += sprintf(str + strings, "%s", t->value) + 1;
+
+			b = e[n].hash & (buckets - 1);
+			e[n].next = bucket[b];
+			bucket[b] = n + 1;
+		}
+	}
+
+	if ((fd = mkstemp(tmp)) > -1) {
+		if (write(fd, buf, len) == (ssize_t)len && !rename(tmp, NVRAM_INDEX))
+			tmp[0] = 0;
+
+		close(fd);
+
+		if (tmp[0])
+			unlink(tmp);
+	}
+
+	free(buf);
+}
+
+/* Look up a variable in the mapped index. */
+static char * _nvram_index_get(nvram_handle_t *h, const char *name)
+{
+	nvram_index_header_t *x = (nvram_index_header_t *) h->index;
+	uint32_t *bucket = (uint32_t *) &x[1];
+	nvram_index_entry_t *e = (nvram_index_entry_t *) &bucket[x->buckets];
+	char *str = (char *) &e[x->count];
+	uint32_t i, hv = hash(name);
+
+	for (i = bucket[hv & (x->buckets - 1)]; i; i = e[i - 1].next)
+		if (e[i - 1].hash == hv && !strcmp(str + e[i - 1].name, name))
+			return str + e[i - 1].value;
+
+	return NULL;
+}
+
+/* Switch an indexed handle over to parsed tuples before modifying it. */
+static void _nvram_index_unshare(nvram_handle_t *h)
+{
+	if (!h->index)
+		return;
+
+	_nvram_index_drop(h);
+	_nvram_rehash(h);
+}
+
 
 /*
  * -- Public functions --
@@ -160,6 +358,9 @@ char * nvram_get(nvram_handle_t *h, const char *name)
 	if (!name)
 		return NULL;
 
+	if (h->index)
+		return _nvram_index_get(h, name);
+
 	/* Hash the name */
 	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
 
@@ -177,6 +378,8 @@ int nvram_set(nvram_handle_t *h, const char *name, const char *value)
 	uint32_t i;
 	nvram_tuple_t *t, *u, **prev;
 
+	_nvram_index_unshare(h);
+
 	/* Hash the name */
 	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
 
@@ -184,10 +387,16 @@ int nvram_set(nvram_handle_t *h, const char *name, const char *value)
 	for (prev = &h->nvram_hash[i], t = *prev;
 		 t && strcmp(t->name, name); prev = &t->next, t = *prev);
 
+	/* Unchanged value */
+	if (t && !strcmp(t->value, value))
+		return 0;
+
 	/* (Re)allocate tuple */
 	if (!(u = _nvram_realloc(h, t, name, value)))
 		return -12; /* -ENOMEM */
 
+	h->dirty = 1;
+
 	/* Value reallocated */
 	if (t && t == u)
 		return 0;
@@ -215,6 +424,8 @@ int nvram_unset(nvram_handle_t *h, const char *name)
 	if (!name)
 		return 0;
 
+	_nvram_index_unshare(h);
+
 	/* Hash the name */
 	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
 
@@ -227,6 +438,7 @@ int nvram_unset(nvram_handle_t *h, const char *name)
 		*prev = t->next;
 		t->next = h->nvram_dead;
 		h->nvram_dead = t;
+		h->dirty = 1;
 	}
 
 	return 0;
@@ -240,6 +452,25 @@ nvram_tuple_t * nvram_getall(nvram_handle_t *h)
 
 	l = NULL;
 
+	if (h->index) {
+		nvram_index_header_t *ix = (nvram_index_header_t *) h->index;
+		nvram_index_entry_t *e = (nvram_index_entry_t *)
+			((uint32_t *) &ix[1] + ix->buckets);
+		char *str = (char *) &e[ix->count];
+
+		for (i = ix->count - 1; i >= 0; i--) {
+			if (!(x = (nvram_tuple_t *) malloc(sizeof(nvram_tuple_t))))
+				break;
+
+			x->name  = str + e[i].name;
+			x->value = str + e[i].value;
+			x->next  = l;
+			l = x;
+		}
+
+		return l;
+	}
+
 	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
 		for (t = h->nvram_hash[i]; t; t = t->next) {
 			if( (x = (nvram_tuple_t *) malloc(sizeof(nvram_tuple_t))) != NULL )
@@ -270,6 +501,9 @@ int nvram_commit(nvram_handle_t *h)
 	nvram_header_t tmp;
 	uint8_t crc;
 
+	_nvram_index_unshare(h);
+	nvram_index_invalidate();
+
 	/* Regenerate header */
 	header->magic = NVRAM_MAGIC;
 	header->crc_ver_init = (NVRAM_VERSION << 8);
@@ -336,6 +570,7 @@ int nvram_commit(nvram_handle_t *h)
 	fsync(h->fd);
 
 	/* Reinitialize hash table */
+	h->dirty = 0;
 	return _nvram_rehash(h);
 }
 
@@ -402,7 +637,20 @@ nvram_handle_t * nvram_open(const char *file, int rdonly)
 
 				if (header->magic == NVRAM_MAGIC &&
 				    (rdonly || header->len < h->length - h->offset)) {
-					_nvram_rehash(h);
+					uint64_t start = _nvram_usec();
+
+					/*
+					 * Read-only users share a prebuilt index instead
+					 * of parsing all variables on every open.
+					 */
+					if (rdonly != NVRAM_RO || _nvram_index_load(h)) {
+						_nvram_rehash(h);
+						if (rdonly == NVRAM_RO)
+							_nvram_index_save(h);
+					}
+
+					h->parse_usec = _nvram_usec() - start;
+					h->dirty = 0;
 					free(mtd);
 					return h;
 				}
@@ -423,6 +671,7 @@ nvram_handle_t * nvram_open(const char *file, int rdonly)
 /* Close NVRAM and free memory. */
 int nvram_close(nvram_handle_t *h)
 {
+	_nvram_index_drop(h);
 	_nvram_free(h);
 	munmap(h->mmap, h->length);
 	close(h->fd);
@@ -431,6 +680,12 @@ int nvram_close(nvram_handle_t *h)
 	return 0;
 }
 
+/* Remove the shared read-only index. */
+void nvram_index_invalidate(void)
+{
+	unlink(NVRAM_INDEX);
+}
+
 /* Determine NVRAM device node. */
 char * nvram_find_mtd(void)
 {
@@ -538,7 +793,10 @@ int staging_to_nvram(void)
 			close(fdstg);
 
 			if( !stat )
+			{
+				nvram_index_invalidate();
 				stat = unlink(NVRAM_STAGING) ? 1 : 0;
+			}
 		}
 	}
 
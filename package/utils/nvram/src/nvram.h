@@ -15,6 +15,7 @@
 #ifndef _nvram_h_
 #define _nvram_h_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -22,6 +23,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <linux/limits.h>
@@ -50,11 +52,49 @@ struct nvram_handle {
 	unsigned int offset;
 	struct nvram_tuple *nvram_hash[257];
 	struct nvram_tuple *nvram_dead;
+	char *index;			/* mapped variable index, tuples not parsed */
+	unsigned int index_len;
+	int dirty;			/* variables changed since open or commit */
+	unsigned int parse_usec;	/* time spent parsing or loading the index */
+};
+
+/*
+ * Read-only variable index shared between invocations. It is valid for the
+ * source file it was built from (device, inode, mtime) and the NVRAM header
+ * (length, CRC, SDRAM settings); writes through this library remove it.
+ *
+ * Layout: header, bucket heads, entries, NUL terminated strings. Bucket heads
+ * and next links are 1-based entry numbers, 0 ends a chain.
+ */
+struct nvram_index_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t dev;
+	uint64_t ino;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	uint32_t nv_len;
+	uint32_t nv_crc_ver_init;
+	uint32_t nv_config_refresh;
+	uint32_t nv_config_ncdl;
+	uint32_t offset;
+	uint32_t count;
+	uint32_t buckets;
+	uint32_t strings;
+} __attribute__((__packed__));
+
+struct nvram_index_entry {
+	uint32_t hash;
+	uint32_t next;
+	uint32_t name;
+	uint32_t value;
 };
 
 typedef struct nvram_handle nvram_handle_t;
 typedef struct nvram_header nvram_header_t;
 typedef struct nvram_tuple  nvram_tuple_t;
+typedef struct nvram_index_header nvram_index_header_t;
+typedef struct nvram_index_entry  nvram_index_entry_t;
 
 
 /* Get nvram header. */
@@ -81,6 +121,9 @@ nvram_handle_t * nvram_open(const char *file, int rdonly);
 /* Close NVRAM and free memory. */
 int nvram_close(nvram_handle_t *h);
 
+/* Remove the shared read-only index. */
+void nvram_index_invalidate(void);
+
 /* Get the value of an NVRAM variable in a safe way, use "" instead of NULL. */
 #define nvram_safe_get(h, name) (nvram_get(h, name) ? : "")
 
@@ -105,6 +148,12 @@ char * nvram_find_staging(void);
 
 /* Staging file for NVRAM */
 #define NVRAM_STAGING		"/tmp/.nvram"
+
+/* Read-only variable index */
+#define NVRAM_INDEX			"/tmp/.nvram.idx"
+#define NVRAM_INDEX_MAGIC	0x5856494E	/* 'NIVX' */
+#define NVRAM_INDEX_VERSION	1
+
 #define NVRAM_RO			1
 #define NVRAM_RW			0
 
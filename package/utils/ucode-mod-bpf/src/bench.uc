@@ -0,0 +1,76 @@
+#!/usr/bin/env ucode
+// Compare per-element and batched map access on a pinned map:
+//
+//   ucode bench.uc /sys/fs/bpf/<map> [entries]
+//
+// The map needs 4 or 8 byte keys and values, its contents are overwritten.
+'use strict';
+import * as bpf from "bpf";
+
+let path = ARGV[0];
+let n = +(ARGV[1] ?? 10000);
+
+if (!path) {
+	warn("Usage: bench.uc <pinned map> [entries]\n");
+	exit(1);
+}
+
+let m = bpf.open_map(path);
+if (!m) {
+	warn(`Unable to open ${path}: ${bpf.error()}\n`);
+	exit(1);
+}
+
+function now() {
+	let t = clock();
+	return t[0] + t[1] / 1000000000.0;
+}
+
+function run(name, fn) {
+	let start = now();
+	let count = fn();
+	let elapsed = now() - start;
+
+	if (count == null)
+		warn(`${name}: ${bpf.error()}\n`);
+	else
+		printf("%-16s %8d entries %12.0f entries/s\n", name, count,
+		       elapsed > 0 ? count / elapsed : 0);
+}
+
+let entries = [];
+for (let i = 0; i < n; i++)
+	push(entries, [ i, i ]);
+
+let keys = map(entries, (e) => e[0]);
+
+m.delete_all();
+
+run("set", () => {
+	for (let e in entries)
+		m.set(e[0], e[1]);
+	return n;
+});
+run("update_batch", () => m.update_batch(entries));
+
+run("iterator+get", () => {
+	let it = m.iterator(), count = 0, key;
+	while ((key = it.next()) != null)
+		if (m.get(key) != null)
+			count++;
+	return count;
+});
+run("get_batch", () => length(m.get_batch()));
+
+run("delete", () => {
+	let count = 0;
+	for (let key in keys)
+		if (m.delete(key))
+			count++;
+	return count;
+});
+m.update_batch(entries);
+run("delete_batch", () => m.delete_batch(keys));
+
+m.update_batch(entries);
+run("drain", () => length(m.drain()));
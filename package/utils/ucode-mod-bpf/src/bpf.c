@@ -17,6 +17,12 @@
 #define err_return(err, ...) do { set_error(err, __VA_ARGS__); return NULL; } while(0)
 #define TRUE ucv_boolean_new(true)
 
+#ifndef ENOTSUPP
+#define ENOTSUPP 524
+#endif
+
+#define BATCH_DEFAULT_COUNT 256
+
 static uc_resource_type_t *module_type, *map_type, *map_iter_type, *program_type;
 static uc_value_t *registry;
 static uc_vm_t *debug_vm;
@@ -445,23 +451,368 @@ uc_bpf_map_delete(uc_vm_t *vm, size_t nargs)
 	return ucv_string_new_length(val, map->val_size);
 }
 
+/* per-CPU maps return one (8 byte aligned) value per possible CPU */
+static unsigned int
+uc_bpf_map_value_size(struct uc_bpf_map *map)
+{
+	struct bpf_map_info info = {};
+	__u32 len = sizeof(info);
+	int ncpus;
+
+	if (bpf_obj_get_info_by_fd(map->fd.fd, &info, &len))
+		return map->val_size;
+
+	switch (info.type) {
+	case BPF_MAP_TYPE_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_ARRAY:
+	case BPF_MAP_TYPE_LRU_PERCPU_HASH:
+		ncpus = libbpf_num_possible_cpus();
+		if (ncpus > 0)
+			return ((map->val_size + 7) & ~7) * ncpus;
+		break;
+	default:
+		break;
+	}
+
+	return map->val_size;
+}
+
+static bool
+uc_bpf_batch_unsupported(int err)
+{
+	/* batch commands need Linux 5.6 and are not implemented for all map types */
+	return err == EINVAL || err == ENOTSUPP || err == EOPNOTSUPP;
+}
+
+static uc_value_t *
+uc_bpf_map_elem(const void *data, unsigned int size, bool as_int)
+{
+	uint32_t u32;
+	uint64_t u64;
+
+	if (as_int && size == 4) {
+		memcpy(&u32, data, sizeof(u32));
+		return ucv_int64_new(u32);
+	}
+
+	if (as_int && size == 8) {
+		memcpy(&u64, data, sizeof(u64));
+		return ucv_int64_new(u64);
+	}
+
+	return ucv_string_new_length(data, size);
+}
+
+static void
+uc_bpf_map_push_entry(uc_vm_t *vm, uc_value_t *rv,
+		      const void *key, unsigned int key_size, bool int_keys,
+		      const void *val, unsigned int val_size, bool int_values)
+{
+	uc_value_t *entry = ucv_array_new(vm);
+
+	ucv_array_push(entry, uc_bpf_map_elem(key, key_size, int_keys));
+	ucv_array_push(entry, uc_bpf_map_elem(val, val_size, int_values));
+	ucv_array_push(rv, entry);
+}
+
+static void
+uc_bpf_map_lookup_each(uc_vm_t *vm, struct uc_bpf_map *map, uc_value_t *rv,
+		       unsigned int val_size, bool delete,
+		       bool int_keys, bool int_values)
+{
+	void *key, *next, *val;
+	bool has_next;
+
+	key = alloca(map->key_size);
+	next = alloca(map->key_size);
+	val = alloca(val_size);
+	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
+	while (has_next) {
+		memcpy(key, next, map->key_size);
+		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
+
+		if (bpf_map_lookup_elem(map->fd.fd, key, val))
+			continue;
+
+		if (delete)
+			bpf_map_delete_elem(map->fd.fd, key);
+
+		uc_bpf_map_push_entry(vm, rv, key, map->key_size, int_keys,
+				      val, val_size, int_values);
+	}
+}
+
+static uc_value_t *
+uc_bpf_map_lookup_batch(uc_vm_t *vm, size_t nargs, bool delete)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_opts = uc_fn_arg(0);
+	unsigned int count = BATCH_DEFAULT_COUNT;
+	unsigned int val_size, n, i;
+	bool int_keys, int_values;
+	void *keys, *values, *token;
+	bool first = true;
+	uc_value_t *val, *rv;
+	int ret, err;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (a_opts && ucv_type(a_opts) != UC_OBJECT)
+		err_return(EINVAL, "options argument");
+
+	val = ucv_object_get(a_opts, "count", NULL);
+	if (val) {
+		if (ucv_type(val) != UC_INTEGER || ucv_int64_get(val) <= 0 ||
+		    ucv_int64_get(val) > 65536)
+			err_return(EINVAL, "count");
+
+		count = ucv_int64_get(val);
+	}
+
+	int_keys = ucv_is_truish(ucv_object_get(a_opts, "int_keys", NULL));
+	int_values = ucv_is_truish(ucv_object_get(a_opts, "int_values", NULL));
+
+	val_size = uc_bpf_map_value_size(map);
+	token = alloca(map->key_size > 8 ? map->key_size : 8);
+	keys = xalloc(count * map->key_size);
+	values = xalloc(count * val_size);
+	rv = ucv_array_new(vm);
+
+	while (1) {
+		n = count;
+		if (delete)
+			ret = bpf_map_lookup_and_delete_batch(map->fd.fd,
+							      first ? NULL : token, token,
+							      keys, values, &n, &opts);
+		else
+			ret = bpf_map_lookup_batch(map->fd.fd,
+						   first ? NULL : token, token,
+						   keys, values, &n, &opts);
+		err = ret < 0 ? errno : 0;
+
+		/* a single hash bucket did not fit, retry with more room */
+		if (err == ENOSPC && !n && count < 65536) {
+			count *= 2;
+			keys = xrealloc(keys, count * map->key_size);
+			values = xrealloc(values, count * val_size);
+			continue;
+		}
+
+		for (i = 0; i < n; i++)
+			uc_bpf_map_push_entry(vm, rv,
+					      keys + i * map->key_size, map->key_size, int_keys,
+					      values + i * val_size, val_size, int_values);
+
+		if (ret < 0)
+			break;
+
+		first = false;
+	}
+
+	if (err && err != ENOENT) {
+		if (first && !n && uc_bpf_batch_unsupported(err)) {
+			uc_bpf_map_lookup_each(vm, map, rv, val_size, delete,
+					       int_keys, int_values);
+		} else {
+			set_error(err, NULL);
+			ucv_put(rv);
+			rv = NULL;
+		}
+	}
+
+	free(keys);
+	free(values);
+
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_get_batch(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_map_lookup_batch(vm, nargs, false);
+}
+
+static uc_value_t *
+uc_bpf_map_drain(uc_vm_t *vm, size_t nargs)
+{
+	return uc_bpf_map_lookup_batch(vm, nargs, true);
+}
+
+static uc_value_t *
+uc_bpf_map_update_batch(uc_vm_t *vm, size_t nargs)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_entries = uc_fn_arg(0);
+	uc_value_t *a_flags = uc_fn_arg(1);
+	unsigned int val_size, count, done, i;
+	void *keys, *values, *key, *val;
+	uc_value_t *entry, *rv = NULL;
+	int ret;
+
+	if (!map || ucv_type(a_entries) != UC_ARRAY)
+		err_return(EINVAL, NULL);
+
+	if (!a_flags)
+		opts.elem_flags = BPF_ANY;
+	else if (ucv_type(a_flags) != UC_INTEGER)
+		err_return(EINVAL, "flags");
+	else
+		opts.elem_flags = ucv_int64_get(a_flags);
+
+	count = ucv_array_length(a_entries);
+	if (!count)
+		return ucv_int64_new(0);
+
+	val_size = uc_bpf_map_value_size(map);
+	keys = xalloc(count * map->key_size);
+	values = xalloc(count * val_size);
+
+	for (i = 0; i < count; i++) {
+		entry = ucv_array_get(a_entries, i);
+		if (ucv_type(entry) != UC_ARRAY || ucv_array_length(entry) != 2) {
+			set_error(EINVAL, "entry %u", i);
+			goto out;
+		}
+
+		key = uc_bpf_map_arg(ucv_array_get(entry, 0), "key", map->key_size);
+		if (!key)
+			goto out;
+
+		memcpy(keys + i * map->key_size, key, map->key_size);
+
+		val = uc_bpf_map_arg(ucv_array_get(entry, 1), "value", val_size);
+		if (!val)
+			goto out;
+
+		memcpy(values + i * val_size, val, val_size);
+	}
+
+	done = count;
+	ret = bpf_map_update_batch(map->fd.fd, keys, values, &done, &opts);
+	if (ret < 0 && !done && uc_bpf_batch_unsupported(errno)) {
+		for (ret = 0; done < count; done++) {
+			ret = bpf_map_update_elem(map->fd.fd,
+						  keys + done * map->key_size,
+						  values + done * val_size,
+						  opts.elem_flags);
+			if (ret)
+				break;
+		}
+	}
+
+	if (ret < 0)
+		set_error(errno, NULL);
+
+	rv = ucv_int64_new(done);
+
+out:
+	free(keys);
+	free(values);
+
+	return rv;
+}
+
+/* deletes count keys, keys that do not exist are skipped */
+static unsigned int
+uc_bpf_map_delete_keys(struct uc_bpf_map *map, void *keys, unsigned int count)
+{
+	DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts);
+	unsigned int deleted = 0, done = 0, n;
+	bool batch = true;
+	int ret;
+
+	while (done < count) {
+		void *key = keys + done * map->key_size;
+
+		if (!batch) {
+			if (!bpf_map_delete_elem(map->fd.fd, key))
+				deleted++;
+			done++;
+			continue;
+		}
+
+		n = count - done;
+		ret = bpf_map_delete_batch(map->fd.fd, key, &n, &opts);
+		deleted += n;
+		done += n;
+
+		if (!ret)
+			break;
+
+		if (errno == ENOENT) {
+			done++;
+		} else if (!deleted && uc_bpf_batch_unsupported(errno)) {
+			batch = false;
+		} else {
+			set_error(errno, NULL);
+			break;
+		}
+	}
+
+	return deleted;
+}
+
+static uc_value_t *
+uc_bpf_map_delete_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	unsigned int count, i;
+	void *keys, *key;
+	uc_value_t *rv = NULL;
+
+	if (!map || ucv_type(a_keys) != UC_ARRAY)
+		err_return(EINVAL, NULL);
+
+	count = ucv_array_length(a_keys);
+	if (!count)
+		return ucv_int64_new(0);
+
+	keys = xalloc(count * map->key_size);
+	for (i = 0; i < count; i++) {
+		key = uc_bpf_map_arg(ucv_array_get(a_keys, i), "key", map->key_size);
+		if (!key)
+			goto out;
+
+		memcpy(keys + i * map->key_size, key, map->key_size);
+	}
+
+	rv = ucv_int64_new(uc_bpf_map_delete_keys(map, keys, count));
+
+out:
+	free(keys);
+
+	return rv;
+}
+
 static uc_value_t *
 uc_bpf_map_delete_all(uc_vm_t *vm, size_t nargs)
 {
 	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
 	uc_value_t *filter = uc_fn_arg(0);
+	unsigned int count = 0, size = BATCH_DEFAULT_COUNT;
+	void *keys, *key, *next;
 	bool has_next;
-	void *key, *next;
 
 	if (!map)
 		err_return(EINVAL, NULL);
 
-	key = alloca(map->key_size);
+	/* collect the keys first, deleting while walking a hash map restarts the walk */
+	keys = xalloc(size * map->key_size);
 	next = alloca(map->key_size);
 	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
 	while (has_next) {
 		bool skip = false;
 
+		if (count == size) {
+			size *= 2;
+			keys = xrealloc(keys, size * map->key_size);
+		}
+
+		key = keys + count * map->key_size;
 		memcpy(key, next, map->key_size);
 		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
 
@@ -482,9 +833,12 @@ uc_bpf_map_delete_all(uc_vm_t *vm, size_t nargs)
 		}
 
 		if (!skip)
-			bpf_map_delete_elem(map->fd.fd, key);
+			count++;
 	}
 
+	uc_bpf_map_delete_keys(map, keys, count);
+	free(keys);
+
 	return TRUE;
 }
 
@@ -767,6 +1121,10 @@ static const uc_function_list_t map_fns[] = {
 	{ "set",			uc_bpf_map_set },
 	{ "delete",			uc_bpf_map_delete },
 	{ "delete_all",			uc_bpf_map_delete_all },
+	{ "get_batch",			uc_bpf_map_get_batch },
+	{ "update_batch",		uc_bpf_map_update_batch },
+	{ "delete_batch",		uc_bpf_map_delete_batch },
+	{ "drain",			uc_bpf_map_drain },
 	{ "foreach",			uc_bpf_map_foreach },
 	{ "iterator",			uc_bpf_map_iterator },
 };
@@ -129,6 +129,14 @@ struct symbol {
 	 * "Weak" reverse dependencies through being implied by other symbols
 	 */
 	struct expr_value implied;
+
+	/*
+	 * Symbols whose value is calculated from this one, i.e. that have to
+	 * be recalculated when it changes. Built on first use.
+	 */
+	struct symbol **rdeps;
+	int rdep_count, rdep_size;
+	unsigned int rdep_gen;
 };
 
 #define for_all_symbols(i, sym) for (i = 0; i < SYMBOL_HASHSIZE; i++) for (sym = symbol_hash[i]; sym; sym = sym->next)
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <regex.h>
+#include <time.h>
 
 #include "lkc.h"
 
@@ -39,6 +40,36 @@ struct symbol *modules_sym;
 static tristate modules_val;
 int recursive_is_error;
 
+/*
+ * Reference build for scripts/kconfig-incr-check: every value change
+ * clears all symbols, as before the reverse dependency lists existed.
+ */
+#ifndef KCONFIG_FULL_INVALIDATE
+#define KCONFIG_FULL_INVALIDATE 0
+#endif
+
+static bool sym_rdeps_built;
+static unsigned int sym_rdep_gen;
+static int sym_total;
+
+/* choices whose user value sym_calc_choice() dropped, see sym_clear_valid() */
+static struct symbol **sym_stale_choices;
+static int sym_stale_count, sym_stale_size;
+
+/* KCONFIG_CALC_STATS: calculations and time spent since the last change */
+static int sym_calc_stats = -1;
+static int sym_calc_depth;
+static unsigned long sym_calc_count;
+static unsigned long long sym_calc_nsec;
+
+static unsigned long long sym_stats_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 enum symbol_type sym_get_type(struct symbol *sym)
 {
 	enum symbol_type type = sym->type;
@@ -283,6 +314,14 @@ static struct symbol *sym_calc_choice(struct symbol *sym)
 			flags &= def_sym->flags;
 	}
 
+	if (sym->flags & ~flags & SYMBOL_DEF_USER) {
+		if (sym_stale_count == sym_stale_size) {
+			sym_stale_size = sym_stale_size ? sym_stale_size * 2 : 4;
+			sym_stale_choices = xrealloc(sym_stale_choices,
+				sym_stale_size * sizeof(*sym_stale_choices));
+		}
+		sym_stale_choices[sym_stale_count++] = sym;
+	}
 	sym->flags &= flags | ~SYMBOL_DEF_USER;
 
 	/* is the user choice visible? */
@@ -299,11 +338,11 @@ static struct symbol *sym_calc_choice(struct symbol *sym)
 	return def_sym;
 }
 
+static void __sym_calc_value(struct symbol *sym);
+
 void sym_calc_value(struct symbol *sym)
 {
-	struct symbol_value newval, oldval;
-	struct property *prop;
-	struct expr *e;
+	unsigned long long start;
 
 	if (!sym)
 		return;
@@ -311,6 +350,29 @@ void sym_calc_value(struct symbol *sym)
 	if (sym->flags & SYMBOL_VALID)
 		return;
 
+	if (sym_calc_stats < 0)
+		sym_calc_stats = getenv("KCONFIG_CALC_STATS") != NULL;
+	if (!sym_calc_stats || sym_calc_depth) {
+		__sym_calc_value(sym);
+		return;
+	}
+
+	/* only the outermost call is timed, it covers the recursion */
+	start = sym_stats_nsec();
+	sym_calc_depth++;
+	__sym_calc_value(sym);
+	sym_calc_depth--;
+	sym_calc_nsec += sym_stats_nsec() - start;
+}
+
+static void __sym_calc_value(struct symbol *sym)
+{
+	struct symbol_value newval, oldval;
+	struct property *prop;
+	struct expr *e;
+
+	sym_calc_count++;
+
 	if (sym_is_choice_value(sym) &&
 	    sym->flags & SYMBOL_NEED_SET_CHOICE_VALUES) {
 		sym->flags &= ~SYMBOL_NEED_SET_CHOICE_VALUES;
@@ -454,6 +516,144 @@ void sym_clear_all_valid(void)
 	sym_calc_value(modules_sym);
 }
 
+static void sym_add_rdep(struct symbol *sym, struct symbol *dep)
+{
+	if (!sym || sym == dep || sym->flags & SYMBOL_CONST)
+		return;
+	/* properties of one symbol tend to reference the same symbols */
+	if (sym->rdep_count && sym->rdeps[sym->rdep_count - 1] == dep)
+		return;
+	if (sym->rdep_count == sym->rdep_size) {
+		sym->rdep_size = sym->rdep_size ? sym->rdep_size * 2 : 4;
+		sym->rdeps = xrealloc(sym->rdeps,
+				      sym->rdep_size * sizeof(*sym->rdeps));
+	}
+	sym->rdeps[sym->rdep_count++] = dep;
+}
+
+static void expr_add_rdeps(struct expr *e, struct symbol *dep)
+{
+	if (!e)
+		return;
+	switch (e->type) {
+	case E_OR:
+	case E_AND:
+		expr_add_rdeps(e->left.expr, dep);
+		expr_add_rdeps(e->right.expr, dep);
+		break;
+	case E_NOT:
+		expr_add_rdeps(e->left.expr, dep);
+		break;
+	case E_LIST:
+		expr_add_rdeps(e->left.expr, dep);
+		sym_add_rdep(e->right.sym, dep);
+		break;
+	case E_EQUAL:
+	case E_UNEQUAL:
+	case E_LTH:
+	case E_LEQ:
+	case E_GTH:
+	case E_GEQ:
+	case E_RANGE:
+		sym_add_rdep(e->left.sym, dep);
+		sym_add_rdep(e->right.sym, dep);
+		break;
+	case E_SYMBOL:
+		sym_add_rdep(e->left.sym, dep);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Record for every symbol which other symbols read it while being
+ * calculated: everything referenced by the dependencies, the prompt and
+ * default conditions, the ranges and (through P_CHOICE in both directions)
+ * the members of the same choice block. select and imply are already
+ * folded into the rev_dep/implied expressions of their targets.
+ */
+static void sym_build_rdeps(void)
+{
+	struct symbol *sym;
+	struct property *prop;
+	int i;
+
+	for_all_symbols(i, sym) {
+		sym_total++;
+		expr_add_rdeps(sym->dir_dep.expr, sym);
+		expr_add_rdeps(sym->rev_dep.expr, sym);
+		expr_add_rdeps(sym->implied.expr, sym);
+		for (prop = sym->prop; prop; prop = prop->next) {
+			if (prop->type == P_SELECT || prop->type == P_IMPLY)
+				continue;
+			expr_add_rdeps(prop->expr, sym);
+			expr_add_rdeps(prop->visible.expr, sym);
+		}
+	}
+	sym_rdeps_built = true;
+}
+
+static int sym_invalidate(struct symbol *sym)
+{
+	int i, count = 1;
+
+	sym->rdep_gen = sym_rdep_gen;
+	sym->flags &= ~SYMBOL_VALID;
+	for (i = 0; i < sym->rdep_count; i++)
+		if (sym->rdeps[i]->rdep_gen != sym_rdep_gen)
+			count += sym_invalidate(sym->rdeps[i]);
+
+	return count;
+}
+
+/*
+ * Like sym_clear_all_valid(), but only for the symbols that depend on
+ * sym, directly or transitively. A change of modules_sym alters the type
+ * of every tristate symbol, so that still clears everything.
+ *
+ * A choice that lost its user value in sym_calc_choice() keeps the value
+ * calculated with it until the next change recalculates it, so those
+ * choices are invalidated along with sym.
+ */
+static void sym_clear_valid(struct symbol *sym)
+{
+	unsigned long long start = 0;
+	int count;
+
+	if (sym_calc_stats < 0)
+		sym_calc_stats = getenv("KCONFIG_CALC_STATS") != NULL;
+	if (sym_calc_stats)
+		start = sym_stats_nsec();
+	if (!sym_rdeps_built)
+		sym_build_rdeps();
+
+	sym_rdep_gen++;
+	count = sym_invalidate(sym);
+	while (sym_stale_count) {
+		struct symbol *cs = sym_stale_choices[--sym_stale_count];
+
+		if (cs->rdep_gen != sym_rdep_gen)
+			count += sym_invalidate(cs);
+	}
+	if (KCONFIG_FULL_INVALIDATE ||
+	    (modules_sym && modules_sym->rdep_gen == sym_rdep_gen)) {
+		sym_clear_all_valid();
+		count = sym_total;
+	} else {
+		conf_set_changed(true);
+		sym_calc_value(modules_sym);
+	}
+
+	if (sym_calc_stats)
+		fprintf(stderr, "%s: %d of %d symbols invalidated in %llu us, %lu calculated in %llu us since the last change\n",
+			sym->name ? sym->name : "<choice>", count, sym_total,
+			(sym_stats_nsec() - start) / 1000, sym_calc_count,
+			sym_calc_nsec / 1000);
+	sym_calc_count = 0;
+	sym_calc_nsec = 0;
+}
+
 bool sym_tristate_within_range(struct symbol *sym, tristate val)
 {
 	int type = sym_get_type(sym);
@@ -504,7 +704,7 @@ bool sym_set_tristate_value(struct symbol *sym, tristate val)
 
 	sym->def[S_DEF_USER].tri = val;
 	if (oldval != val)
-		sym_clear_all_valid();
+		sym_clear_valid(sym);
 
 	return true;
 }
@@ -661,7 +861,7 @@ bool sym_set_string_value(struct symbol *sym, const char *newval)
 
 	strcpy(val, newval);
 	free((void *)oldval);
-	sym_clear_all_valid();
+	sym_clear_valid(sym);
 
 	return true;
 }
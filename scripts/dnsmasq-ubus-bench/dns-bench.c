@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Query load and upstream server for measuring the dnsmasq dns_result hook
+ *
+ * Sends queries for unique names to dnsmasq one at a time and answers the
+ * ones it forwards to the upstream port itself, with a fixed number of A
+ * records each. Unique names keep the dnsmasq cache out of the way, so
+ * every reply goes through do_doctor(). Prints the reply latency seen by
+ * the client.
+ *
+ * Usage: dns-bench [-s port] [-u port] [-n queries] [-k records]
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QUERY_TIMEOUT_MS	2000
+
+static int udp_socket(int port)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int fd;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		perror("socket");
+		exit(1);
+	}
+
+	return fd;
+}
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* a query for q<seq>.bench.test IN A */
+static int build_query(unsigned char *buf, uint16_t id, int seq)
+{
+	unsigned char *p = buf + 12;
+	char label[16];
+	int len;
+
+	memset(buf, 0, 12);
+	buf[0] = id >> 8;
+	buf[1] = id;
+	buf[2] = 0x01;		/* RD */
+	buf[5] = 1;		/* QDCOUNT */
+
+	len = snprintf(label, sizeof(label), "q%d", seq);
+	*p++ = len;
+	memcpy(p, label, len);
+	p += len;
+	memcpy(p, "\x05" "bench" "\x04" "test", 11);
+	p += 11;
+	*p++ = 0;
+
+	memcpy(p, "\x00\x01\x00\x01", 4);	/* A, IN */
+	return p + 4 - buf;
+}
+
+/* answer a forwarded query with k A records 10.<k>.x.y */
+static void upstream_reply(int fd, int k)
+{
+	unsigned char buf[1500];
+	struct sockaddr_in from;
+	socklen_t fromlen = sizeof(from);
+	unsigned char *p;
+	ssize_t len;
+	int i;
+
+	len = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromlen);
+	if (len < 12 + 5)
+		return;
+
+	/* the question ends the query, skip any EDNS0 record after it */
+	p = buf + 12;
+	while (p < buf + len && *p)
+		p += *p + 1;
+	p += 5;
+	if (p > buf + len || (size_t)(p - buf) + k * 16 > sizeof(buf))
+		return;
+
+	buf[2] = 0x81;		/* QR, RD */
+	buf[3] = 0x80;		/* RA */
+	buf[6] = k >> 8;
+	buf[7] = k;
+	memset(buf + 8, 0, 4);	/* NSCOUNT, ARCOUNT */
+
+	for (i = 0; i < k; i++) {
+		memcpy(p, "\xc0\x0c\x00\x01\x00\x01\x00\x00\x01\x2c\x00\x04", 12);
+		p += 12;
+		*p++ = 10;
+		*p++ = k;
+		*p++ = i >> 8;
+		*p++ = i;
+	}
+
+	sendto(fd, buf, p - buf, 0, (struct sockaddr *)&from, fromlen);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	int port = 5300, uport = 5301, queries = 2000, k = 4;
+	struct sockaddr_in dst = { .sin_family = AF_INET };
+	unsigned char buf[1500];
+	struct pollfd pfd[2];
+	uint32_t *lat;
+	uint64_t total = 0, start;
+	int i, n = 0, lost = 0, opt, len;
+
+	while ((opt = getopt(argc, argv, "s:u:n:k:")) != -1) {
+		switch (opt) {
+		case 's': port = atoi(optarg); break;
+		case 'u': uport = atoi(optarg); break;
+		case 'n': queries = atoi(optarg); break;
+		case 'k': k = atoi(optarg); break;
+		default:
+			fprintf(stderr, "Usage: %s [-s port] [-u port] [-n queries] [-k records]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (queries < 1 || k < 1 || k > 64)
+		return 1;
+
+	lat = calloc(queries, sizeof(*lat));
+	if (!lat)
+		return 1;
+
+	pfd[0].fd = udp_socket(0);
+	pfd[0].events = POLLIN;
+	pfd[1].fd = udp_socket(uport);
+	pfd[1].events = POLLIN;
+
+	dst.sin_port = htons(port);
+	dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (i = 0; i < queries; i++) {
+		uint16_t id = i;
+
+		len = build_query(buf, id, i);
+		start = now_us();
+		sendto(pfd[0].fd, buf, len, 0, (struct sockaddr *)&dst, sizeof(dst));
+
+		for (;;) {
+			int left = QUERY_TIMEOUT_MS - (int)((now_us() - start) / 1000);
+
+			if (left <= 0 || poll(pfd, 2, left) <= 0) {
+				lost++;
+				break;
+			}
+
+			if (pfd[1].revents & POLLIN)
+				upstream_reply(pfd[1].fd, k);
+
+			if (!(pfd[0].revents & POLLIN))
+				continue;
+
+			len = recv(pfd[0].fd, buf, sizeof(buf), 0);
+			if (len < 12 || buf[0] != (id >> 8) || buf[1] != (id & 0xff))
+				continue;
+
+			lat[n] = now_us() - start;
+			total += lat[n++];
+			break;
+		}
+	}
+
+	if (!n) {
+		printf("%d queries, all lost\n", queries);
+		return 1;
+	}
+
+	qsort(lat, n, sizeof(*lat), cmp_u32);
+	printf("%d queries %d lost  avg %llu us  p50 %u us  p99 %u us  max %u us\n",
+	       queries, lost, (unsigned long long)(total / n), lat[n / 2],
+	       lat[(n * 99) / 100], lat[n - 1]);
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Test subscriber for the dnsmasq dns_result hook
+ *
+ * Sets the notification mode with the config method of <name>.dns, then
+ * subscribes and answers every dns_result and dns_results notification
+ * after a fixed delay, standing in for a subscriber that does some work
+ * per record. With -r every address is rewritten, otherwise the records
+ * are left alone. Prints "ready" once subscribed and the number of
+ * notifications and records on SIGINT/SIGTERM.
+ *
+ * Usage: dns-subscriber [-o object] [-d delay_us] [-r address] [-b] [-a]
+ *                       [-c cache] [-t timeout_ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libubox/blobmsg.h>
+#include <libubox/uloop.h>
+#include <libubus.h>
+
+static struct ubus_context *ctx;
+static struct ubus_subscriber sub;
+static struct blob_buf b;
+static const char *rewrite = "";
+static int delay_us;
+static unsigned int notifications, records;
+
+static const struct blobmsg_policy records_policy =
+	{ .name = "records", .type = BLOBMSG_TYPE_ARRAY };
+
+static int notify_cb(struct ubus_context *ctx, struct ubus_object *obj,
+		     struct ubus_request_data *req, const char *method,
+		     struct blob_attr *msg)
+{
+	struct blob_attr *tb, *cur;
+	void *array;
+	int rem;
+
+	(void)obj;
+
+	notifications++;
+	if (delay_us)
+		usleep(delay_us);
+
+	blob_buf_init(&b, 0);
+
+	if (!strcmp(method, "dns_result")) {
+		records++;
+		blobmsg_add_string(&b, "address", rewrite);
+	} else if (!strcmp(method, "dns_results")) {
+		blobmsg_parse(&records_policy, 1, &tb, blob_data(msg), blob_len(msg));
+		if (!tb)
+			return 0;
+
+		array = blobmsg_open_array(&b, "addresses");
+		blobmsg_for_each_attr(cur, tb, rem) {
+			records++;
+			blobmsg_add_string(&b, NULL, rewrite);
+		}
+		blobmsg_close_array(&b, array);
+	} else {
+		return 0;
+	}
+
+	ubus_send_reply(ctx, req, b.head);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *object = "dnsmasq.dns";
+	uint32_t id;
+	int opt, ret;
+
+	blob_buf_init(&b, 0);
+
+	while ((opt = getopt(argc, argv, "o:d:r:bac:t:")) != -1) {
+		switch (opt) {
+		case 'o': object = optarg; break;
+		case 'd': delay_us = atoi(optarg); break;
+		case 'r': rewrite = optarg; break;
+		case 'b': blobmsg_add_u8(&b, "batch", 1); break;
+		case 'a': blobmsg_add_u8(&b, "async", 1); break;
+		case 'c': blobmsg_add_u32(&b, "cache", atoi(optarg)); break;
+		case 't': blobmsg_add_u32(&b, "timeout", atoi(optarg)); break;
+		default:
+			fprintf(stderr, "Usage: %s [-o object] [-d delay_us] [-r address] [-b] [-a]\n"
+				"\t[-c cache] [-t timeout_ms]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	uloop_init();
+	ctx = ubus_connect(NULL);
+	if (!ctx) {
+		fprintf(stderr, "failed to connect to ubus\n");
+		return 1;
+	}
+	ubus_add_uloop(ctx);
+
+	if (ubus_lookup_id(ctx, object, &id)) {
+		fprintf(stderr, "%s not found\n", object);
+		return 1;
+	}
+
+	/* the mode is set before subscribing, so no notification uses the old one */
+	ret = ubus_invoke(ctx, id, "config", b.head, NULL, NULL, 1000);
+	if (ret) {
+		fprintf(stderr, "config failed: %s\n", ubus_strerror(ret));
+		return 1;
+	}
+
+	sub.cb = notify_cb;
+	if (ubus_register_subscriber(ctx, &sub) || ubus_subscribe(ctx, &sub, id)) {
+		fprintf(stderr, "failed to subscribe to %s\n", object);
+		return 1;
+	}
+
+	printf("ready\n");
+	fflush(stdout);
+
+	/* uloop ends on SIGINT and SIGTERM */
+	uloop_run();
+
+	printf("%u notifications, %u records\n", notifications, records);
+
+	ubus_free(ctx);
+	uloop_done();
+	return 0;
+}
@@ -0,0 +1,122 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Reply latency of dnsmasq with the dns_result ubus hook in each of its modes.
+#
+# A dnsmasq instance of its own listens on 127.0.0.1:<port> under the ubus
+# name "dnsbench" and forwards to dns-bench on <port>+1, which also sends
+# the queries. ubusd is started when none is running. For each mode a
+# dns-subscriber answers the notifications after -d microseconds:
+# - none: no subscriber, the hook is skipped
+# - sync: one dns_result per record, each waited for (the default)
+# - batch: one dns_results per reply, waited for
+# - async: nothing waited for, the replies fill a 1024 entry cache
+# Prints the latency dns-bench saw along with the notification and timeout
+# counters of the metrics method.
+#
+# Needs ubusd, the ubus CLI and a dnsmasq built with the 200-ubus_dns.patch.
+#
+# Usage: run.sh [-n queries] [-k records] [-d delay_us] [-p port] [-D dnsmasq]
+
+set -eu
+
+QUERIES=2000
+RECORDS=4
+DELAY=0
+PORT=5300
+DNSMASQ=dnsmasq
+OBJ=dnsbench.dns
+HERE="$(cd "$(dirname "$0")" && pwd)"
+
+while getopts "n:k:d:p:D:" opt; do
+	case "$opt" in
+	n) QUERIES="$OPTARG" ;;
+	k) RECORDS="$OPTARG" ;;
+	d) DELAY="$OPTARG" ;;
+	p) PORT="$OPTARG" ;;
+	D) DNSMASQ="$OPTARG" ;;
+	*) echo "Usage: $0 [-n queries] [-k records] [-d delay_us] [-p port] [-D dnsmasq]" >&2; exit 1 ;;
+	esac
+done
+
+make -s -C "$HERE"
+
+WORK="$(mktemp -d)"
+PIDS=""
+cleanup() {
+	for pid in $PIDS; do
+		kill "$pid" 2>/dev/null || true
+	done
+	wait 2>/dev/null || true
+	rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+# wait_for <what> <command...>: retry a command for up to 5s
+wait_for() {
+	what="$1"; shift
+	i=0
+	until "$@" >/dev/null 2>&1; do
+		i=$((i + 1))
+		if [ $i -ge 50 ]; then
+			echo "timed out waiting for $what" >&2
+			exit 1
+		fi
+		sleep 0.1
+	done
+}
+
+if ! ubus list >/dev/null 2>&1; then
+	mkdir -p /var/run/ubus
+	ubusd &
+	PIDS="$PIDS $!"
+	wait_for ubusd ubus list
+fi
+
+"$DNSMASQ" -k -C /dev/null --port="$PORT" --listen-address=127.0.0.1 \
+	--bind-interfaces --no-resolv --no-hosts --cache-size=0 --pid-file \
+	--server="127.0.0.1#$((PORT + 1))" --enable-ubus=dnsbench \
+	>"$WORK/dnsmasq.log" 2>&1 &
+PIDS="$PIDS $!"
+wait_for "$OBJ" ubus list "$OBJ"
+
+metric() {
+	sed -n "s/.*\"$1\": \([0-9]*\).*/\1/p" "$WORK/metrics"
+}
+
+# the settings go back to the defaults once the previous subscriber is gone
+cfg_is_default() {
+	ubus call "$OBJ" config | grep -q '"batch": false' &&
+		ubus call "$OBJ" config | grep -q '"cache": 0'
+}
+
+# run_mode <mode> [dns-subscriber options]
+run_mode() {
+	mode="$1"; shift
+	sub=""
+
+	wait_for "the default settings" cfg_is_default
+	if [ "$mode" != none ]; then
+		"$HERE/dns-subscriber" -o "$OBJ" -d "$DELAY" "$@" >"$WORK/sub.log" 2>&1 &
+		sub=$!
+		wait_for dns-subscriber grep -q ready "$WORK/sub.log"
+	fi
+
+	ubus call "$OBJ" metrics '{ "reset": true }' >/dev/null
+	lat="$("$HERE/dns-bench" -s "$PORT" -u $((PORT + 1)) -n "$QUERIES" -k "$RECORDS")"
+	ubus call "$OBJ" metrics >"$WORK/metrics"
+
+	if [ -n "$sub" ]; then
+		kill "$sub"
+		wait "$sub" || true
+	fi
+
+	printf "%-6s %s  notifications %s  timeouts %s\n" \
+		"$mode" "$lat" "$(metric notifications)" "$(metric timeouts)"
+}
+
+echo "$QUERIES queries, $RECORDS A records each, subscriber delay $DELAY us"
+run_mode none
+run_mode sync
+run_mode batch -b
+run_mode async -a -c 1024
@@ -0,0 +1,137 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Measure the per-packet cost of long legacy iptables chains.
+#
+# Two network namespaces are joined by a veth pair. The receiving one gets
+# a chain of N rules that each match one host other than the sender, on the
+# source address (-k src), the destination address (-k dst) or the source
+# address plus a udp port match (-k match), followed by a rule counting the
+# test packets.
+#
+# iperf3 sends small UDP packets at a fixed rate (-p packets/s) for -t
+# seconds per chain length, pinned to the sender CPU (-s). RPS hands the
+# receive path, and so the INPUT chain, to the receiver CPU (-r), which
+# should have nothing else to do. The busy time of the receiver CPU from
+# /proc/stat divided by the counted packets gives the cost per packet, and
+# the difference to an empty chain, which is always measured first, the
+# cost of the chain. /proc/stat counts in ticks of 1/CLK_TCK seconds, so
+# small differences need a longer -t. A run where fewer than 95% of the
+# packets are counted is flagged: the receiver did not keep up and the
+# rate has to come down.
+#
+# Needs root, ip, iptables-legacy(-restore), iperf3 and taskset.
+#
+# Usage: iptables-chain-bench.sh [-k src|dst|match] [-t seconds] [-p pps]
+#                                [-s cpu] [-r cpu] [N...]
+
+set -eu
+
+KEY=src
+TIME=10
+PPS=50000
+TX_CPU=0
+RX_CPU=1
+NS_TX=iptbench-tx
+NS_RX=iptbench-rx
+USAGE="Usage: $0 [-k src|dst|match] [-t seconds] [-p pps] [-s cpu] [-r cpu] [N...]"
+
+while getopts "k:t:p:s:r:" opt; do
+	case "$opt" in
+	k) KEY="$OPTARG" ;;
+	t) TIME="$OPTARG" ;;
+	p) PPS="$OPTARG" ;;
+	s) TX_CPU="$OPTARG" ;;
+	r) RX_CPU="$OPTARG" ;;
+	*) echo "$USAGE" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || set -- 10 100 1000 5000 20000
+[ "$TX_CPU" != "$RX_CPU" ] || { echo "sender and receiver need their own CPUs" >&2; exit 1; }
+
+IPT=iptables-legacy
+command -v "$IPT" >/dev/null || IPT=iptables
+for cmd in ip "$IPT" "$IPT-restore" iperf3 taskset; do
+	command -v "$cmd" >/dev/null || { echo "$cmd not found" >&2; exit 1; }
+done
+
+cleanup() {
+	ip netns pids "$NS_RX" 2>/dev/null | xargs -r kill 2>/dev/null || true
+	ip netns del "$NS_TX" 2>/dev/null || true
+	ip netns del "$NS_RX" 2>/dev/null || true
+}
+trap cleanup EXIT INT TERM
+
+cleanup
+ip netns add "$NS_TX"
+ip netns add "$NS_RX"
+ip link add veth-tx netns "$NS_TX" type veth peer name veth-rx netns "$NS_RX"
+ip -n "$NS_TX" addr add 192.168.250.1/24 dev veth-tx
+ip -n "$NS_RX" addr add 192.168.250.2/24 dev veth-rx
+ip -n "$NS_TX" link set veth-tx up
+ip -n "$NS_RX" link set veth-rx up
+ip -n "$NS_TX" link set lo up
+ip -n "$NS_RX" link set lo up
+
+# the receive path runs on the receiver CPU, the iperf3 server does not
+printf "%x" $((1 << RX_CPU)) |
+	ip netns exec "$NS_RX" tee /sys/class/net/veth-rx/queues/rx-0/rps_cpus >/dev/null
+ip netns exec "$NS_RX" taskset -c "$TX_CPU" iperf3 -s -D >/dev/null
+sleep 1
+
+# N rules for hosts in 10.0.0.0/8, none of them the sender
+gen_rules() {
+	n="$1"
+	i=0
+
+	echo "*filter"
+	echo ":INPUT ACCEPT [0:0]"
+	echo ":bench - [0:0]"
+	echo "-A INPUT -i veth-rx -j bench"
+	while [ "$i" -lt "$n" ]; do
+		host="10.$((i >> 16 & 255)).$((i >> 8 & 255)).$((i & 255))"
+		case "$KEY" in
+		src) echo "-A bench -s $host/32 -j DROP" ;;
+		dst) echo "-A bench -d $host/32 -j DROP" ;;
+		match) echo "-A bench -s $host/32 -p udp -m udp --dport 53 -j DROP" ;;
+		esac
+		i=$((i + 1))
+	done
+	echo "-A bench -p udp -j ACCEPT"
+	echo "COMMIT"
+}
+
+# busy time of a CPU in USER_HZ ticks
+cpu_busy() {
+	awk -v cpu="cpu$1" '$1 == cpu { print $2 + $3 + $4 + $7 + $8 }' /proc/stat
+}
+
+# measure <N>: sets pkts and ns, the receiver CPU time per counted packet
+measure() {
+	gen_rules "$1" | ip netns exec "$NS_RX" "$IPT-restore"
+
+	busy=$(cpu_busy "$RX_CPU")
+	# -b is the payload rate, 18 bytes per packet
+	ip netns exec "$NS_TX" taskset -c "$TX_CPU" iperf3 -c 192.168.250.2 -u \
+		-b $((PPS * 18 * 8)) -l 18 -t "$TIME" >/dev/null
+	busy=$(($(cpu_busy "$RX_CPU") - busy))
+
+	pkts="$(ip netns exec "$NS_RX" "$IPT" -L bench -v -x -n |
+		awk '$3 == "ACCEPT" { print $1 }')"
+	[ "$pkts" -gt 0 ] || { echo "no packets counted for $1 rules" >&2; exit 1; }
+
+	ns=$((busy * (1000000000 / $(getconf CLK_TCK)) / pkts))
+	note=
+	[ $((pkts * 100)) -ge $((PPS * TIME * 95)) ] || note="  receiver fell behind"
+}
+
+echo "$PPS packets/s for $TIME s, sender on CPU $TX_CPU, receiver on CPU $RX_CPU"
+measure 0
+base="$ns"
+printf "%8s %12s %10s %10s\n" rules packets ns/pkt +ns/pkt
+printf "%8u %12u %10u %10d%s\n" 0 "$pkts" "$ns" 0 "$note"
+for n in "$@"; do
+	measure "$n"
+	printf "%8u %12u %10u %10d%s\n" "$n" "$pkts" "$ns" $((ns - base)) "$note"
+done
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Write a random Kconfig tree to stdout: bool, tristate, int, hex and
+# string symbols with dependencies, if blocks, choices, selects, implies,
+# ranges and conditional defaults, plus MODULES.
+#
+# Usage: gen-kconfig.py <seed> <symbols>
+
+import random
+import sys
+
+rng = random.Random(int(sys.argv[1]))
+count = int(sys.argv[2])
+
+out = []
+syms = []  # (name, type)
+
+
+def sym_of(kind):
+    return [s for s in syms if s[1] in kind]
+
+
+def dep():
+    """Random dependency expression over earlier symbols, or None."""
+    cand = [s for s in sym_of(("bool", "tristate")) if not s[0].startswith("T")]
+    if not cand or rng.random() < 0.3:
+        return None
+
+    parts = []
+    for _ in range(rng.randint(1, 3)):
+        name, kind = rng.choice(cand)
+        r = rng.random()
+        if r < 0.2:
+            parts.append("!" + name)
+        elif r < 0.3 and kind == "tristate":
+            parts.append(name + "=m")
+        elif r < 0.4 and kind == "tristate":
+            parts.append(name + "!=y")
+        else:
+            parts.append(name)
+
+    ints = sym_of(("int",))
+    if ints and rng.random() < 0.1:
+        parts.append(rng.choice(ints)[0] + ">10")
+
+    return (" && " if rng.random() < 0.6 else " || ").join(parts)
+
+
+def add_choice(idx):
+    kind = rng.choice(["bool", "tristate"])
+    out.append('choice\n\tprompt "choice %d"\n' % idx)
+    if kind == "tristate":
+        out.append("\ttristate\n")
+    if rng.random() < 0.3:
+        out.append("\toptional\n")
+    d = dep()
+    if d:
+        out.append("\tdepends on %s\n" % d)
+
+    members = []
+    for k in range(rng.randint(2, 5)):
+        name = "C%d_%d" % (idx, k)
+        members.append(name)
+        out.append('config %s\n\t%s "%s"\n' % (name, kind, name))
+        d = dep()
+        if d and rng.random() < 0.4:
+            out.append("\tdepends on %s\n" % d)
+    out.append("endchoice\n")
+    syms.extend((m, kind) for m in members)
+
+
+def add_symbol(idx):
+    kind = rng.choice(["bool", "bool", "tristate", "tristate", "int", "string", "hex"])
+    # T symbols are select/imply targets and never used in dependencies
+    prefix = "T" if kind in ("bool", "tristate") and rng.random() < 0.2 else "S"
+    name = "%s%d" % (prefix, idx)
+
+    s = "config %s\n" % name
+    if rng.random() < 0.8:
+        s += '\t%s "%s"\n' % (kind, name)
+    else:
+        s += "\t%s\n" % kind
+    d = dep()
+    if d:
+        s += "\tdepends on %s\n" % d
+
+    if kind in ("bool", "tristate"):
+        targets = [x for x in syms if x[0].startswith("T")]
+        for _ in range(rng.randint(0, 2)):
+            if targets and rng.random() < 0.5:
+                s += "\t%s %s" % (rng.choice(["select", "imply"]), rng.choice(targets)[0])
+                d = dep()
+                if d:
+                    s += " if %s" % d
+                s += "\n"
+        if rng.random() < 0.5:
+            s += "\tdefault %s" % rng.choice(["y", "m", "n", dep() or "y"])
+            d = dep()
+            if d:
+                s += " if %s" % d
+            s += "\n"
+    elif kind == "int":
+        s += "\trange 0 %d\n" % rng.randint(5, 100)
+        ints = sym_of(("int",))
+        if ints and rng.random() < 0.3:
+            s += "\tdefault %s\n" % rng.choice(ints)[0]
+        else:
+            s += "\tdefault %d\n" % rng.randint(0, 5)
+    elif kind == "hex":
+        s += "\tdefault 0x%x\n" % rng.randint(0, 100)
+    else:
+        s += '\tdefault "x%d"' % idx
+        d = dep()
+        if d:
+            s += " if %s" % d
+        s += "\n"
+
+    out.append(s)
+    syms.append((name, kind))
+
+
+out.append('config MODULES\n\tbool "modules"\n\tmodules\n\tdefault y\n')
+syms.append(("MODULES", "bool"))
+
+idx = 0
+choices = 0
+ifdepth = 0
+while idx < count:
+    r = rng.random()
+    if r < 0.05 and ifdepth < 3:
+        d = dep()
+        if d:
+            out.append("if %s\n" % d)
+            ifdepth += 1
+            continue
+    if r < 0.08 and ifdepth > 0:
+        out.append("endif\n")
+        ifdepth -= 1
+        continue
+    if r < 0.12:
+        choices += 1
+        add_choice(choices)
+        continue
+    add_symbol(idx)
+    idx += 1
+
+out.append("endif\n" * ifdepth)
+sys.stdout.write("".join(out))
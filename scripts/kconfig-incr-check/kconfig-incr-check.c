@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Random value changes through sym_set_string_value() against a full
+ * recalculation
+ *
+ * Parses a Kconfig tree, then changes random symbols to random values.
+ * After each change a few random symbols are calculated, as a front end
+ * showing part of the menu would. Every tenth change the value, visibility
+ * and write flag of every symbol are recorded, all symbols are cleared
+ * with sym_clear_all_valid() and the same properties are compared after
+ * recalculating from scratch.
+ *
+ * The write flag of an invisible choice value is not compared: a choice
+ * calculated from within the calculation of one of its values sets the
+ * flag from that value's previous visibility, so it depends on the order
+ * of the calculations rather than on what was invalidated.
+ *
+ * Usage: kconfig-incr-check <Kconfig> <seed> <changes>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lkc.h"
+
+struct sym_snap {
+	tristate tri;
+	tristate visible;
+	bool write;
+	char *str;
+};
+
+static struct symbol **syms;
+static int nsyms;
+
+static void snapshot(struct sym_snap *snap)
+{
+	int i;
+
+	for (i = 0; i < nsyms; i++) {
+		sym_calc_value(syms[i]);
+		snap[i].tri = syms[i]->curr.tri;
+		snap[i].visible = syms[i]->visible;
+		snap[i].write = !!(syms[i]->flags & SYMBOL_WRITE);
+		free(snap[i].str);
+		snap[i].str = strdup(sym_get_string_value(syms[i]));
+	}
+}
+
+static void set_random_value(struct symbol *sym)
+{
+	static const char * const tri[] = { "y", "m", "n" };
+	char buf[16];
+
+	switch (sym->type) {
+	case S_BOOLEAN:
+	case S_TRISTATE:
+		sym_set_string_value(sym, tri[rand() % 3]);
+		break;
+	case S_INT:
+		snprintf(buf, sizeof(buf), "%d", rand() % 120);
+		sym_set_string_value(sym, buf);
+		break;
+	case S_HEX:
+		snprintf(buf, sizeof(buf), "0x%x", rand() % 120);
+		sym_set_string_value(sym, buf);
+		break;
+	case S_STRING:
+		snprintf(buf, sizeof(buf), "v%d", rand() % 5);
+		sym_set_string_value(sym, buf);
+		break;
+	default:
+		break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct sym_snap *incr, *full;
+	struct symbol *sym;
+	int changes, step, bad = 0;
+	int i, j;
+
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s <Kconfig> <seed> <changes>\n", argv[0]);
+		return 2;
+	}
+
+	conf_parse(argv[1]);
+	conf_read(NULL);
+	srand(atoi(argv[2]));
+	changes = atoi(argv[3]);
+
+	for_all_symbols(i, sym)
+		nsyms++;
+	syms = calloc(nsyms, sizeof(*syms));
+	incr = calloc(nsyms, sizeof(*incr));
+	full = calloc(nsyms, sizeof(*full));
+	if (!syms || !incr || !full)
+		return 2;
+
+	j = 0;
+	for_all_symbols(i, sym)
+		syms[j++] = sym;
+
+	for (step = 0; step < changes; step++) {
+		sym = syms[rand() % nsyms];
+		if (!sym->name)
+			continue;
+
+		sym_calc_value(sym);
+		set_random_value(sym);
+		for (i = 0; i < 50; i++)
+			sym_calc_value(syms[rand() % nsyms]);
+
+		if (step % 10 != 9)
+			continue;
+
+		snapshot(incr);
+		sym_clear_all_valid();
+		snapshot(full);
+
+		for (i = 0; i < nsyms; i++) {
+			if (incr[i].tri == full[i].tri &&
+			    incr[i].visible == full[i].visible &&
+			    (incr[i].write == full[i].write ||
+			     (sym_is_choice_value(syms[i]) &&
+			      full[i].visible == no)) &&
+			    !strcmp(incr[i].str, full[i].str))
+				continue;
+
+			if (bad++ < 10)
+				printf("change %d: %s is %s/%d/%d, full recalculation gives %s/%d/%d\n",
+				       step, syms[i]->name ? syms[i]->name : "<choice>",
+				       incr[i].str, incr[i].visible, incr[i].write,
+				       full[i].str, full[i].visible, full[i].write);
+		}
+	}
+
+	printf("%s: %d symbols, %d changes, %d mismatches\n",
+	       argv[1], nsyms, changes, bad);
+
+	return bad != 0;
+}
@@ -0,0 +1,99 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Compare the incremental symbol invalidation against a full one.
+#
+# For each seed a random Kconfig tree is generated, then:
+# - kconfig-incr-check makes random sym_set_string_value() changes and
+#   compares every symbol against a full recalculation.
+# - conf-incr and conf-full (the same conf built with
+#   KCONFIG_FULL_INVALIDATE) answer the same random input stream in
+#   --oldconfig mode, which prompts through check_conf() for the symbols
+#   missing from a partial .config, and in --oldaskconfig mode, which
+#   prompts for every symbol. The prompts show the current values, so the
+#   transcripts and the written .config files must be identical.
+#
+# Usage: run.sh [-n symbols] [-c changes] [seed...]
+
+set -eu
+
+SYMS=1500
+CHANGES=500
+HERE="$(cd "$(dirname "$0")" && pwd)"
+
+while getopts "n:c:" opt; do
+	case "$opt" in
+	n) SYMS="$OPTARG" ;;
+	c) CHANGES="$OPTARG" ;;
+	*) echo "Usage: $0 [-n symbols] [-c changes] [seed...]" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || set -- 1 2 3 4 5 6 7 8
+
+make -s -C "$HERE"
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT INT TERM
+
+# random answers: tristates, defaults, ints, hex values and strings
+answers() {
+	awk -v seed="$1" -v n="$2" 'BEGIN {
+		srand(seed)
+		for (i = 0; i < n; i++) {
+			r = int(rand() * 7)
+			if (r == 0) print "y"
+			else if (r == 1) print "m"
+			else if (r == 2) print "n"
+			else if (r == 3) print ""
+			else if (r == 4) print int(rand() * 120)
+			else if (r == 5) printf "0x%x\n", int(rand() * 120)
+			else print "v" int(rand() * 5)
+		}
+	}'
+}
+
+# run_conf <conf> <mode> <seed> <name>: answer a session, time it in ms.
+# Both sessions use the same relative .config name, the logs print it.
+run_conf() {
+	mkdir -p "$WORK/$4"
+	cp "$WORK/partial.config" "$WORK/$4/.config"
+	start=$(date +%s%N)
+	answers "$3" $((SYMS * 20)) |
+		(cd "$WORK/$4" && timeout 120 "$HERE/$1" "--$2" "$WORK/Kconfig") \
+		>"$WORK/$4.log" 2>&1 || true
+	echo $((($(date +%s%N) - start) / 1000000))
+}
+
+fail=0
+for seed in "$@"; do
+	# --alldefconfig would start from the previous seed's def.config
+	rm -rf "$WORK"/*
+	python3 "$HERE/gen-kconfig.py" "$seed" "$SYMS" >"$WORK/Kconfig"
+
+	"$HERE/kconfig-incr-check" "$WORK/Kconfig" "$seed" "$CHANGES" || fail=1
+
+	# drop about half the lines of a default config to get new symbols
+	KCONFIG_CONFIG="$WORK/def.config" \
+		"$HERE/conf-full" --alldefconfig "$WORK/Kconfig" >/dev/null
+	awk -v seed="$seed" 'BEGIN { srand(seed) } rand() < 0.5' \
+		"$WORK/def.config" >"$WORK/partial.config"
+
+	for mode in oldconfig oldaskconfig; do
+		t_full=$(run_conf conf-full "$mode" "$seed" full)
+		t_incr=$(run_conf conf-incr "$mode" "$seed" incr)
+		prompts=$(grep -c ' \[' "$WORK/incr.log" || true)
+
+		if cmp -s "$WORK/full.log" "$WORK/incr.log" &&
+		   cmp -s "$WORK/full/.config" "$WORK/incr/.config"; then
+			result=identical
+		else
+			result=DIFFERENT
+			fail=1
+		fi
+		printf "seed %s %-13s %6d prompts  full %6d ms  incr %6d ms  %s\n" \
+			"$seed" "$mode" "$prompts" "$t_full" "$t_incr" "$result"
+	done
+done
+
+exit $fail
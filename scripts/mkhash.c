@@ -86,12 +86,38 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#define SHA256_X86_SHA
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__)
+#if (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8) || \
+    defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#define SHA256_ARM_SHA2
+#include <arm_neon.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2	(1 << 6)
+#endif
+#endif
+#endif
+#endif
+
 #define ARRAY_SIZE(_n) (sizeof(_n) / sizeof((_n)[0]))
 
 #ifndef __FreeBSD__
@@ -451,6 +477,26 @@ be32dec_vect(uint32_t *dst, const unsigned char *src, size_t len)
 #define Maj(x, y, z)	((x & (y | z)) | (y & z))
 #define ROTR(x, n)	((x >> n) | (x << (32 - n)))
 
+/* SHA256 round constants. */
+static const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
 /*
  * SHA256 block compression function.  The 256-bit state is transformed via
  * the 512-bit input block to produce a new state.
@@ -458,25 +504,6 @@ be32dec_vect(uint32_t *dst, const unsigned char *src, size_t len)
 static void
 SHA256_Transform(uint32_t * state, const unsigned char block[64])
 {
-	/* SHA256 round constants. */
-	static const uint32_t K[64] = {
-		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-		0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-		0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-		0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-		0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-		0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-		0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-		0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-		0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-	};
 	uint32_t W[64];
 	uint32_t S[8];
 	int i;
@@ -498,7 +525,7 @@ SHA256_Transform(uint32_t * state, const unsigned char block[64])
 	    S[(66 - i) % 8], S[(67 - i) % 8],	\
 	    S[(68 - i) % 8], S[(69 - i) % 8],	\
 	    S[(70 - i) % 8], S[(71 - i) % 8],	\
-	    W[i + ii] + K[i + ii])
+	    W[i + ii] + SHA256_K[i + ii])
 
 /* Message schedule computation */
 #define MSCH(W, ii, i)				\
@@ -562,6 +589,183 @@ SHA256_Transform(uint32_t * state, const unsigned char block[64])
 		state[i] += S[i];
 }
 
+static void
+SHA256_Blocks_generic(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+	while (blocks--) {
+		SHA256_Transform(state, data);
+		data += 64;
+	}
+}
+
+#ifdef SHA256_X86_SHA
+/*
+ * SHA256 using the x86 SHA extensions.  The state is kept in the ABEF/CDGH
+ * register layout expected by sha256rnds2 across all blocks of an update.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void
+SHA256_Blocks_x86(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					    0x0405060700010203ULL);
+	__m128i state0, state1, abef, cdgh, msg, tmp, m[4];
+	int i;
+
+	tmp = _mm_loadu_si128((const __m128i *) &state[0]);
+	state1 = _mm_loadu_si128((const __m128i *) &state[4]);
+	tmp = _mm_shuffle_epi32(tmp, 0xB1);		/* CDAB */
+	state1 = _mm_shuffle_epi32(state1, 0x1B);	/* EFGH */
+	state0 = _mm_alignr_epi8(tmp, state1, 8);	/* ABEF */
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);	/* CDGH */
+
+	while (blocks--) {
+		abef = state0;
+		cdgh = state1;
+
+		for (i = 0; i < 16; i++) {
+			if (i < 4) {
+				msg = _mm_loadu_si128((const __m128i *) (data + i * 16));
+				m[i] = _mm_shuffle_epi8(msg, mask);
+			} else {
+				/* W[t] from W[t-16], W[t-15], W[t-7] and W[t-2] */
+				tmp = _mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]);
+				tmp = _mm_add_epi32(tmp,
+					_mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+				m[i & 3] = _mm_sha256msg2_epu32(tmp, m[(i + 3) & 3]);
+			}
+
+			msg = _mm_add_epi32(m[i & 3],
+				_mm_loadu_si128((const __m128i *) &SHA256_K[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+		data += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);		/* FEBA */
+	state1 = _mm_shuffle_epi32(state1, 0xB1);	/* DCHG */
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);	/* DCBA */
+	state1 = _mm_alignr_epi8(state1, tmp, 8);	/* HGFE */
+
+	_mm_storeu_si128((__m128i *) &state[0], state0);
+	_mm_storeu_si128((__m128i *) &state[4], state1);
+}
+
+static bool
+SHA256_Supported_x86(void)
+{
+	unsigned int a, b, c, d;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d) ||
+	    !(c & bit_SSSE3) || !(c & bit_SSE4_1))
+		return false;
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__cpuid_count(7, 0, a, b, c, d);
+
+	/* CPUID.(EAX=7,ECX=0):EBX.SHA */
+	return b & (1 << 29);
+}
+#endif
+
+#ifdef SHA256_ARM_SHA2
+/* SHA256 using the ARMv8 cryptography extensions. */
+#if defined(__GNUC__) && !defined(__clang__)
+__attribute__((target("+crypto")))
+#endif
+static void
+SHA256_Blocks_arm(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+	uint32x4_t state0, state1, abcd, efgh, wk, tmp, m[4];
+	int i;
+
+	state0 = vld1q_u32(&state[0]);
+	state1 = vld1q_u32(&state[4]);
+
+	while (blocks--) {
+		abcd = state0;
+		efgh = state1;
+
+		for (i = 0; i < 16; i++) {
+			if (i < 4) {
+				m[i] = vreinterpretq_u32_u8(
+					vrev32q_u8(vld1q_u8(data + i * 16)));
+			} else {
+				/* W[t] from W[t-16], W[t-15], W[t-7] and W[t-2] */
+				tmp = vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]);
+				m[i & 3] = vsha256su1q_u32(tmp, m[(i + 2) & 3],
+							   m[(i + 3) & 3]);
+			}
+
+			wk = vaddq_u32(m[i & 3], vld1q_u32(&SHA256_K[i * 4]));
+			tmp = state0;
+			state0 = vsha256hq_u32(state0, state1, wk);
+			state1 = vsha256h2q_u32(state1, tmp, wk);
+		}
+
+		state0 = vaddq_u32(state0, abcd);
+		state1 = vaddq_u32(state1, efgh);
+		data += 64;
+	}
+
+	vst1q_u32(&state[0], state0);
+	vst1q_u32(&state[4], state1);
+}
+
+static bool
+SHA256_Supported_arm(void)
+{
+#if defined(__linux__)
+	return getauxval(AT_HWCAP) & HWCAP_SHA2;
+#elif defined(__APPLE__)
+	return true;
+#else
+	return false;
+#endif
+}
+#endif
+
+struct sha256_impl {
+	const char *name;
+	void (*blocks)(uint32_t *state, const unsigned char *data, size_t blocks);
+	bool (*supported)(void);
+};
+
+/* Preferred implementations first, the generic one has to be last */
+static const struct sha256_impl sha256_impls[] = {
+#ifdef SHA256_X86_SHA
+	{ "sha-ni", SHA256_Blocks_x86, SHA256_Supported_x86 },
+#endif
+#ifdef SHA256_ARM_SHA2
+	{ "armv8-sha2", SHA256_Blocks_arm, SHA256_Supported_arm },
+#endif
+	{ "generic", SHA256_Blocks_generic, NULL },
+};
+
+static const struct sha256_impl *sha256_impl =
+	&sha256_impls[ARRAY_SIZE(sha256_impls) - 1];
+
+/* Pick the block function once, before any hashing starts */
+static void
+SHA256_Select(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(sha256_impls); i++) {
+		if (!sha256_impls[i].supported || sha256_impls[i].supported()) {
+			sha256_impl = &sha256_impls[i];
+			return;
+		}
+	}
+}
+
 static unsigned char PAD[64] = {
 	0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -585,7 +789,7 @@ SHA256_Pad(SHA256_CTX * ctx)
 	} else {
 		/* Finish the current block and mix. */
 		memcpy(&ctx->buf[r], PAD, 64 - r);
-		SHA256_Transform(ctx->state, ctx->buf);
+		sha256_impl->blocks(ctx->state, ctx->buf, 1);
 
 		/* The start of the final block is all zeroes. */
 		memset(&ctx->buf[0], 0, 56);
@@ -595,7 +799,7 @@ SHA256_Pad(SHA256_CTX * ctx)
 	be64enc(&ctx->buf[56], ctx->count);
 
 	/* Mix in the final block. */
-	SHA256_Transform(ctx->state, ctx->buf);
+	sha256_impl->blocks(ctx->state, ctx->buf, 1);
 }
 
 /* SHA-256 initialization.  Begins a SHA-256 operation. */
@@ -642,16 +846,14 @@ SHA256_Update(SHA256_CTX * ctx, const void *in, size_t len)
 
 	/* Finish the current block */
 	memcpy(&ctx->buf[r], src, 64 - r);
-	SHA256_Transform(ctx->state, ctx->buf);
+	sha256_impl->blocks(ctx->state, ctx->buf, 1);
 	src += 64 - r;
 	len -= 64 - r;
 
 	/* Perform complete blocks */
-	while (len >= 64) {
-		SHA256_Transform(ctx->state, src);
-		src += 64;
-		len -= 64;
-	}
+	sha256_impl->blocks(ctx->state, src, len / 64);
+	src += len & ~(size_t) 63;
+	len &= 63;
 
 	/* Copy left over data into buffer */
 	memcpy(ctx->buf, src, len);
@@ -674,70 +876,329 @@ SHA256_Final(unsigned char digest[static SHA256_DIGEST_LENGTH], SHA256_CTX *ctx)
 	memset(ctx, 0, sizeof(*ctx));
 }
 
-static void *hash_buf(FILE *f, int *len)
+#define HASH_BUF_SIZE	(256 * 1024)
+#define HASH_STR_LENGTH	(SHA256_DIGEST_LENGTH * 2 + 1)
+
+union hash_ctx {
+	MD5_CTX md5;
+	SHA256_CTX sha256;
+};
+
+static void md5_begin(void *ctx)
 {
-	static char buf[1024];
+	MD5_begin(ctx);
+}
 
-	*len = fread(buf, 1, sizeof(buf), f);
+static void md5_update(void *ctx, const void *data, size_t len)
+{
+	MD5_hash(data, len, ctx);
+}
 
-	return *len > 0 ? buf : NULL;
+static void md5_end(void *ctx, unsigned char *val)
+{
+	MD5_end(val, ctx);
 }
 
-static char *hash_string(unsigned char *buf, int len)
+static void sha256_begin(void *ctx)
 {
-	static char str[SHA256_DIGEST_LENGTH * 2 + 1];
-	int i;
+	SHA256_Init(ctx);
+}
 
-	if (len * 2 + 1 > sizeof(str))
-		return NULL;
+static void sha256_update(void *ctx, const void *data, size_t len)
+{
+	SHA256_Update(ctx, data, len);
+}
+
+static void sha256_end(void *ctx, unsigned char *val)
+{
+	SHA256_Final(val, ctx);
+}
+
+
+struct hash_type {
+	const char *name;
+	void (*begin)(void *ctx);
+	void (*update)(void *ctx, const void *data, size_t len);
+	void (*end)(void *ctx, unsigned char *val);
+	int len;
+};
+
+struct hash_type types[] = {
+	{ "md5", md5_begin, md5_update, md5_end, MD5_DIGEST_LENGTH },
+	{ "sha256", sha256_begin, sha256_update, sha256_end, SHA256_DIGEST_LENGTH },
+};
+
+struct hash_job {
+	const char *filename;
+	char str[HASH_STR_LENGTH];
+	const char *error;
+	bool done;
+};
+
+struct hash_queue {
+	struct hash_type *type;
+	struct hash_job *jobs;
+	int n_jobs;
+	int next;
+	bool stop;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+
+static void hash_string(char *str, unsigned char *buf, int len)
+{
+	int i;
 
 	for (i = 0; i < len; i++)
 		sprintf(&str[i * 2], "%02x", buf[i]);
+}
+
+/*
+ * Hash a file descriptor. Regular files are mapped and hashed in one go,
+ * anything else is read in large chunks through buf.
+ */
+static int hash_fd(struct hash_type *t, int fd, bool map, char *buf, char *str)
+{
+	unsigned char val[SHA256_DIGEST_LENGTH];
+	union hash_ctx ctx;
+	struct stat st;
+	ssize_t len;
+	void *data;
+
+	t->begin(&ctx);
+
+	if (map && !fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0 &&
+	    (uintmax_t) st.st_size <= SIZE_MAX) {
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			madvise(data, st.st_size, MADV_SEQUENTIAL);
+			t->update(&ctx, data, st.st_size);
+			munmap(data, st.st_size);
+			goto out;
+		}
+	}
 
-	return str;
+	while ((len = read(fd, buf, HASH_BUF_SIZE)) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		t->update(&ctx, buf, len);
+	}
+
+out:
+	t->end(&ctx, val);
+	hash_string(str, val, t->len);
+	return 0;
 }
 
-static const char *md5_hash(FILE *f)
+static void hash_job_run(struct hash_type *t, struct hash_job *job, char *buf)
 {
-	MD5_CTX ctx;
-	unsigned char val[MD5_DIGEST_LENGTH];
-	void *buf;
-	int len;
+	struct stat path_stat;
+	int fd;
 
-	MD5_begin(&ctx);
-	while ((buf = hash_buf(f, &len)) != NULL)
-		MD5_hash(buf, len, &ctx);
-	MD5_end(val, &ctx);
+	if (!job->filename || !strcmp(job->filename, "-")) {
+		if (hash_fd(t, STDIN_FILENO, false, buf, job->str))
+			job->error = "Failed to generate hash\n";
+		return;
+	}
 
-	return hash_string(val, MD5_DIGEST_LENGTH);
+	fd = open(job->filename, O_RDONLY);
+	if (fd < 0) {
+		job->error = "Failed to open '%s'\n";
+		return;
+	}
+
+	if (!fstat(fd, &path_stat) && S_ISDIR(path_stat.st_mode))
+		job->error = "Failed to open '%s': Is a directory\n";
+	else if (hash_fd(t, fd, true, buf, job->str))
+		job->error = "Failed to generate hash\n";
+
+	close(fd);
 }
 
-static const char *sha256_hash(FILE *f)
+static int hash_job_print(struct hash_job *job, bool add_filename,
+	bool no_newline)
 {
-	SHA256_CTX ctx;
-	unsigned char val[SHA256_DIGEST_LENGTH];
-	void *buf;
-	int len;
+	if (job->error) {
+		fprintf(stderr, job->error, job->filename);
+		return 1;
+	}
+
+	if (add_filename)
+		printf("%s %s%s", job->str, job->filename ? job->filename : "-",
+			no_newline ? "" : "\n");
+	else
+		printf("%s%s", job->str, no_newline ? "" : "\n");
+	return 0;
+}
+
+static void *hash_worker(void *arg)
+{
+	struct hash_queue *q = arg;
+	struct hash_job *job;
+	char *buf;
+
+	buf = malloc(HASH_BUF_SIZE);
 
-	SHA256_Init(&ctx);
-	while ((buf = hash_buf(f, &len)) != NULL)
-		SHA256_Update(&ctx, buf, len);
-	SHA256_Final(val, &ctx);
+	pthread_mutex_lock(&q->lock);
+	while (!q->stop && q->next < q->n_jobs) {
+		job = &q->jobs[q->next++];
+		pthread_mutex_unlock(&q->lock);
 
-	return hash_string(val, SHA256_DIGEST_LENGTH);
+		if (buf)
+			hash_job_run(q->type, job, buf);
+		else
+			job->error = "Failed to generate hash\n";
+
+		pthread_mutex_lock(&q->lock);
+		job->done = true;
+		pthread_cond_broadcast(&q->cond);
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	free(buf);
+	return NULL;
 }
 
+/*
+ * Hash files on up to n_threads workers. Results are printed in argument
+ * order as soon as they are available, the first failure stops the run.
+ */
+static int hash_files(struct hash_type *t, char **files, int n_files,
+	int n_threads, bool add_filename, bool no_newline)
+{
+	static char buf[HASH_BUF_SIZE];
+	struct hash_queue q = {
+		.type = t,
+		.n_jobs = n_files,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	pthread_t *threads = NULL;
+	int i, started = 0, ret = 0;
 
-struct hash_type {
-	const char *name;
-	const char *(*func)(FILE *f);
-	int len;
-};
+	q.jobs = calloc(n_files, sizeof(*q.jobs));
+	if (!q.jobs) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
 
-struct hash_type types[] = {
-	{ "md5", md5_hash, MD5_DIGEST_LENGTH },
-	{ "sha256", sha256_hash, SHA256_DIGEST_LENGTH },
-};
+	for (i = 0; i < n_files; i++)
+		q.jobs[i].filename = files[i];
+
+	if (n_threads > n_files)
+		n_threads = n_files;
+
+	if (n_threads > 1)
+		threads = calloc(n_threads, sizeof(*threads));
+
+	for (i = 0; threads && i < n_threads; i++)
+		if (!pthread_create(&threads[i], NULL, hash_worker, &q))
+			started++;
+
+	for (i = 0; i < n_files; i++) {
+		struct hash_job *job = &q.jobs[i];
+
+		if (!started) {
+			hash_job_run(t, job, buf);
+		} else {
+			pthread_mutex_lock(&q.lock);
+			while (!job->done)
+				pthread_cond_wait(&q.cond, &q.lock);
+			pthread_mutex_unlock(&q.lock);
+		}
+
+		ret = hash_job_print(job, add_filename, no_newline);
+		if (ret)
+			break;
+	}
+
+	pthread_mutex_lock(&q.lock);
+	q.stop = true;
+	pthread_mutex_unlock(&q.lock);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+	free(q.jobs);
+	return ret;
+}
+
+static double bench_run(struct hash_type *t, const char *impl,
+	const unsigned char *data, size_t len, char *str)
+{
+	unsigned char val[SHA256_DIGEST_LENGTH];
+	struct timespec start, end;
+	union hash_ctx ctx;
+	double sec;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	t->begin(&ctx);
+	t->update(&ctx, data, len);
+	t->end(&ctx, val);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	hash_string(str, val, t->len);
+	sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%-8s %-12s %9.1f MiB/s  %s\n", t->name, impl,
+		len / sec / (1024 * 1024), str);
+
+	return sec;
+}
+
+/* Compare the throughput of all usable implementations of a hash type */
+static int benchmark(struct hash_type *t)
+{
+	const struct sha256_impl *selected = sha256_impl;
+	char str[HASH_STR_LENGTH], ref[HASH_STR_LENGTH];
+	size_t i, len = 64 * 1024 * 1024;
+	unsigned char *data;
+	int ret = 0;
+
+	data = malloc(len);
+	if (!data) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < len; i++)
+		data[i] = i * 2654435761U >> 24;
+
+	if (t->begin != sha256_begin) {
+		bench_run(t, "generic", data, len, str);
+		goto out;
+	}
+
+	/* The generic implementation goes last and is the reference */
+	sha256_impl = &sha256_impls[ARRAY_SIZE(sha256_impls) - 1];
+	bench_run(t, sha256_impl->name, data, len, ref);
+
+	for (i = 0; i < ARRAY_SIZE(sha256_impls) - 1; i++) {
+		sha256_impl = &sha256_impls[i];
+		if (!sha256_impl->supported()) {
+			printf("%-8s %-12s not supported by this CPU\n",
+				t->name, sha256_impl->name);
+			continue;
+		}
+
+		bench_run(t, sha256_impl->name, data, len, str);
+		if (strcmp(str, ref)) {
+			fprintf(stderr, "%s result differs from generic implementation\n",
+				sha256_impl->name);
+			ret = 1;
+		}
+	}
+
+	sha256_impl = selected;
+
+out:
+	free(data);
+	return ret;
+}
 
 
 static int usage(const char *progname)
@@ -748,6 +1209,8 @@ static int usage(const char *progname)
 		"Options:\n"
 		"	-n		Print filename(s)\n"
 		"	-N		Suppress trailing newline\n"
+		"	-j <jobs>	Hash files on <jobs> threads (0: one per CPU)\n"
+		"	-b		Benchmark the available implementations\n"
 		"\n"
 		"Supported hash types:", progname);
 
@@ -772,53 +1235,15 @@ static struct hash_type *get_hash_type(const char *name)
 }
 
 
-static int hash_file(struct hash_type *t, const char *filename, bool add_filename,
-	bool no_newline)
-{
-	const char *str;
-
-	if (!filename || !strcmp(filename, "-")) {
-		str = t->func(stdin);
-	} else {
-		struct stat path_stat;
-		stat(filename, &path_stat);
-		if (S_ISDIR(path_stat.st_mode)) {
-			fprintf(stderr, "Failed to open '%s': Is a directory\n", filename);
-			return 1;
-		}
-
-		FILE *f = fopen(filename, "r");
-
-		if (!f) {
-			fprintf(stderr, "Failed to open '%s'\n", filename);
-			return 1;
-		}
-		str = t->func(f);
-		fclose(f);
-	}
-
-	if (!str) {
-		fprintf(stderr, "Failed to generate hash\n");
-		return 1;
-	}
-
-	if (add_filename)
-		printf("%s %s%s", str, filename ? filename : "-",
-			no_newline ? "" : "\n");
-	else
-		printf("%s%s", str, no_newline ? "" : "\n");
-	return 0;
-}
-
-
 int main(int argc, char **argv)
 {
 	struct hash_type *t;
 	const char *progname = argv[0];
-	int i, ch;
-	bool add_filename = false, no_newline = false;
+	char *stdin_file[] = { NULL };
+	int ch, jobs = 1;
+	bool add_filename = false, no_newline = false, bench = false;
 
-	while ((ch = getopt(argc, argv, "nN")) != -1) {
+	while ((ch = getopt(argc, argv, "nNj:b")) != -1) {
 		switch (ch) {
 		case 'n':
 			add_filename = true;
@@ -826,6 +1251,14 @@ int main(int argc, char **argv)
 		case 'N':
 			no_newline = true;
 			break;
+		case 'j':
+			jobs = atoi(optarg);
+			if (jobs <= 0)
+				jobs = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
+		case 'b':
+			bench = true;
+			break;
 		default:
 			return usage(progname);
 		}
@@ -841,14 +1274,13 @@ int main(int argc, char **argv)
 	if (!t)
 		return usage(progname);
 
-	if (argc < 2)
-		return hash_file(t, NULL, add_filename, no_newline);
+	SHA256_Select();
 
-	for (i = 0; i < argc - 1; i++) {
-		int ret = hash_file(t, argv[1 + i], add_filename, no_newline);
-		if (ret)
-			return ret;
-	}
+	if (bench)
+		return benchmark(t);
 
-	return 0;
+	if (argc < 2)
+		return hash_files(t, stdin_file, 1, 1, add_filename, no_newline);
+
+	return hash_files(t, argv + 1, argc - 1, jobs, add_filename, no_newline);
 }
@@ -0,0 +1,255 @@
+/*
+ * Just enough of the kernel API to build swconfig_leds.c on the host:
+ * jiffies only advance when the model says so, delayed work is a pending
+ * flag and an expiry time, and locks and RCU are no-ops as the model is
+ * single threaded.
+ */
+#ifndef __SWCONFIG_LED_SIM_SHIM_H
+#define __SWCONFIG_LED_SIM_SHIM_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#define IFNAMSIZ	16
+#define GFP_KERNEL	0
+#define HZ		250
+
+#define BIT(n)		(1UL << (n))
+#define min(a, b)	((a) < (b) ? (a) : (b))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+extern unsigned long jiffies;
+
+#define time_after(a, b)	((long)((b) - (a)) < 0)
+#define time_after_eq(a, b)	((long)((a) - (b)) >= 0)
+
+static inline unsigned int jiffies_to_msecs(unsigned long j)
+{
+	return j * 1000 / HZ;
+}
+
+static inline void *kzalloc(size_t size, int flags)
+{
+	return calloc(1, size);
+}
+
+#define kfree(p)	free(p)
+
+static inline int kstrtoul(const char *s, unsigned int base, unsigned long *res)
+{
+	char *end;
+
+	*res = strtoul(s, &end, base);
+	return end == s ? -EINVAL : 0;
+}
+
+static inline int kstrtou8(const char *s, unsigned int base, u8 *res)
+{
+	unsigned long val;
+	int ret = kstrtoul(s, base, &val);
+
+	*res = val;
+	return ret;
+}
+
+static inline void set_bit(int nr, unsigned long *addr)
+{
+	*addr |= BIT(nr);
+}
+
+static inline bool test_and_clear_bit(int nr, unsigned long *addr)
+{
+	bool ret = *addr & BIT(nr);
+
+	*addr &= ~BIT(nr);
+	return ret;
+}
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list->prev = list;
+}
+
+static inline void list_add_tail(struct list_head *entry, struct list_head *head)
+{
+	entry->prev = head->prev;
+	entry->next = head;
+	head->prev->next = entry;
+	head->prev = entry;
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+#define list_for_each(pos, head) \
+	for (pos = (head)->next; pos != (head); pos = pos->next)
+
+struct net_device;
+struct device_node;
+
+struct mutex { int unused; };
+typedef struct { int unused; } spinlock_t;
+typedef struct { int unused; } rwlock_t;
+
+#define spin_lock(l)		do { } while (0)
+#define spin_unlock(l)		do { } while (0)
+#define rwlock_init(l)		do { } while (0)
+#define read_lock(l)		do { } while (0)
+#define read_unlock(l)		do { } while (0)
+#define write_lock(l)		do { } while (0)
+#define write_unlock(l)		do { } while (0)
+
+#define __rcu
+#define rcu_read_lock()			do { } while (0)
+#define rcu_read_unlock()		do { } while (0)
+#define synchronize_rcu()		do { } while (0)
+#define rcu_dereference(p)		(p)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_assign_pointer(p, v)	((p) = (v))
+#define RCU_INIT_POINTER(p, v)		((p) = (v))
+
+struct work_struct {
+	void (*func)(struct work_struct *work);
+};
+
+struct delayed_work {
+	struct work_struct work;
+	bool pending;
+	unsigned long expires;
+};
+
+struct workqueue_struct;
+extern struct workqueue_struct *system_wq;
+
+#define INIT_DELAYED_WORK(w, f) \
+	do { (w)->work.func = (f); (w)->pending = false; } while (0)
+
+static inline bool schedule_delayed_work(struct delayed_work *w, unsigned long delay)
+{
+	if (w->pending)
+		return false;
+	w->pending = true;
+	w->expires = jiffies + delay;
+	return true;
+}
+
+static inline bool mod_delayed_work(struct workqueue_struct *wq,
+				    struct delayed_work *w, unsigned long delay)
+{
+	bool ret = w->pending;
+
+	w->pending = true;
+	w->expires = jiffies + delay;
+	return ret;
+}
+
+static inline bool cancel_delayed_work_sync(struct delayed_work *w)
+{
+	bool ret = w->pending;
+
+	w->pending = false;
+	return ret;
+}
+
+struct device {
+	void *driver_data;
+};
+
+struct device_attribute {
+	const char *name;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count);
+};
+
+#define DEVICE_ATTR(_name, _mode, _show, _store) \
+	struct device_attribute dev_attr_##_name = { #_name, _show, _store }
+
+static inline void *dev_get_drvdata(struct device *dev)
+{
+	return dev->driver_data;
+}
+
+static inline int device_create_file(struct device *dev,
+				     struct device_attribute *attr)
+{
+	return 0;
+}
+
+static inline void device_remove_file(struct device *dev,
+				      struct device_attribute *attr)
+{
+}
+
+enum led_brightness {
+	LED_OFF = 0,
+	LED_FULL = 255,
+};
+
+struct led_trigger;
+
+struct led_classdev {
+	struct device *dev;
+	struct led_trigger *trigger;
+	void *trigger_data;
+	struct list_head trig_list;
+	enum led_brightness brightness;
+};
+
+struct led_trigger {
+	const char *name;
+	int (*activate)(struct led_classdev *led_cdev);
+	void (*deactivate)(struct led_classdev *led_cdev);
+	spinlock_t leddev_list_lock;
+	struct list_head led_cdevs;
+};
+
+static inline void led_set_brightness(struct led_classdev *led_cdev,
+				      enum led_brightness brightness)
+{
+	led_cdev->brightness = brightness;
+}
+
+static inline int led_trigger_register(struct led_trigger *trig)
+{
+	INIT_LIST_HEAD(&trig->led_cdevs);
+	return 0;
+}
+
+/* as led_trigger_set(led_cdev, NULL): unlink first, then deactivate */
+static inline void led_trigger_unregister(struct led_trigger *trig)
+{
+	while (trig->led_cdevs.next != &trig->led_cdevs) {
+		struct led_classdev *led_cdev;
+
+		led_cdev = list_entry(trig->led_cdevs.next,
+				      struct led_classdev, trig_list);
+		list_del(&led_cdev->trig_list);
+		trig->deactivate(led_cdev);
+		led_cdev->trigger = NULL;
+		led_cdev->trigger_data = NULL;
+	}
+}
+
+#endif
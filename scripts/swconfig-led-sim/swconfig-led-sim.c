@@ -0,0 +1,213 @@
+/*
+ * Software switch model for the swconfig LED trigger
+ *
+ * Runs swconfig_leds.c against a modelled switch whose link reads cost as
+ * many MDIO transactions as on an ar8327: three for the port status
+ * register and, in get_port_link only, four for the EEE MMD register. One
+ * LED per port follows that port's link. The trigger is driven in virtual
+ * time while port 0 flaps, and the MDIO transactions and LED latency are
+ * reported per driver flavour.
+ *
+ * This is free software, licensed under the GNU General Public License v2.
+ */
+
+#include <stdio.h>
+
+#define CONFIG_SWCONFIG_LEDS
+#include <linux/switch.h>
+
+unsigned long jiffies;
+struct workqueue_struct *system_wq;
+
+#include "swconfig_leds.c"
+
+/* as in swconfig.c */
+void
+switch_port_link_changed(struct switch_dev *dev)
+{
+	swconfig_led_link_changed(dev);
+}
+
+#define SIM_PORTS		5
+#define SIM_STATUS_OPS		3	/* page select + 32 bit read */
+#define SIM_EEE_OPS		4	/* MMD read */
+
+struct sim_switch {
+	struct switch_dev dev;
+	struct switch_dev_ops ops;
+	bool link[SIM_PORTS];
+	struct device led_dev[SIM_PORTS];
+	struct led_classdev led[SIM_PORTS];
+};
+
+static int
+sim_read_link(struct switch_dev *dev, int port, struct switch_port_link *link)
+{
+	struct sim_switch *sw = container_of(dev, struct sim_switch, dev);
+
+	dev->mdio_ops += SIM_STATUS_OPS;
+	link->link = sw->link[port];
+	link->speed = SWITCH_PORT_SPEED_1000;
+	link->duplex = true;
+	return 0;
+}
+
+static int
+sim_get_port_link(struct switch_dev *dev, int port, struct switch_port_link *link)
+{
+	if (port >= SIM_PORTS)
+		return -EINVAL;
+
+	dev->mdio_ops += SIM_EEE_OPS;
+	return sim_read_link(dev, port, link);
+}
+
+static int
+sim_get_port_links(struct switch_dev *dev, u32 port_mask,
+		   struct switch_port_link *links)
+{
+	int i;
+
+	for (i = 0; i < SIM_PORTS; i++)
+		if (port_mask & BIT(i))
+			sim_read_link(dev, i, &links[i]);
+	return 0;
+}
+
+static void
+sim_setup(struct sim_switch *sw, bool bulk)
+{
+	char buf[16];
+	int i;
+
+	memset(sw, 0, sizeof(*sw));
+	sw->ops.get_port_link = sim_get_port_link;
+	if (bulk)
+		sw->ops.get_port_links = sim_get_port_links;
+	sw->dev.ops = &sw->ops;
+	strcpy(sw->dev.devname, "switch0");
+
+	if (swconfig_create_led_trigger(&sw->dev))
+		exit(1);
+
+	for (i = 0; i < SIM_PORTS; i++) {
+		struct led_classdev *led = &sw->led[i];
+
+		sw->link[i] = true;
+		sw->led_dev[i].driver_data = led;
+		led->dev = &sw->led_dev[i];
+		led->trigger = &sw->dev.led_trigger->trig;
+		list_add_tail(&led->trig_list, &led->trigger->led_cdevs);
+		if (led->trigger->activate(led))
+			exit(1);
+
+		dev_attr_mode.store(led->dev, &dev_attr_mode, "link", 4);
+		snprintf(buf, sizeof(buf), "%#lx", BIT(i));
+		dev_attr_port_mask.store(led->dev, &dev_attr_port_mask, buf,
+					 strlen(buf));
+	}
+}
+
+/*
+ * Run for @seconds, flapping port 0 every @flap seconds (0: never) and
+ * reporting the flaps through switch_port_link_changed() if @events.
+ * Returns the worst time in jiffies from a flap to the LED following it.
+ */
+static unsigned long
+sim_run(struct sim_switch *sw, int seconds, int flap, bool events)
+{
+	struct switch_led_trigger *sw_trig = sw->dev.led_trigger;
+	struct delayed_work *work = &sw_trig->sw_led_work;
+	unsigned long end = jiffies + seconds * HZ;
+	unsigned long next_flap = jiffies + flap * HZ;
+	unsigned long flapped = 0, latency = 0;
+	bool pending = false;
+
+	while (time_after(end, jiffies)) {
+		unsigned long next = end;
+
+		if (work->pending && time_after(next, work->expires))
+			next = work->expires;
+		if (flap && time_after(next, next_flap))
+			next = next_flap;
+		if (time_after(next, jiffies))
+			jiffies = next;
+
+		if (flap && jiffies == next_flap) {
+			sw->link[0] = !sw->link[0];
+			flapped = jiffies;
+			pending = true;
+			next_flap += flap * HZ;
+			if (events)
+				switch_port_link_changed(&sw->dev);
+			continue;
+		}
+
+		if (!work->pending || time_after(work->expires, jiffies))
+			continue;
+
+		work->pending = false;
+		work->work.func(&work->work);
+
+		if (pending && (sw->led[0].brightness != LED_OFF) == sw->link[0]) {
+			if (jiffies - flapped > latency)
+				latency = jiffies - flapped;
+			pending = false;
+		}
+	}
+
+	return latency;
+}
+
+static void
+sim_report(const char *name, bool bulk, bool events, int flap)
+{
+	struct sim_switch sw;
+	struct switch_led_trigger *sw_trig;
+	unsigned long latency, ops, polls;
+	const int seconds = 600;
+
+	jiffies = 0;
+	sim_setup(&sw, bulk);
+	sw_trig = sw.dev.led_trigger;
+
+	/* a driver with link events reports the first link coming up */
+	if (events)
+		switch_port_link_changed(&sw.dev);
+
+	/* let the interval settle before counting */
+	sim_run(&sw, 30, 0, false);
+	ops = sw_trig->mdio_ops;
+	polls = sw_trig->link_polls;
+
+	latency = sim_run(&sw, seconds, flap, events);
+
+	printf("%-26s %8.2f %10.2f %12u\n", name,
+	       (double)(sw_trig->link_polls - polls) / seconds,
+	       (double)(sw_trig->mdio_ops - ops) / seconds,
+	       jiffies_to_msecs(latency));
+
+	swconfig_destroy_led_trigger(&sw.dev);
+	/* a late event must not touch the freed trigger */
+	switch_port_link_changed(&sw.dev);
+}
+
+int main(int argc, char **argv)
+{
+	printf("%d ports with a link, HZ=%d, 600 s per run\n", SIM_PORTS, HZ);
+	printf("%-26s %8.2f %10.2f %12s\n", "fixed HZ/10 (before)",
+	       (double)HZ / SWCONFIG_LED_TIMER_INTERVAL,
+	       (double)HZ / SWCONFIG_LED_TIMER_INTERVAL * SIM_PORTS *
+	       (SIM_STATUS_OPS + SIM_EEE_OPS), "100");
+	printf("%-26s %8s %10s %12s\n", "", "polls/s", "mdio ops/s",
+	       "max led ms");
+
+	sim_report("get_port_link, stable", false, false, 0);
+	sim_report("get_port_links, stable", true, false, 0);
+	sim_report("get_port_links + events", true, true, 0);
+	sim_report("get_port_link, flap 30s", false, false, 30);
+	sim_report("get_port_links, flap 30s", true, false, 30);
+	sim_report("links + events, flap 30s", true, true, 30);
+
+	return 0;
+}
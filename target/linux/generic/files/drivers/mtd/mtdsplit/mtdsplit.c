@@ -15,7 +15,11 @@
 #include <linux/export.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/list.h>
 #include <linux/magic.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
 #include <linux/byteorder/generic.h>
@@ -24,6 +28,171 @@
 
 #define UBI_EC_MAGIC			0x55424923	/* UBI# */
 
+/*
+ * Number of bytes cached from the start of each eraseblock. This covers
+ * the headers and magics looked at by the parsers, which all probe the
+ * same eraseblocks of a firmware partition in turn.
+ */
+#define MTDSPLIT_EB_HEAD_SIZE		512
+
+struct mtdsplit_eb_cache {
+	struct list_head list;
+	struct mtd_info *mtd;
+	u32 n_ebs;
+	u8 *heads[];
+};
+
+static LIST_HEAD(mtdsplit_caches);
+static DEFINE_MUTEX(mtdsplit_cache_lock);
+/* the cache is only used while partitions are parsed at boot */
+static bool mtdsplit_cache_enabled = true;
+static u64 mtdsplit_bytes_read;
+static u64 mtdsplit_bytes_cached;
+
+static void mtdsplit_free_cache(struct mtdsplit_eb_cache *c)
+{
+	u32 i;
+
+	list_del(&c->list);
+	for (i = 0; i < c->n_ebs; i++)
+		kfree(c->heads[i]);
+	kvfree(c);
+}
+
+static struct mtdsplit_eb_cache *mtdsplit_get_cache(struct mtd_info *mtd)
+{
+	struct mtdsplit_eb_cache *c;
+	u32 n_ebs;
+
+	lockdep_assert_held(&mtdsplit_cache_lock);
+
+	list_for_each_entry(c, &mtdsplit_caches, list)
+		if (c->mtd == mtd)
+			return c;
+
+	if (!mtdsplit_cache_enabled ||
+	    mtd->erasesize < MTDSPLIT_EB_HEAD_SIZE)
+		return NULL;
+
+	n_ebs = mtd_div_by_eb(mtd->size, mtd);
+	c = kvzalloc(struct_size(c, heads, n_ebs), GFP_KERNEL);
+	if (!c)
+		return NULL;
+
+	c->mtd = mtd;
+	c->n_ebs = n_ebs;
+	list_add(&c->list, &mtdsplit_caches);
+
+	return c;
+}
+
+int mtdsplit_read(struct mtd_info *mtd, loff_t from, size_t len,
+		  size_t *retlen, u_char *buf)
+{
+	struct mtdsplit_eb_cache *c;
+	size_t head_len;
+	u32 eb, ofs;
+	u8 *head;
+	int ret;
+
+	if (from < 0 || from + len > mtd->size)
+		goto direct;
+
+	ofs = mtd_mod_by_eb(from, mtd);
+	if (ofs + len > MTDSPLIT_EB_HEAD_SIZE)
+		goto direct;
+
+	mutex_lock(&mtdsplit_cache_lock);
+	c = mtdsplit_get_cache(mtd);
+	eb = mtd_div_by_eb(from, mtd);
+	if (!c || eb >= c->n_ebs)
+		goto unlock_direct;
+
+	head = c->heads[eb];
+	if (!head) {
+		head = kmalloc(MTDSPLIT_EB_HEAD_SIZE, GFP_KERNEL);
+		if (!head)
+			goto unlock_direct;
+
+		ret = mtd_read(mtd, from - ofs, MTDSPLIT_EB_HEAD_SIZE,
+			       &head_len, head);
+		mtdsplit_bytes_read += head_len;
+		if (ret || head_len != MTDSPLIT_EB_HEAD_SIZE) {
+			kfree(head);
+			goto unlock_direct;
+		}
+
+		c->heads[eb] = head;
+	}
+
+	memcpy(buf, head + ofs, len);
+	*retlen = len;
+	mtdsplit_bytes_cached += len;
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	return 0;
+
+unlock_direct:
+	mutex_unlock(&mtdsplit_cache_lock);
+direct:
+	ret = mtd_read(mtd, from, len, retlen, buf);
+	mutex_lock(&mtdsplit_cache_lock);
+	mtdsplit_bytes_read += *retlen;
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mtdsplit_read);
+
+static void mtdsplit_notify_add(struct mtd_info *mtd)
+{
+}
+
+static void mtdsplit_notify_remove(struct mtd_info *mtd)
+{
+	struct mtdsplit_eb_cache *c;
+
+	mutex_lock(&mtdsplit_cache_lock);
+	list_for_each_entry(c, &mtdsplit_caches, list) {
+		if (c->mtd != mtd)
+			continue;
+
+		mtdsplit_free_cache(c);
+		break;
+	}
+	mutex_unlock(&mtdsplit_cache_lock);
+}
+
+static struct mtd_notifier mtdsplit_notifier = {
+	.add = mtdsplit_notify_add,
+	.remove = mtdsplit_notify_remove,
+};
+
+static int __init mtdsplit_cache_init(void)
+{
+	register_mtd_user(&mtdsplit_notifier);
+
+	return 0;
+}
+subsys_initcall(mtdsplit_cache_init);
+
+static int __init mtdsplit_cache_cleanup(void)
+{
+	struct mtdsplit_eb_cache *c, *tmp;
+
+	mutex_lock(&mtdsplit_cache_lock);
+	mtdsplit_cache_enabled = false;
+	list_for_each_entry_safe(c, tmp, &mtdsplit_caches, list)
+		mtdsplit_free_cache(c);
+
+	pr_debug("partition parsing read %llu bytes from flash, %llu bytes served from cache\n",
+		 mtdsplit_bytes_read, mtdsplit_bytes_cached);
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	return 0;
+}
+late_initcall_sync(mtdsplit_cache_cleanup);
+
 struct squashfs_super_block {
 	__le32 s_magic;
 	__le32 pad0[9];
@@ -38,7 +207,7 @@ int mtd_get_squashfs_len(struct mtd_info *master,
 	size_t retlen;
 	int err;
 
-	err = mtd_read(master, offset, sizeof(sb), &retlen, (void *)&sb);
+	err = mtdsplit_read(master, offset, sizeof(sb), &retlen, (void *)&sb);
 	if (err || (retlen != sizeof(sb))) {
 		pr_alert("error occured while reading from \"%s\"\n",
 			 master->name);
@@ -79,8 +248,8 @@ int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 	size_t retlen;
 	int ret;
 
-	ret = mtd_read(mtd, offset, sizeof(magic), &retlen,
-		       (unsigned char *) &magic);
+	ret = mtdsplit_read(mtd, offset, sizeof(magic), &retlen,
+			    (unsigned char *) &magic);
 	if (ret)
 		return ret;
 
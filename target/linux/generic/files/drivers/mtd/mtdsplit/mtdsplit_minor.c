@@ -62,7 +62,7 @@ static int mtdsplit_parse_minor(struct mtd_info *master,
 	int err;
 
 	hdr_len = sizeof(hdr);
-	err = mtd_read(master, 0, hdr_len, &retlen, (void *) &hdr);
+	err = mtdsplit_read(master, 0, hdr_len, &retlen, (void *) &hdr);
 	if (err) {
 		pr_err("MiNOR mtd_read error: %d\n", err);
 		return err;
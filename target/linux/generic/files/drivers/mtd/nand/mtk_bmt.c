@@ -92,15 +92,111 @@ bool mapping_block_in_range(int block, int *start, int *end)
 	return false;
 }
 
+/* -------- Remap cache -------- */
+static void mtk_bmt_invalidate_cache(void)
+{
+	int i;
+
+	if (!bmtd.remap_cache)
+		return;
+
+	/*
+	 * A remap may shift the mapping of other blocks too (e.g. bbt skips
+	 * bad blocks within a range), so drop all cached entries. Lookups
+	 * read the entries without the lock, hence WRITE_ONCE.
+	 */
+	spin_lock(&bmtd.remap_lock);
+	bmtd.remap_gen++;
+	for (i = 0; i < bmtd.total_blks; i++)
+		WRITE_ONCE(bmtd.remap_cache[i], BMT_REMAP_INVALID);
+	spin_unlock(&bmtd.remap_lock);
+}
+
+static int mtk_bmt_get_mapping_block(int block)
+{
+	u32 gen;
+	int mapped;
+
+	bmtd.stats.remap_lookups++;
+
+	if (!bmtd.remap_cache || block < 0 || block >= bmtd.total_blks)
+		return bmtd.ops->get_mapping_block(block);
+
+	mapped = READ_ONCE(bmtd.remap_cache[block]);
+	if (mapped != BMT_REMAP_INVALID)
+		return mapped;
+
+	bmtd.stats.remap_misses++;
+	gen = READ_ONCE(bmtd.remap_gen);
+	mapped = bmtd.ops->get_mapping_block(block);
+
+	/* a remap that ran during the lookup may have made it stale */
+	spin_lock(&bmtd.remap_lock);
+	if (mapped >= 0 && gen == bmtd.remap_gen)
+		WRITE_ONCE(bmtd.remap_cache[block], mapped);
+	spin_unlock(&bmtd.remap_lock);
+
+	return mapped;
+}
+
+static void mtk_bmt_init_cache(void)
+{
+	int blocks = bmtd.mtd->size >> bmtd.blk_shift;
+	int i;
+
+	bmtd.remap_cache = kvmalloc_array(bmtd.total_blks,
+					  sizeof(*bmtd.remap_cache),
+					  GFP_KERNEL);
+	if (!bmtd.remap_cache)
+		return;
+
+	spin_lock_init(&bmtd.remap_lock);
+	mtk_bmt_invalidate_cache();
+	for (i = 0; i < blocks; i++)
+		mtk_bmt_get_mapping_block(i);
+
+	memset(&bmtd.stats, 0, sizeof(bmtd.stats));
+}
+
 static bool
 mtk_bmt_remap_block(u32 block, u32 mapped_block, int copy_len)
 {
 	int start, end;
+	bool ret;
 
 	if (!mapping_block_in_range(block, &start, &end))
 		return false;
 
-	return bmtd.ops->remap_block(block, mapped_block, copy_len);
+	ret = bmtd.ops->remap_block(block, mapped_block, copy_len);
+	mtk_bmt_invalidate_cache();
+
+	return ret;
+}
+
+static void
+mtk_bmt_unmap_block(u16 block)
+{
+	bmtd.ops->unmap_block(block);
+	mtk_bmt_invalidate_cache();
+}
+
+/*
+ * Number of blocks following @block that are mapped to the physically
+ * following blocks of @cur_block and can be read in one go.
+ */
+static int
+mtk_bmt_contiguous_blocks(u32 block, int cur_block, u32 len)
+{
+	u32 blocks = bmtd.mtd->size >> bmtd.blk_shift;
+	int n = 0;
+
+	while (len > bmtd.blk_size * n && block + n + 1 < blocks) {
+		if (mtk_bmt_get_mapping_block(block + n + 1) != cur_block + n + 1)
+			break;
+		n++;
+	}
+
+	return n;
 }
 
 static int
@@ -109,6 +205,7 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 {
 	struct mtd_oob_ops cur_ops = *ops;
 	int retry_count = 0;
+	bool no_merge = false;
 	loff_t cur_from;
 	int ret = 0;
 	int max_bitflips = 0;
@@ -122,8 +219,9 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 		u32 offset = from & (bmtd.blk_size - 1);
 		u32 block = from >> bmtd.blk_shift;
 		int cur_block;
+		int merged = 0;
 
-		cur_block = bmtd.ops->get_mapping_block(block);
+		cur_block = mtk_bmt_get_mapping_block(block);
 		if (cur_block < 0)
 			return -EIO;
 
@@ -133,7 +231,35 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 		cur_ops.retlen = 0;
 		cur_ops.len = min_t(u32, mtd->erasesize - offset,
 					 ops->len - ops->retlen);
+
+		/* read physically contiguous blocks with a single request */
+		if (cur_ops.len && !no_merge)
+			merged = mtk_bmt_contiguous_blocks(block, cur_block,
+					ops->len - ops->retlen - cur_ops.len);
+		if (merged)
+			cur_ops.len = min_t(size_t,
+					    cur_ops.len + merged * bmtd.blk_size,
+					    ops->len - ops->retlen);
+
 		cur_ret = bmtd._read_oob(mtd, cur_from, &cur_ops);
+
+		/*
+		 * Errors and bitflips have to be attributed to a single block,
+		 * so redo the request block by block.
+		 */
+		if (merged &&
+		    ((cur_ret < 0 && !mtd_is_bitflip(cur_ret)) ||
+		     (mtd->bitflip_threshold &&
+		      cur_ret >= mtd->bitflip_threshold))) {
+			no_merge = true;
+			continue;
+		}
+
+		if (merged) {
+			bmtd.stats.merged_reads++;
+			bmtd.stats.merged_blocks += merged;
+		}
+
 		if (cur_ret < 0)
 			ret = cur_ret;
 		else
@@ -162,6 +288,7 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 
 		from += cur_ops.len;
 		retry_count = 0;
+		no_merge = false;
 	}
 
 out:
@@ -188,7 +315,7 @@ mtk_bmt_write(struct mtd_info *mtd, loff_t to,
 		u32 block = to >> bmtd.blk_shift;
 		int cur_block;
 
-		cur_block = bmtd.ops->get_mapping_block(block);
+		cur_block = mtk_bmt_get_mapping_block(block);
 		if (cur_block < 0)
 			return -EIO;
 
@@ -242,7 +369,7 @@ mtk_bmt_mtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 
 	while (start_addr < end_addr) {
 		orig_block = start_addr >> bmtd.blk_shift;
-		block = bmtd.ops->get_mapping_block(orig_block);
+		block = mtk_bmt_get_mapping_block(orig_block);
 		if (block < 0)
 			return -EIO;
 		mapped_instr.addr = (loff_t)block << bmtd.blk_shift;
@@ -269,7 +396,7 @@ mtk_bmt_block_isbad(struct mtd_info *mtd, loff_t ofs)
 	int ret;
 
 retry:
-	block = bmtd.ops->get_mapping_block(orig_block);
+	block = mtk_bmt_get_mapping_block(orig_block);
 	ret = bmtd._block_isbad(mtd, (loff_t)block << bmtd.blk_shift);
 	if (ret) {
 		if (mtk_bmt_remap_block(orig_block, block, bmtd.blk_size) &&
@@ -285,7 +412,7 @@ mtk_bmt_block_markbad(struct mtd_info *mtd, loff_t ofs)
 	u16 orig_block = ofs >> bmtd.blk_shift;
 	int block;
 
-	block = bmtd.ops->get_mapping_block(orig_block);
+	block = mtk_bmt_get_mapping_block(orig_block);
 	if (block < 0)
 		return -EIO;
 
@@ -315,12 +442,12 @@ static int mtk_bmt_debug_repair(void *data, u64 val)
 	int block = val >> bmtd.blk_shift;
 	int prev_block, new_block;
 
-	prev_block = bmtd.ops->get_mapping_block(block);
+	prev_block = mtk_bmt_get_mapping_block(block);
 	if (prev_block < 0)
 		return -EIO;
 
-	bmtd.ops->unmap_block(block);
-	new_block = bmtd.ops->get_mapping_block(block);
+	mtk_bmt_unmap_block(block);
+	new_block = mtk_bmt_get_mapping_block(block);
 	if (new_block < 0)
 		return -EIO;
 
@@ -335,7 +462,7 @@ static int mtk_bmt_debug_repair(void *data, u64 val)
 
 static int mtk_bmt_debug_mark_good(void *data, u64 val)
 {
-	bmtd.ops->unmap_block(val >> bmtd.blk_shift);
+	mtk_bmt_unmap_block(val >> bmtd.blk_shift);
 
 	return 0;
 }
@@ -345,7 +472,7 @@ static int mtk_bmt_debug_mark_bad(void *data, u64 val)
 	u32 block = val >> bmtd.blk_shift;
 	int cur_block;
 
-	cur_block = bmtd.ops->get_mapping_block(block);
+	cur_block = mtk_bmt_get_mapping_block(block);
 	if (cur_block < 0)
 		return -EIO;
 
@@ -356,7 +483,12 @@ static int mtk_bmt_debug_mark_bad(void *data, u64 val)
 
 static int mtk_bmt_debug(void *data, u64 val)
 {
-	return bmtd.ops->debug(data, val);
+	int ret;
+
+	ret = bmtd.ops->debug(data, val);
+	mtk_bmt_invalidate_cache();
+
+	return ret;
 }
 
 
@@ -378,6 +510,15 @@ mtk_bmt_add_debugfs(void)
 	debugfs_create_file_unsafe("mark_good", S_IWUSR, dir, NULL, &fops_mark_good);
 	debugfs_create_file_unsafe("mark_bad", S_IWUSR, dir, NULL, &fops_mark_bad);
 	debugfs_create_file_unsafe("debug", S_IWUSR, dir, NULL, &fops_debug);
+
+	debugfs_create_u64("remap_lookups", S_IRUSR, dir,
+			   &bmtd.stats.remap_lookups);
+	debugfs_create_u64("remap_misses", S_IRUSR, dir,
+			   &bmtd.stats.remap_misses);
+	debugfs_create_u64("merged_reads", S_IRUSR, dir,
+			   &bmtd.stats.merged_reads);
+	debugfs_create_u64("merged_blocks", S_IRUSR, dir,
+			   &bmtd.stats.merged_blocks);
 }
 
 void mtk_bmt_detach(struct mtd_info *mtd)
@@ -391,6 +532,7 @@ void mtk_bmt_detach(struct mtd_info *mtd)
 
 	kfree(bmtd.bbt_buf);
 	kfree(bmtd.data_buf);
+	kvfree(bmtd.remap_cache);
 
 	mtd->_read_oob = bmtd._read_oob;
 	mtd->_write_oob = bmtd._write_oob;
@@ -459,6 +601,7 @@ int mtk_bmt_attach(struct mtd_info *mtd)
 	if (ret)
 		goto error;
 
+	mtk_bmt_init_cache();
 	mtk_bmt_add_debugfs();
 	return 0;
 
@@ -7,6 +7,7 @@
 #include <linux/mtd/partitions.h>
 #include <linux/mtd/mtk_bmt.h>
 #include <linux/debugfs.h>
+#include <linux/spinlock.h>
 
 #define MAIN_SIGNATURE_OFFSET   0
 #define OOB_SIGNATURE_OFFSET    1
@@ -71,8 +72,23 @@ struct bmt_desc {
 
 	/* to compensate for driver level remapping */
 	u8 oob_offset;
+
+	/* logical to physical block cache, BMT_REMAP_INVALID if not cached */
+	u16 *remap_cache;
+	/* bumped by every invalidation, fills started before it are dropped */
+	u32 remap_gen;
+	spinlock_t remap_lock;
+
+	struct {
+		u64 remap_lookups;
+		u64 remap_misses;
+		u64 merged_reads;
+		u64 merged_blocks;
+	} stats;
 };
 
+#define BMT_REMAP_INVALID	0xffff
+
 extern struct bmt_desc bmtd;
 extern const struct mtk_bmt_ops mtk_bmt_v2_ops;
 extern const struct mtk_bmt_ops mtk_bmt_bbt_ops;
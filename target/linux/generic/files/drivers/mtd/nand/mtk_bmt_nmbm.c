@@ -1,4 +1,5 @@
 #include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include "mtk_bmt.h"
 
@@ -111,6 +112,9 @@ struct nmbm_instance {
 	u32 max_reserved_blocks;
 	bool empty_page_ecc_ok;
 	bool force_create;
+
+	/* number of pages read from the lower device */
+	u32 page_reads;
 };
 
 static inline u32 nmbm_crc32(u32 crcval, const void *buf, size_t size)
@@ -245,6 +249,7 @@ static int nmbm_read_phys_page(struct nmbm_instance *ni, uint64_t addr,
 		if (oob)
 			ops.ooblen = mtd_oobavail(bmtd.mtd, &ops);
 
+		ni->page_reads++;
 		ret = bmtd._read_oob(bmtd.mtd, addr, &ops);
 		if (ret == -EUCLEAN)
 			return min_t(u32, bmtd.mtd->bitflip_threshold + 1,
@@ -1754,6 +1759,7 @@ static bool nmbm_try_load_info_table(struct nmbm_instance *ni, uint32_t ba,
 	uint8_t *off = ni->info_table_cache;
 	uint32_t limit = ba + size2blk(ni, ni->info_table_size);
 	uint32_t start_ba = 0, chunksize, sizeremain = ni->info_table_size;
+	uint32_t probed;
 	bool success, checkhdr = true;
 	int ret;
 
@@ -1770,18 +1776,35 @@ static bool nmbm_try_load_info_table(struct nmbm_instance *ni, uint32_t ba,
 		if (chunksize > bmtd.blk_size)
 			chunksize = bmtd.blk_size;
 
-		/* Assume block with ECC error has no info table data */
-		ret = nmbn_read_data(ni, ba2addr(ni, ba), off, chunksize);
+		/*
+		 * Check the header page first, most blocks probed while
+		 * searching do not hold a table and need no further reads.
+		 * Assume block with ECC error has no info table data.
+		 */
+		probed = 0;
+		if (checkhdr) {
+			ret = nmbn_read_data(ni, ba2addr(ni, ba), off,
+					     bmtd.pg_size);
+			if (ret < 0)
+				goto skip_bad_block;
+			else if (ret > 0)
+				return false;
+
+			success = nmbm_check_info_table_header(ni, off);
+			if (!success)
+				return false;
+
+			probed = bmtd.pg_size;
+		}
+
+		ret = nmbn_read_data(ni, ba2addr(ni, ba) + probed, off + probed,
+				     chunksize - probed);
 		if (ret < 0)
 			goto skip_bad_block;
 		else if (ret > 0)
 			return false;
 
 		if (checkhdr) {
-			success = nmbm_check_info_table_header(ni, off);
-			if (!success)
-				return false;
-
 			start_ba = ba;
 			checkhdr = false;
 		}
@@ -1838,6 +1861,12 @@ static bool nmbm_try_load_info_table(struct nmbm_instance *ni, uint32_t ba,
  * @write_count: return the write count of this table
  * @mapping_blocks_top_ba: return the block address of top remapped block
  * @table_loaded: used to record whether ni->info_table has valid data
+ *
+ * The search is sequential on purpose. All reads go through the single
+ * lower MTD device, which serializes them on the chip lock, so splitting
+ * the range between workers would only queue the same page reads. Each
+ * block without a table costs one header page read, see
+ * nmbm_try_load_info_table().
  */
 static bool nmbm_search_info_table(struct nmbm_instance *ni, uint32_t ba,
 				   uint32_t limit, uint32_t *table_start_ba,
@@ -2165,6 +2194,7 @@ static void nmbm_init_structure(struct nmbm_instance *ni)
  */
 static int nmbm_attach(struct nmbm_instance *ni)
 {
+	ktime_t start = ktime_get();
 	bool success;
 
 	if (!ni)
@@ -2209,6 +2239,9 @@ static int nmbm_attach(struct nmbm_instance *ni)
 	if (!success)
 		return -ENODEV;
 
+	nlog_info(ni, "NMBM attached in %lld ms, %u pages read\n",
+		  ktime_ms_delta(ktime_get(), start), ni->page_reads);
+
 	return 0;
 }
 
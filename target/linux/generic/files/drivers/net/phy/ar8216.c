@@ -225,6 +225,7 @@ ar8xxx_mii_read32(struct ar8xxx_priv *priv, int phy_id, int regnum)
 
 	lo = bus->read(bus, phy_id, regnum);
 	hi = bus->read(bus, phy_id, regnum + 1);
+	priv->dev.mdio_ops += 2;
 
 	return (hi << 16) | lo;
 }
@@ -237,6 +238,7 @@ ar8xxx_mii_write32(struct ar8xxx_priv *priv, int phy_id, int regnum, u32 val)
 
 	lo = val & 0xffff;
 	hi = (u16) (val >> 16);
+	priv->dev.mdio_ops += 2;
 
 	if (priv->chip->mii_lo_first)
 	{
@@ -260,6 +262,7 @@ ar8xxx_read(struct ar8xxx_priv *priv, int reg)
 	mutex_lock(&bus->mdio_lock);
 
 	bus->write(bus, 0x18, 0, page);
+	priv->dev.mdio_ops++;
 	wait_for_page_switch();
 	val = ar8xxx_mii_read32(priv, 0x10 | r2, r1);
 
@@ -279,6 +282,7 @@ ar8xxx_write(struct ar8xxx_priv *priv, int reg, u32 val)
 	mutex_lock(&bus->mdio_lock);
 
 	bus->write(bus, 0x18, 0, page);
+	priv->dev.mdio_ops++;
 	wait_for_page_switch();
 	ar8xxx_mii_write32(priv, 0x10 | r2, r1, val);
 
@@ -297,6 +301,7 @@ ar8xxx_rmw(struct ar8xxx_priv *priv, int reg, u32 mask, u32 val)
 	mutex_lock(&bus->mdio_lock);
 
 	bus->write(bus, 0x18, 0, page);
+	priv->dev.mdio_ops++;
 	wait_for_page_switch();
 
 	ret = ar8xxx_mii_read32(priv, 0x10 | r2, r1);
@@ -317,6 +322,7 @@ ar8xxx_phy_dbg_read(struct ar8xxx_priv *priv, int phy_addr,
        mutex_lock(&bus->mdio_lock);
        bus->write(bus, phy_addr, MII_ATH_DBG_ADDR, dbg_addr);
        *dbg_data = bus->read(bus, phy_addr, MII_ATH_DBG_DATA);
+       priv->dev.mdio_ops += 2;
        mutex_unlock(&bus->mdio_lock);
 }
 
@@ -329,6 +335,7 @@ ar8xxx_phy_dbg_write(struct ar8xxx_priv *priv, int phy_addr,
 	mutex_lock(&bus->mdio_lock);
 	bus->write(bus, phy_addr, MII_ATH_DBG_ADDR, dbg_addr);
 	bus->write(bus, phy_addr, MII_ATH_DBG_DATA, dbg_data);
+	priv->dev.mdio_ops += 2;
 	mutex_unlock(&bus->mdio_lock);
 }
 
@@ -348,6 +355,7 @@ ar8xxx_phy_mmd_write(struct ar8xxx_priv *priv, int phy_addr, u16 addr, u16 reg,
 	mutex_lock(&bus->mdio_lock);
 	ar8xxx_phy_mmd_prep(bus, phy_addr, addr, reg);
 	bus->write(bus, phy_addr, MII_ATH_MMD_DATA, data);
+	priv->dev.mdio_ops += 4;
 	mutex_unlock(&bus->mdio_lock);
 }
 
@@ -360,6 +368,7 @@ ar8xxx_phy_mmd_read(struct ar8xxx_priv *priv, int phy_addr, u16 addr, u16 reg)
 	mutex_lock(&bus->mdio_lock);
 	ar8xxx_phy_mmd_prep(bus, phy_addr, addr, reg);
 	data = bus->read(bus, phy_addr, MII_ATH_MMD_DATA);
+	priv->dev.mdio_ops += 4;
 	mutex_unlock(&bus->mdio_lock);
 
 	return data;
@@ -458,8 +467,8 @@ ar8xxx_mib_fetch_port_stat(struct ar8xxx_priv *priv, int port, bool flush)
 }
 
 static void
-ar8216_read_port_link(struct ar8xxx_priv *priv, int port,
-		      struct switch_port_link *link)
+__ar8216_read_port_link(struct ar8xxx_priv *priv, int port,
+			struct switch_port_link *link, bool eee)
 {
 	u32 status;
 	u32 speed;
@@ -490,7 +499,8 @@ ar8216_read_port_link(struct ar8xxx_priv *priv, int port,
 	link->tx_flow = !!(status & AR8216_PORT_STATUS_TXFLOW);
 	link->rx_flow = !!(status & AR8216_PORT_STATUS_RXFLOW);
 
-	if (link->aneg && link->duplex && priv->chip->read_port_eee_status)
+	if (eee && link->aneg && link->duplex &&
+	    priv->chip->read_port_eee_status)
 		link->eee = priv->chip->read_port_eee_status(priv, port);
 
 	speed = (status & AR8216_PORT_STATUS_SPEED) >>
@@ -512,6 +522,13 @@ ar8216_read_port_link(struct ar8xxx_priv *priv, int port,
 	}
 }
 
+static void
+ar8216_read_port_link(struct ar8xxx_priv *priv, int port,
+		      struct switch_port_link *link)
+{
+	__ar8216_read_port_link(priv, port, link, true);
+}
+
 #ifdef CONFIG_ETHERNET_PACKET_MANGLE
 
 static struct sk_buff *
@@ -1242,6 +1259,21 @@ ar8xxx_sw_get_port_link(struct switch_dev *dev, int port,
 	return 0;
 }
 
+/* for the LED trigger: leaves out the EEE state, an MMD read per port */
+int
+ar8xxx_sw_get_port_links(struct switch_dev *dev, u32 port_mask,
+			 struct switch_port_link *links)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	int i;
+
+	for (i = 0; i < dev->ports; i++)
+		if (port_mask & BIT(i))
+			__ar8216_read_port_link(priv, i, &links[i], false);
+
+	return 0;
+}
+
 static int
 ar8xxx_sw_get_ports(struct switch_dev *dev, struct switch_val *val)
 {
@@ -1910,6 +1942,40 @@ ar8xxx_sw_get_port_stats(struct switch_dev *dev, int port,
 	return 0;
 }
 
+int
+ar8xxx_sw_get_port_mib_snapshot(struct switch_dev *dev, int port,
+				u64 *counters, unsigned long *stamp)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	unsigned int num_mibs = priv->chip->num_mibs;
+
+	/* the snapshot is only kept up to date by the MIB work */
+	if (!ar8xxx_has_mib_counters(priv) || !priv->mib_poll_interval)
+		return -EOPNOTSUPP;
+
+	if (port >= dev->ports)
+		return -EINVAL;
+
+	mutex_lock(&priv->mib_lock);
+	memcpy(counters, &priv->mib_stats[port * num_mibs],
+	       num_mibs * sizeof(*counters));
+	*stamp = priv->mib_stamp;
+	mutex_unlock(&priv->mib_lock);
+
+	return 0;
+}
+
+const char *
+ar8xxx_sw_get_mib_name(struct switch_dev *dev, int idx)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+
+	if (idx >= priv->chip->num_mibs)
+		return NULL;
+
+	return priv->chip->mib_decs[idx].name;
+}
+
 static int
 ar8xxx_phy_read(struct mii_bus *bus, int phy_addr, int reg_addr)
 {
@@ -2054,7 +2120,10 @@ static const struct switch_dev_ops ar8xxx_sw_ops = {
 	.apply_config = ar8xxx_sw_hw_apply,
 	.reset_switch = ar8xxx_sw_reset_switch,
 	.get_port_link = ar8xxx_sw_get_port_link,
+	.get_port_links = ar8xxx_sw_get_port_links,
 	.get_port_stats = ar8xxx_sw_get_port_stats,
+	.get_port_mib = ar8xxx_sw_get_port_mib_snapshot,
+	.get_mib_name = ar8xxx_sw_get_mib_name,
 };
 
 static const struct ar8xxx_chip ar7240sw_chip = {
@@ -2302,6 +2371,8 @@ ar8xxx_mib_work_func(struct work_struct *work)
 	for (i = 0; i < priv->dev.ports; i++)
 		ar8xxx_mib_fetch_port_stat(priv, i, false);
 
+	priv->mib_stamp = jiffies;
+
 next_attempt:
 	mutex_unlock(&priv->mib_lock);
 	schedule_delayed_work(&priv->mib_work,
@@ -2325,6 +2396,9 @@ ar8xxx_mib_init(struct ar8xxx_priv *priv)
 	if (!priv->mib_stats)
 		return -ENOMEM;
 
+	priv->dev.mibs = priv->chip->num_mibs;
+	priv->mib_stamp = jiffies;
+
 	return 0;
 }
 
@@ -2492,6 +2566,9 @@ ar8xxx_check_link_states(struct ar8xxx_priv *priv)
 
 	mutex_unlock(&priv->reg_mutex);
 
+	if (changed)
+		switch_port_link_changed(&priv->dev);
+
 	return changed;
 }
 
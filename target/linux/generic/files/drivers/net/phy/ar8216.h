@@ -499,6 +499,7 @@ struct ar8xxx_priv {
 	struct mutex mib_lock;
 	struct delayed_work mib_work;
 	u64 *mib_stats;
+	unsigned long mib_stamp;
 	u32 mib_poll_interval;
 	u8 mib_type;
 
@@ -617,6 +618,9 @@ int
 ar8xxx_sw_get_port_link(struct switch_dev *dev, int port,
 			struct switch_port_link *link);
 int
+ar8xxx_sw_get_port_links(struct switch_dev *dev, u32 port_mask,
+			 struct switch_port_link *links);
+int
 ar8xxx_sw_set_port_reset_mib(struct switch_dev *dev,
                              const struct switch_attr *attr,
                              struct switch_val *val);
@@ -648,6 +652,11 @@ int
 ar8xxx_sw_get_port_stats(struct switch_dev *dev, int port,
 			struct switch_port_stats *stats);
 int
+ar8xxx_sw_get_port_mib_snapshot(struct switch_dev *dev, int port,
+				u64 *counters, unsigned long *stamp);
+const char *
+ar8xxx_sw_get_mib_name(struct switch_dev *dev, int idx);
+int
 ar8216_wait_bit(struct ar8xxx_priv *priv, int reg, u32 mask, u32 val);
 
 static inline struct ar8xxx_priv *
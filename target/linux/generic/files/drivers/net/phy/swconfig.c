@@ -279,6 +279,8 @@ static const struct nla_policy switch_policy[SWITCH_ATTR_MAX+1] = {
 	[SWITCH_ATTR_OP_VALUE_STR] = { .type = NLA_NUL_STRING },
 	[SWITCH_ATTR_OP_VALUE_PORTS] = { .type = NLA_NESTED },
 	[SWITCH_ATTR_TYPE] = { .type = NLA_U32 },
+	[SWITCH_ATTR_OP_VALUE_MIB] = { .type = NLA_BINARY },
+	[SWITCH_ATTR_OP_MIB_NAMES] = { .type = NLA_NESTED },
 };
 
 static const struct nla_policy port_policy[SWITCH_PORT_ATTR_MAX+1] = {
@@ -305,7 +307,7 @@ swconfig_unlock(void)
 }
 
 static struct switch_dev *
-swconfig_get_dev(struct genl_info *info)
+swconfig_get_dev(const struct genl_info *info)
 {
 	struct switch_dev *dev = NULL;
 	struct switch_dev *p;
@@ -981,6 +983,113 @@ static int swconfig_dump_switches(struct sk_buff *skb,
 	return skb->len;
 }
 
+static int
+swconfig_send_mib_names(struct sk_buff *msg, struct switch_dev *dev)
+{
+	struct nlattr *p;
+	const char *name;
+	int i;
+
+	p = nla_nest_start(msg, SWITCH_ATTR_OP_MIB_NAMES);
+	if (!p)
+		return -EMSGSIZE;
+
+	for (i = 0; i < dev->mibs; i++) {
+		name = dev->ops->get_mib_name(dev, i);
+		if (nla_put_string(msg, SWITCH_ATTR_OP_NAME, name ? name : ""))
+			goto nla_put_failure;
+	}
+	nla_nest_end(msg, p);
+
+	return 0;
+
+nla_put_failure:
+	nla_nest_cancel(msg, p);
+	return -EMSGSIZE;
+}
+
+static int
+swconfig_send_port_mib(struct sk_buff *msg, u32 pid, u32 seq,
+		       struct switch_dev *dev, int port)
+{
+	struct switch_mib_record *rec;
+	struct nlattr *nla;
+	unsigned long stamp = jiffies;
+	void *hdr;
+	int err;
+
+	hdr = genlmsg_put(msg, pid, seq, &switch_fam, NLM_F_MULTI,
+			SWITCH_CMD_GET_PORT_MIB);
+	if (!hdr)
+		return -EMSGSIZE;
+
+	if (nla_put_u32(msg, SWITCH_ATTR_OP_PORT, port))
+		goto nla_put_failure;
+
+	/* counter names only go out with the first record */
+	if (!port && swconfig_send_mib_names(msg, dev))
+		goto nla_put_failure;
+
+	nla = nla_reserve_64bit(msg, SWITCH_ATTR_OP_VALUE_MIB,
+				struct_size(rec, counters, dev->mibs),
+				SWITCH_ATTR_PAD);
+	if (!nla)
+		goto nla_put_failure;
+
+	rec = nla_data(nla);
+	memset(rec, 0, struct_size(rec, counters, dev->mibs));
+	err = dev->ops->get_port_mib(dev, port, rec->counters, &stamp);
+	if (err) {
+		genlmsg_cancel(msg, hdr);
+		return err;
+	}
+
+	rec->port = port;
+	rec->n_counters = dev->mibs;
+	rec->age_ms = jiffies_to_msecs(jiffies - stamp);
+
+	genlmsg_end(msg, hdr);
+	return 0;
+
+nla_put_failure:
+	genlmsg_cancel(msg, hdr);
+	return -EMSGSIZE;
+}
+
+static int
+swconfig_dump_port_mib(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct genl_dumpit_info *info = genl_dumpit_info(cb);
+	struct switch_dev *dev;
+	int port = cb->args[0];
+	int err = 0;
+
+	dev = swconfig_get_dev(&info->info);
+	if (!dev)
+		return -EINVAL;
+
+	if (!dev->mibs || !dev->ops->get_port_mib || !dev->ops->get_mib_name) {
+		err = -EOPNOTSUPP;
+		goto out;
+	}
+
+	for (; port < dev->ports; port++) {
+		err = swconfig_send_port_mib(skb, NETLINK_CB(cb->skb).portid,
+					     cb->nlh->nlmsg_seq, dev, port);
+		if (err)
+			break;
+	}
+	cb->args[0] = port;
+
+	/* continue in the next message if this one is full */
+	if (err == -EMSGSIZE && skb->len)
+		err = 0;
+
+out:
+	swconfig_put_dev(dev);
+	return err ? err : skb->len;
+}
+
 static int
 swconfig_done(struct netlink_callback *cb)
 {
@@ -1041,6 +1150,11 @@ static struct genl_ops swconfig_ops[] = {
 		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
 		.dumpit = swconfig_dump_switches,
 		.done = swconfig_done,
+	},
+	{
+		.cmd = SWITCH_CMD_GET_PORT_MIB,
+		.dumpit = swconfig_dump_port_mib,
+		.done = swconfig_done,
 	}
 };
 
@@ -1187,6 +1301,19 @@ unregister_switch(struct switch_dev *dev)
 }
 EXPORT_SYMBOL_GPL(unregister_switch);
 
+/*
+ * For drivers that learn about link changes from an interrupt or from the
+ * PHY state machine: the LED trigger updates at once instead of on its next
+ * poll, and polls less while nothing changes. May be called from any context
+ * until unregister_switch() has returned.
+ */
+void
+switch_port_link_changed(struct switch_dev *dev)
+{
+	swconfig_led_link_changed(dev);
+}
+EXPORT_SYMBOL_GPL(switch_port_link_changed);
+
 int
 switch_generic_set_link(struct switch_dev *dev, int port,
 			struct switch_port_link *link)
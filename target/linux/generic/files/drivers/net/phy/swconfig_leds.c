@@ -16,10 +16,22 @@
 #include <linux/ctype.h>
 #include <linux/device.h>
 #include <linux/workqueue.h>
+#include <linux/rcupdate.h>
 
 #define SWCONFIG_LED_TIMER_INTERVAL	(HZ / 10)
 #define SWCONFIG_LED_NUM_PORTS		32
 
+/*
+ * Links are polled every SWCONFIG_LED_TIMER_INTERVAL after a change, and the
+ * interval doubles with every poll that finds them as they were, up to
+ * SWCONFIG_LED_LINK_POLL_MAX. Once the driver has reported a change through
+ * switch_port_link_changed(), polling is only a fallback.
+ */
+#define SWCONFIG_LED_LINK_POLL_MAX	(2 * HZ)
+#define SWCONFIG_LED_LINK_EVENT_MAX	(10 * HZ)
+
+#define SWCONFIG_LED_LINK_EVENT		0	/* flags bit */
+
 #define SWCONFIG_LED_PORT_SPEED_NA	0x01	/* unknown speed */
 #define SWCONFIG_LED_PORT_SPEED_10	0x02	/* 10 Mbps */
 #define SWCONFIG_LED_PORT_SPEED_100	0x04	/* 100 Mbps */
@@ -45,9 +57,23 @@ struct switch_led_trigger {
 	struct delayed_work sw_led_work;
 	u32 port_mask;
 	u32 port_link;
+	u8 mode;			/* of all LEDs using the trigger */
 	unsigned long long port_tx_traffic[SWCONFIG_LED_NUM_PORTS];
 	unsigned long long port_rx_traffic[SWCONFIG_LED_NUM_PORTS];
 	u8 link_speed[SWCONFIG_LED_NUM_PORTS];
+	struct switch_port_link links[SWCONFIG_LED_NUM_PORTS];
+
+	unsigned long flags;
+	bool link_events;		/* the driver reports link changes */
+	unsigned long link_interval;
+	unsigned long link_next;
+
+	/* cost of the polling, shown in poll_stats */
+	unsigned long link_polls;
+	unsigned long link_calls;
+	unsigned long stats_calls;
+	unsigned long events;
+	unsigned long mdio_ops;
 };
 
 struct swconfig_trig_data {
@@ -78,6 +104,7 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 	struct list_head *entry;
 	struct switch_led_trigger *sw_trig;
 	u32 port_mask;
+	u8 mode;
 
 	if (!trigger)
 		return;
@@ -85,6 +112,7 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 	sw_trig = (void *) trigger;
 
 	port_mask = 0;
+	mode = 0;
 	spin_lock(&trigger->leddev_list_lock);
 	list_for_each(entry, &trigger->led_cdevs) {
 		struct led_classdev *led_cdev;
@@ -95,16 +123,22 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 		if (trig_data) {
 			read_lock(&trig_data->lock);
 			port_mask |= trig_data->port_mask;
+			if (trig_data->port_mask)
+				mode |= trig_data->mode;
 			read_unlock(&trig_data->lock);
 		}
 	}
 	spin_unlock(&trigger->leddev_list_lock);
 
 	sw_trig->port_mask = port_mask;
+	sw_trig->mode = mode;
+
+	/* look at the links again right away */
+	sw_trig->link_interval = SWCONFIG_LED_TIMER_INTERVAL;
+	sw_trig->link_next = jiffies;
 
 	if (port_mask)
-		schedule_delayed_work(&sw_trig->sw_led_work,
-				      SWCONFIG_LED_TIMER_INTERVAL);
+		mod_delayed_work(system_wq, &sw_trig->sw_led_work, 0);
 	else
 		cancel_delayed_work_sync(&sw_trig->sw_led_work);
 }
@@ -235,6 +269,7 @@ static ssize_t swconfig_trig_mode_store(struct device *dev,
 	char copybuf[128];
 	int new_mode = -1;
 	char *p, *token;
+	bool changed;
 
 	/* take a copy since we don't want to trash the inbound buffer when using strsep */
 	strncpy(copybuf, buf, sizeof(copybuf));
@@ -264,9 +299,14 @@ static ssize_t swconfig_trig_mode_store(struct device *dev,
 		return -EINVAL;
 
 	write_lock(&trig_data->lock);
+	changed = (trig_data->mode != new_mode);
 	trig_data->mode = (u8)new_mode;
 	write_unlock(&trig_data->lock);
 
+	/* the trigger only reads the traffic counters if an LED blinks */
+	if (changed)
+		swconfig_trig_update_port_mask(led_cdev->trigger);
+
 	return size;
 }
 
@@ -274,6 +314,29 @@ static ssize_t swconfig_trig_mode_store(struct device *dev,
 static DEVICE_ATTR(mode, 0644, swconfig_trig_mode_show,
 		   swconfig_trig_mode_store);
 
+/*
+ * How much the trigger of the switch polls: link polls and the driver calls
+ * they took, stats calls, link changes the driver reported, and the MDIO
+ * transactions counted around the polls for drivers that count them.
+ */
+static ssize_t swconfig_trig_poll_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct led_classdev *led_cdev = dev_get_drvdata(dev);
+	struct switch_led_trigger *sw_trig = (void *) led_cdev->trigger;
+
+	if (!sw_trig)
+		return -ENODEV;
+
+	return sprintf(buf, "link_polls %lu\nlink_calls %lu\nstats_calls %lu\n"
+		       "link_events %lu\nmdio_ops %lu\nlink_interval_ms %u\n",
+		       sw_trig->link_polls, sw_trig->link_calls,
+		       sw_trig->stats_calls, sw_trig->events, sw_trig->mdio_ops,
+		       jiffies_to_msecs(sw_trig->link_interval));
+}
+
+static DEVICE_ATTR(poll_stats, 0444, swconfig_trig_poll_stats_show, NULL);
+
 static int
 swconfig_trig_activate(struct led_classdev *led_cdev)
 {
@@ -306,8 +369,15 @@ swconfig_trig_activate(struct led_classdev *led_cdev)
 	if (err)
 		goto err_mode_free;
 
+	err = device_create_file(led_cdev->dev, &dev_attr_poll_stats);
+	if (err)
+		goto err_poll_stats_free;
+
 	return 0;
 
+err_poll_stats_free:
+	device_remove_file(led_cdev->dev, &dev_attr_mode);
+
 err_mode_free:
 	device_remove_file(led_cdev->dev, &dev_attr_speed_mask);
 
@@ -333,6 +403,7 @@ swconfig_trig_deactivate(struct led_classdev *led_cdev)
 		device_remove_file(led_cdev->dev, &dev_attr_port_mask);
 		device_remove_file(led_cdev->dev, &dev_attr_speed_mask);
 		device_remove_file(led_cdev->dev, &dev_attr_mode);
+		device_remove_file(led_cdev->dev, &dev_attr_poll_stats);
 		kfree(trig_data);
 	}
 }
@@ -428,13 +499,77 @@ swconfig_trig_update_leds(struct switch_led_trigger *sw_trig)
 	spin_unlock(&trigger->leddev_list_lock);
 }
 
+static u8
+swconfig_trig_link_speed(enum switch_port_speed speed)
+{
+	switch (speed) {
+	case SWITCH_PORT_SPEED_UNKNOWN:
+		return SWCONFIG_LED_PORT_SPEED_NA;
+	case SWITCH_PORT_SPEED_10:
+		return SWCONFIG_LED_PORT_SPEED_10;
+	case SWITCH_PORT_SPEED_100:
+		return SWCONFIG_LED_PORT_SPEED_100;
+	case SWITCH_PORT_SPEED_1000:
+		return SWCONFIG_LED_PORT_SPEED_1000;
+	default:
+		return 0;
+	}
+}
+
+/* returns true if a link went up or down or changed its speed */
+static bool
+swconfig_trig_poll_links(struct switch_led_trigger *sw_trig, u32 port_mask)
+{
+	struct switch_dev *swdev = sw_trig->swdev;
+	struct switch_port_link *links = sw_trig->links;
+	bool changed = false;
+	u32 link = 0;
+	u8 speed;
+	int i;
+
+	memset(links, '\0', sizeof(sw_trig->links));
+
+	if (swdev->ops->get_port_links) {
+		swdev->ops->get_port_links(swdev, port_mask, links);
+		sw_trig->link_calls++;
+	} else if (swdev->ops->get_port_link) {
+		for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+			if ((port_mask & BIT(i)) == 0)
+				continue;
+
+			swdev->ops->get_port_link(swdev, i, &links[i]);
+			sw_trig->link_calls++;
+		}
+	}
+
+	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+		speed = 0;
+		if ((port_mask & BIT(i)) && links[i].link) {
+			link |= BIT(i);
+			speed = swconfig_trig_link_speed(links[i].speed);
+		}
+
+		if (speed != sw_trig->link_speed[i])
+			changed = true;
+		sw_trig->link_speed[i] = speed;
+	}
+
+	if (link != sw_trig->port_link)
+		changed = true;
+	sw_trig->port_link = link;
+	sw_trig->link_polls++;
+
+	return changed;
+}
+
 static void
 swconfig_led_work_func(struct work_struct *work)
 {
 	struct switch_led_trigger *sw_trig;
 	struct switch_dev *swdev;
-	u32 port_mask;
-	u32 link;
+	unsigned long mdio_ops, delay, max_interval;
+	u32 port_mask, stats_mask;
+	bool event;
 	int i;
 
 	sw_trig = container_of(work, struct switch_led_trigger,
@@ -442,62 +577,81 @@ swconfig_led_work_func(struct work_struct *work)
 
 	port_mask = sw_trig->port_mask;
 	swdev = sw_trig->swdev;
+	if (!port_mask)
+		return;
 
-	link = 0;
-	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
-		u32 port_bit;
+	mdio_ops = swdev->mdio_ops;
 
-		sw_trig->link_speed[i] = 0;
+	event = test_and_clear_bit(SWCONFIG_LED_LINK_EVENT, &sw_trig->flags);
+	if (event || time_after_eq(jiffies, sw_trig->link_next)) {
+		max_interval = sw_trig->link_events ?
+			       SWCONFIG_LED_LINK_EVENT_MAX :
+			       SWCONFIG_LED_LINK_POLL_MAX;
 
-		port_bit = BIT(i);
-		if ((port_mask & port_bit) == 0)
-			continue;
+		if (swconfig_trig_poll_links(sw_trig, port_mask) || event)
+			sw_trig->link_interval = SWCONFIG_LED_TIMER_INTERVAL;
+		else
+			sw_trig->link_interval = min(sw_trig->link_interval * 2,
+						     max_interval);
 
-		if (swdev->ops->get_port_link) {
-			struct switch_port_link port_link;
-
-			memset(&port_link, '\0', sizeof(port_link));
-			swdev->ops->get_port_link(swdev, i, &port_link);
-
-			if (port_link.link) {
-				link |= port_bit;
-				switch (port_link.speed) {
-				case SWITCH_PORT_SPEED_UNKNOWN:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_NA;
-					break;
-				case SWITCH_PORT_SPEED_10:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_10;
-					break;
-				case SWITCH_PORT_SPEED_100:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_100;
-					break;
-				case SWITCH_PORT_SPEED_1000:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_1000;
-					break;
-				}
-			}
-		}
+		sw_trig->link_next = jiffies + sw_trig->link_interval;
+	}
 
-		if (swdev->ops->get_port_stats) {
-			struct switch_port_stats port_stats;
+	/* traffic only matters to blinking LEDs, and on ports with a link */
+	stats_mask = 0;
+	if ((sw_trig->mode & SWCONFIG_LED_MODE_TXRX) && swdev->ops->get_port_stats) {
+		stats_mask = port_mask;
+		if (swdev->ops->get_port_links || swdev->ops->get_port_link)
+			stats_mask &= sw_trig->port_link;
+	}
 
-			memset(&port_stats, '\0', sizeof(port_stats));
-			swdev->ops->get_port_stats(swdev, i, &port_stats);
-			sw_trig->port_tx_traffic[i] = port_stats.tx_bytes;
-			sw_trig->port_rx_traffic[i] = port_stats.rx_bytes;
-		}
+	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+		struct switch_port_stats port_stats;
+
+		if ((stats_mask & BIT(i)) == 0)
+			continue;
+
+		memset(&port_stats, '\0', sizeof(port_stats));
+		swdev->ops->get_port_stats(swdev, i, &port_stats);
+		sw_trig->port_tx_traffic[i] = port_stats.tx_bytes;
+		sw_trig->port_rx_traffic[i] = port_stats.rx_bytes;
+		sw_trig->stats_calls++;
 	}
 
-	sw_trig->port_link = link;
+	/* also counts what other users of the bus did meanwhile */
+	sw_trig->mdio_ops += swdev->mdio_ops - mdio_ops;
 
 	swconfig_trig_update_leds(sw_trig);
 
-	schedule_delayed_work(&sw_trig->sw_led_work,
-			      SWCONFIG_LED_TIMER_INTERVAL);
+	delay = SWCONFIG_LED_TIMER_INTERVAL;
+	if (!stats_mask)
+		delay = time_after(sw_trig->link_next, jiffies) ?
+			sw_trig->link_next - jiffies : 0;
+
+	schedule_delayed_work(&sw_trig->sw_led_work, delay);
+}
+
+/*
+ * May run in any context, also while the switch is unregistered: the
+ * trigger is looked up under RCU, and swconfig_destroy_led_trigger() waits
+ * for a grace period before it stops the work for good.
+ */
+static void
+swconfig_led_link_changed(struct switch_dev *swdev)
+{
+	struct switch_led_trigger *sw_trig;
+
+	rcu_read_lock();
+	sw_trig = rcu_dereference(swdev->led_trigger);
+	if (sw_trig) {
+		sw_trig->link_events = true;
+		sw_trig->events++;
+		set_bit(SWCONFIG_LED_LINK_EVENT, &sw_trig->flags);
+
+		if (sw_trig->port_mask)
+			mod_delayed_work(system_wq, &sw_trig->sw_led_work, 0);
+	}
+	rcu_read_unlock();
 }
 
 static int
@@ -517,6 +671,8 @@ swconfig_create_led_trigger(struct switch_dev *swdev)
 	sw_trig->trig.name = swdev->devname;
 	sw_trig->trig.activate = swconfig_trig_activate;
 	sw_trig->trig.deactivate = swconfig_trig_deactivate;
+	sw_trig->link_interval = SWCONFIG_LED_TIMER_INTERVAL;
+	sw_trig->link_next = jiffies;
 
 	INIT_DELAYED_WORK(&sw_trig->sw_led_work, swconfig_led_work_func);
 
@@ -524,7 +680,7 @@ swconfig_create_led_trigger(struct switch_dev *swdev)
 	if (err)
 		goto err_free;
 
-	swdev->led_trigger = sw_trig;
+	rcu_assign_pointer(swdev->led_trigger, sw_trig);
 
 	return 0;
 
@@ -538,10 +694,13 @@ swconfig_destroy_led_trigger(struct switch_dev *swdev)
 {
 	struct switch_led_trigger *sw_trig;
 
-	sw_trig = swdev->led_trigger;
+	sw_trig = rcu_dereference_protected(swdev->led_trigger, true);
 	if (sw_trig) {
-		cancel_delayed_work_sync(&sw_trig->sw_led_work);
+		RCU_INIT_POINTER(swdev->led_trigger, NULL);
+		synchronize_rcu();
+		/* deactivating the LEDs may queue the work again */
 		led_trigger_unregister(&sw_trig->trig);
+		cancel_delayed_work_sync(&sw_trig->sw_led_work);
 		kfree(sw_trig);
 	}
 }
@@ -552,4 +711,7 @@ swconfig_create_led_trigger(struct switch_dev *swdev) { return 0; }
 
 static inline void
 swconfig_destroy_led_trigger(struct switch_dev *swdev) { }
+
+static inline void
+swconfig_led_link_changed(struct switch_dev *swdev) { }
 #endif /* CONFIG_SWCONFIG_LEDS */
@@ -80,6 +80,16 @@ struct switch_port_stats {
  *
  * @apply_config: apply all changed settings to the switch
  * @reset_switch: resetting the switch
+ *
+ * @get_port_links: read the link state of all ports in a mask at once, as
+ *	cheaply as the hardware allows; links[port] is filled for each port in
+ *	the mask that the switch has, though details that cost extra bus
+ *	accesses (such as eee) may be left out. Optional, get_port_link is
+ *	used per port otherwise
+ *
+ * @get_port_mib: copy the cached MIB counters of a port (dev->mibs entries)
+ *	without touching the hardware, @stamp is the jiffies of the last refresh
+ * @get_mib_name: get the name of a MIB counter
  */
 struct switch_dev_ops {
 	struct switch_attrlist attr_global, attr_port, attr_vlan;
@@ -95,11 +105,17 @@ struct switch_dev_ops {
 
 	int (*get_port_link)(struct switch_dev *dev, int port,
 			     struct switch_port_link *link);
+	int (*get_port_links)(struct switch_dev *dev, u32 port_mask,
+			      struct switch_port_link *links);
 	int (*set_port_link)(struct switch_dev *dev, int port,
 			     struct switch_port_link *link);
 	int (*get_port_stats)(struct switch_dev *dev, int port,
 			      struct switch_port_stats *stats);
 
+	int (*get_port_mib)(struct switch_dev *dev, int port, u64 *counters,
+			    unsigned long *stamp);
+	const char *(*get_mib_name)(struct switch_dev *dev, int idx);
+
 	int (*phy_read16)(struct switch_dev *dev, int addr, u8 reg, u16 *value);
 	int (*phy_write16)(struct switch_dev *dev, int addr, u8 reg, u16 value);
 };
@@ -118,6 +134,10 @@ struct switch_dev {
 	unsigned int ports;
 	unsigned int vlans;
 	unsigned int cpu_port;
+	/* number of counters in a MIB snapshot, 0 if not supported */
+	unsigned int mibs;
+	/* MDIO transactions the driver issued, if it counts them */
+	unsigned long mdio_ops;
 
 	/* the following fields are internal for swconfig */
 	unsigned int id;
@@ -132,7 +152,7 @@ struct switch_dev {
 	char buf[128];
 
 #ifdef CONFIG_SWCONFIG_LEDS
-	struct switch_led_trigger *led_trigger;
+	struct switch_led_trigger __rcu *led_trigger;
 #endif
 };
 
@@ -173,6 +193,7 @@ struct switch_attr {
 	int max;
 };
 
+void switch_port_link_changed(struct switch_dev *dev);
 int switch_generic_set_link(struct switch_dev *dev, int port,
 			    struct switch_port_link *link);
 
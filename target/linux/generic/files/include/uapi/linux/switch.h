@@ -54,6 +54,10 @@ enum {
 	SWITCH_ATTR_OP_DESCRIPTION,
 	/* port lists */
 	SWITCH_ATTR_PORT,
+	/* MIB snapshots */
+	SWITCH_ATTR_PAD,
+	SWITCH_ATTR_OP_VALUE_MIB,
+	SWITCH_ATTR_OP_MIB_NAMES,
 	SWITCH_ATTR_MAX
 };
 
@@ -78,7 +82,8 @@ enum {
 	SWITCH_CMD_SET_PORT,
 	SWITCH_CMD_LIST_VLAN,
 	SWITCH_CMD_GET_VLAN,
-	SWITCH_CMD_SET_VLAN
+	SWITCH_CMD_SET_VLAN,
+	SWITCH_CMD_GET_PORT_MIB
 };
 
 /* data types */
@@ -113,6 +118,21 @@ enum {
 	SWITCH_LINK_ATTR_MAX,
 };
 
+/*
+ * Per-port MIB snapshot, carried as binary payload of
+ * SWITCH_ATTR_OP_VALUE_MIB in SWITCH_CMD_GET_PORT_MIB dump messages.
+ * The counters are in the order of the names sent in
+ * SWITCH_ATTR_OP_MIB_NAMES with the first record.
+ */
+struct switch_mib_record {
+	__u32 port;
+	__u32 n_counters;
+	/* time since the driver refreshed the snapshot */
+	__u32 age_ms;
+	__u32 reserved;
+	__u64 counters[];
+};
+
 #define SWITCH_ATTR_DEFAULTS_OFFSET	0x1000
 
 
@@ -0,0 +1,120 @@
+/*
+ * Host harness for the loader's LZMA decoder
+ *
+ * Decodes an LZMA image (as made for the loader by the image recipes) with
+ * LzmaDecode built for an input callback that returns one byte per call,
+ * as the loader did before, and built for a flat input buffer, as it does
+ * now. Both outputs are compared and the decode time of each is printed.
+ *
+ * This is free software, licensed under the GNU General Public License v2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "LzmaDecode.h"
+
+typedef struct {
+	int (*Read)(void *object, const unsigned char **buffer, SizeT *bufferSize);
+} ILzmaInCallbackCB;
+
+int LzmaDecodeCB(CLzmaDecoderState *vs, ILzmaInCallbackCB *inCallback,
+		 unsigned char *outStream, SizeT outSize, SizeT *outSizeProcessed);
+
+static const unsigned char *data;
+
+static int read_byte(void *object, const unsigned char **buffer, SizeT *bufferSize)
+{
+	*bufferSize = 1;
+	*buffer = data;
+	++data;
+	return LZMA_RESULT_OK;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	ILzmaInCallbackCB callback = { read_byte };
+	unsigned char *in, *out_cb, *out_buf;
+	double t, t_cb = 0, t_buf = 0;
+	CLzmaDecoderState vs;
+	SizeT osize, done, used;
+	int i, iter = 10;
+	long isize;
+	FILE *f;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <file.lzma> [iterations]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2)
+		iter = atoi(argv[2]);
+
+	f = fopen(argv[1], "rb");
+	if (!f || fseek(f, 0, SEEK_END) || (isize = ftell(f)) < 13) {
+		perror(argv[1]);
+		return 1;
+	}
+	rewind(f);
+	in = malloc(isize);
+	if (!in || fread(in, 1, isize, f) != isize) {
+		perror(argv[1]);
+		return 1;
+	}
+	fclose(f);
+
+	/* same header parsing as the loader */
+	i = in[0];
+	vs.Properties.lc = i % 9, i = i / 9;
+	vs.Properties.lp = i % 5, vs.Properties.pb = i / 5;
+	osize = in[5] | in[6] << 8 | in[7] << 16 | (SizeT)in[8] << 24;
+
+	vs.Probs = malloc(LzmaGetNumProbs(&vs.Properties) * sizeof(CProb));
+	out_cb = malloc(osize);
+	out_buf = malloc(osize);
+	if (!vs.Probs || !out_cb || !out_buf)
+		return 1;
+
+	for (i = 0; i < iter; i++) {
+		data = in + 13;
+		t = now();
+		if (LzmaDecodeCB(&vs, &callback, out_cb, osize, &done) != LZMA_RESULT_OK ||
+		    done != osize) {
+			fprintf(stderr, "callback decode failed\n");
+			return 1;
+		}
+		t_cb += now() - t;
+
+		t = now();
+		if (LzmaDecode(&vs, in + 13, isize - 13, &used, out_buf, osize, &done) != LZMA_RESULT_OK ||
+		    done != osize) {
+			fprintf(stderr, "buffer decode failed\n");
+			return 1;
+		}
+		t_buf += now() - t;
+	}
+
+	if (memcmp(out_cb, out_buf, osize)) {
+		fprintf(stderr, "outputs differ\n");
+		return 1;
+	}
+
+	printf("%s: %ld -> %lu bytes, %d iterations\n", argv[1], isize,
+	       (unsigned long)osize, iter);
+	printf("callback: %8.2f ms/decode %8.2f MB/s\n", t_cb * 1e3 / iter,
+	       osize * iter / t_cb / 1e6);
+	printf("buffer:   %8.2f ms/decode %8.2f MB/s\n", t_buf * 1e3 / iter,
+	       osize * iter / t_buf / 1e6);
+	printf("buffer/callback time: %.3f\n", t_buf / t_cb);
+
+	return 0;
+}
@@ -32,6 +32,9 @@
  *
  * ??-Nov-2005 Mike Baker
  *   reorder the script as an lzma wrapper; do not depend on flash access
+ *
+ * The compressed kernel is linked into the loader, so hand the decoder
+ * the whole buffer instead of feeding it one byte per callback.
  */
 
 #include "LzmaDecode.h"
@@ -80,20 +83,9 @@ static __inline__ void blast_dcache(unsigned long size, unsigned long lsize)
 
 unsigned char *data;
 
-static int read_byte(void *object, unsigned char **buffer, UInt32 *bufferSize)
-{
-	*bufferSize = 1;
-	*buffer = data;
-	++data;
-	return LZMA_RESULT_OK;
-}
-
 static __inline__ unsigned char get_byte(void)
 {
-	unsigned char *buffer;
-	UInt32 fake;
-	
-	return read_byte(0, &buffer, &fake), *buffer;
+	return *data++;
 }
 
 /* This puts lzma workspace 128k below RAM end. 
@@ -109,6 +101,7 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 {
 	unsigned int i;  /* temp value */
 	unsigned int osize; /* uncompressed size */
+	SizeT isize; /* compressed size, without the header */
 	volatile unsigned int arg0, arg1, arg2, arg3;
 
 	/* restore argument registers */
@@ -117,11 +110,9 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 	__asm__ __volatile__ ("ori %0, $14, 0":"=r"(arg2));
 	__asm__ __volatile__ ("ori %0, $15, 0":"=r"(arg3));
 
-	ILzmaInCallback callback;
 	CLzmaDecoderState vs;
-	callback.Read = read_byte;
 
-	data = lzma_start;
+	data = (unsigned char *)lzma_start;
 
 	/* lzma args */
 	i = get_byte();
@@ -144,8 +135,10 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 	for (i = 0; i < 4; i++) 
 		get_byte();
 
+	isize = (unsigned char *)lzma_end - data;
+
 	/* decompress kernel */
-	if ((i = LzmaDecode(&vs, &callback,
+	if ((i = LzmaDecode(&vs, data, isize, &isize,
 	(unsigned char*)KERNEL_ENTRY, osize, &osize)) == LZMA_RESULT_OK)
 	{
 		blast_dcache(dcache_size, dcache_lsize);